@@ -18,16 +18,36 @@
   extern uint32_t SystemCoreClock;
 #endif
 
+/* Build mode: 1 = tasks, queues, kernel task stacks and profiler buffers are
+ * statically allocated and the heap is left to the application
+ * (make STATIC_ALLOC=1) */
+#ifndef PROFILER_STATIC_ALLOCATION
+#define PROFILER_STATIC_ALLOCATION               0
+#endif
+
 #define configUSE_PREEMPTION                     1
-#define configSUPPORT_STATIC_ALLOCATION          0
+#define configSUPPORT_STATIC_ALLOCATION          PROFILER_STATIC_ALLOCATION
 #define configSUPPORT_DYNAMIC_ALLOCATION         1
 #define configUSE_IDLE_HOOK                      1
 #define configUSE_TICK_HOOK                      1
 #define configCPU_CLOCK_HZ                       ( SystemCoreClock )
 #define configTICK_RATE_HZ                       ((TickType_t)1000)
 #define configMAX_PRIORITIES                     ( 7 )
+/* Stack and heap sizes may come from a sizing header (make SIZING=<header>) */
+#ifndef configMINIMAL_STACK_SIZE
 #define configMINIMAL_STACK_SIZE                 ((uint16_t)128)
-#define configTOTAL_HEAP_SIZE                    ((size_t)15360)
+#endif
+#ifndef configTOTAL_HEAP_SIZE
+#if PROFILER_STATIC_ALLOCATION
+#define configTOTAL_HEAP_SIZE                    ((size_t)4096)    /* Application only */
+#else
+/* ~26 KB at boot: 7 task stacks 8704 B, idle + timer stacks 1536 B, 9 TCBs
+ * ~830 B, profiler queue 10 x sizeof(SystemReport_t) (1432 B) ~14.4 KB, timer
+ * queue and UART mutex ~320 B, heap_4 block headers. The rest is headroom for
+ * the profiler's TaskStatus_t snapshot and workload tasks. */
+#define configTOTAL_HEAP_SIZE                    ((size_t)32768)
+#endif
+#endif
 #define configMAX_TASK_NAME_LEN                  ( 16 )
 #define configUSE_TRACE_FACILITY                 1
 #define configUSE_16_BIT_TICKS                   0
@@ -45,7 +65,9 @@
 #define configUSE_TIMERS                         1
 #define configTIMER_TASK_PRIORITY                ( 2 )
 #define configTIMER_QUEUE_LENGTH                 10
+#ifndef configTIMER_TASK_STACK_DEPTH
 #define configTIMER_TASK_STACK_DEPTH             256
+#endif
 
 /* IMPORTANT for system profiling */
 #define configGENERATE_RUN_TIME_STATS            1
@@ -54,7 +76,20 @@
 /* Runtime stats timer configuration */
 extern volatile uint32_t ulHighFrequencyTimerTicks;
 #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() (ulHighFrequencyTimerTicks = 0)
-#define portGET_RUN_TIME_COUNTER_VALUE()         ulHighFrequencyTimerTicks
+#define portGET_RUN_TIME_COUNTER_VALUE()         (ulHighFrequencyTimerTicks << PROFILER_RUN_TIME_SHIFT)
+
+/* Wrap test build (make WRAP_TEST=1): the tick starts 65.5 s before its
+ * 32-bit wrap and the run-time counter counts 2^16 per tick, so both wrap
+ * within the first minutes instead of after 49.7 days */
+#ifndef PROFILER_WRAP_TEST
+#define PROFILER_WRAP_TEST                       0
+#endif
+#if PROFILER_WRAP_TEST
+#define configINITIAL_TICK_COUNT                 ((TickType_t)0xFFFF0000UL)
+#define PROFILER_RUN_TIME_SHIFT                  16
+#else
+#define PROFILER_RUN_TIME_SHIFT                  0
+#endif
 
 /* Set the following definitions to 1 to include the API function, or zero
 to exclude the API function. */
@@ -70,6 +105,7 @@ to exclude the API function. */
 #define INCLUDE_xQueueGetMutexHolder             1
 #define INCLUDE_uxTaskGetStackHighWaterMark      1
 #define INCLUDE_eTaskGetState                    1
+#define INCLUDE_xTaskGetCurrentTaskHandle        1
 
 /* Cortex-M specific definitions. */
 #ifdef __NVIC_PRIO_BITS
@@ -108,4 +144,69 @@ header file. */
 /* IMPORTANT: This macro enables systick hook */
 #define xPortSysTickHandler SysTick_Handler
 
+/* Queue / semaphore / mutex instrumentation. Each object keeps its
+   queue_trace slot in uxQueueNumber and each task its block-timing index in
+   uxTaskNumber; the delete hooks give both back. The send/receive hooks run
+   before the kernel updates uxMessagesWaiting. Task create/delete also feed
+   the stack monitor's registry (pxEndOfStack needs
+   configRECORD_STACK_HIGH_ADDRESS); delete releases the PC sampler's task
+   slot. */
+#define configRECORD_STACK_HIGH_ADDRESS          1
+#define STACK_MONITOR_HOOKED                     1
+
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+  #include "queue_trace.h"
+  #include "mutex_trace.h"
+  #include "burst_capture.h"
+  #include "stack_monitor.h"
+  #include "pc_sampler.h"
+
+  #define traceTASK_CREATE( pxNewTCB ) \
+      do { \
+          ( pxNewTCB )->uxTaskNumber = QueueTrace_TaskCreate(); \
+          StackMonitor_TaskCreated( ( void * ) ( pxNewTCB ), ( void * ) ( pxNewTCB )->pxStack, \
+                                    ( void * ) ( pxNewTCB )->pxEndOfStack ); \
+      } while( 0 )
+  #define traceTASK_DELETE( pxTCB ) \
+      do { \
+          QueueTrace_TaskDeleted( ( pxTCB )->uxTaskNumber ); \
+          StackMonitor_TaskDeleted( ( void * ) ( pxTCB ) ); \
+          PcSampler_TaskDeleted( ( void * ) ( pxTCB ) ); \
+      } while( 0 )
+  #define traceQUEUE_CREATE( pxNewQueue ) \
+      ( pxNewQueue )->uxQueueNumber = QueueTrace_Create( ( void * ) ( pxNewQueue ), \
+          ( pxNewQueue )->uxLength, ( pxNewQueue )->ucQueueType )
+  #define traceQUEUE_DELETE( pxQueue ) \
+      QueueTrace_Delete( ( pxQueue )->uxQueueNumber )
+
+  #define traceQUEUE_SEND( pxQueue ) \
+      QueueTrace_Send( ( pxQueue )->uxQueueNumber, ( pxQueue )->uxMessagesWaiting + 1, 0 )
+  #define traceQUEUE_SEND_FROM_ISR( pxQueue ) \
+      QueueTrace_Send( ( pxQueue )->uxQueueNumber, ( pxQueue )->uxMessagesWaiting + 1, 1 )
+  #define traceQUEUE_SEND_FAILED( pxQueue ) \
+      QueueTrace_SendFailed( ( pxQueue )->uxQueueNumber, 0 )
+  #define traceQUEUE_SEND_FROM_ISR_FAILED( pxQueue ) \
+      QueueTrace_SendFailed( ( pxQueue )->uxQueueNumber, 1 )
+  #define traceBLOCKING_ON_QUEUE_SEND( pxQueue ) \
+      QueueTrace_Block( ( pxQueue )->uxQueueNumber, 0 )
+
+  #define traceQUEUE_RECEIVE( pxQueue ) \
+      QueueTrace_Receive( ( pxQueue )->uxQueueNumber, ( pxQueue )->uxMessagesWaiting - 1, 0 )
+  #define traceQUEUE_RECEIVE_FROM_ISR( pxQueue ) \
+      QueueTrace_Receive( ( pxQueue )->uxQueueNumber, ( pxQueue )->uxMessagesWaiting - 1, 1 )
+  #define traceQUEUE_RECEIVE_FAILED( pxQueue ) \
+      QueueTrace_ReceiveFailed( ( pxQueue )->uxQueueNumber, 0 )
+  #define traceQUEUE_RECEIVE_FROM_ISR_FAILED( pxQueue ) \
+      QueueTrace_ReceiveFailed( ( pxQueue )->uxQueueNumber, 1 )
+  #define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue ) \
+      QueueTrace_Block( ( pxQueue )->uxQueueNumber, 1 )
+
+  #define traceTASK_PRIORITY_INHERIT( pxTCBOfMutexHolder, uxInheritedPriority ) \
+      MutexTrace_PriorityInherit()
+
+  /* Idle-time accounting for the burst capture load samples */
+  #define traceTASK_SWITCHED_IN() \
+      BurstCapture_TaskSwitchedIn( pxCurrentTCB->uxPriority )
+#endif
+
 #endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,65 @@
+/**
+  ******************************************************************************
+  * @file    analog_monitor.h
+  * @brief   Analog Monitor - Die temperature, VDDA and VBAT via ADC1 scan + DMA
+  ******************************************************************************
+  */
+
+#ifndef __ANALOG_MONITOR_H
+#define __ANALOG_MONITOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Sampling configuration */
+#define ANALOG_OVERSAMPLE               64      /* Scan pairs averaged per block */
+#define ANALOG_VBAT_EVERY               1000    /* Temperature blocks between VBAT blocks */
+#define ANALOG_TEMP_FILTER_SHIFT        2       /* EMA weight 1/4 on top of oversampling */
+
+/* Below the kernel-aware range; the handlers make no RTOS API calls */
+#define ANALOG_IRQ_PRIORITY             7
+
+/* Factory calibration (RM0368 / DS10086), taken at VDDA = 3.3 V */
+#define ANALOG_VREFINT_CAL_ADDR         ((const uint16_t *)0x1FFF7A2AUL)
+#define ANALOG_TS_CAL1_ADDR             ((const uint16_t *)0x1FFF7A2CUL)   /* 30 degC */
+#define ANALOG_TS_CAL2_ADDR             ((const uint16_t *)0x1FFF7A2EUL)   /* 110 degC */
+#define ANALOG_CAL_VDDA_MV              3300
+#define ANALOG_TS_CAL1_C                30
+#define ANALOG_TS_CAL2_C                110
+#define ANALOG_VBAT_DIVIDER             4       /* VBAT is sampled through a /4 bridge */
+
+/* Latest calibrated values (0 until the first block completes) */
+typedef struct {
+    int32_t tempCentiC;         /* Die temperature, 0.01 degC */
+    uint32_t vddaMv;            /* Analog supply from VREFINT */
+    uint32_t vbatMv;            /* Backup domain supply */
+    uint32_t blocks;            /* Completed oversampling blocks */
+    uint32_t restarts;          /* ADC overrun / DMA error recoveries */
+} AnalogReadings_t;
+
+/*
+ * ADC1 converts VREFINT (IN17) and IN18 back to back, continuously, into a
+ * circular DMA buffer. Each half-buffer is one block of ANALOG_OVERSAMPLE
+ * pairs, averaged and calibrated in the DMA interrupt. IN18 is the
+ * temperature sensor except for one block every ANALOG_VBAT_EVERY, when
+ * VBATE switches it to VBAT; the block straddling each switch is only
+ * used for VDDA. Readings are published as single words, so reading them
+ * costs a few loads and never waits on the ADC.
+ */
+
+/* Function prototypes */
+void AnalogMonitor_Init(void);
+void AnalogMonitor_Suspend(void);
+void AnalogMonitor_Resume(void);
+void AnalogMonitor_GetReadings(AnalogReadings_t *readings);
+void AnalogMonitor_DmaIrq(void);
+void AnalogMonitor_AdcIrq(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANALOG_MONITOR_H */
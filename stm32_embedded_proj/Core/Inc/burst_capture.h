@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file    burst_capture.h
+  * @brief   Burst Capture - Pre/post-trigger sample window on threshold events
+  ******************************************************************************
+  * @attention
+  *
+  * traceTASK_SWITCHED_IN in FreeRTOSConfig.h calls
+  * BurstCapture_TaskSwitchedIn() with the priority as a plain uint32_t;
+  * nothing here needs the kernel headers.
+  *
+  ******************************************************************************
+  */
+
+#ifndef __BURST_CAPTURE_H
+#define __BURST_CAPTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Capture configuration */
+#define BURST_SAMPLE_MS                 10      /* Ring resolution (tick hook) */
+#define BURST_RING_SIZE                 64      /* Samples in a captured window */
+#define BURST_PRE_SAMPLES               32      /* Of which before the trigger */
+
+/* Default trigger: CPU load above 80% */
+#define BURST_DEFAULT_FIELD             BURST_FIELD_CPU_LOAD
+#define BURST_DEFAULT_OP                BURST_OP_ABOVE
+#define BURST_DEFAULT_THRESHOLD         80
+
+/* SystemReport_t fields the ring mirrors; names match the JSON keys */
+typedef enum {
+    BURST_FIELD_CPU_LOAD = 0,           /* Percent */
+    BURST_FIELD_HEAP_FREE,              /* Bytes */
+    BURST_FIELD_HEAP_MIN,               /* Bytes */
+    BURST_FIELD_COUNT
+} BurstField_t;
+
+typedef enum {
+    BURST_OP_ABOVE = 0,                 /* '>' */
+    BURST_OP_BELOW                      /* '<' */
+} BurstOp_t;
+
+/* One ring entry */
+typedef struct {
+    uint32_t tick;
+    uint32_t heapFree;
+    uint32_t heapMin;
+    uint16_t cpuPermille;               /* Busy time over the last BURST_SAMPLE_MS */
+} BurstSample_t;
+
+/*
+ * Stream format (one captured window, text lines):
+ *   #bst <seq> <trigger_tick> <field><op><threshold> <period_ms> <samples>
+ *   #bs <tick> <cpu_pct> <heap_free> <heap_min>    (oldest first)
+ *   #bse
+ * The trigger sample is the (BURST_PRE_SAMPLES + 1)th #bs line.
+ */
+
+/* Function prototypes */
+void BurstCapture_Init(void);
+uint8_t BurstCapture_SetTrigger(uint8_t field, uint8_t op, uint32_t threshold);
+void BurstCapture_Disable(void);
+const char *BurstCapture_FieldName(uint8_t field);
+void BurstCapture_Tick(void);
+void BurstCapture_TaskSwitchedIn(uint32_t ulPriority);
+void BurstCapture_Stream(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BURST_CAPTURE_H */
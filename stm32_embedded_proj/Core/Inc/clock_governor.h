@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file    clock_governor.h
+  * @brief   Load-driven Dynamic Frequency Scaling Governor
+  ******************************************************************************
+  */
+
+#ifndef __CLOCK_GOVERNOR_H
+#define __CLOCK_GOVERNOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Operating points, ordered from slowest to fastest */
+typedef enum {
+    CLOCK_OPP_LOW = 0,     /* 16 MHz HSI, PLL off, voltage scale 3 */
+    CLOCK_OPP_MID = 1,     /* 42 MHz PLL, voltage scale 3 */
+    CLOCK_OPP_HIGH = 2,    /* 84 MHz PLL, voltage scale 2 (boot default) */
+    CLOCK_OPP_COUNT
+} ClockOpp_t;
+
+/* Governor policy */
+#define CLOCK_GOV_UP_THRESHOLD      70.0f  /* Jump to HIGH when load exceeds this */
+#define CLOCK_GOV_DOWN_THRESHOLD    50.0f  /* Step down when projected load stays below this */
+#define CLOCK_GOV_DOWN_SAMPLES      20     /* Consecutive low samples required (2s at 100ms) */
+
+/* Governor statistics */
+typedef struct {
+    ClockOpp_t currentOpp;                    /* Active operating point */
+    uint32_t ulFrequencyHz;                   /* Current HCLK */
+    uint32_t ulSwitchCount;                   /* Number of operating point changes */
+    uint32_t ulResidencyMs[CLOCK_OPP_COUNT];  /* Time spent in each operating point */
+} ClockGovernorStats_t;
+
+/* Function prototypes */
+void ClockGovernor_Init(void);
+void ClockGovernor_Update(float cpuLoad);
+void ClockGovernor_SetOpp(ClockOpp_t opp);
+void ClockGovernor_OnClockReset(void);
+ClockOpp_t ClockGovernor_GetCurrentOpp(void);
+uint32_t ClockGovernor_GetFrequencyHz(void);
+void ClockGovernor_GetStats(ClockGovernorStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_GOVERNOR_H */
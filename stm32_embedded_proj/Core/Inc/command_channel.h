@@ -0,0 +1,68 @@
+/**
+  ******************************************************************************
+  * @file    command_channel.h
+  * @brief   UART Command Channel - Runtime reconfiguration over USART2 RX
+  ******************************************************************************
+  */
+
+#ifndef __COMMAND_CHANNEL_H
+#define __COMMAND_CHANNEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Buffer sizes */
+#define COMMAND_RX_CHUNK_SIZE     32     /* Idle-line reception chunk */
+#define COMMAND_RX_RING_SIZE      128    /* ISR -> task byte ring (power of 2) */
+#define COMMAND_LINE_MAX          48     /* Longest accepted command line */
+
+/*
+ * Commands (newline terminated, replies "OK" or "ERR <reason>"):
+ *   rate <ms>                  Sample period (PROFILER_MIN/MAX_SAMPLE_MS)
+ *   every <n>                  Samples per periodic report (1-255)
+ *   format pretty|compact|binary
+ *   pause | resume             Suppress / restore periodic reports
+ *   dump [n]                   Queue the n most recent buffered samples
+ *   reset                      Reset TestMetrics
+ *   fields <hex>               Top-level field mask (REPORT_FIELD_x)
+ *   taskfields <hex>           Per-task field mask (TASK_FIELD_x)
+ *   tasks <name,...>|*         Task filter (up to REPORT_TASK_FILTER_MAX)
+ *   verbose <0|1>              Status message verbosity
+ *   baud <rate>                Switch link rate; confirm with any command
+ *                              at the new rate (TRANSPORT_CONFIRM_TIMEOUT_MS)
+ *   ping                       Replies "pong"
+ *   sample <hz>                PC sampling rate (PC_SAMPLER_MIN/MAX_HZ), 0 = off
+ *   trigger <field><op><n>|off Burst capture condition, e.g. cpu_load>80,
+ *                              heap_free<4096 (fields: cpu_load, heap_free, heap_min)
+ *   budget <pct>               Profiler self-overhead budget (0-OVERHEAD_MAX_BUDGET_PCT),
+ *                              0 = account only, never throttle
+ *   load <n> [duty] [period]|off
+ *                              Spawn n synthetic workers (WORKLOAD_MAX_TASKS),
+ *                              duty 1-100 %, period 1-1000 ms; ERR if the heap
+ *                              could not fit all n (the ones that fit keep running)
+ *   sweep <start> <end> [step] Measure profiler cost/accuracy per N, "#wl" lines
+ *   loadmode [rt|idle|cmp]     CPU load estimator: run-time stats, calibrated idle
+ *                              count, or both with the idle error and cost tracked;
+ *                              no argument writes a "#ld" status line
+ *   sizing                     Stack/heap/queue size recommendation from the peaks
+ *                              seen since boot, "#sz" lines (see sizing_advisor.h)
+ *   isrbench [bursts] [len]    Time ISR -> task event bursts through a queue and
+ *                              through the ISR event ring, "#ib" lines (see isr_event.h)
+ */
+
+/* Function prototypes */
+void CommandChannel_Init(TaskHandle_t xNotifyTask);
+uint8_t CommandChannel_ReadLine(char *line, size_t lineSize, TickType_t xTimeout);
+void CommandChannel_Execute(char *line);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __COMMAND_CHANNEL_H */
@@ -0,0 +1,50 @@
+/**
+  ******************************************************************************
+  * @file    energy_model.h
+  * @brief   Software Energy Estimation Model
+  ******************************************************************************
+  */
+
+#ifndef __ENERGY_MODEL_H
+#define __ENERGY_MODEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "clock_governor.h"
+
+/* Board current table selection (see energy_model.c) */
+#if !defined(ENERGY_BOARD_NUCLEO_F401RE)
+#define ENERGY_BOARD_NUCLEO_F401RE
+#endif
+
+/* Per-board current draw table (MCU supply, in microamps) */
+typedef struct {
+    uint32_t ulRunCurrentUA[CLOCK_OPP_COUNT];    /* Run mode, per operating point */
+    uint32_t ulSleepCurrentUA[CLOCK_OPP_COUNT];  /* Sleep (WFI), per operating point */
+    uint32_t ulStopCurrentUA;                    /* STOP, low-power regulator */
+} EnergyBoardProfile_t;
+
+/* Energy model statistics */
+typedef struct {
+    uint32_t ulRunTimeMs;       /* Residency in Run mode */
+    uint32_t ulSleepTimeMs;     /* Residency in Sleep (WFI) */
+    uint32_t ulStopTimeMs;      /* Residency in STOP */
+    float fRunEnergyUAh;        /* Charge consumed in Run mode */
+    float fTotalEnergyUAh;      /* Charge consumed in all modes */
+    float fAvgCurrentUA;        /* Average current since init */
+} EnergyStats_t;
+
+/* Function prototypes */
+void EnergyModel_Init(void);
+void EnergyModel_Update(void);
+void EnergyModel_GetStats(EnergyStats_t *stats);
+const EnergyBoardProfile_t* EnergyModel_GetBoardProfile(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ENERGY_MODEL_H */
@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file    idle_load.h
+  * @brief   Idle-Counter CPU Load - Calibrated idle loop counting
+  ******************************************************************************
+  */
+
+#ifndef __IDLE_LOAD_H
+#define __IDLE_LOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "power_management.h"
+
+/* Calibration window, in kernel ticks, with the scheduler locked */
+#define IDLE_LOAD_CAL_TICKS             100
+
+/* WFI in the idle hook turns the idle count into a wake-up count */
+#define IDLE_LOAD_AVAILABLE             (!POWER_IDLE_SLEEP_ENABLED)
+
+/* Calibration and runtime-stats comparison */
+typedef struct {
+    uint8_t calibrated;
+    uint32_t calCount;          /* Idle loop iterations in IDLE_LOAD_CAL_TICKS */
+    uint32_t calHz;             /* SystemCoreClock during calibration */
+    uint32_t samples;           /* Compared samples since "loadmode cmp" */
+    float meanAbsError;         /* |idle - runtime| in load points */
+    float maxAbsError;
+    uint32_t runtimeCycles;     /* Mean cost per estimate */
+    uint32_t idleCycles;
+} IdleLoadStats_t;
+
+/*
+ * The idle hook does nothing but count. On its first run it locks the
+ * scheduler, the tick hook counts IDLE_LOAD_CAL_TICKS full ticks of pure
+ * idle looping, and the hook unlocks again. Load is then
+ *   100 * (1 - idle iterations / (calibrated iterations per tick * ticks))
+ * with the expectation scaled by SystemCoreClock against the calibration
+ * clock. Only the idle task counts: time in IdleMon (also priority 0)
+ * reads as load here, while the runtime-stats path counts it as idle.
+ */
+
+/* Function prototypes */
+void IdleLoad_Hook(void);
+void IdleLoad_Tick(void);
+uint8_t IdleLoad_IsCalibrated(void);
+float IdleLoad_GetLoad(void);
+void IdleLoad_RecordComparison(float runtimeLoad, float idleLoad,
+                               uint32_t runtimeCycles, uint32_t idleCycles);
+void IdleLoad_ResetComparison(void);
+void IdleLoad_GetStats(IdleLoadStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IDLE_LOAD_H */
@@ -0,0 +1,101 @@
+/**
+  ******************************************************************************
+  * @file    isr_event.h
+  * @brief   ISR Event Ring - Lock-free ISR -> task events with notification wakeup
+  ******************************************************************************
+  */
+
+#ifndef __ISR_EVENT_H
+#define __ISR_EVENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Event codes */
+#define ISR_EVENT_BUTTON            1       /* arg = EXTI pin */
+#define ISR_EVENT_BENCH             2       /* arg = index within the burst */
+
+/* Benchmark ("isrbench"): bursts are raised on an EXTI line no pin uses,
+ * at the highest priority allowed to call FreeRTOS *FromISR() functions */
+#define ISR_EVENT_BENCH_IRQn        EXTI1_IRQn
+#define ISR_EVENT_BENCH_PRIORITY    configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+#define ISR_EVENT_BENCH_LENGTH      16      /* Ring / queue length, longest burst */
+#define ISR_EVENT_BENCH_BURSTS      100     /* Defaults */
+#define ISR_EVENT_BENCH_BURST_LEN   8
+#define ISR_EVENT_BENCH_STACK       256
+#define ISR_EVENT_BENCH_TASK_PRIO   (configMAX_PRIORITIES - 1)
+
+/* One event: 8 bytes, copied in and out by value */
+typedef struct {
+    uint32_t timestamp;                 /* DWT->CYCCNT when posted */
+    uint16_t code;                      /* ISR_EVENT_x */
+    uint16_t arg;
+} IsrEvent_t;
+
+/* Single-producer (one ISR), single-consumer (one task) ring */
+typedef struct {
+    IsrEvent_t *events;
+    uint32_t mask;                      /* Length - 1, length a power of 2 */
+    volatile uint32_t head;             /* Free-running, written by the ISR */
+    volatile uint32_t tail;             /* Free-running, written by the task */
+    volatile uint32_t dropped;          /* Posts that found the ring full */
+    TaskHandle_t consumer;
+    uint32_t notifyBits;
+} IsrEventRing_t;
+
+/* Per-path benchmark result */
+typedef struct {
+    uint32_t events;                    /* Received by the consumer */
+    uint32_t lost;                      /* Posts that failed (queue/ring full) */
+    uint32_t isrMaxCycles;
+    uint32_t wakeMaxCycles;
+    uint32_t wakeCount;                 /* First events of a burst received */
+    uint32_t lastCount;                 /* Last events of a burst received */
+    uint64_t isrCycles;                 /* Posting, per event */
+    uint64_t wakeCycles;                /* Post -> consumer, first event of a burst */
+    uint64_t lastCycles;                /* Post -> consumer, last event of a burst */
+} IsrEventBenchPath_t;
+
+typedef struct {
+    uint16_t bursts;
+    uint16_t burstLength;
+    IsrEventBenchPath_t queue;
+    IsrEventBenchPath_t ring;
+} IsrEventBench_t;
+
+/*
+ * The ring replaces a FreeRTOS queue where an ISR only has to hand a small
+ * event to one task. Posting is a slot copy, a barrier and a head update:
+ * no critical section, no kernel list handling. The consumer is notified
+ * (xTaskNotifyFromISR, eSetBits) only when a post finds the ring empty;
+ * IsrEvent_Wait() drains the ring before it blocks again, so a burst
+ * costs one wakeup. Each ring must have exactly one posting ISR (or ISRs
+ * at one priority that cannot preempt each other) and one consuming task.
+ * Timestamps and the benchmark use the DWT cycle counter, which reads 0
+ * under QEMU.
+ */
+
+/* Function prototypes */
+uint8_t IsrEvent_Init(IsrEventRing_t *ring, IsrEvent_t *storage, uint32_t length);
+void IsrEvent_SetConsumer(IsrEventRing_t *ring, TaskHandle_t task, uint32_t bits);
+uint8_t IsrEvent_PostFromISR(IsrEventRing_t *ring, uint16_t code, uint16_t arg,
+                             BaseType_t *pxHigherPriorityTaskWoken);
+uint8_t IsrEvent_Get(IsrEventRing_t *ring, IsrEvent_t *event);
+uint8_t IsrEvent_Wait(IsrEventRing_t *ring, IsrEvent_t *event, TickType_t xTimeout);
+uint32_t IsrEvent_GetDropped(const IsrEventRing_t *ring);
+
+/* Benchmark against xQueueSendFromISR() */
+uint8_t IsrEvent_Benchmark(uint32_t bursts, uint32_t burstLength, IsrEventBench_t *result);
+void IsrEvent_WriteBenchmark(const IsrEventBench_t *result);
+void IsrEvent_BenchIrq(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ISR_EVENT_H */
@@ -14,9 +14,18 @@ extern "C" {
 
 #include <stdint.h>
 #include "system_profiler.h"
+#include "test_metrics.h"
+
+/* Binary frame: sync, little-endian payload length, payload, Fletcher-16 */
+#define REPORT_BINARY_SYNC0       0xA5
+#define REPORT_BINARY_SYNC1       0x5A
+#define REPORT_BINARY_VERSION     3
 
 /* Function prototypes */
 void FormatSystemReportJSON(const SystemReport_t *report, char *buffer, size_t bufferSize);
+void FormatSystemReportJSONCompact(const SystemReport_t *report, char *buffer, size_t bufferSize);
+size_t FormatSystemReportBinary(const SystemReport_t *report, uint8_t *buffer, size_t bufferSize);
+void FormatTestMetricsJSON(const TestMetrics_t *metrics, char *buffer, size_t bufferSize);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,81 @@
+/**
+  ******************************************************************************
+  * @file    log_channel.h
+  * @brief   Log Channel - Deferred-formatting log ring drained by a low-priority task
+  ******************************************************************************
+  */
+
+#ifndef __LOG_CHANNEL_H
+#define __LOG_CHANNEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Ring configuration */
+#define LOG_RING_WORDS              256     /* Power of 2 (1 KB) */
+#define LOG_MAX_ARGS                6       /* 32-bit arguments per record */
+#define LOG_STR_MAX                 16      /* Bytes copied by LOG_STR() */
+#define LOG_DRAIN_PERIOD_MS         20
+
+/*
+ * Records hold the address of the format string plus raw 32-bit arguments;
+ * nothing is formatted on the target. Format strings live in
+ * .rodata.logfmt, which the CubeMX linker script keeps in flash through its
+ * *(.rodata*) rule, and Tools/log_decode.py reads them back from the ELF.
+ *
+ *   LOG("Heap low: %lu bytes", freeHeap);
+ *   LOG("CPU %.1f%%", Log_F32(load));          (floats are passed as bits)
+ *   LOG_STR("Stack overflow in task: %s", pcTaskName);
+ *
+ * Writing is lock-free and safe from tasks and from ISRs of any priority.
+ * A full ring drops the record and counts it.
+ *
+ * Stream format (text lines, written by the drain task):
+ *   #lg <tick> <fmt_addr_hex> [<arg_hex> ...]
+ *   #lgs <tick> <fmt_addr_hex> <string bytes hex>
+ *   #lgd <dropped total>
+ */
+#define LOG(fmt, ...)                                                           \
+    do {                                                                        \
+        static const char _logFmt[] __attribute__((section(".rodata.logfmt"))) = fmt; \
+        const uint32_t _logArgs[] = { 0, ##__VA_ARGS__ };                       \
+        _Static_assert(sizeof(_logArgs) / sizeof(uint32_t) <= LOG_MAX_ARGS + 1, \
+                       "too many log arguments");                               \
+        LogChannel_Write(_logFmt, &_logArgs[1],                                 \
+                         (uint8_t)(sizeof(_logArgs) / sizeof(uint32_t) - 1));   \
+    } while (0)
+
+#define LOG_STR(fmt, str)                                                       \
+    do {                                                                        \
+        static const char _logFmt[] __attribute__((section(".rodata.logfmt"))) = fmt; \
+        LogChannel_WriteString(_logFmt, str);                                   \
+    } while (0)
+
+/**
+  * @brief  Pass a float argument by its bit pattern
+  * @param  value: Value for a %f/%e/%g conversion
+  * @retval IEEE-754 single precision bits
+  */
+static inline uint32_t Log_F32(float value)
+{
+    union { float f; uint32_t u; } xBits;
+
+    xBits.f = value;
+    return xBits.u;
+}
+
+/* Function prototypes */
+void LogChannel_Write(const char *fmt, const uint32_t *args, uint8_t count);
+void LogChannel_WriteString(const char *fmt, const char *str);
+uint8_t LogChannel_Drain(void);
+void LogChannel_Flush(void);
+uint32_t LogChannel_GetDropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LOG_CHANNEL_H */
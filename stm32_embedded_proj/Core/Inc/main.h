@@ -15,6 +15,14 @@ extern "C" {
 /* Includes ------------------------------------------------------------------*/
 #include "stm32f4xx_hal.h"
 
+/* Build mode: 1 = image for the QEMU netduinoplus2 machine (make QEMU=1).
+ * The model has no RCC, so the clock tree is left at reset and the kernel
+ * tick is derived from the CPU clock QEMU drives SysTick with */
+#ifndef PROFILER_QEMU
+#define PROFILER_QEMU                   0
+#endif
+#define PROFILER_QEMU_CPU_HZ            168000000UL
+
 /* Exported functions prototypes ---------------------------------------------*/
 void Error_Handler(void);
 
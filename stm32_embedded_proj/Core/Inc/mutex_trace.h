@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file    mutex_trace.h
+  * @brief   Mutex Contention and Priority-Inversion Profiler
+  ******************************************************************************
+  * @attention
+  *
+  * Fed by queue_trace.c for mutex-type objects and by the priority
+  * inheritance trace hook in FreeRTOSConfig.h, so this header may only
+  * depend on standard types.
+  *
+  ******************************************************************************
+  */
+
+#ifndef __MUTEX_TRACE_H
+#define __MUTEX_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Tracking capacity */
+#define MUTEX_TRACE_MAX_MUTEXES     2
+#define MUTEX_TRACE_HIST_BINS       5       /* <10 us, <100 us, <1 ms, <10 ms, >=10 ms */
+#define MUTEX_TRACE_NAME_LEN        16      /* configMAX_TASK_NAME_LEN */
+
+/* A higher-priority task waiting at least this long on a lower-priority
+ * holder is reported as a priority inversion */
+#define MUTEX_TRACE_INVERSION_US    1000
+
+/* Per-mutex statistics (cumulative since creation) */
+typedef struct {
+    const char *name;               /* Queue registry name, "" if unregistered */
+    const char *holder;             /* Current holder task, "" if free */
+    uint8_t recursive;
+    uint8_t waiters;                /* Tasks blocked on the mutex now */
+    uint8_t peakWaiters;
+    uint32_t takes;
+    uint32_t contended;             /* Takes that had to block */
+    uint32_t timeouts;              /* Takes that gave up */
+    uint32_t inherits;              /* Priority-inheritance events */
+    uint32_t maxHoldUs;
+    uint32_t maxWaitUs;
+    uint16_t holdHist[MUTEX_TRACE_HIST_BINS];
+    uint16_t waitHist[MUTEX_TRACE_HIST_BINS];
+    uint32_t inversions;
+    uint32_t lastInversionUs;       /* Wait of the most recent inversion */
+    char lastInversionHolder[MUTEX_TRACE_NAME_LEN];
+    char lastInversionWaiter[MUTEX_TRACE_NAME_LEN];
+} MutexStats_t;
+
+/* Trace hook entry points */
+uint8_t MutexTrace_Create(void *pvMutex, uint8_t ucRecursive);
+void MutexTrace_Delete(uint8_t ucMutex);
+void MutexTrace_TaskDeleted(uint8_t ucTask);
+void MutexTrace_Taken(uint8_t ucMutex);
+void MutexTrace_TakeFailed(uint8_t ucMutex);
+void MutexTrace_Given(uint8_t ucMutex);
+void MutexTrace_Block(uint8_t ucMutex);
+void MutexTrace_PriorityInherit(void);
+
+/* Reporting */
+uint8_t MutexTrace_GetStats(MutexStats_t *stats, uint8_t maxMutexes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MUTEX_TRACE_H */
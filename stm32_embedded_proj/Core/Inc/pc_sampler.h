@@ -0,0 +1,65 @@
+/**
+  ******************************************************************************
+  * @file    pc_sampler.h
+  * @brief   Sampling PC Profiler - Function-level hotspots via TIM3 interrupt
+  ******************************************************************************
+  */
+
+#ifndef __PC_SAMPLER_H
+#define __PC_SAMPLER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Sampling configuration */
+#define PC_SAMPLER_MIN_HZ               1000
+#define PC_SAMPLER_MAX_HZ               10000
+#define PC_SAMPLER_STREAM_MS            1000    /* Histogram window */
+#define PC_SAMPLER_MAX_OVERHEAD_PCT     2.0f    /* Rate is halved above this */
+#define PC_SAMPLER_ENTRY_CYCLES         30      /* Exception entry/exit + shim, not seen by CYCCNT */
+
+/* Above configMAX_SYSCALL_INTERRUPT_PRIORITY so critical sections and
+ * kernel-aware ISRs are sampled too. The handler only reads the current TCB
+ * (xTaskGetCurrentTaskHandle, pcTaskGetName on a task's first sample): no
+ * critical sections, nothing that blocks or wakes a task */
+#define PC_SAMPLER_IRQ_PRIORITY         4
+
+/* Histogram: open-addressed (pc, lr, task) table, double buffered */
+#define PC_SAMPLER_TABLE_SIZE           128     /* Power of 2 */
+#define PC_SAMPLER_PROBE_LIMIT          8
+#define PC_SAMPLER_ISR_SLOT             0xFF    /* Sample taken from handler mode */
+
+/* Sampler statistics (last completed window) */
+typedef struct {
+    uint32_t ulRateHz;            /* 0 = disabled */
+    uint32_t ulSamples;
+    uint32_t ulDropped;           /* Histogram full */
+    float fOverheadPct;           /* Sampling ISR time / CPU time */
+    uint32_t ulThrottleCount;     /* Rate reductions by the overhead cap */
+} PcSamplerStats_t;
+
+/*
+ * Stream format (one window, text lines):
+ *   #pcs <tick> <rate_hz> <samples> <dropped> <overhead_pct>
+ *   #pc <pc_hex> <lr_hex> <count> <task name>      (one per histogram entry)
+ *   #pce
+ * Tools/pc_symbolize.py turns this into flat and folded-stack profiles.
+ */
+
+/* Function prototypes */
+void PcSampler_Init(void);
+uint8_t PcSampler_SetRate(uint32_t rateHz);
+void PcSampler_ApplyClock(void);
+void PcSampler_Sample(const uint32_t *pulFrame, uint32_t ulExcReturn);
+void PcSampler_TaskDeleted(void *pvTask);
+void PcSampler_Stream(void);
+void PcSampler_GetStats(PcSamplerStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PC_SAMPLER_H */
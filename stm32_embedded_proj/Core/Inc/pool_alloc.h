@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file    pool_alloc.h
+  * @brief   Pool Allocator - Fixed-size block pools in front of the FreeRTOS heap
+  ******************************************************************************
+  */
+
+#ifndef __POOL_ALLOC_H
+#define __POOL_ALLOC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* 1 = serve small allocations from the pools (make POOL_ALLOC=1); 0 = every
+ * allocation goes to the FreeRTOS heap, still counted and timed */
+#ifndef POOL_ALLOC_ENABLED
+#define POOL_ALLOC_ENABLED          0
+#endif
+
+/* Size classes, smallest first: block bytes and blocks per class. Defaults
+ * cover the workload churn (16-128 B), TCBs and small queues (128 B) and
+ * the profiler's TaskStatus_t array (512 B, up to 14 tasks) */
+#define POOL_ALLOC_CLASS_COUNT      4
+#ifndef POOL_ALLOC_BLOCK_SIZES
+#define POOL_ALLOC_BLOCK_SIZES      { 32, 64, 128, 512 }
+#endif
+#ifndef POOL_ALLOC_BLOCK_COUNTS
+#define POOL_ALLOC_BLOCK_COUNTS     { 8, 8, 4, 1 }
+#endif
+#define POOL_ALLOC_HEAP_RESERVE     1024    /* Never carve a class below this */
+
+/* One size class */
+typedef struct {
+    uint16_t blockSize;
+    uint16_t blockCount;                /* 0 = not carved (pools off, or no heap) */
+    uint16_t used;
+    uint16_t peak;
+    uint32_t hits;                      /* Served from the pool, spills from the class below included */
+    uint32_t misses;                    /* This and the next class empty, served by the heap */
+} PoolStats_t;
+
+/* Allocator totals since boot */
+typedef struct {
+    uint8_t poolCount;
+    PoolStats_t pools[POOL_ALLOC_CLASS_COUNT];
+    uint32_t allocs;                    /* pvPortMalloc() calls */
+    uint32_t frees;                     /* vPortFree() calls, NULL excluded */
+    uint32_t heapAllocs;                /* Too large for any class, or a miss */
+    uint64_t allocCycles;               /* Total, including heap fallbacks */
+    uint64_t freeCycles;
+    uint32_t allocMeanCycles;           /* Filled by PoolAlloc_GetStats() */
+    uint32_t freeMeanCycles;
+} PoolAllocStats_t;
+
+/*
+ * The Makefiles link with -Wl,--wrap=pvPortMalloc,--wrap=vPortFree, so
+ * every allocation in the image, the kernel's included, goes through
+ * pool_alloc.c. A request takes the smallest class that fits, or the
+ * next larger class when that one is empty; when both are empty (a miss,
+ * counted on the smaller) or the request is larger than every class it
+ * falls back to heap_4. vPortFree() finds the owning pool by address
+ * range. Both are a bounded walk over
+ * POOL_ALLOC_CLASS_COUNT classes plus a free-list push or pop in a
+ * critical section, so the pool path costs the same whatever the heap
+ * state. PoolAlloc_Init() carves each class from the heap in one block,
+ * after main() has made its own allocations, and skips a class that
+ * would leave less than POOL_ALLOC_HEAP_RESERVE free.
+ */
+
+/* Function prototypes */
+void PoolAlloc_Init(void);
+void PoolAlloc_GetStats(PoolAllocStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __POOL_ALLOC_H */
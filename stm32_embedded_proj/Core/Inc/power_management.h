@@ -14,6 +14,18 @@ extern "C" {
 
 #include "stm32f4xx_hal.h"
 
+/* Set to 1 to execute WFI from the idle hook (Sleep residency becomes non-zero) */
+#ifndef POWER_IDLE_SLEEP_ENABLED
+#define POWER_IDLE_SLEEP_ENABLED  0
+#endif
+
+/* STOP is timed with the RTC on LSI (~32 kHz): 1 Hz calendar, 4 ms
+ * sub-second steps. LSI varies by up to +/-50 % between parts, so STOP
+ * residency is coarse; periods longer than a day wrap */
+#define POWER_RTC_PREDIV_ASYNC    127
+#define POWER_RTC_PREDIV_SYNC     249
+#define POWER_RTC_WAIT_LOOPS      100000  /* Bound on LSI / RTC ready waits */
+
 /* Power modes */
 typedef enum {
     POWER_MODE_RUN = 0,      /* Normal run mode */
@@ -26,11 +38,16 @@ typedef struct {
     uint32_t ulDeepSleepCount;    /* Number of times entered deep sleep */
     uint32_t ulTotalSleepTimeMs;  /* Total time spent in deep sleep */
     uint32_t ulLastWakeupTime;    /* Timestamp of last wakeup */
+    uint32_t ulLastDeepSleepMs;   /* Duration of the last STOP period */
+    uint32_t ulLastWakeupLatencyMs; /* Wake-up to clocks and peripherals restored */
+    uint32_t ulSleepCount;        /* Number of WFI sleep entries */
+    uint64_t ullTotalSleepTimeUs; /* Total time spent in WFI sleep */
 } SleepStats_t;
 
 /* Function prototypes */
 void PowerManagement_Init(void);
 void PowerManagement_EnterDeepSleep(void);
+void PowerManagement_EndDeepSleep(void);
 void PowerManagement_EnterSleep(void);
 PowerMode_t PowerManagement_GetCurrentMode(void);
 SleepStats_t* PowerManagement_GetStats(void);
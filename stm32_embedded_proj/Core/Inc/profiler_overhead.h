@@ -0,0 +1,75 @@
+/**
+  ******************************************************************************
+  * @file    profiler_overhead.h
+  * @brief   Profiler Self-Overhead - Cycle accounting and budget throttling
+  ******************************************************************************
+  */
+
+#ifndef __PROFILER_OVERHEAD_H
+#define __PROFILER_OVERHEAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Accounting window and budget */
+#define OVERHEAD_WINDOW_MS              1000
+#define OVERHEAD_DEFAULT_BUDGET_PCT     2       /* 0 = account only, never throttle */
+#define OVERHEAD_MAX_BUDGET_PCT         50
+#define OVERHEAD_RELAX_PCT              50      /* Step back below this share of the budget... */
+#define OVERHEAD_RELAX_WINDOWS          5       /* ...for this many consecutive windows */
+
+/* Throttle levels, applied cumulatively */
+#define OVERHEAD_LEVEL_NONE             0
+#define OVERHEAD_LEVEL_REPORT_TASKS     1       /* Walk the task list on reported samples only */
+#define OVERHEAD_LEVEL_PERIOD_X2        2       /* Sample (and report) period doubled... */
+#define OVERHEAD_LEVEL_MAX              4       /* ...up to x8 */
+
+/* Accounted profiler work */
+typedef enum {
+    OVERHEAD_SNAPSHOT = 0,      /* Per-task walk and stack scan */
+    OVERHEAD_COMPUTE,           /* CPU load, heap and section snapshots */
+    OVERHEAD_STORE,             /* History buffer copy */
+    OVERHEAD_FORMAT,            /* Report serialisation */
+    OVERHEAD_TRANSMIT,          /* Report UART write */
+    OVERHEAD_PHASE_COUNT
+} OverheadPhase_t;
+
+/* Last closed window */
+typedef struct {
+    float totalPct;                         /* Profiler cycles / elapsed cycles */
+    float phasePct[OVERHEAD_PHASE_COUNT];
+    float budgetPct;
+    uint8_t level;                          /* OVERHEAD_LEVEL_x */
+    uint32_t throttleCount;                 /* Level increases since boot */
+} OverheadStats_t;
+
+/*
+ * Each phase is bracketed with DWT cycle stamps:
+ *   uint32_t start = ProfilerOverhead_Begin();
+ *   ...work...
+ *   ProfilerOverhead_End(OVERHEAD_FORMAT, start);
+ * ProfilerOverhead_Update(), called by ProfilerTask after every sample,
+ * closes a window every OVERHEAD_WINDOW_MS and moves the throttle level
+ * one step: up while the total exceeds the budget, down after
+ * OVERHEAD_RELAX_WINDOWS windows below OVERHEAD_RELAX_PCT of it.
+ * Stamps are wall-clock cycles, so preemption and interrupts inside a
+ * phase count against the profiler (an upper bound).
+ */
+
+/* Function prototypes */
+uint32_t ProfilerOverhead_Begin(void);
+void ProfilerOverhead_End(OverheadPhase_t phase, uint32_t startCycles);
+void ProfilerOverhead_Update(void);
+uint8_t ProfilerOverhead_SetBudget(uint32_t budgetPct);
+uint8_t ProfilerOverhead_GetLevel(void);
+uint32_t ProfilerOverhead_SamplePeriodMs(uint32_t configuredMs);
+void ProfilerOverhead_GetStats(OverheadStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PROFILER_OVERHEAD_H */
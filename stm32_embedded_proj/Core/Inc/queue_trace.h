@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    queue_trace.h
+  * @brief   Queue / Semaphore Instrumentation via FreeRTOS trace hooks
+  ******************************************************************************
+  * @attention
+  *
+  * Included from FreeRTOSConfig.h, so this header may only depend on
+  * standard types. The trace macros that call into it are defined there.
+  *
+  ******************************************************************************
+  */
+
+#ifndef __QUEUE_TRACE_H
+#define __QUEUE_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Tracking capacity */
+#define QUEUE_TRACE_MAX_OBJECTS     6       /* Queues, semaphores and mutexes */
+#define QUEUE_TRACE_MAX_TASKS       16      /* Live tasks that can be timed while blocked */
+#define QUEUE_TRACE_HIST_BINS       4       /* Block time: <1, <10, <100, >=100 ms */
+#define QUEUE_TRACE_UNTRACKED       0xFF    /* uxQueueNumber of objects beyond the table */
+
+/* Per-object statistics (cumulative since creation) */
+typedef struct {
+    const char *name;               /* Queue registry name, "" if unregistered */
+    uint8_t type;                   /* queueQUEUE_TYPE_x */
+    uint8_t length;                 /* Capacity (saturated at 255) */
+    uint8_t depth;                  /* Items after the last operation */
+    uint8_t peak;                   /* High-water mark */
+    uint32_t sends;
+    uint32_t receives;
+    uint32_t sendFull;              /* Sends that found the queue full */
+    uint32_t recvEmpty;             /* Receives that found the queue empty */
+    uint16_t sendBlockHist[QUEUE_TRACE_HIST_BINS];
+    uint16_t recvBlockHist[QUEUE_TRACE_HIST_BINS];
+} QueueObjectStats_t;
+
+/* Trace hook entry points (called from queue.c / tasks.c) */
+uint32_t QueueTrace_Create(void *pvQueue, uint32_t ulLength, uint8_t ucType);
+void QueueTrace_Delete(uint32_t ulObject);
+uint32_t QueueTrace_TaskCreate(void);
+void QueueTrace_TaskDeleted(uint32_t ulTaskNumber);
+void QueueTrace_Send(uint32_t ulObject, uint32_t ulDepth, uint8_t ucFromIsr);
+void QueueTrace_SendFailed(uint32_t ulObject, uint8_t ucFromIsr);
+void QueueTrace_Receive(uint32_t ulObject, uint32_t ulDepth, uint8_t ucFromIsr);
+void QueueTrace_ReceiveFailed(uint32_t ulObject, uint8_t ucFromIsr);
+void QueueTrace_Block(uint32_t ulObject, uint8_t ucReceive);
+uint8_t QueueTrace_CurrentTask(void);
+
+/* Reporting */
+uint8_t QueueTrace_GetStats(QueueObjectStats_t *stats, uint8_t maxObjects);
+const char *QueueTrace_TypeName(uint8_t type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __QUEUE_TRACE_H */
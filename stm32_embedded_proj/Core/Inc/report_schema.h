@@ -0,0 +1,338 @@
+/**
+  ******************************************************************************
+  * @file    report_schema.h
+  * @brief   Report Schema - The one field table behind SystemReport_t,
+  *          every serializer and Tools/report_decode.py
+  ******************************************************************************
+  * @attention
+  *
+  * Tools/report_decode.py parses this file: keep one row per line, string
+  * keys as literals, and the row and encoding names below.
+  *
+  ******************************************************************************
+  */
+
+#ifndef __REPORT_SCHEMA_H
+#define __REPORT_SCHEMA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Top-level report fields (subscription mask) */
+#define REPORT_FIELD_TIMESTAMP          (1UL << 0)
+#define REPORT_FIELD_CPU_LOAD           (1UL << 1)
+#define REPORT_FIELD_HEAP               (1UL << 2)   /* heap_free, heap_min */
+#define REPORT_FIELD_FRAG               (1UL << 3)
+#define REPORT_FIELD_TASKS              (1UL << 4)
+#define REPORT_FIELD_TEMP               (1UL << 5)
+#define REPORT_FIELD_CLOCK              (1UL << 6)
+#define REPORT_FIELD_POWER              (1UL << 7)
+#define REPORT_FIELD_LINK               (1UL << 8)   /* UART transport counters */
+#define REPORT_FIELD_USER               (1UL << 9)   /* Application spans, counters, gauges */
+#define REPORT_FIELD_QUEUES             (1UL << 10)  /* Queue / semaphore / mutex statistics */
+#define REPORT_FIELD_MUTEXES            (1UL << 11)  /* Mutex contention and priority inversion */
+#define REPORT_FIELD_SUPPLY             (1UL << 12)  /* VDDA and VBAT */
+#define REPORT_FIELD_OVERHEAD           (1UL << 13)  /* Profiler self-overhead and throttle */
+#define REPORT_FIELD_POOLS              (1UL << 14)  /* Allocator pools and alloc/free cost */
+
+/* Per-task report fields (subscription mask) */
+#define TASK_FIELD_NAME                 (1UL << 0)
+#define TASK_FIELD_RUNTIME              (1UL << 1)
+#define TASK_FIELD_STACK                (1UL << 2)
+#define TASK_FIELD_ENERGY               (1UL << 3)
+#define TASK_FIELD_STACK_GROWTH         (1UL << 4)
+
+/* Rows of nested records that are always written */
+#define REPORT_ITEM                     0UL
+#define REPORT_ITEM_ENABLED             1
+
+/* Build switches (0 or 1, e.g. make REPORT_OFF="USER MUTEXES"): a field
+ * built as 0 is dropped from SystemReport_t, the collector and every
+ * serializer, and can no longer be subscribed. CPU load, heap and the
+ * task list feed the clock governor, test metrics and the workload
+ * sweep, so they are always built */
+#define REPORT_FIELD_CPU_LOAD_ENABLED   1
+#define REPORT_FIELD_HEAP_ENABLED       1
+#define REPORT_FIELD_FRAG_ENABLED       1
+#define REPORT_FIELD_TASKS_ENABLED      1
+#ifndef REPORT_FIELD_TIMESTAMP_ENABLED
+#define REPORT_FIELD_TIMESTAMP_ENABLED  1
+#endif
+#ifndef REPORT_FIELD_TEMP_ENABLED
+#define REPORT_FIELD_TEMP_ENABLED       1
+#endif
+#ifndef REPORT_FIELD_CLOCK_ENABLED
+#define REPORT_FIELD_CLOCK_ENABLED      1
+#endif
+#ifndef REPORT_FIELD_POWER_ENABLED
+#define REPORT_FIELD_POWER_ENABLED      1
+#endif
+#ifndef REPORT_FIELD_LINK_ENABLED
+#define REPORT_FIELD_LINK_ENABLED       1
+#endif
+#ifndef REPORT_FIELD_USER_ENABLED
+#define REPORT_FIELD_USER_ENABLED       1
+#endif
+#ifndef REPORT_FIELD_QUEUES_ENABLED
+#define REPORT_FIELD_QUEUES_ENABLED     1
+#endif
+#ifndef REPORT_FIELD_MUTEXES_ENABLED
+#define REPORT_FIELD_MUTEXES_ENABLED    1
+#endif
+#ifndef REPORT_FIELD_SUPPLY_ENABLED
+#define REPORT_FIELD_SUPPLY_ENABLED     1
+#endif
+#ifndef REPORT_FIELD_OVERHEAD_ENABLED
+#define REPORT_FIELD_OVERHEAD_ENABLED   1
+#endif
+#ifndef REPORT_FIELD_POOLS_ENABLED
+#define REPORT_FIELD_POOLS_ENABLED      1
+#endif
+#ifndef TASK_FIELD_NAME_ENABLED
+#define TASK_FIELD_NAME_ENABLED         1
+#endif
+#ifndef TASK_FIELD_RUNTIME_ENABLED
+#define TASK_FIELD_RUNTIME_ENABLED      1
+#endif
+#ifndef TASK_FIELD_STACK_ENABLED
+#define TASK_FIELD_STACK_ENABLED        1
+#endif
+#ifndef TASK_FIELD_ENERGY_ENABLED
+#define TASK_FIELD_ENERGY_ENABLED       1
+#endif
+#ifndef TASK_FIELD_STACK_GROWTH_ENABLED
+#define TASK_FIELD_STACK_GROWTH_ENABLED 1
+#endif
+
+#define REPORT_STRING_MAX               15      /* Longer strings are truncated in binary frames */
+
+/*
+ * Rows. A table lists the rows of one struct in output order; the
+ * top-level table is in mask bit order. bit is the mask bit that gates
+ * the row (REPORT_FIELD_x at the top level, TASK_FIELD_x in a task,
+ * REPORT_ITEM in other records). pretty and compact are the row's keys
+ * in the two JSON formats. Compact keys are short because key text is
+ * most of a compact report: 263 bytes fewer than pretty keys with every
+ * list empty, plus 42 per task. Tools/report_decode.py maps either style
+ * to the one asked for (--keys), so a row keeps both.
+ *   F(bit, enc, member, pretty, compact)      Scalar
+ *   A(bit, enc, member, count, pretty, compact)
+ *                                             Fixed array: u8 count, elements
+ *   O(bit, type, member, table, pretty, compact)
+ *                                             Object: a struct member written
+ *                                             with REPORT_SCHEMA_<table>
+ *   L(bit, type, member, count, counter, table, pretty, compact)
+ *                                             List: u8 counter (member), then up
+ *                                             to count records
+ *   M(bit, type, member, count, counter, table, pretty, compact)
+ *                                             Map: a list whose records are a
+ *                                             name and a value, {"name": value}
+ *                                             in JSON
+ *   C(bit, when, table, pretty, compact)      Object over the same struct, left
+ *                                             out of JSON while the u32 member
+ *                                             when is 0 (always in binary)
+ *
+ * Encodings: JSON text / binary (little endian). Binary percentages are
+ * x100, temperature x10, energy in 0.01 uAh.
+ *   U8, U16, U32, I32   integer / same width
+ *   U64                 integer / u32 low, u32 high
+ *   PCT1, PCT2          float, 1 or 2 decimals / u16 x100
+ *   PCT0                float, no decimals / u8
+ *   UA                  float, no decimals / u32
+ *   UAH                 float, 2 decimals / u32 x100
+ *   TEMP                float, 1 decimal / i16 x10
+ *   MHZ                 Hz as integer MHz / u32 Hz
+ *   QTYPE               queueQUEUE_TYPE_x as its name / u8
+ *   STR, PSTR           char array or const char * / u8 length, bytes
+ *
+ * Tables for report-owned structs (REPORT, TASK, CLOCK, POWER, LINK,
+ * SUPPLY) also declare them: system_profiler.h builds the struct from the
+ * F, A, O, L and M rows. The other tables describe module snapshots.
+ */
+
+#define REPORT_SCHEMA_REPORT(F, A, O, L, M, C)                                                                 \
+    F(REPORT_FIELD_TIMESTAMP, U32,  timestamp,   "timestamp", "ts")                                           \
+    F(REPORT_FIELD_CPU_LOAD,  PCT1, cpuLoad,     "cpu_load",  "cpu")                                          \
+    F(REPORT_FIELD_HEAP,      U32,  heapFree,    "heap_free", "heap")                                         \
+    F(REPORT_FIELD_HEAP,      U32,  heapMin,     "heap_min",  "min")                                          \
+    F(REPORT_FIELD_FRAG,      PCT1, fragPercent, "frag_pct",  "frag")                                         \
+    L(REPORT_FIELD_TASKS,     TaskStats_t, tasks, MAX_TASKS, taskCount, TASK, "tasks", "tasks")               \
+    F(REPORT_FIELD_TEMP,      TEMP, temperature, "temp",      "temp")                                         \
+    O(REPORT_FIELD_CLOCK,     ReportClock_t, clock, CLOCK, "clock", "clk")                                    \
+    O(REPORT_FIELD_POWER,     ReportPower_t, power, POWER, "power", "pwr")                                    \
+    O(REPORT_FIELD_LINK,      ReportLink_t, link, LINK, "link", "lnk")                                        \
+    O(REPORT_FIELD_USER,      UserMetricsReport_t, user, USER, "user", "usr")                                 \
+    L(REPORT_FIELD_QUEUES,    QueueObjectStats_t, queues, QUEUE_TRACE_MAX_OBJECTS, queueCount, QUEUE, "queues", "q") \
+    L(REPORT_FIELD_MUTEXES,   MutexStats_t, mutexes, MUTEX_TRACE_MAX_MUTEXES, mutexCount, MUTEX, "mutexes", "mx") \
+    O(REPORT_FIELD_SUPPLY,    ReportSupply_t, supply, SUPPLY, "supply", "sup")                                \
+    O(REPORT_FIELD_OVERHEAD,  OverheadStats_t, overhead, OVERHEAD, "profiler_overhead", "ovh")                \
+    O(REPORT_FIELD_POOLS,     PoolAllocStats_t, pools, POOLS, "pools", "pl")
+
+#define REPORT_SCHEMA_TASK(F, A, O, L, M, C)                                                                   \
+    F(TASK_FIELD_NAME,         STR,  taskName,       "name",         "n")                                     \
+    F(TASK_FIELD_RUNTIME,      PCT1, runtimePercent, "runtime_pct",  "r")                                     \
+    F(TASK_FIELD_STACK,        U32,  stackFree,      "stack_free",   "s")                                     \
+    F(TASK_FIELD_ENERGY,       UAH,  energyUAh,      "energy_uah",   "e")                                     \
+    F(TASK_FIELD_STACK_GROWTH, U32,  stackGrowth,    "stack_growth", "g")
+
+#define REPORT_SCHEMA_CLOCK(F, A, O, L, M, C)                                                                  \
+    F(REPORT_ITEM, MHZ, freqHz,      "freq_mhz", "mhz")                                                       \
+    F(REPORT_ITEM, U32, switchCount, "switches", "sw")                                                        \
+    A(REPORT_ITEM, U32, residencyMs, CLOCK_OPP_COUNT, "residency_ms", "res")
+
+#define REPORT_SCHEMA_POWER(F, A, O, L, M, C)                                                                  \
+    F(REPORT_ITEM, UA,  avgCurrentUA, "avg_ua",     "ua")                                                     \
+    F(REPORT_ITEM, UAH, energyUAh,    "energy_uah", "uah")                                                    \
+    F(REPORT_ITEM, U32, runTimeMs,    "run_ms",     "run")                                                    \
+    F(REPORT_ITEM, U32, sleepTimeMs,  "sleep_ms",   "slp")                                                    \
+    F(REPORT_ITEM, U32, stopTimeMs,   "stop_ms",    "stop")
+
+#define REPORT_SCHEMA_LINK(F, A, O, L, M, C)                                                                   \
+    F(REPORT_ITEM, U32,  baud,        "baud",      "bd")                                                      \
+    F(REPORT_ITEM, U32,  bytesPerSec, "bps",       "bps")                                                     \
+    F(REPORT_ITEM, PCT1, utilPct,     "util_pct",  "u")                                                       \
+    F(REPORT_ITEM, U32,  txErrors,    "tx_err",    "te")                                                      \
+    F(REPORT_ITEM, U32,  rxErrors,    "rx_err",    "re")                                                      \
+    F(REPORT_ITEM, U32,  fallbacks,   "fallbacks", "fb")
+
+#define REPORT_SCHEMA_USER(F, A, O, L, M, C)                                                                   \
+    L(REPORT_ITEM, UserSpanStats_t, spans, USER_MAX_SPANS, spanCount, SPAN, "spans", "sp")                    \
+    M(REPORT_ITEM, UserCounterStats_t, counters, USER_MAX_COUNTERS, counterCount, COUNTER, "counters", "ct")  \
+    M(REPORT_ITEM, UserGaugeStats_t, gauges, USER_MAX_GAUGES, gaugeCount, GAUGE, "gauges", "g")
+
+#define REPORT_SCHEMA_SPAN(F, A, O, L, M, C)                                                                   \
+    F(REPORT_ITEM, PSTR, name,        "name",      "n")                                                       \
+    F(REPORT_ITEM, U32,  count,       "count",     "c")                                                       \
+    F(REPORT_ITEM, U64,  totalCycles, "total_cyc", "t")                                                       \
+    F(REPORT_ITEM, U32,  maxCycles,   "max_cyc",   "m")                                                       \
+    A(REPORT_ITEM, U16,  hist, USER_SPAN_HIST_BINS, "hist", "h")
+
+#define REPORT_SCHEMA_COUNTER(F, A, O, L, M, C)                                                                \
+    F(REPORT_ITEM, PSTR, name,  "name",  "n")                                                                 \
+    F(REPORT_ITEM, U32,  value, "value", "v")
+
+#define REPORT_SCHEMA_GAUGE(F, A, O, L, M, C)                                                                  \
+    F(REPORT_ITEM, PSTR, name,  "name",  "n")                                                                 \
+    F(REPORT_ITEM, I32,  value, "value", "v")
+
+#define REPORT_SCHEMA_QUEUE(F, A, O, L, M, C)                                                                  \
+    F(REPORT_ITEM, PSTR,  name,      "name",       "n")                                                       \
+    F(REPORT_ITEM, QTYPE, type,      "type",       "ty")                                                      \
+    F(REPORT_ITEM, U8,    length,    "len",        "l")                                                       \
+    F(REPORT_ITEM, U8,    depth,     "depth",      "d")                                                       \
+    F(REPORT_ITEM, U8,    peak,      "peak",       "p")                                                       \
+    F(REPORT_ITEM, U32,   sends,     "sends",      "s")                                                       \
+    F(REPORT_ITEM, U32,   receives,  "recvs",      "r")                                                       \
+    F(REPORT_ITEM, U32,   sendFull,  "send_full",  "sf")                                                      \
+    F(REPORT_ITEM, U32,   recvEmpty, "recv_empty", "re")                                                      \
+    A(REPORT_ITEM, U16,   sendBlockHist, QUEUE_TRACE_HIST_BINS, "send_block", "sb")                           \
+    A(REPORT_ITEM, U16,   recvBlockHist, QUEUE_TRACE_HIST_BINS, "recv_block", "rb")
+
+#define REPORT_SCHEMA_MUTEX(F, A, O, L, M, C)                                                                  \
+    F(REPORT_ITEM, PSTR, name,        "name",         "n")                                                    \
+    F(REPORT_ITEM, U8,   recursive,   "recursive",    "rc")                                                   \
+    F(REPORT_ITEM, PSTR, holder,      "holder",       "h")                                                    \
+    F(REPORT_ITEM, U8,   waiters,     "waiters",      "w")                                                    \
+    F(REPORT_ITEM, U8,   peakWaiters, "peak_waiters", "pw")                                                   \
+    F(REPORT_ITEM, U32,  takes,       "takes",        "t")                                                    \
+    F(REPORT_ITEM, U32,  contended,   "contended",    "c")                                                    \
+    F(REPORT_ITEM, U32,  timeouts,    "timeouts",     "to")                                                   \
+    F(REPORT_ITEM, U32,  inherits,    "inherits",     "pi")                                                   \
+    F(REPORT_ITEM, U32,  maxHoldUs,   "max_hold_us",  "mh")                                                   \
+    F(REPORT_ITEM, U32,  maxWaitUs,   "max_wait_us",  "mw")                                                   \
+    A(REPORT_ITEM, U16,  holdHist, MUTEX_TRACE_HIST_BINS, "hold_hist", "hh")                                  \
+    A(REPORT_ITEM, U16,  waitHist, MUTEX_TRACE_HIST_BINS, "wait_hist", "wh")                                  \
+    F(REPORT_ITEM, U32,  inversions,  "inversions",   "inv")                                                  \
+    C(REPORT_ITEM, inversions, INVERSION, "last_inversion", "li")
+
+#define REPORT_SCHEMA_INVERSION(F, A, O, L, M, C)                                                              \
+    F(REPORT_ITEM, STR, lastInversionHolder, "holder",  "h")                                                  \
+    F(REPORT_ITEM, STR, lastInversionWaiter, "waiter",  "w")                                                  \
+    F(REPORT_ITEM, U32, lastInversionUs,     "wait_us", "us")
+
+#define REPORT_SCHEMA_SUPPLY(F, A, O, L, M, C)                                                                 \
+    F(REPORT_ITEM, U16, vddaMv, "vdda_mv", "va")                                                              \
+    F(REPORT_ITEM, U16, vbatMv, "vbat_mv", "vb")
+
+#define REPORT_SCHEMA_OVERHEAD(F, A, O, L, M, C)                                                               \
+    F(REPORT_ITEM, PCT2, totalPct,                     "total_pct",    "t")                                   \
+    F(REPORT_ITEM, PCT2, phasePct[OVERHEAD_SNAPSHOT],  "snapshot_pct", "sn")                                  \
+    F(REPORT_ITEM, PCT2, phasePct[OVERHEAD_COMPUTE],   "compute_pct",  "cp")                                  \
+    F(REPORT_ITEM, PCT2, phasePct[OVERHEAD_STORE],     "store_pct",    "st")                                  \
+    F(REPORT_ITEM, PCT2, phasePct[OVERHEAD_FORMAT],    "format_pct",   "fm")                                  \
+    F(REPORT_ITEM, PCT2, phasePct[OVERHEAD_TRANSMIT],  "transmit_pct", "tx")                                  \
+    F(REPORT_ITEM, PCT0, budgetPct,                    "budget_pct",   "b")                                   \
+    F(REPORT_ITEM, U8,   level,                        "level",        "l")                                   \
+    F(REPORT_ITEM, U32,  throttleCount,                "throttles",    "n")
+
+#define REPORT_SCHEMA_POOLS(F, A, O, L, M, C)                                                                  \
+    F(REPORT_ITEM, U32, allocs,          "allocs",      "a")                                                  \
+    F(REPORT_ITEM, U32, frees,           "frees",       "f")                                                  \
+    F(REPORT_ITEM, U32, heapAllocs,      "heap_allocs", "h")                                                  \
+    F(REPORT_ITEM, U32, allocMeanCycles, "alloc_cyc",   "ac")                                                 \
+    F(REPORT_ITEM, U32, freeMeanCycles,  "free_cyc",    "fc")                                                 \
+    L(REPORT_ITEM, PoolStats_t, pools, POOL_ALLOC_CLASS_COUNT, poolCount, POOL, "classes", "c")
+
+#define REPORT_SCHEMA_POOL(F, A, O, L, M, C)                                                                   \
+    F(REPORT_ITEM, U16, blockSize,  "size",   "sz")                                                           \
+    F(REPORT_ITEM, U16, blockCount, "blocks", "b")                                                            \
+    F(REPORT_ITEM, U16, used,       "used",   "u")                                                            \
+    F(REPORT_ITEM, U16, peak,       "peak",   "p")                                                            \
+    F(REPORT_ITEM, U32, hits,       "hits",   "h")                                                            \
+    F(REPORT_ITEM, U32, misses,     "misses", "m")
+
+/* REPORT_IF(flag, ...) keeps its arguments when flag expands to 1 */
+#define REPORT_IF(flag, ...)            REPORT_IF_(flag, __VA_ARGS__)
+#define REPORT_IF_(flag, ...)           REPORT_IF_##flag(__VA_ARGS__)
+#define REPORT_IF_0(...)
+#define REPORT_IF_1(...)                __VA_ARGS__
+
+/* REPORT_APPLY(table, rows) expands a table with a comma-separated row set */
+#define REPORT_APPLY(table, ...)        table(__VA_ARGS__)
+
+/* Row set: struct members */
+#define REPORT_MEMBER_U8(m)             uint8_t m;
+#define REPORT_MEMBER_U16(m)            uint16_t m;
+#define REPORT_MEMBER_U32(m)            uint32_t m;
+#define REPORT_MEMBER_I32(m)            int32_t m;
+#define REPORT_MEMBER_U64(m)            uint64_t m;
+#define REPORT_MEMBER_PCT0(m)           float m;
+#define REPORT_MEMBER_PCT1(m)           float m;
+#define REPORT_MEMBER_PCT2(m)           float m;
+#define REPORT_MEMBER_UA(m)             float m;
+#define REPORT_MEMBER_UAH(m)            float m;
+#define REPORT_MEMBER_TEMP(m)           float m;
+#define REPORT_MEMBER_MHZ(m)            uint32_t m;
+#define REPORT_MEMBER_QTYPE(m)          uint8_t m;
+#define REPORT_MEMBER_STR(m)            char m[REPORT_STRING_MAX + 1];
+#define REPORT_MEMBER_PSTR(m)           const char *m;
+
+#define REPORT_DECLARE_F(bit, enc, member, pretty, compact) \
+    REPORT_IF(bit##_ENABLED, REPORT_MEMBER_##enc(member))
+#define REPORT_DECLARE_A(bit, enc, member, count, pretty, compact) \
+    REPORT_IF(bit##_ENABLED, REPORT_MEMBER_##enc(member[count]))
+#define REPORT_DECLARE_O(bit, type, member, table, pretty, compact) \
+    REPORT_IF(bit##_ENABLED, type member;)
+#define REPORT_DECLARE_L(bit, type, member, count, counter, table, pretty, compact) \
+    REPORT_IF(bit##_ENABLED, uint8_t counter; type member[count];)
+#define REPORT_DECLARE_M                REPORT_DECLARE_L
+#define REPORT_DECLARE_C(bit, when, table, pretty, compact)
+#define REPORT_DECLARE                  REPORT_DECLARE_F, REPORT_DECLARE_A, REPORT_DECLARE_O, \
+                                        REPORT_DECLARE_L, REPORT_DECLARE_M, REPORT_DECLARE_C
+
+/* Row set: mask of the bits built into this image */
+#define REPORT_BUILT_ROW(bit, ...)      REPORT_IF(bit##_ENABLED, | (bit))
+#define REPORT_BUILT                    REPORT_BUILT_ROW, REPORT_BUILT_ROW, REPORT_BUILT_ROW, \
+                                        REPORT_BUILT_ROW, REPORT_BUILT_ROW, REPORT_BUILT_ROW
+
+#define REPORT_FIELD_ALL                (0UL REPORT_APPLY(REPORT_SCHEMA_REPORT, REPORT_BUILT))
+#define TASK_FIELD_ALL                  (0UL REPORT_APPLY(REPORT_SCHEMA_TASK, REPORT_BUILT))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __REPORT_SCHEMA_H */
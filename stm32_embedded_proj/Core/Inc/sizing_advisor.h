@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file    sizing_advisor.h
+  * @brief   Sizing Advisor - Stack, heap and queue sizes from observed peaks
+  ******************************************************************************
+  */
+
+#ifndef __SIZING_ADVISOR_H
+#define __SIZING_ADVISOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Margins on the observed peaks (override with -D, or re-apply on the host
+ * with Tools/sizing_advisor.py) */
+#ifndef SIZING_STACK_MARGIN_PCT
+#define SIZING_STACK_MARGIN_PCT         25
+#endif
+#ifndef SIZING_HEAP_MARGIN_PCT
+#define SIZING_HEAP_MARGIN_PCT          25
+#endif
+#ifndef SIZING_QUEUE_MARGIN_PCT
+#define SIZING_QUEUE_MARGIN_PCT         50
+#endif
+
+/* Never less than this above the peak: an FPU exception frame (26 words)
+ * plus a shallow call */
+#define SIZING_STACK_MIN_HEADROOM_WORDS 32
+#define SIZING_STACK_ROUND_WORDS        8
+#define SIZING_HEAP_ROUND_BYTES         64
+
+/* Size defines known to the advisor */
+#define SIZING_MAX_TRACKED              16
+
+typedef enum {
+    SIZING_KIND_STACK = 0,              /* Task stack depth, in words */
+    SIZING_KIND_QUEUE                   /* Queue length, in items */
+} SizingKind_t;
+
+/*
+ * Each task stack and queue whose size is a define is registered with the
+ * name of that define (CREATE_TASK does this for every task in main.c).
+ * Peaks are lifetime values: the stack high water mark, the queue trace
+ * peak depth and the heap's minimum ever free size, so a run should cover
+ * every code path (button dump, "load", "sweep", deep sleep) first.
+ *
+ * Stream format ("sizing" command), sizes in the define's own units:
+ *   #szh <static|dynamic> <stack_margin_pct> <heap_margin_pct> <queue_margin_pct> <uptime_s>
+ *   #sz stack <task> <define|-> <depth_words> <peak_words> <rec_words>
+ *   #sz queue <queue> <define|-> <item_bytes> <length> <peak> <rec>
+ *   #sz heap configTOTAL_HEAP_SIZE <total_bytes> <peak_bytes> <rec_bytes>
+ *   #szd
+ * Spaces in names are sent as '_'. Untracked tasks and queues ("-") are
+ * listed but keep their size. In dynamic builds stacks and queue storage
+ * come from the heap, so the heap recommendation already assumes the
+ * recommended stack and queue sizes.
+ */
+
+/* Function prototypes */
+void SizingAdvisor_Track(SizingKind_t kind, const char *pcName, const char *pcDefine,
+                         uint32_t ulItemBytes);
+void SizingAdvisor_Report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SIZING_ADVISOR_H */
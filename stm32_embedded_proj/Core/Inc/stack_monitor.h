@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file    stack_monitor.h
+  * @brief   Stack Monitor - Incremental high water marks and growth trends
+  ******************************************************************************
+  * @attention
+  *
+  * The task create/delete hooks in FreeRTOSConfig.h pass the TCB and its
+  * stack bounds as void pointers, since the kernel's types are not yet
+  * declared where they are expanded.
+  *
+  ******************************************************************************
+  */
+
+#ifndef __STACK_MONITOR_H
+#define __STACK_MONITOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* FreeRTOSConfig.h defines STACK_MONITOR_HOOKED when its trace hooks feed
+ * the task registry; without it the profiler keeps using
+ * uxTaskGetSystemState() (host build) */
+
+/* Registry and scan budget */
+#ifndef STACK_MONITOR_MAX_TASKS
+#define STACK_MONITOR_MAX_TASKS         24
+#endif
+#define STACK_MONITOR_SCAN_WORDS        32      /* Words read per task per scan */
+#define STACK_MONITOR_FILL_WORD         0xA5A5A5A5UL    /* tskSTACK_FILL_BYTE x4 */
+
+/* Growth trend and early warning */
+#define STACK_MONITOR_TREND_MS          10000   /* Growth measured over this window... */
+#define STACK_MONITOR_TREND_ALPHA       0.25f   /* ...and smoothed with this EWMA weight */
+#define STACK_MONITOR_WARN_BYTES        64      /* Warn below this much free stack... */
+#define STACK_MONITOR_WARN_HORIZON_S    3600    /* ...or when the trend exhausts it sooner */
+
+/*
+ * Each task keeps a cached high water mark (free words above the stack
+ * base). StackMonitor_Scan(), called once per profiler sample, does two
+ * things per task within STACK_MONITOR_SCAN_WORDS reads:
+ *  - checks the word just below the cached mark and walks down while it
+ *    has been written, which catches ordinary deepening immediately;
+ *  - advances a sweep from the stack base up to the mark, which catches
+ *    frames that skipped words (large, partly written locals).
+ * The mark only ever decreases, and it equals what
+ * uxTaskGetStackHighWaterMark() would return once the sweep has passed
+ * since the stack was last deepened. Until a task's first sweep completes
+ * StackMonitor_GetFree() reports "not ready" and the profiler falls back to
+ * the kernel's full scan for that task.
+ */
+
+/* Function prototypes */
+void StackMonitor_TaskCreated(void *pvTask, void *pvStackBase, void *pvStackEnd);
+void StackMonitor_TaskDeleted(void *pvTask);
+void StackMonitor_Scan(void);
+uint32_t StackMonitor_GetTaskCount(void);
+void *StackMonitor_GetTask(uint32_t index);
+uint32_t StackMonitor_GetSize(uint32_t index);
+uint8_t StackMonitor_GetFree(uint32_t index, uint32_t *pulFreeWords);
+uint32_t StackMonitor_GetGrowth(void *pvTask);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STACK_MONITOR_H */
@@ -19,8 +19,12 @@ void MemManage_Handler(void);
 void BusFault_Handler(void);
 void UsageFault_Handler(void);
 void DebugMon_Handler(void);
+void EXTI1_IRQHandler(void);
 void EXTI15_10_IRQHandler(void);
 void USART2_IRQHandler(void);
+void TIM3_IRQHandler(void);
+void ADC_IRQHandler(void);
+void DMA2_Stream0_IRQHandler(void);
 
 #ifdef __cplusplus
 }
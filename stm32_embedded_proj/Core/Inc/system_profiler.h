@@ -15,33 +15,105 @@ extern "C" {
 #include <stdint.h>
 #include "FreeRTOS.h"
 #include "task.h"
+#include "clock_governor.h"
+#include "energy_model.h"
+#include "uart_transport.h"
+#include "user_metrics.h"
+#include "queue_trace.h"
+#include "mutex_trace.h"
+#include "analog_monitor.h"
+#include "profiler_overhead.h"
+#include "idle_load.h"
+#include "pool_alloc.h"
+#include "report_schema.h"
 
-/* Maximum number of tasks to track */
+/* Maximum number of tasks to track (the host build raises it) */
+#ifndef MAX_TASKS
 #define MAX_TASKS                 16
+#endif
+
+/* Default runtime configuration */
+#define PROFILER_DEFAULT_SAMPLE_MS      100
+#define PROFILER_DEFAULT_REPORT_EVERY   10     /* Samples per report (1 second) */
+#define PROFILER_MIN_SAMPLE_MS          10
+#define PROFILER_MAX_SAMPLE_MS          10000
+
+/* CPU load estimator at boot (production builds without per-task detail: 1) */
+#ifndef PROFILER_DEFAULT_CPU_LOAD_MODE
+#define PROFILER_DEFAULT_CPU_LOAD_MODE  CPU_LOAD_MODE_RUNTIME
+#endif
+
+/* Maximum number of task names in a subscription filter */
+#define REPORT_TASK_FILTER_MAX          4
 
-/* Task statistics structure */
+/* Per-stream field subscription */
 typedef struct {
-    char taskName[16];
-    float runtimePercent;
-    uint32_t stackFree;
+    volatile uint32_t fieldMask;        /* REPORT_FIELD_x */
+    volatile uint8_t taskFieldMask;     /* TASK_FIELD_x */
+    volatile uint8_t taskFilterCount;   /* 0 = all tasks */
+    char taskFilter[REPORT_TASK_FILTER_MAX][configMAX_TASK_NAME_LEN];
+} ReportSubscription_t;
+
+/* Report output formats */
+typedef enum {
+    REPORT_FORMAT_PRETTY = 0,   /* Multi-line JSON */
+    REPORT_FORMAT_COMPACT = 1,  /* Single-line JSON */
+    REPORT_FORMAT_BINARY = 2    /* Framed little-endian binary */
+} ReportFormat_t;
+
+/* CPU load estimators */
+typedef enum {
+    CPU_LOAD_MODE_RUNTIME = 0,  /* Idle task run-time counters (uxTaskGetSystemState) */
+    CPU_LOAD_MODE_IDLE = 1,     /* Calibrated idle loop count */
+    CPU_LOAD_MODE_COMPARE = 2   /* Both, runtime reported, idle error and cost tracked */
+} CpuLoadMode_t;
+
+/* Runtime configuration (written by the command channel, read by tasks) */
+typedef struct {
+    volatile uint32_t samplePeriodMs;
+    volatile uint32_t reportEverySamples;
+    volatile ReportFormat_t format;
+    volatile uint8_t verbosity;       /* 0 = reports only, 1 = status messages */
+    volatile uint8_t paused;          /* 1 = periodic reports suppressed */
+    volatile CpuLoadMode_t loadMode;
+    ReportSubscription_t subscription;
+} ProfilerConfig_t;
+
+/* Report structs, generated from the tables in report_schema.h */
+typedef struct {
+    REPORT_APPLY(REPORT_SCHEMA_TASK, REPORT_DECLARE)
 } TaskStats_t;
 
+typedef struct {
+    REPORT_APPLY(REPORT_SCHEMA_CLOCK, REPORT_DECLARE)
+} ReportClock_t;
+
+typedef struct {
+    REPORT_APPLY(REPORT_SCHEMA_POWER, REPORT_DECLARE)
+} ReportPower_t;
+
+typedef struct {
+    REPORT_APPLY(REPORT_SCHEMA_LINK, REPORT_DECLARE)
+} ReportLink_t;
+
+typedef struct {
+    REPORT_APPLY(REPORT_SCHEMA_SUPPLY, REPORT_DECLARE)
+} ReportSupply_t;
+
 /* System report structure */
 typedef struct {
-    uint32_t timestamp;
-    float cpuLoad;
-    uint32_t heapFree;
-    uint32_t heapMin;
-    float fragPercent;
-    uint8_t taskCount;
-    TaskStats_t tasks[MAX_TASKS];
-    float temperature;
+    uint32_t fieldMask;               /* Fields collected (REPORT_FIELD_x) */
+    uint8_t taskFieldMask;            /* Per-task fields collected (TASK_FIELD_x) */
+    REPORT_APPLY(REPORT_SCHEMA_REPORT, REPORT_DECLARE)
 } SystemReport_t;
 
 /* Function prototypes */
-void CollectSystemStats(SystemReport_t *report);
-float CalculateCPULoad(void);
+void CollectSystemStats(SystemReport_t *report, const ReportSubscription_t *subscription);
+float CalculateCPULoad(uint8_t fullSample);
 float CalculateHeapFragmentation(void);
+uint8_t GetBufferedStats(uint8_t index, SystemReport_t *report);
+uint8_t GetBufferedStatsCount(void);
+ProfilerConfig_t* GetProfilerConfig(void);
 
 #ifdef __cplusplus
 }
@@ -15,39 +15,73 @@ extern "C" {
 #include <stdint.h>
 #include "FreeRTOS.h"
 
-/* Performance metrics structure */
+/* Pass/fail checks (TestMetrics_EvaluateChecks) */
+#define TEST_CHECK_CPU            0x01    /* Average CPU load < 5% */
+#define TEST_CHECK_LATENCY        0x02    /* IRQ to JSON latency < 10 ms */
+#define TEST_CHECK_HEAP           0x04    /* Min free >= SIZING_HEAP_MARGIN_PCT of peak use */
+#define TEST_CHECK_POWER          0x08    /* Deep sleep entered at least once */
+#define TEST_CHECK_COUNT          4
+
+/* Aggregation windows of every series */
+#define TEST_WINDOW_1S            0       /* Last completed second */
+#define TEST_WINDOW_1MIN          1       /* Rolling, advances every 10 s */
+#define TEST_WINDOW_1H            2       /* Rolling, advances every 5 min */
+#define TEST_WINDOW_COUNT         3
+
+/* One aggregation window */
 typedef struct {
-    /* CPU Metrics */
-    float avgCpuLoad;
-    float maxCpuLoad;
-    float minCpuLoad;
-    uint32_t profileCycleCount;
-    
-    /* Latency Metrics (in milliseconds) */
-    uint32_t irqToJsonMinLatency;
-    uint32_t irqToJsonMaxLatency;
-    uint32_t irqToJsonAvgLatency;
-    uint32_t jsonTransmitCount;
-    
-    /* Heap Metrics */
-    uint32_t minHeapFree;
-    uint32_t avgHeapFree;
+    uint32_t count;
+    float mean;
+    float min;
+    float max;
+} TestMetricsWindow_t;
+
+/* One sampled quantity, cumulative since reset plus the rolling windows */
+typedef struct {
+    uint32_t count;
+    float mean;                       /* 64-bit sum / count */
+    float stddev;                     /* Welford, population */
+    float min;
+    float max;
+    TestMetricsWindow_t window[TEST_WINDOW_COUNT];
+} TestMetricsSeries_t;
+
+/* Performance metrics snapshot (TestMetrics_Snapshot) */
+typedef struct {
+    /* Sampled series */
+    TestMetricsSeries_t cpuLoad;      /* Percent */
+    TestMetricsSeries_t latency;      /* IRQ to JSON, milliseconds */
+    TestMetricsSeries_t heapFree;     /* Bytes */
     float heapFragmentationMax;
-    
+
     /* Stability Metrics */
     uint32_t uptimeSeconds;
     uint32_t watchdogFeedCount;
     uint32_t stackOverflowCount;
     uint32_t mallocFailureCount;
-    
+    uint32_t watchdogLoopMaxUs;       /* Longest watchdog loop body */
+    uint32_t watchdogJitterMaxUs;     /* Largest deviation from the 500 ms period */
+
     /* Sleep Metrics */
     uint32_t deepSleepEntryCount;
     uint32_t totalDeepSleepMs;
     uint32_t lastWakeupLatencyMs;
 } TestMetrics_t;
 
+/*
+ * Recording never blocks or masks interrupts, so every recorder may be
+ * called from tasks and ISRs alike:
+ *   - counters and maxima are LDREX/STREX updates, any number of writers
+ *   - each sampled series has exactly one writer context:
+ *       cpuLoad, heapFree  ProfilerTask
+ *       latency            ReportTask
+ * Readers copy a series' published state and retry if the writer published
+ * again meanwhile; a writer preempted mid-update never stalls a reader.
+ */
+
 /* Function prototypes */
 void TestMetrics_Init(void);
+void TestMetrics_Reset(void);
 void TestMetrics_RecordCpuLoad(float cpuLoad);
 void TestMetrics_RecordIrqToJsonLatency(uint32_t latencyMs);
 void TestMetrics_RecordHeapStatus(uint32_t heapFree, float fragmentation);
@@ -55,8 +89,11 @@ void TestMetrics_IncrementWatchdogFeed(void);
 void TestMetrics_IncrementStackOverflow(void);
 void TestMetrics_IncrementMallocFailure(void);
 void TestMetrics_RecordDeepSleep(uint32_t durationMs, uint32_t wakeupLatencyMs);
-TestMetrics_t* TestMetrics_GetMetrics(void);
-void TestMetrics_PrintReport(void);
+void TestMetrics_RecordWatchdogTiming(uint32_t loopUs, uint32_t jitterUs);
+void TestMetrics_Snapshot(TestMetrics_t *metrics);
+void TestMetrics_RequestReport(void);
+uint8_t TestMetrics_GetReport(TestMetrics_t *snapshot);
+uint8_t TestMetrics_EvaluateChecks(const TestMetrics_t *metrics);
 float TestMetrics_GetAverageCpuLoad(void);
 uint32_t TestMetrics_GetUptimeSeconds(void);
 uint8_t TestMetrics_IsCpuOverheadAcceptable(void);
@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file    uart_transport.h
+  * @brief   UART Transport Layer - Baud negotiation and link statistics
+  ******************************************************************************
+  */
+
+#ifndef __UART_TRANSPORT_H
+#define __UART_TRANSPORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32f4xx_hal.h"
+
+/* Link configuration */
+#define TRANSPORT_DEFAULT_BAUD          115200
+#define TRANSPORT_MAX_BAUD_ERROR_PPM    20000   /* 2% total divider error */
+#define TRANSPORT_CONFIRM_TIMEOUT_MS    2000    /* Host must talk at the new rate within this */
+#define TRANSPORT_RX_ERROR_LIMIT        8       /* RX errors per window before falling back */
+#define TRANSPORT_STATS_WINDOW_MS       1000
+
+/* Link statistics */
+typedef struct {
+    uint32_t ulBaudRate;          /* Active baud rate */
+    uint32_t ulBytesSent;         /* Total bytes written to the wire */
+    uint32_t ulFramesSent;        /* Successful Transport_Write() calls */
+    uint32_t ulTxErrors;          /* Write timeouts / busy */
+    uint32_t ulRxErrors;          /* Framing, noise and overrun errors */
+    uint32_t ulFallbacks;         /* Reverts to a slower rate */
+    uint32_t ulBytesPerSec;       /* Throughput over the last stats window */
+    float fUtilisationPct;        /* Throughput relative to wire capacity */
+} TransportStats_t;
+
+/* Function prototypes */
+void Transport_Init(void);
+HAL_StatusTypeDef Transport_Write(const uint8_t *data, uint16_t length, uint32_t timeout);
+void Transport_Suspend(void);
+void Transport_Resume(void);
+uint8_t Transport_IsBaudSupported(uint32_t baud);
+uint8_t Transport_IsClockSupported(uint32_t pclkHz);
+void Transport_SetBaud(uint32_t baud);
+void Transport_Confirm(void);
+void Transport_Poll(void);
+void Transport_RecordRxError(void);
+void Transport_ApplyClock(void);
+void Transport_GetStats(TransportStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UART_TRANSPORT_H */
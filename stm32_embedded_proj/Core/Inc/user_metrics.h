@@ -0,0 +1,81 @@
+/**
+  ******************************************************************************
+  * @file    user_metrics.h
+  * @brief   User Instrumentation API - Application spans, counters and gauges
+  ******************************************************************************
+  */
+
+#ifndef __USER_METRICS_H
+#define __USER_METRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Registry sizes (every slot is carried in each SystemReport_t) */
+#define USER_MAX_SPANS            4
+#define USER_MAX_COUNTERS         4
+#define USER_MAX_GAUGES           4
+#define USER_SPAN_HIST_BINS       8       /* x4 cycle buckets: <64, <256, ... >=256K */
+#define USER_METRIC_INVALID       0xFF    /* Returned when a table is full */
+#define USER_METRIC_NAME_MAX      15      /* Longer names are truncated in binary frames */
+
+/* Per-span snapshot (cumulative since boot) */
+typedef struct {
+    const char *name;
+    uint32_t count;
+    uint64_t totalCycles;
+    uint32_t maxCycles;
+    uint16_t hist[USER_SPAN_HIST_BINS];   /* Saturating */
+} UserSpanStats_t;
+
+typedef struct {
+    const char *name;
+    uint32_t value;
+} UserCounterStats_t;
+
+typedef struct {
+    const char *name;
+    int32_t value;
+} UserGaugeStats_t;
+
+/* Registry snapshot carried in SystemReport_t */
+typedef struct {
+    uint8_t spanCount;
+    uint8_t counterCount;
+    uint8_t gaugeCount;
+    UserSpanStats_t spans[USER_MAX_SPANS];
+    UserCounterStats_t counters[USER_MAX_COUNTERS];
+    UserGaugeStats_t gauges[USER_MAX_GAUGES];
+} UserMetricsReport_t;
+
+/*
+ * Registration (task context, normally at startup) returns a small id;
+ * names must stay valid for the lifetime of the program.
+ *
+ * Recording is constant time, lock-free and ISR-safe:
+ *   uint32_t start = Profiler_SpanBegin(id);
+ *   ...hot path...
+ *   Profiler_SpanEnd(id, start);
+ *
+ * Span durations are DWT cycles at the clock that was running, so they
+ * stretch when the clock governor lowers the frequency.
+ */
+
+/* Function prototypes */
+uint8_t Profiler_SpanRegister(const char *name);
+uint32_t Profiler_SpanBegin(uint8_t span);
+void Profiler_SpanEnd(uint8_t span, uint32_t startCycles);
+uint8_t Profiler_CounterRegister(const char *name);
+void Profiler_CounterAdd(uint8_t counter, uint32_t delta);
+uint8_t Profiler_GaugeRegister(const char *name);
+void Profiler_GaugeSet(uint8_t gauge, int32_t value);
+void Profiler_GetUserMetrics(UserMetricsReport_t *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USER_METRICS_H */
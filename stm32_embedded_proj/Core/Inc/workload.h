@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+  * @file    workload.h
+  * @brief   Synthetic Workload Generator - Profiler scaling against task count
+  ******************************************************************************
+  */
+
+#ifndef __WORKLOAD_H
+#define __WORKLOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "system_profiler.h"
+
+/* Worker table (RAM: ~32 bytes per slot; stacks and TCBs come from the heap) */
+#ifndef WORKLOAD_MAX_TASKS
+#define WORKLOAD_MAX_TASKS          48
+#endif
+#define WORKLOAD_STACK_TOUCH_MAX    128     /* Bytes of stack a worker may dirty */
+#define WORKLOAD_STACK_WORDS        (configMINIMAL_STACK_SIZE + WORKLOAD_STACK_TOUCH_MAX / sizeof(StackType_t))
+#define WORKLOAD_MAX_BLOCKS         4       /* Heap blocks held per worker */
+#define WORKLOAD_SWEEP_PRIORITY     2       /* Above the default workers, below ProfilerTask */
+#define WORKLOAD_SWEEP_STACK        384
+
+/* Defaults (command "load <n>" / "sweep") */
+#define WORKLOAD_DEFAULT_DUTY_PCT   1
+#define WORKLOAD_DEFAULT_PERIOD_MS  20
+#define WORKLOAD_DEFAULT_SETTLE_MS  2000
+#define WORKLOAD_DEFAULT_MEASURE_MS 10000
+
+/* Per-worker behaviour, applied to all N workers */
+typedef struct {
+    uint8_t taskCount;                /* N */
+    uint8_t dutyPct;                  /* Busy share of each period, per worker */
+    uint16_t periodMs;
+    uint8_t priorityMin;              /* Workers spread round-robin over */
+    uint8_t priorityMax;              /* [priorityMin, priorityMax] */
+    uint8_t pingPong;                 /* Pair workers (0,1), (2,3)... through queues */
+    uint8_t allocsPerPeriod;          /* Heap churn, 0 = none */
+    uint16_t stackTouchBytes;         /* Stack dirtied per period */
+    uint16_t allocMinBytes;
+    uint16_t allocMaxBytes;
+} WorkloadConfig_t;
+
+/* Sweep over N: startN, startN + stepN, ... endN */
+typedef struct {
+    uint8_t startN;
+    uint8_t endN;
+    uint8_t stepN;
+    uint16_t settleMs;
+    uint16_t measureMs;
+} WorkloadSweep_t;
+
+/* One point of the scaling curve */
+typedef struct {
+    uint8_t requested;                /* N asked for */
+    uint8_t spawned;                  /* N created (heap permitting) */
+    uint8_t tasksReported;            /* Largest report task list seen */
+    uint32_t samples;                 /* Profiler samples in the window */
+    float expectedLoad;               /* Idle baseline + spawned * duty */
+    float measuredLoad;               /* Mean profiler cpu_load */
+    uint32_t collectUs;               /* Mean CollectSystemStats() time */
+    uint32_t formatUs;                /* Mean report formatting time */
+    uint32_t heapFree;                /* Lowest heap_free in the window */
+    uint32_t heapMin;
+    uint32_t allocFailures;
+    uint32_t allocCycles;             /* Mean pvPortMalloc() cost in the window */
+    uint32_t freeCycles;              /* Mean vPortFree() cost */
+    float poolHitPct;                 /* Allocations served by a pool */
+    float fragPct;                    /* Worst 1 - largest free block / free heap */
+} WorkloadStep_t;
+
+/*
+ * Workers spin for dutyPct of every period (cycle counter, bounded by the
+ * tick so an unmodelled DWT cannot hang them), dirty part of their stack,
+ * optionally ping-pong a token with their partner and free/allocate random
+ * heap blocks. Workload_OnSample() is fed every profiler sample; a sweep
+ * turns the samples, the "collect"/"format" span deltas and the allocator
+ * counter deltas of each window into one "#wl" line per N.
+ */
+
+/* Function prototypes */
+void Workload_DefaultConfig(WorkloadConfig_t *config);
+uint8_t Workload_Start(const WorkloadConfig_t *config);
+void Workload_Stop(void);
+uint8_t Workload_GetActiveCount(void);
+uint8_t Workload_StartSweep(const WorkloadConfig_t *config, const WorkloadSweep_t *sweep);
+uint8_t Workload_IsSweepRunning(void);
+void Workload_OnSample(const SystemReport_t *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WORKLOAD_H */
@@ -0,0 +1,278 @@
+/**
+  ******************************************************************************
+  * @file    analog_monitor.c
+  * @brief   Analog Monitor Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * ADC1 runs a two-channel continuous scan (VREFINT, IN18) at 480 sampling
+  * cycles, the minimum the temperature sensor needs at a 21 MHz ADC clock.
+  * DMA2 Stream0 moves the results into a circular buffer and interrupts at
+  * half and full transfer. With PCLK2 / 4 at 84 MHz a pair takes ~47 us, so
+  * a block of ANALOG_OVERSAMPLE pairs completes every ~3 ms.
+  *
+  * Averages are kept x16 (oversampling adds ~3 bits). VDDA follows from
+  * VREFINT_CAL, the temperature sensor reading is rescaled to the 3.3 V
+  * calibration supply before interpolating between TS_CAL1 and TS_CAL2.
+  *
+  * The VBAT bridge draws from the battery while VBATE is set, so it is
+  * enabled for two blocks (~6 ms) every ANALOG_VBAT_EVERY blocks and never
+  * across STOP mode.
+  *
+  ******************************************************************************
+  */
+
+#include "analog_monitor.h"
+#include "main.h"
+
+#define DMA_BUFFER_PAIRS        (2 * ANALOG_OVERSAMPLE)
+#define ANALOG_CH_VREFINT       17
+#define ANALOG_CH_IN18          18
+#define ANALOG_SMP_480_CYCLES   7U
+
+/* What IN18 holds in the block that just completed */
+typedef enum {
+    PHASE_SETTLE = 0,           /* First block after (re)start: VDDA only */
+    PHASE_TEMP,
+    PHASE_TO_VBAT,              /* VBATE set during this block: VDDA only */
+    PHASE_VBAT,
+    PHASE_TO_TEMP               /* VBATE cleared during this block: VDDA only */
+} AnalogPhase_t;
+
+/* Static variables */
+static uint16_t usDmaBuffer[DMA_BUFFER_PAIRS * 2];
+static uint8_t ucPhase = PHASE_SETTLE;
+static uint32_t ulBlocksSinceVbat = 0;
+static uint32_t ulVrefintCal = 0;
+static uint32_t ulTsCal1 = 0;
+static uint32_t ulTsCal2 = 0;
+
+/* Published readings, one word each */
+static volatile int32_t lTempCentiC = 0;
+static volatile uint32_t ulVddaMv = 0;
+static volatile uint32_t ulVbatMv = 0;
+static volatile uint32_t ulBlocks = 0;
+static volatile uint32_t ulRestarts = 0;
+static uint8_t ucTempValid = 0;
+
+/* Private function prototypes */
+static void Start(void);
+static void Stop(void);
+static void ProcessBlock(const uint16_t *pusBlock);
+
+/**
+  * @brief  Configure ADC1 and DMA2 Stream0 and start the scan
+  * @retval None
+  */
+void AnalogMonitor_Init(void)
+{
+    ulVrefintCal = *ANALOG_VREFINT_CAL_ADDR;
+    ulTsCal1 = *ANALOG_TS_CAL1_ADDR;
+    ulTsCal2 = *ANALOG_TS_CAL2_ADDR;
+
+    __HAL_RCC_ADC1_CLK_ENABLE();
+    __HAL_RCC_DMA2_CLK_ENABLE();
+
+    /* PCLK2 / 4, temperature sensor and VREFINT on, VBAT bridge off */
+    ADC1_COMMON->CCR = ADC_CCR_ADCPRE_0 | ADC_CCR_TSVREFE;
+
+    ADC1->CR2 = 0;
+    ADC1->CR1 = ADC_CR1_SCAN | ADC_CR1_OVRIE;
+    ADC1->SMPR1 = (ANALOG_SMP_480_CYCLES << ADC_SMPR1_SMP17_Pos) |
+                  (ANALOG_SMP_480_CYCLES << ADC_SMPR1_SMP18_Pos);
+    ADC1->SQR1 = (2U - 1U) << ADC_SQR1_L_Pos;
+    ADC1->SQR3 = (ANALOG_CH_VREFINT << ADC_SQR3_SQ1_Pos) |
+                 (ANALOG_CH_IN18 << ADC_SQR3_SQ2_Pos);
+
+    HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, ANALOG_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+    HAL_NVIC_SetPriority(ADC_IRQn, ANALOG_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(ADC_IRQn);
+
+    Start();
+}
+
+/**
+  * @brief  Stop conversions and drop the VBAT bridge (before STOP mode)
+  * @retval None
+  */
+void AnalogMonitor_Suspend(void)
+{
+    Stop();
+}
+
+/**
+  * @brief  Restart conversions (after STOP mode)
+  * @retval None
+  */
+void AnalogMonitor_Resume(void)
+{
+    Start();
+}
+
+/**
+  * @brief  Latest calibrated readings (any context, never blocks)
+  * @param  readings: Output
+  * @retval None
+  */
+void AnalogMonitor_GetReadings(AnalogReadings_t *readings)
+{
+    readings->tempCentiC = lTempCentiC;
+    readings->vddaMv = ulVddaMv;
+    readings->vbatMv = ulVbatMv;
+    readings->blocks = ulBlocks;
+    readings->restarts = ulRestarts;
+}
+
+/**
+  * @brief  DMA2 Stream0 interrupt: a half-buffer block is complete
+  * @retval None
+  */
+void AnalogMonitor_DmaIrq(void)
+{
+    uint32_t ulFlags = DMA2->LISR;
+
+    if (ulFlags & (DMA_LISR_TEIF0 | DMA_LISR_DMEIF0)) {
+        ulRestarts++;
+        Stop();
+        Start();
+        return;
+    }
+
+    if (ulFlags & DMA_LISR_HTIF0) {
+        DMA2->LIFCR = DMA_LIFCR_CHTIF0;
+        ProcessBlock(&usDmaBuffer[0]);
+    }
+    if (ulFlags & DMA_LISR_TCIF0) {
+        DMA2->LIFCR = DMA_LIFCR_CTCIF0;
+        ProcessBlock(&usDmaBuffer[DMA_BUFFER_PAIRS]);
+    }
+}
+
+/**
+  * @brief  ADC interrupt: overrun stops DMA requests, so restart the scan
+  * @retval None
+  */
+void AnalogMonitor_AdcIrq(void)
+{
+    if (ADC1->SR & ADC_SR_OVR) {
+        ulRestarts++;
+        Stop();
+        Start();
+    }
+}
+
+/**
+  * @brief  Arm the circular DMA and start a continuous scan
+  * @retval None
+  */
+static void Start(void)
+{
+    DMA2_Stream0->PAR = (uint32_t)&ADC1->DR;
+    DMA2_Stream0->M0AR = (uint32_t)usDmaBuffer;
+    DMA2_Stream0->NDTR = DMA_BUFFER_PAIRS * 2;
+    DMA2_Stream0->FCR = 0;                              /* Direct mode */
+    DMA2_Stream0->CR = (0U << DMA_SxCR_CHSEL_Pos) |     /* Channel 0 = ADC1 */
+                       DMA_SxCR_MSIZE_0 | DMA_SxCR_PSIZE_0 |
+                       DMA_SxCR_MINC | DMA_SxCR_CIRC |
+                       DMA_SxCR_HTIE | DMA_SxCR_TCIE | DMA_SxCR_TEIE | DMA_SxCR_DMEIE;
+    DMA2->LIFCR = DMA_LIFCR_CTCIF0 | DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTEIF0 |
+                  DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CFEIF0;
+    DMA2_Stream0->CR |= DMA_SxCR_EN;
+
+    ucPhase = PHASE_SETTLE;
+    ulBlocksSinceVbat = 0;
+
+    ADC1->SR = 0;
+    ADC1->CR2 = ADC_CR2_CONT | ADC_CR2_DMA | ADC_CR2_DDS | ADC_CR2_ADON;
+    ADC1->CR2 |= ADC_CR2_SWSTART;
+}
+
+/**
+  * @brief  Stop the ADC and DMA and switch the VBAT bridge off
+  * @retval None
+  */
+static void Stop(void)
+{
+    ADC1->CR2 = 0;
+    ADC1_COMMON->CCR &= ~ADC_CCR_VBATE;
+
+    DMA2_Stream0->CR &= ~DMA_SxCR_EN;
+    while (DMA2_Stream0->CR & DMA_SxCR_EN) {
+    }
+    DMA2->LIFCR = DMA_LIFCR_CTCIF0 | DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTEIF0 |
+                  DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CFEIF0;
+}
+
+/**
+  * @brief  Average one block, calibrate and advance the VBAT schedule
+  * @param  pusBlock: ANALOG_OVERSAMPLE (VREFINT, IN18) pairs
+  * @retval None
+  */
+static void ProcessBlock(const uint16_t *pusBlock)
+{
+    uint32_t ulVrefSum = 0;
+    uint32_t ulIn18Sum = 0;
+    uint32_t ulVref16;
+    uint32_t ulIn18x16;
+    uint32_t ulVdda;
+
+    for (uint32_t i = 0; i < ANALOG_OVERSAMPLE; i++) {
+        ulVrefSum += pusBlock[2 * i];
+        ulIn18Sum += pusBlock[2 * i + 1];
+    }
+    ulVref16 = (ulVrefSum * 16U) / ANALOG_OVERSAMPLE;
+    ulIn18x16 = (ulIn18Sum * 16U) / ANALOG_OVERSAMPLE;
+
+    if (ulVref16 == 0) {
+        return;
+    }
+    ulVdda = (ANALOG_CAL_VDDA_MV * ulVrefintCal * 16U) / ulVref16;
+    ulVddaMv = ulVdda;
+
+    switch (ucPhase) {
+    case PHASE_TEMP: {
+        /* Sensor reading as it would have been at the 3.3 V calibration supply */
+        int32_t lTs16 = (int32_t)((ulIn18x16 * ulVdda) / ANALOG_CAL_VDDA_MV);
+        int32_t lSpan16 = (int32_t)(ulTsCal2 - ulTsCal1) * 16;
+        int32_t lTemp;
+
+        if (lSpan16 <= 0) {
+            break;
+        }
+        lTemp = ANALOG_TS_CAL1_C * 100 +
+                ((lTs16 - (int32_t)ulTsCal1 * 16) * (ANALOG_TS_CAL2_C - ANALOG_TS_CAL1_C) * 100) / lSpan16;
+
+        if (ucTempValid) {
+            lTempCentiC += (lTemp - lTempCentiC) >> ANALOG_TEMP_FILTER_SHIFT;
+        } else {
+            lTempCentiC = lTemp;
+            ucTempValid = 1;
+        }
+
+        if (++ulBlocksSinceVbat >= ANALOG_VBAT_EVERY) {
+            ADC1_COMMON->CCR |= ADC_CCR_VBATE;
+            ucPhase = PHASE_TO_VBAT;
+        }
+        break;
+    }
+
+    case PHASE_TO_VBAT:
+        ucPhase = PHASE_VBAT;
+        break;
+
+    case PHASE_VBAT:
+        ulVbatMv = (ulIn18x16 * ulVdda * ANALOG_VBAT_DIVIDER) / (4095U * 16U);
+        ADC1_COMMON->CCR &= ~ADC_CCR_VBATE;
+        ucPhase = PHASE_TO_TEMP;
+        break;
+
+    default:
+        /* PHASE_SETTLE, PHASE_TO_TEMP: IN18 is mixed, VDDA only */
+        ucPhase = PHASE_TEMP;
+        ulBlocksSinceVbat = 0;
+        break;
+    }
+
+    ulBlocks++;
+}
@@ -0,0 +1,311 @@
+/**
+  ******************************************************************************
+  * @file    burst_capture.c
+  * @brief   Burst Capture Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * Oscilloscope-style trigger engine. Every BURST_SAMPLE_MS the tick hook
+  * appends one sample to a ring and compares the trigger field against its
+  * threshold, at the same cost whether or not anything fires:
+  *
+  *   ARMED     - ring is filling; the trigger may fire once it holds
+  *               BURST_PRE_SAMPLES samples
+  *   TRIGGERED - ring keeps filling for the post-trigger samples
+  *   CAPTURED  - ring is frozen until BurstCapture_Stream() has written
+  *               it out from the low-priority report task, then re-arms
+  *
+  * A trigger set while a window is being streamed keeps the ring frozen
+  * and takes effect when the stream re-arms.
+  *
+  * CPU load per sample is DWT time spent outside idle-priority tasks,
+  * accumulated by the context switch hook. Both hooks run at the kernel
+  * interrupt priority and cannot preempt each other.
+  *
+  ******************************************************************************
+  */
+
+#include "burst_capture.h"
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "uart_transport.h"
+#include <stdio.h>
+#include <string.h>
+
+#define STREAM_BUFFER_SIZE    256
+
+typedef enum {
+    BURST_STATE_OFF = 0,
+    BURST_STATE_ARMED,
+    BURST_STATE_TRIGGERED,
+    BURST_STATE_CAPTURED
+} BurstState_t;
+
+/* Static variables */
+static BurstSample_t xRing[BURST_RING_SIZE];
+static uint8_t ucHead = 0;                      /* Next slot to write */
+static uint8_t ucFilled = 0;                    /* Samples since arming */
+static uint8_t ucPostRemaining = 0;
+static volatile uint8_t ucState = BURST_STATE_OFF;
+static uint8_t ucStreaming = 0;                 /* Stream() is reading the ring */
+
+static uint8_t ucField = BURST_DEFAULT_FIELD;
+static uint8_t ucOp = BURST_DEFAULT_OP;
+static uint32_t ulThreshold = BURST_DEFAULT_THRESHOLD;
+static uint32_t ulSequence = 0;
+static uint32_t ulTriggerTick = 0;
+
+/* Idle accounting (context switch hook) */
+static uint32_t ulTickDivider = 0;
+static uint32_t ulWindowStart = 0;
+static uint32_t ulIdleStart = 0;
+static uint32_t ulIdleCycles = 0;
+static uint8_t ucInIdle = 0;
+
+static const char * const pcFieldNames[BURST_FIELD_COUNT] = {
+    "cpu_load", "heap_free", "heap_min"
+};
+
+/* Private function prototypes */
+static uint16_t SampleCpuPermille(void);
+static uint8_t Evaluate(const BurstSample_t *pxSample);
+
+/**
+  * @brief  Arm the default trigger
+  * @retval None
+  */
+void BurstCapture_Init(void)
+{
+    ulWindowStart = DWT->CYCCNT;
+    BurstCapture_SetTrigger(BURST_DEFAULT_FIELD, BURST_DEFAULT_OP, BURST_DEFAULT_THRESHOLD);
+}
+
+/**
+  * @brief  Set the trigger condition and re-arm
+  * @note   While a window is being streamed the ring stays frozen; the
+  *         stream re-arms with the new condition when it completes
+  * @param  field: BurstField_t
+  * @param  op: BurstOp_t
+  * @param  threshold: Percent for cpu_load, bytes for the heap fields
+  * @retval 1 if applied, 0 if invalid
+  */
+uint8_t BurstCapture_SetTrigger(uint8_t field, uint8_t op, uint32_t threshold)
+{
+    uint32_t ulPrimask;
+
+    if (field >= BURST_FIELD_COUNT || op > BURST_OP_BELOW ||
+        (field == BURST_FIELD_CPU_LOAD && threshold > 100)) {
+        return 0;
+    }
+
+    ulPrimask = __get_PRIMASK();
+    __disable_irq();
+    ucField = field;
+    ucOp = op;
+    ulThreshold = (field == BURST_FIELD_CPU_LOAD) ? threshold * 10 : threshold;
+    if (ucStreaming) {
+        ucState = BURST_STATE_CAPTURED;
+    } else {
+        ucFilled = 0;
+        ucState = BURST_STATE_ARMED;
+    }
+    __set_PRIMASK(ulPrimask);
+
+    return 1;
+}
+
+/**
+  * @brief  Stop sampling and drop any pending capture
+  * @retval None
+  */
+void BurstCapture_Disable(void)
+{
+    ucState = BURST_STATE_OFF;
+}
+
+/**
+  * @brief  Report key of a trigger field
+  * @param  field: BurstField_t
+  * @retval Field name, NULL if out of range
+  */
+const char *BurstCapture_FieldName(uint8_t field)
+{
+    return (field < BURST_FIELD_COUNT) ? pcFieldNames[field] : NULL;
+}
+
+/**
+  * @brief  Sample and evaluate the trigger (tick hook, ISR context)
+  * @retval None
+  */
+void BurstCapture_Tick(void)
+{
+    BurstSample_t *pxSample;
+    uint16_t usCpu;
+
+    if (++ulTickDivider < pdMS_TO_TICKS(BURST_SAMPLE_MS)) {
+        return;
+    }
+    ulTickDivider = 0;
+
+    /* Close the load window even when frozen so the next one starts clean */
+    usCpu = SampleCpuPermille();
+    if (ucState == BURST_STATE_OFF || ucState == BURST_STATE_CAPTURED) {
+        return;
+    }
+
+    pxSample = &xRing[ucHead];
+    pxSample->tick = xTaskGetTickCountFromISR();
+    pxSample->heapFree = xPortGetFreeHeapSize();
+    pxSample->heapMin = xPortGetMinimumEverFreeHeapSize();
+    pxSample->cpuPermille = usCpu;
+    ucHead = (ucHead + 1) % BURST_RING_SIZE;
+    if (ucFilled < BURST_RING_SIZE) {
+        ucFilled++;
+    }
+
+    if (ucState == BURST_STATE_ARMED) {
+        if (ucFilled > BURST_PRE_SAMPLES && Evaluate(pxSample)) {
+            ulTriggerTick = pxSample->tick;
+            ucPostRemaining = BURST_RING_SIZE - BURST_PRE_SAMPLES - 1;
+            ucState = (ucPostRemaining > 0) ? BURST_STATE_TRIGGERED : BURST_STATE_CAPTURED;
+        }
+    } else if (--ucPostRemaining == 0) {
+        ucState = BURST_STATE_CAPTURED;
+    }
+}
+
+/**
+  * @brief  Track time spent in idle-priority tasks (traceTASK_SWITCHED_IN)
+  * @param  ulPriority: Priority of the task being switched in
+  * @retval None
+  */
+void BurstCapture_TaskSwitchedIn(uint32_t ulPriority)
+{
+    uint32_t ulNow = DWT->CYCCNT;
+
+    if (ucInIdle) {
+        ulIdleCycles += ulNow - ulIdleStart;
+    }
+    ucInIdle = (ulPriority == tskIDLE_PRIORITY);
+    ulIdleStart = ulNow;
+}
+
+/**
+  * @brief  Write out a captured window and re-arm (report task)
+  * @retval None
+  */
+void BurstCapture_Stream(void)
+{
+    static char buffer[STREAM_BUFFER_SIZE];
+    size_t xLen;
+    uint8_t ucIndex;
+    uint8_t ucStreamField, ucStreamOp;
+    uint32_t ulStreamThreshold;
+
+    /* Condition that fired; SetTrigger() may replace it while streaming */
+    taskENTER_CRITICAL();
+    if (ucState != BURST_STATE_CAPTURED) {
+        taskEXIT_CRITICAL();
+        return;
+    }
+    ucStreaming = 1;
+    ucStreamField = ucField;
+    ucStreamOp = ucOp;
+    ulStreamThreshold = ulThreshold;
+    taskEXIT_CRITICAL();
+
+    xLen = snprintf(buffer, sizeof(buffer), "#bst %lu %lu %s%c%lu %u %u\r\n",
+                    ++ulSequence, ulTriggerTick, pcFieldNames[ucStreamField],
+                    (ucStreamOp == BURST_OP_ABOVE) ? '>' : '<',
+                    (ucStreamField == BURST_FIELD_CPU_LOAD) ? ulStreamThreshold / 10 : ulStreamThreshold,
+                    BURST_SAMPLE_MS, BURST_RING_SIZE);
+
+    /* Frozen ring: ucHead is the oldest sample */
+    ucIndex = ucHead;
+    for (uint8_t i = 0; i < BURST_RING_SIZE; i++) {
+        const BurstSample_t *pxSample = &xRing[ucIndex];
+        char line[48];
+        int lineLen;
+
+        lineLen = snprintf(line, sizeof(line), "#bs %lu %u.%u %lu %lu\r\n",
+                           pxSample->tick, pxSample->cpuPermille / 10, pxSample->cpuPermille % 10,
+                           pxSample->heapFree, pxSample->heapMin);
+        if (xLen + lineLen >= sizeof(buffer)) {
+            Transport_Write((const uint8_t*)buffer, xLen, 1000);
+            xLen = 0;
+        }
+        memcpy(&buffer[xLen], line, lineLen);
+        xLen += lineLen;
+        ucIndex = (ucIndex + 1) % BURST_RING_SIZE;
+    }
+
+    if (xLen + 6 >= sizeof(buffer)) {
+        Transport_Write((const uint8_t*)buffer, xLen, 1000);
+        xLen = 0;
+    }
+    memcpy(&buffer[xLen], "#bse\r\n", 6);
+    xLen += 6;
+    Transport_Write((const uint8_t*)buffer, xLen, 1000);
+
+    /* Re-arm, with any trigger set meanwhile, unless disabled meanwhile */
+    taskENTER_CRITICAL();
+    if (ucState == BURST_STATE_CAPTURED) {
+        ucFilled = 0;
+        ucState = BURST_STATE_ARMED;
+    }
+    ucStreaming = 0;
+    taskEXIT_CRITICAL();
+}
+
+/**
+  * @brief  Busy time since the previous sample, relative to BURST_SAMPLE_MS
+  * @note   Cycles the core spends halted in sleep are neither busy nor
+  *         counted, so the window length comes from SystemCoreClock
+  * @retval Load in 0.1% units
+  */
+static uint16_t SampleCpuPermille(void)
+{
+    uint32_t ulNow = DWT->CYCCNT;
+    uint32_t ulWindowCycles = (SystemCoreClock / 1000UL) * BURST_SAMPLE_MS;
+    uint32_t ulElapsed = ulNow - ulWindowStart;
+    uint32_t ulBusy;
+
+    if (ucInIdle) {
+        ulIdleCycles += ulNow - ulIdleStart;
+        ulIdleStart = ulNow;
+    }
+
+    ulBusy = (ulElapsed > ulIdleCycles) ? ulElapsed - ulIdleCycles : 0;
+    ulWindowStart = ulNow;
+    ulIdleCycles = 0;
+
+    if (ulBusy >= ulWindowCycles) {
+        return 1000;
+    }
+    return (uint16_t)(((uint64_t)ulBusy * 1000ULL) / ulWindowCycles);
+}
+
+/**
+  * @brief  Test the trigger condition on a sample
+  * @param  pxSample: Newest sample
+  * @retval 1 if the condition holds
+  */
+static uint8_t Evaluate(const BurstSample_t *pxSample)
+{
+    uint32_t ulValue;
+
+    switch (ucField) {
+    case BURST_FIELD_CPU_LOAD:
+        ulValue = pxSample->cpuPermille;
+        break;
+    case BURST_FIELD_HEAP_FREE:
+        ulValue = pxSample->heapFree;
+        break;
+    default:
+        ulValue = pxSample->heapMin;
+        break;
+    }
+
+    return (ucOp == BURST_OP_ABOVE) ? (ulValue > ulThreshold) : (ulValue < ulThreshold);
+}
@@ -0,0 +1,294 @@
+/**
+  ******************************************************************************
+  * @file    clock_governor.c
+  * @brief   Dynamic Frequency Scaling Governor Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * The governor is fed the profiler's CPU load every sample period. Above
+  * CLOCK_GOV_UP_THRESHOLD it jumps straight to the fastest operating point;
+  * it only steps one level down after the load, scaled to the slower clock,
+  * has stayed under CLOCK_GOV_DOWN_THRESHOLD for CLOCK_GOV_DOWN_SAMPLES.
+  *
+  * Every switch re-derives the SysTick reload and the USART2 baud divider
+  * from the new clock tree, so the 1 kHz kernel tick, the tick-driven
+  * run-time stats counter and the negotiated baud rate are unaffected.
+  * Operating points whose APB1 clock cannot generate the active baud rate
+  * within tolerance are skipped while that rate is in use.
+  *
+  ******************************************************************************
+  */
+
+#include "clock_governor.h"
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "uart_transport.h"
+#include "pc_sampler.h"
+
+/* Upper bound on the TX drain wait before a switch (~1 byte at 115200) */
+#define UART_DRAIN_TIMEOUT_LOOPS    10000
+
+/* Operating point description */
+typedef struct {
+    uint32_t ulFrequencyHz;
+    uint8_t ucUsePll;
+    uint32_t ulPllN;
+    uint32_t ulPllP;
+    uint32_t ulApb1Divider;
+    uint32_t ulApb1Hz;
+    uint32_t ulFlashLatency;
+    uint32_t ulVoltageScale;
+} ClockOppConfig_t;
+
+/* HSI (16 MHz) / PLLM 16 gives a 1 MHz PLL input for every PLL point */
+static const ClockOppConfig_t xOppTable[CLOCK_OPP_COUNT] = {
+    [CLOCK_OPP_LOW]  = { 16000000, 0,   0, 0,             RCC_HCLK_DIV1, 16000000, FLASH_LATENCY_0, PWR_REGULATOR_VOLTAGE_SCALE3 },
+    [CLOCK_OPP_MID]  = { 42000000, 1, 336, RCC_PLLP_DIV8, RCC_HCLK_DIV1, 42000000, FLASH_LATENCY_1, PWR_REGULATOR_VOLTAGE_SCALE3 },
+    [CLOCK_OPP_HIGH] = { 84000000, 1, 336, RCC_PLLP_DIV4, RCC_HCLK_DIV2, 42000000, FLASH_LATENCY_2, PWR_REGULATOR_VOLTAGE_SCALE2 },
+};
+
+/* Static variables */
+static ClockOpp_t xCurrentOpp = CLOCK_OPP_HIGH;
+static uint32_t ulSwitchCount = 0;
+static uint32_t ulResidencyMs[CLOCK_OPP_COUNT] = {0};
+static TickType_t xLastAccountTick = 0;
+static uint32_t ulLowLoadSamples = 0;
+
+/* Private function prototypes */
+static void AccountResidency(void);
+static void ApplyOperatingPoint(const ClockOppConfig_t *cfg);
+static void ResyncTimebase(void);
+
+/**
+  * @brief  Initialize the governor (clock tree must be at CLOCK_OPP_HIGH)
+  * @retval None
+  */
+void ClockGovernor_Init(void)
+{
+    xCurrentOpp = CLOCK_OPP_HIGH;
+    ulSwitchCount = 0;
+    ulLowLoadSamples = 0;
+
+    for (uint8_t i = 0; i < CLOCK_OPP_COUNT; i++) {
+        ulResidencyMs[i] = 0;
+    }
+
+    xLastAccountTick = xTaskGetTickCount();
+}
+
+/**
+  * @brief  Feed a CPU load sample and change operating point if needed
+  * @param  cpuLoad: CPU load percentage (0.0-100.0) at the current clock
+  * @retval None
+  */
+void ClockGovernor_Update(float cpuLoad)
+{
+    if (cpuLoad > CLOCK_GOV_UP_THRESHOLD) {
+        ulLowLoadSamples = 0;
+        ClockGovernor_SetOpp(CLOCK_OPP_HIGH);
+        return;
+    }
+
+    if (xCurrentOpp == CLOCK_OPP_LOW) {
+        ulLowLoadSamples = 0;
+        return;
+    }
+
+    /* Project the load onto the next slower operating point */
+    ClockOpp_t lowerOpp = (ClockOpp_t)(xCurrentOpp - 1);
+    float projectedLoad = cpuLoad * ((float)xOppTable[xCurrentOpp].ulFrequencyHz /
+                                     (float)xOppTable[lowerOpp].ulFrequencyHz);
+
+    if (projectedLoad < CLOCK_GOV_DOWN_THRESHOLD) {
+        if (++ulLowLoadSamples >= CLOCK_GOV_DOWN_SAMPLES) {
+            ulLowLoadSamples = 0;
+            ClockGovernor_SetOpp(lowerOpp);
+        }
+    } else {
+        ulLowLoadSamples = 0;
+    }
+}
+
+/**
+  * @brief  Switch to a specific operating point
+  * @param  opp: Target operating point
+  * @retval None
+  */
+void ClockGovernor_SetOpp(ClockOpp_t opp)
+{
+    if (opp >= CLOCK_OPP_COUNT || opp == xCurrentOpp) {
+        return;
+    }
+
+#if PROFILER_QEMU
+    /* No clock tree to switch in the emulator; stay at the boot point */
+    return;
+#endif
+
+    /* e.g. 921600 baud cannot be derived from a 16 MHz APB1 */
+    if (!Transport_IsClockSupported(xOppTable[opp].ulApb1Hz)) {
+        return;
+    }
+
+    AccountResidency();
+
+    vTaskSuspendAll();
+    taskENTER_CRITICAL();
+
+    ApplyOperatingPoint(&xOppTable[opp]);
+    xCurrentOpp = opp;
+    ulSwitchCount++;
+
+    taskEXIT_CRITICAL();
+    xTaskResumeAll();
+}
+
+/**
+  * @brief  Notify the governor that SystemClock_Config() restored CLOCK_OPP_HIGH
+  *         (e.g. after wake-up from STOP mode)
+  * @retval None
+  */
+void ClockGovernor_OnClockReset(void)
+{
+    AccountResidency();
+
+    if (xCurrentOpp != CLOCK_OPP_HIGH) {
+        xCurrentOpp = CLOCK_OPP_HIGH;
+        ulSwitchCount++;
+    }
+
+    ulLowLoadSamples = 0;
+    ResyncTimebase();
+}
+
+/**
+  * @brief  Get current operating point
+  * @retval Current operating point
+  */
+ClockOpp_t ClockGovernor_GetCurrentOpp(void)
+{
+    return xCurrentOpp;
+}
+
+/**
+  * @brief  Get current HCLK frequency
+  * @retval Frequency in Hz
+  */
+uint32_t ClockGovernor_GetFrequencyHz(void)
+{
+    return xOppTable[xCurrentOpp].ulFrequencyHz;
+}
+
+/**
+  * @brief  Get governor statistics
+  * @param  stats: Pointer to output statistics structure
+  * @retval None
+  */
+void ClockGovernor_GetStats(ClockGovernorStats_t *stats)
+{
+    AccountResidency();
+
+    stats->currentOpp = xCurrentOpp;
+    stats->ulFrequencyHz = xOppTable[xCurrentOpp].ulFrequencyHz;
+    stats->ulSwitchCount = ulSwitchCount;
+
+    for (uint8_t i = 0; i < CLOCK_OPP_COUNT; i++) {
+        stats->ulResidencyMs[i] = ulResidencyMs[i];
+    }
+}
+
+/**
+  * @brief  Credit elapsed time to the current operating point
+  * @retval None
+  */
+static void AccountResidency(void)
+{
+    TickType_t xNow = xTaskGetTickCount();
+
+    ulResidencyMs[xCurrentOpp] += (xNow - xLastAccountTick) * portTICK_PERIOD_MS;
+    xLastAccountTick = xNow;
+}
+
+/**
+  * @brief  Reprogram PLL, bus dividers, flash wait states and regulator scale
+  * @param  cfg: Target operating point
+  * @retval None
+  */
+static void ApplyOperatingPoint(const ClockOppConfig_t *cfg)
+{
+    RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+    RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+    extern UART_HandleTypeDef huart2;
+    uint32_t ulTimeout = UART_DRAIN_TIMEOUT_LOOPS;
+
+    /* Let the byte in flight leave the shift register at the old baud rate */
+    while (!__HAL_UART_GET_FLAG(&huart2, UART_FLAG_TC) && --ulTimeout) {
+    }
+
+    RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK
+                                |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
+    RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
+    RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
+
+    /* Run from HSI while the PLL is reconfigured */
+    RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
+    RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
+    if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_0) != HAL_OK) {
+        Error_Handler();
+    }
+
+    /* VOS can only be changed while the PLL is off */
+    RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI;
+    RCC_OscInitStruct.HSIState = RCC_HSI_ON;
+    RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+    RCC_OscInitStruct.PLL.PLLState = RCC_PLL_OFF;
+    if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK) {
+        Error_Handler();
+    }
+
+    __HAL_PWR_VOLTAGESCALING_CONFIG(cfg->ulVoltageScale);
+
+    if (cfg->ucUsePll) {
+        RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
+        RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSI;
+        RCC_OscInitStruct.PLL.PLLM = 16;
+        RCC_OscInitStruct.PLL.PLLN = cfg->ulPllN;
+        RCC_OscInitStruct.PLL.PLLP = cfg->ulPllP;
+        RCC_OscInitStruct.PLL.PLLQ = 7;
+        if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK) {
+            Error_Handler();
+        }
+
+        RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+        RCC_ClkInitStruct.APB1CLKDivider = cfg->ulApb1Divider;
+        if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, cfg->ulFlashLatency) != HAL_OK) {
+            Error_Handler();
+        }
+    }
+
+    ResyncTimebase();
+}
+
+/**
+  * @brief  Restore the 1 kHz kernel tick, USART2 baud rate and sampler rate
+  *         after a clock change
+  * @note   HAL_RCC_ClockConfig() re-runs HAL_InitTick(), which also rewrites the
+  *         SysTick priority; FreeRTOS requires it at the lowest level.
+  * @retval None
+  */
+static void ResyncTimebase(void)
+{
+#if !PROFILER_QEMU
+    SystemCoreClockUpdate();
+#endif
+
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = (SystemCoreClock / configTICK_RATE_HZ) - 1UL;
+    SysTick->VAL = 0;
+    NVIC_SetPriority(SysTick_IRQn, configLIBRARY_LOWEST_INTERRUPT_PRIORITY);
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+    Transport_ApplyClock();
+    PcSampler_ApplyClock();
+}
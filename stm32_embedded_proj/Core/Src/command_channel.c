@@ -0,0 +1,664 @@
+/**
+  ******************************************************************************
+  * @file    command_channel.c
+  * @brief   UART Command Channel Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * USART2 RX runs in interrupt-driven receive-to-idle mode. The RX event
+  * callback only copies the received chunk into a lock-free byte ring and
+  * notifies the (low priority) command task; parsing, replies and any
+  * queueing happen in task context so ProfilerTask is never delayed.
+  *
+  ******************************************************************************
+  */
+
+#include "command_channel.h"
+#include "main.h"
+#include "queue.h"
+#include "system_profiler.h"
+#include "test_metrics.h"
+#include "uart_transport.h"
+#include "pc_sampler.h"
+#include "burst_capture.h"
+#include "workload.h"
+#include "profiler_overhead.h"
+#include "idle_load.h"
+#include "sizing_advisor.h"
+#include "isr_event.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Reply transmit retries while another task owns the UART */
+#define REPLY_RETRY_COUNT         20
+#define DUMP_QUEUE_WAIT_MS        20
+
+/* External variables */
+extern UART_HandleTypeDef huart2;
+extern QueueHandle_t xProfilerQueue;
+
+/* ISR -> task ring (single producer, single consumer) */
+static uint8_t ucRxChunk[COMMAND_RX_CHUNK_SIZE];
+static uint8_t ucRxRing[COMMAND_RX_RING_SIZE];
+static volatile uint16_t usRxHead = 0;
+static volatile uint16_t usRxTail = 0;
+static volatile uint32_t ulRxOverruns = 0;
+
+/* Line assembly state (task context only) */
+static char cLine[COMMAND_LINE_MAX];
+static size_t xLineLen = 0;
+static uint8_t ucDiscardLine = 0;
+
+static TaskHandle_t xCommandTask = NULL;
+
+/* Worker behaviour for "load" and "sweep" (task context only) */
+static WorkloadConfig_t xLoadConfig;
+static uint8_t ucLoadConfigValid = 0;
+
+/* Private function prototypes */
+static void ArmReception(void);
+static void Reply(const char *msg);
+static void DumpHistory(uint32_t count);
+static uint8_t SetTaskFilter(ReportSubscription_t *subscription, char *list);
+static uint8_t SetTrigger(const char *condition);
+static uint8_t ParseNumber(const char *arg, int base, unsigned long *value);
+static uint8_t ParseNumbers(const char *list, unsigned long *values, uint8_t max);
+static uint8_t StartLoad(const char *args);
+static uint8_t StartSweep(const char *args);
+static uint8_t SetLoadMode(const char *mode);
+static void ReportLoadMode(void);
+static uint8_t RunIsrBench(const char *args);
+
+/**
+  * @brief  Initialize command channel and start reception
+  * @param  xNotifyTask: Task notified when bytes arrive
+  * @retval None
+  */
+void CommandChannel_Init(TaskHandle_t xNotifyTask)
+{
+    xCommandTask = xNotifyTask;
+    usRxHead = 0;
+    usRxTail = 0;
+    xLineLen = 0;
+    ucDiscardLine = 0;
+
+    ArmReception();
+}
+
+/**
+  * @brief  Wait for a complete command line
+  * @param  line: Output buffer for the line (NUL terminated)
+  * @param  lineSize: Size of output buffer
+  * @param  xTimeout: Maximum time to wait for new bytes
+  * @retval 1 if a line was returned, 0 on timeout
+  */
+uint8_t CommandChannel_ReadLine(char *line, size_t lineSize, TickType_t xTimeout)
+{
+    for (;;) {
+        while (usRxTail != usRxHead) {
+            char c = (char)ucRxRing[usRxTail];
+            usRxTail = (usRxTail + 1) & (COMMAND_RX_RING_SIZE - 1);
+
+            if (c == '\r' || c == '\n') {
+                if (ucDiscardLine) {
+                    ucDiscardLine = 0;
+                    xLineLen = 0;
+                    Reply("ERR too long");
+                } else if (xLineLen > 0) {
+                    size_t xCopy = (xLineLen < lineSize - 1) ? xLineLen : lineSize - 1;
+                    memcpy(line, cLine, xCopy);
+                    line[xCopy] = '\0';
+                    xLineLen = 0;
+                    return 1;
+                }
+            } else if (!ucDiscardLine) {
+                if (xLineLen < COMMAND_LINE_MAX - 1) {
+                    cLine[xLineLen++] = c;
+                } else {
+                    ucDiscardLine = 1;
+                }
+            }
+        }
+
+        /* Reception stops after UART errors or a deep-sleep re-init */
+        if (huart2.RxState == HAL_UART_STATE_READY) {
+            ArmReception();
+        }
+
+        if (ulTaskNotifyTake(pdTRUE, xTimeout) == 0) {
+            return 0;
+        }
+    }
+}
+
+/**
+  * @brief  Parse and execute one command line
+  * @param  line: NUL terminated command line (modified in place)
+  * @retval None
+  */
+void CommandChannel_Execute(char *line)
+{
+    ProfilerConfig_t *pxConfig = GetProfilerConfig();
+    char *cmd = line;
+    char *arg;
+    unsigned long value;
+
+    /* Split "<cmd> [arg]" */
+    while (*cmd == ' ') {
+        cmd++;
+    }
+    arg = strchr(cmd, ' ');
+    if (arg != NULL) {
+        *arg++ = '\0';
+        while (*arg == ' ') {
+            arg++;
+        }
+    }
+
+    if (strcmp(cmd, "rate") == 0) {
+        if (arg == NULL || !ParseNumber(arg, 10, &value) ||
+            value < PROFILER_MIN_SAMPLE_MS || value > PROFILER_MAX_SAMPLE_MS) {
+            Reply("ERR range");
+            return;
+        }
+        pxConfig->samplePeriodMs = value;
+    } else if (strcmp(cmd, "every") == 0) {
+        if (arg == NULL || !ParseNumber(arg, 10, &value) || value < 1 || value > 255) {
+            Reply("ERR range");
+            return;
+        }
+        pxConfig->reportEverySamples = value;
+    } else if (strcmp(cmd, "format") == 0 && arg != NULL) {
+        if (strcmp(arg, "pretty") == 0) {
+            pxConfig->format = REPORT_FORMAT_PRETTY;
+        } else if (strcmp(arg, "compact") == 0) {
+            pxConfig->format = REPORT_FORMAT_COMPACT;
+        } else if (strcmp(arg, "binary") == 0) {
+            pxConfig->format = REPORT_FORMAT_BINARY;
+        } else {
+            Reply("ERR format");
+            return;
+        }
+    } else if (strcmp(cmd, "pause") == 0) {
+        pxConfig->paused = 1;
+    } else if (strcmp(cmd, "resume") == 0) {
+        pxConfig->paused = 0;
+    } else if (strcmp(cmd, "dump") == 0) {
+        value = GetBufferedStatsCount();
+        if (arg != NULL && !ParseNumber(arg, 10, &value)) {
+            Reply("ERR range");
+            return;
+        }
+        Reply("OK");
+        DumpHistory(value);
+        return;
+    } else if (strcmp(cmd, "reset") == 0) {
+        TestMetrics_Reset();
+    } else if (strcmp(cmd, "fields") == 0 && arg != NULL) {
+        if (!ParseNumber(arg, 16, &value)) {
+            Reply("ERR fields");
+            return;
+        }
+        pxConfig->subscription.fieldMask = value & REPORT_FIELD_ALL;
+    } else if (strcmp(cmd, "taskfields") == 0 && arg != NULL) {
+        if (!ParseNumber(arg, 16, &value)) {
+            Reply("ERR fields");
+            return;
+        }
+        pxConfig->subscription.taskFieldMask = (uint8_t)(value & TASK_FIELD_ALL);
+    } else if (strcmp(cmd, "tasks") == 0 && arg != NULL) {
+        if (!SetTaskFilter(&pxConfig->subscription, arg)) {
+            Reply("ERR filter");
+            return;
+        }
+    } else if (strcmp(cmd, "verbose") == 0 && arg != NULL) {
+        if (!ParseNumber(arg, 10, &value)) {
+            Reply("ERR range");
+            return;
+        }
+        pxConfig->verbosity = (value > 0) ? 1 : 0;
+    } else if (strcmp(cmd, "baud") == 0) {
+        if (arg == NULL || !ParseNumber(arg, 10, &value) || !Transport_IsBaudSupported(value)) {
+            Reply("ERR baud");
+            return;
+        }
+        /* Acknowledge at the old rate; the host confirms at the new one */
+        Reply("OK");
+        Transport_SetBaud(value);
+        return;
+    } else if (strcmp(cmd, "sample") == 0) {
+        value = 0;
+        if ((arg != NULL && !ParseNumber(arg, 10, &value)) || !PcSampler_SetRate(value)) {
+            Reply("ERR range");
+            return;
+        }
+    } else if (strcmp(cmd, "trigger") == 0 && arg != NULL) {
+        if (strcmp(arg, "off") == 0) {
+            BurstCapture_Disable();
+        } else if (!SetTrigger(arg)) {
+            Reply("ERR trigger");
+            return;
+        }
+    } else if (strcmp(cmd, "budget") == 0) {
+        value = OVERHEAD_MAX_BUDGET_PCT + 1;
+        if ((arg != NULL && !ParseNumber(arg, 10, &value)) || !ProfilerOverhead_SetBudget(value)) {
+            Reply("ERR range");
+            return;
+        }
+    } else if (strcmp(cmd, "loadmode") == 0) {
+        if (arg == NULL) {
+            Reply("OK");
+            ReportLoadMode();
+            return;
+        }
+        if (!SetLoadMode(arg)) {
+            Reply("ERR mode");
+            return;
+        }
+    } else if (strcmp(cmd, "sizing") == 0) {
+        Reply("OK");
+        SizingAdvisor_Report();
+        return;
+    } else if (strcmp(cmd, "isrbench") == 0) {
+        if (!RunIsrBench(arg)) {
+            Reply("ERR isrbench");
+        }
+        return;
+    } else if (strcmp(cmd, "load") == 0 && arg != NULL) {
+        if (Workload_IsSweepRunning()) {
+            Reply("ERR busy");
+            return;
+        }
+        if (strcmp(arg, "off") == 0) {
+            Workload_Stop();
+        } else if (!StartLoad(arg)) {
+            Reply("ERR load");
+            return;
+        }
+    } else if (strcmp(cmd, "sweep") == 0 && arg != NULL) {
+        if (!StartSweep(arg)) {
+            Reply("ERR sweep");
+            return;
+        }
+    } else if (strcmp(cmd, "ping") == 0) {
+        Transport_Confirm();
+        Reply("pong");
+        return;
+    } else {
+        Reply("ERR unknown");
+        return;
+    }
+
+    Transport_Confirm();
+    Reply("OK");
+}
+
+/**
+  * @brief  UART RX event callback (idle line or chunk full) - ISR context
+  * @param  huart: UART handle
+  * @param  Size: Number of bytes received into the chunk
+  * @retval None
+  */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    if (huart->Instance != USART2) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < Size; i++) {
+        uint16_t usNext = (usRxHead + 1) & (COMMAND_RX_RING_SIZE - 1);
+        if (usNext == usRxTail) {
+            ulRxOverruns++;
+            break;
+        }
+        ucRxRing[usRxHead] = ucRxChunk[i];
+        usRxHead = usNext;
+    }
+
+    ArmReception();
+
+    if (xCommandTask != NULL) {
+        vTaskNotifyGiveFromISR(xCommandTask, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+}
+
+/**
+  * @brief  UART error callback - restart reception after overrun/noise/framing
+  * @param  huart: UART handle
+  * @retval None
+  */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance == USART2) {
+        Transport_RecordRxError();
+        ArmReception();
+    }
+}
+
+/**
+  * @brief  Start interrupt-driven receive-to-idle on USART2
+  * @retval None
+  */
+static void ArmReception(void)
+{
+    HAL_UARTEx_ReceiveToIdle_IT(&huart2, ucRxChunk, sizeof(ucRxChunk));
+}
+
+/**
+  * @brief  Send a reply line, retrying while another task is transmitting
+  * @param  msg: Reply text without line terminator
+  * @retval None
+  */
+static void Reply(const char *msg)
+{
+    char buffer[COMMAND_LINE_MAX + 4];
+    int len = snprintf(buffer, sizeof(buffer), "%s\r\n", msg);
+
+    for (uint8_t i = 0; i < REPLY_RETRY_COUNT; i++) {
+        if (Transport_Write((const uint8_t*)buffer, len, 100) != HAL_BUSY) {
+            return;
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+}
+
+/**
+  * @brief  Queue buffered samples to ReportTask, oldest first
+  * @note   One queue slot is always left free for ProfilerTask
+  * @param  count: Number of most recent samples to send
+  * @retval None
+  */
+static void DumpHistory(uint32_t count)
+{
+    static SystemReport_t report;
+    uint8_t available = GetBufferedStatsCount();
+
+    if (count > available) {
+        count = available;
+    }
+
+    while (count > 0) {
+        if (uxQueueSpacesAvailable(xProfilerQueue) <= 1) {
+            vTaskDelay(pdMS_TO_TICKS(DUMP_QUEUE_WAIT_MS));
+            continue;
+        }
+
+        count--;
+        if (GetBufferedStats((uint8_t)count, &report)) {
+            xQueueSend(xProfilerQueue, &report, 0);
+        }
+    }
+}
+
+/**
+  * @brief  Replace the subscription task filter
+  * @note   The whole list is checked first, so an invalid one leaves the
+  *         filter as it was. The filter is disabled while names are
+  *         rewritten so the profiler never matches against a half-written list
+  * @param  subscription: Subscription to update
+  * @param  list: "*" for all tasks, or comma separated task names
+  * @retval 1 if applied, 0 if the list is invalid
+  */
+static uint8_t SetTaskFilter(ReportSubscription_t *subscription, char *list)
+{
+    uint8_t count = 0;
+    char *name = list;
+    char *next;
+
+    if (strcmp(list, "*") == 0) {
+        subscription->taskFilterCount = 0;
+        return 1;
+    }
+
+    while (name != NULL && *name != '\0') {
+        next = strchr(name, ',');
+        if (count >= REPORT_TASK_FILTER_MAX ||
+            ((next != NULL) ? (size_t)(next - name) : strlen(name)) >= configMAX_TASK_NAME_LEN) {
+            return 0;
+        }
+        count++;
+        name = (next != NULL) ? next + 1 : NULL;
+    }
+
+    subscription->taskFilterCount = 0;
+    __DMB();
+
+    count = 0;
+    name = list;
+    while (name != NULL && *name != '\0') {
+        next = strchr(name, ',');
+        if (next != NULL) {
+            *next++ = '\0';
+        }
+        strncpy(subscription->taskFilter[count], name, configMAX_TASK_NAME_LEN);
+        count++;
+        name = next;
+    }
+
+    __DMB();
+    subscription->taskFilterCount = count;
+    return 1;
+}
+
+/**
+  * @brief  Parse and apply a burst capture trigger
+  * @param  condition: "<field>><value>" or "<field><<value>", e.g. "cpu_load>80"
+  * @retval 1 if applied, 0 if the condition is invalid
+  */
+static uint8_t SetTrigger(const char *condition)
+{
+    const char *op = strpbrk(condition, "<>");
+    char *end;
+    unsigned long value;
+
+    if (op == NULL || op[1] == '\0') {
+        return 0;
+    }
+    value = strtoul(op + 1, &end, 10);
+    if (*end != '\0') {
+        return 0;
+    }
+
+    for (uint8_t field = 0; field < BURST_FIELD_COUNT; field++) {
+        const char *name = BurstCapture_FieldName(field);
+
+        if (strlen(name) == (size_t)(op - condition) &&
+            strncmp(condition, name, op - condition) == 0) {
+            return BurstCapture_SetTrigger(field, (*op == '>') ? BURST_OP_ABOVE : BURST_OP_BELOW, value);
+        }
+    }
+
+    return 0;
+}
+
+/**
+  * @brief  Parse a whole argument as one unsigned number
+  * @param  arg: Argument text
+  * @param  base: 10 or 16
+  * @param  value: Output, untouched on failure
+  * @retval 1 if parsed, 0 if empty or followed by anything else
+  */
+static uint8_t ParseNumber(const char *arg, int base, unsigned long *value)
+{
+    char *end;
+    unsigned long parsed = strtoul(arg, &end, base);
+
+    if (end == arg || *end != '\0') {
+        return 0;
+    }
+    *value = parsed;
+    return 1;
+}
+
+/**
+  * @brief  Parse up to max space separated decimal numbers
+  * @param  list: Argument text
+  * @param  values: Output
+  * @param  max: Capacity of values
+  * @retval Number of values parsed, 0 on malformed input
+  */
+static uint8_t ParseNumbers(const char *list, unsigned long *values, uint8_t max)
+{
+    uint8_t count = 0;
+    char *end;
+
+    while (*list != '\0') {
+        if (count >= max) {
+            return 0;
+        }
+        values[count++] = strtoul(list, &end, 10);
+        if (end == list || (*end != ' ' && *end != '\0')) {
+            return 0;
+        }
+        list = end;
+        while (*list == ' ') {
+            list++;
+        }
+    }
+
+    return count;
+}
+
+/**
+  * @brief  Spawn synthetic workers: "<n> [duty%] [period ms]"
+  * @param  args: Argument text
+  * @retval 1 if all requested workers were spawned, 0 otherwise
+  */
+static uint8_t StartLoad(const char *args)
+{
+    unsigned long values[3];
+    uint8_t count = ParseNumbers(args, values, 3);
+
+    if (count == 0 || values[0] > WORKLOAD_MAX_TASKS ||
+        (count > 1 && (values[1] < 1 || values[1] > 100)) ||
+        (count > 2 && (values[2] < 1 || values[2] > 1000))) {
+        return 0;
+    }
+
+    if (!ucLoadConfigValid) {
+        Workload_DefaultConfig(&xLoadConfig);
+        ucLoadConfigValid = 1;
+    }
+    xLoadConfig.taskCount = (uint8_t)values[0];
+    if (count > 1) {
+        xLoadConfig.dutyPct = (uint8_t)values[1];
+    }
+    if (count > 2) {
+        xLoadConfig.periodMs = (uint16_t)values[2];
+    }
+
+    return Workload_Start(&xLoadConfig) == xLoadConfig.taskCount;
+}
+
+/**
+  * @brief  Start a scaling sweep: "<start> <end> [step]" with the last load settings
+  * @param  args: Argument text
+  * @retval 1 if started, 0 otherwise
+  */
+static uint8_t StartSweep(const char *args)
+{
+    unsigned long values[3];
+    uint8_t count = ParseNumbers(args, values, 3);
+    WorkloadSweep_t sweep;
+
+    if (count < 2 || values[1] > WORKLOAD_MAX_TASKS || values[0] > values[1] ||
+        (count > 2 && values[2] == 0)) {
+        return 0;
+    }
+
+    if (!ucLoadConfigValid) {
+        Workload_DefaultConfig(&xLoadConfig);
+        ucLoadConfigValid = 1;
+    }
+    sweep.startN = (uint8_t)values[0];
+    sweep.endN = (uint8_t)values[1];
+    sweep.stepN = (count > 2) ? (uint8_t)values[2] : 1;
+    sweep.settleMs = WORKLOAD_DEFAULT_SETTLE_MS;
+    sweep.measureMs = WORKLOAD_DEFAULT_MEASURE_MS;
+
+    return Workload_StartSweep(&xLoadConfig, &sweep);
+}
+
+/**
+  * @brief  Select the CPU load estimator
+  * @param  mode: "rt", "idle" or "cmp" (cmp restarts the comparison)
+  * @retval 1 if applied, 0 if unknown or unavailable in this build
+  */
+static uint8_t SetLoadMode(const char *mode)
+{
+    ProfilerConfig_t *pxConfig = GetProfilerConfig();
+
+    if (strcmp(mode, "rt") == 0) {
+        pxConfig->loadMode = CPU_LOAD_MODE_RUNTIME;
+        return 1;
+    }
+
+    if (!IDLE_LOAD_AVAILABLE) {
+        return 0;
+    }
+
+    if (strcmp(mode, "idle") == 0) {
+        pxConfig->loadMode = CPU_LOAD_MODE_IDLE;
+    } else if (strcmp(mode, "cmp") == 0) {
+        IdleLoad_ResetComparison();
+        pxConfig->loadMode = CPU_LOAD_MODE_COMPARE;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+  * @brief  Write the "#ld" estimator status line
+  * @retval None
+  */
+static void ReportLoadMode(void)
+{
+    static const char *const pcModes[] = { "rt", "idle", "cmp" };
+    IdleLoadStats_t xStats;
+    char line[128];
+    int len;
+
+    IdleLoad_GetStats(&xStats);
+    len = snprintf(line, sizeof(line),
+                   "#ld mode=%s cal=%lu/%u@%luHz n=%lu err_avg=%lu.%02lu err_max=%lu.%02lu "
+                   "rt_cyc=%lu idle_cyc=%lu\r\n",
+                   pcModes[GetProfilerConfig()->loadMode],
+                   xStats.calibrated ? xStats.calCount : 0UL, IDLE_LOAD_CAL_TICKS, xStats.calHz,
+                   xStats.samples,
+                   (uint32_t)(xStats.meanAbsError * 100.0f) / 100,
+                   (uint32_t)(xStats.meanAbsError * 100.0f) % 100,
+                   (uint32_t)(xStats.maxAbsError * 100.0f) / 100,
+                   (uint32_t)(xStats.maxAbsError * 100.0f) % 100,
+                   xStats.runtimeCycles, xStats.idleCycles);
+    if (len > 0) {
+        (void)Transport_Write((const uint8_t *)line, (uint16_t)len, 1000);
+    }
+}
+
+/**
+  * @brief  Run the ISR event benchmark: "[bursts] [burst length]"
+  * @note   Replies "OK" and writes the "#ib" lines once both paths are timed
+  * @param  args: Argument text, NULL for the defaults
+  * @retval 1 if it ran, 0 on bad arguments or no heap for it
+  */
+static uint8_t RunIsrBench(const char *args)
+{
+    static IsrEventBench_t xResult;
+    unsigned long values[2] = { ISR_EVENT_BENCH_BURSTS, ISR_EVENT_BENCH_BURST_LEN };
+
+    if (args != NULL && ParseNumbers(args, values, 2) == 0) {
+        return 0;
+    }
+    if (!IsrEvent_Benchmark(values[0], values[1], &xResult)) {
+        return 0;
+    }
+
+    Reply("OK");
+    IsrEvent_WriteBenchmark(&xResult);
+    return 1;
+}
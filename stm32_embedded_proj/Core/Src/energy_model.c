@@ -0,0 +1,133 @@
+/**
+  ******************************************************************************
+  * @file    energy_model.c
+  * @brief   Software Energy Estimation Model Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * Charge is integrated as current(mode, operating point) x residency. Run
+  * and Sleep residency come from the kernel tick and the WFI timing in
+  * power_management.c; STOP residency comes from SleepStats_t because the
+  * tick does not advance while in STOP. Call EnergyModel_Update() from a
+  * single task, once per sample period, before the clock governor runs.
+  *
+  ******************************************************************************
+  */
+
+#include "energy_model.h"
+#include "power_management.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* 1 uAh = 3.6e9 uA*us */
+#define UA_US_PER_UAH   3600000000.0f
+
+#if defined(ENERGY_BOARD_NUCLEO_F401RE)
+/* STM32F401RE typical IDD (datasheet, 25 C, flash ART on, peripherals off);
+   STOP figure is the bench measurement from TEST_REPORT_24H.md */
+static const EnergyBoardProfile_t xBoardProfile = {
+    .ulRunCurrentUA   = { [CLOCK_OPP_LOW] = 4000, [CLOCK_OPP_MID] = 6400, [CLOCK_OPP_HIGH] = 11200 },
+    .ulSleepCurrentUA = { [CLOCK_OPP_LOW] = 1600, [CLOCK_OPP_MID] = 2700, [CLOCK_OPP_HIGH] = 4800 },
+    .ulStopCurrentUA  = 8,
+};
+#else
+#error "energy_model: no current table for the selected board"
+#endif
+
+/* Static variables */
+static TickType_t xLastTick = 0;
+static uint64_t ullLastSleepUs = 0;
+static uint32_t ulLastStopMs = 0;
+
+static uint64_t ullRunTimeUs = 0;
+static uint64_t ullSleepTimeUs = 0;
+static uint64_t ullStopTimeUs = 0;
+static uint64_t ullRunChargeUAUs = 0;
+static uint64_t ullTotalChargeUAUs = 0;
+
+/**
+  * @brief  Initialize energy model and start integration
+  * @retval None
+  */
+void EnergyModel_Init(void)
+{
+    SleepStats_t *pxSleepStats = PowerManagement_GetStats();
+
+    xLastTick = xTaskGetTickCount();
+    ullLastSleepUs = pxSleepStats->ullTotalSleepTimeUs;
+    ulLastStopMs = pxSleepStats->ulTotalSleepTimeMs;
+
+    ullRunTimeUs = 0;
+    ullSleepTimeUs = 0;
+    ullStopTimeUs = 0;
+    ullRunChargeUAUs = 0;
+    ullTotalChargeUAUs = 0;
+}
+
+/**
+  * @brief  Integrate charge over the interval since the previous update
+  * @retval None
+  */
+void EnergyModel_Update(void)
+{
+    SleepStats_t *pxSleepStats = PowerManagement_GetStats();
+    ClockOpp_t opp = ClockGovernor_GetCurrentOpp();
+    TickType_t xNow = xTaskGetTickCount();
+    uint64_t ullTickUs, ullSleepUs, ullStopUs, ullRunUs;
+    uint64_t ullRunCharge;
+
+    ullTickUs = (uint64_t)(xNow - xLastTick) * portTICK_PERIOD_MS * 1000ULL;
+    ullSleepUs = pxSleepStats->ullTotalSleepTimeUs - ullLastSleepUs;
+    ullStopUs = (uint64_t)(pxSleepStats->ulTotalSleepTimeMs - ulLastStopMs) * 1000ULL;
+
+    xLastTick = xNow;
+    ullLastSleepUs = pxSleepStats->ullTotalSleepTimeUs;
+    ulLastStopMs = pxSleepStats->ulTotalSleepTimeMs;
+
+    /* Sleep (WFI) happens inside tick time, STOP does not */
+    if (ullSleepUs > ullTickUs) {
+        ullSleepUs = ullTickUs;
+    }
+    ullRunUs = ullTickUs - ullSleepUs;
+
+    ullRunCharge = ullRunUs * xBoardProfile.ulRunCurrentUA[opp];
+
+    ullRunTimeUs += ullRunUs;
+    ullSleepTimeUs += ullSleepUs;
+    ullStopTimeUs += ullStopUs;
+    ullRunChargeUAUs += ullRunCharge;
+    ullTotalChargeUAUs += ullRunCharge +
+                          ullSleepUs * xBoardProfile.ulSleepCurrentUA[opp] +
+                          ullStopUs * xBoardProfile.ulStopCurrentUA;
+}
+
+/**
+  * @brief  Get energy model statistics
+  * @param  stats: Pointer to output statistics structure
+  * @retval None
+  */
+void EnergyModel_GetStats(EnergyStats_t *stats)
+{
+    uint64_t ullElapsedUs = ullRunTimeUs + ullSleepTimeUs + ullStopTimeUs;
+
+    stats->ulRunTimeMs = (uint32_t)(ullRunTimeUs / 1000ULL);
+    stats->ulSleepTimeMs = (uint32_t)(ullSleepTimeUs / 1000ULL);
+    stats->ulStopTimeMs = (uint32_t)(ullStopTimeUs / 1000ULL);
+    stats->fRunEnergyUAh = (float)ullRunChargeUAUs / UA_US_PER_UAH;
+    stats->fTotalEnergyUAh = (float)ullTotalChargeUAUs / UA_US_PER_UAH;
+
+    if (ullElapsedUs > 0) {
+        stats->fAvgCurrentUA = (float)ullTotalChargeUAUs / (float)ullElapsedUs;
+    } else {
+        stats->fAvgCurrentUA = 0.0f;
+    }
+}
+
+/**
+  * @brief  Get the active board current table
+  * @retval Pointer to board profile
+  */
+const EnergyBoardProfile_t* EnergyModel_GetBoardProfile(void)
+{
+    return &xBoardProfile;
+}
@@ -0,0 +1,204 @@
+/**
+  ******************************************************************************
+  * @file    idle_load.c
+  * @brief   Idle-Counter CPU Load Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * The calibration has to run the very loop it calibrates: while it is in
+  * progress the idle hook executes the same increment and the same single
+  * flag test as afterwards, and all timing is done by the tick hook (which
+  * FreeRTOS still calls while the scheduler is suspended). The idle hook
+  * only acts on the flag to lock and unlock the scheduler, since
+  * xTaskResumeAll() cannot be called from the tick interrupt.
+  *
+  ******************************************************************************
+  */
+
+#include "idle_load.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Calibration progress (tick hook) */
+typedef enum {
+    IDLE_CAL_WAITING = 0,       /* Scheduler not locked yet */
+    IDLE_CAL_SYNC,              /* Locked, waiting for a tick edge */
+    IDLE_CAL_MEASURE,           /* Counting IDLE_LOAD_CAL_TICKS ticks */
+    IDLE_CAL_DONE
+} IdleCalState_t;
+
+/* Pending work for the idle hook (0 = none) */
+#define IDLE_ACTION_LOCK        1
+#define IDLE_ACTION_UNLOCK      2
+
+/* External variables */
+extern volatile uint32_t ulHighFrequencyTimerTicks;
+
+/* Static variables */
+static volatile uint32_t ulIdleCount = 0;
+static volatile uint8_t ucIdleAction = IDLE_LOAD_AVAILABLE ? IDLE_ACTION_LOCK : 0;
+static volatile uint8_t ucCalState = IDLE_CAL_WAITING;
+static uint32_t ulCalStartTick = 0;
+static uint32_t ulCalStartCount = 0;
+static uint32_t ulCalCount = 0;
+static uint32_t ulCalHz = 0;
+
+static uint32_t ulLastCount = 0;
+static TickType_t xLastTick = 0;
+
+static IdleLoadStats_t xCompare;
+static uint64_t ullRuntimeCycleSum = 0;
+static uint64_t ullIdleCycleSum = 0;
+
+/**
+  * @brief  Idle hook body: count one idle loop iteration
+  * @note   Call from vApplicationIdleHook() and nothing else there
+  * @retval None
+  */
+void IdleLoad_Hook(void)
+{
+    ulIdleCount++;
+
+    if (ucIdleAction != 0) {
+        if (ucIdleAction == IDLE_ACTION_LOCK) {
+            vTaskSuspendAll();
+            ucCalState = IDLE_CAL_SYNC;
+        } else {
+            (void)xTaskResumeAll();
+        }
+        ucIdleAction = 0;
+    }
+}
+
+/**
+  * @brief  Time the calibration window
+  * @note   Call from vApplicationTickHook() (ISR context)
+  * @retval None
+  */
+void IdleLoad_Tick(void)
+{
+    uint32_t ulTicks;
+
+    if (ucCalState == IDLE_CAL_DONE || ucCalState == IDLE_CAL_WAITING) {
+        return;
+    }
+
+    ulTicks = ulHighFrequencyTimerTicks;
+    if (ucCalState == IDLE_CAL_SYNC) {
+        ulCalStartTick = ulTicks;
+        ulCalStartCount = ulIdleCount;
+        ucCalState = IDLE_CAL_MEASURE;
+    } else if ((ulTicks - ulCalStartTick) >= IDLE_LOAD_CAL_TICKS) {
+        ulCalCount = ulIdleCount - ulCalStartCount;
+        ulCalHz = SystemCoreClock;
+        ucCalState = IDLE_CAL_DONE;
+        ucIdleAction = IDLE_ACTION_UNLOCK;
+    }
+}
+
+/**
+  * @brief  Check whether the boot calibration has completed
+  * @retval 1 if calibrated
+  */
+uint8_t IdleLoad_IsCalibrated(void)
+{
+    return (ucCalState == IDLE_CAL_DONE && ulCalCount > 0) ? 1 : 0;
+}
+
+/**
+  * @brief  CPU load since the previous call, from the idle count
+  * @retval CPU load as float (0.0 - 100.0), 0 until calibrated
+  */
+float IdleLoad_GetLoad(void)
+{
+    uint32_t ulCount = ulIdleCount;
+    TickType_t xNow = xTaskGetTickCount();
+    uint32_t ulDeltaCount = ulCount - ulLastCount;
+    TickType_t xDeltaTicks = xNow - xLastTick;
+    float fExpected;
+    float cpuLoad;
+
+    ulLastCount = ulCount;
+    xLastTick = xNow;
+
+    if (!IdleLoad_IsCalibrated() || xDeltaTicks == 0) {
+        return 0.0f;
+    }
+
+    /* Iterations a fully idle CPU would have made at the current clock */
+    fExpected = (float)ulCalCount * (float)xDeltaTicks / (float)IDLE_LOAD_CAL_TICKS;
+    fExpected *= (float)SystemCoreClock / (float)ulCalHz;
+
+    cpuLoad = 100.0f * (1.0f - ((float)ulDeltaCount / fExpected));
+
+    /* Clamp between 0 and 100 */
+    if (cpuLoad < 0.0f) cpuLoad = 0.0f;
+    if (cpuLoad > 100.0f) cpuLoad = 100.0f;
+
+    return cpuLoad;
+}
+
+/**
+  * @brief  Accumulate one side-by-side sample of both estimators
+  * @param  runtimeLoad: Load from the runtime-stats path
+  * @param  idleLoad: Load from the idle count
+  * @param  runtimeCycles: Cycles spent on the runtime-stats estimate
+  * @param  idleCycles: Cycles spent on the idle-count estimate
+  * @retval None
+  */
+void IdleLoad_RecordComparison(float runtimeLoad, float idleLoad,
+                               uint32_t runtimeCycles, uint32_t idleCycles)
+{
+    float fError = idleLoad - runtimeLoad;
+    float n;
+
+    if (fError < 0.0f) {
+        fError = -fError;
+    }
+
+    taskENTER_CRITICAL();
+    xCompare.samples++;
+    n = (float)xCompare.samples;
+    xCompare.meanAbsError += (fError - xCompare.meanAbsError) / n;
+    if (fError > xCompare.maxAbsError) {
+        xCompare.maxAbsError = fError;
+    }
+    ullRuntimeCycleSum += runtimeCycles;
+    ullIdleCycleSum += idleCycles;
+    xCompare.runtimeCycles = (uint32_t)(ullRuntimeCycleSum / xCompare.samples);
+    xCompare.idleCycles = (uint32_t)(ullIdleCycleSum / xCompare.samples);
+    taskEXIT_CRITICAL();
+}
+
+/**
+  * @brief  Clear the comparison statistics
+  * @retval None
+  */
+void IdleLoad_ResetComparison(void)
+{
+    taskENTER_CRITICAL();
+    xCompare.samples = 0;
+    xCompare.meanAbsError = 0.0f;
+    xCompare.maxAbsError = 0.0f;
+    xCompare.runtimeCycles = 0;
+    xCompare.idleCycles = 0;
+    ullRuntimeCycleSum = 0;
+    ullIdleCycleSum = 0;
+    taskEXIT_CRITICAL();
+}
+
+/**
+  * @brief  Get calibration and comparison statistics
+  * @param  stats: Output
+  * @retval None
+  */
+void IdleLoad_GetStats(IdleLoadStats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = xCompare;
+    taskEXIT_CRITICAL();
+
+    stats->calibrated = IdleLoad_IsCalibrated();
+    stats->calCount = ulCalCount;
+    stats->calHz = ulCalHz;
+}
@@ -0,0 +1,422 @@
+/**
+  ******************************************************************************
+  * @file    isr_event.c
+  * @brief   ISR Event Ring Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * head and tail run freely and are masked on access, so the ring holds
+  * length events (no empty slot) and is full when head - tail > mask. The
+  * producer publishes a slot with a barrier before advancing head; the
+  * consumer reads the slot between a barrier after loading head and one
+  * before releasing tail. Each index has a single writer, so neither side
+  * needs a critical section.
+  *
+  * The benchmark runs in the command task. Every burst is one pend of
+  * ISR_EVENT_BENCH_IRQn: the handler posts one event and pends itself again
+  * until the burst is done, so the whole burst tail-chains ahead of PendSV
+  * and the consumer, at the top task priority, runs once it is over.
+  *
+  ******************************************************************************
+  */
+
+#include "isr_event.h"
+#include "main.h"
+#include "queue.h"
+#include "uart_transport.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Benchmark timing */
+#define BENCH_NOTIFY_BIT            (1UL << 0)
+#define BENCH_WAIT_MS               10      /* Consumer re-checks the stop flag */
+#define BENCH_SWITCH_MS             (2 * BENCH_WAIT_MS)
+#define BENCH_LINE_SIZE             96
+
+/* Path under test */
+#define BENCH_PATH_QUEUE            0
+#define BENCH_PATH_RING             1
+
+/* Benchmark state (command task, consumer task and the bench ISR) */
+static IsrEvent_t xBenchEvents[ISR_EVENT_BENCH_LENGTH];
+static IsrEventRing_t xBenchRing;
+static QueueHandle_t xBenchQueue = NULL;
+static IsrEventBenchPath_t *volatile pxBenchResult = NULL;
+static volatile uint8_t ucBenchPath = BENCH_PATH_QUEUE;
+static volatile uint32_t ulBenchRemaining = 0;
+static volatile uint32_t ulBenchIndex = 0;
+static volatile uint32_t ulBenchLength = 0;
+static volatile uint8_t ucBenchStop = 0;
+static volatile uint8_t ucBenchExited = 0;
+
+/* Private function prototypes */
+static void RunBursts(IsrEventBenchPath_t *pxPath, uint8_t ucPath, uint32_t ulBursts,
+                      uint32_t ulLength);
+static void BenchConsumerTask(void *pvParameters);
+static void WritePath(const char *pcName, const IsrEventBench_t *result,
+                      const IsrEventBenchPath_t *pxPath);
+static uint32_t MeanCycles(uint64_t ullTotal, uint32_t ulCount);
+
+/**
+  * @brief  Set up an empty ring
+  * @param  ring: Ring
+  * @param  storage: length events
+  * @param  length: Capacity, a power of 2
+  * @retval 1 on success, 0 if length is not a power of 2
+  */
+uint8_t IsrEvent_Init(IsrEventRing_t *ring, IsrEvent_t *storage, uint32_t length)
+{
+    if (length == 0 || (length & (length - 1U)) != 0) {
+        return 0;
+    }
+
+    ring->events = storage;
+    ring->mask = length - 1U;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+    ring->consumer = NULL;
+    ring->notifyBits = 0;
+    return 1;
+}
+
+/**
+  * @brief  Name the task that consumes the ring
+  * @note   Before the first post that should wake it; posts made while no
+  *         consumer is set are kept but wake nobody
+  * @param  ring: Ring
+  * @param  task: Consumer
+  * @param  bits: Notification value bits it waits on
+  * @retval None
+  */
+void IsrEvent_SetConsumer(IsrEventRing_t *ring, TaskHandle_t task, uint32_t bits)
+{
+    ring->notifyBits = bits;
+    ring->consumer = task;
+}
+
+/**
+  * @brief  Post an event - ISR context, the ring's only producer
+  * @param  ring: Ring
+  * @param  code: ISR_EVENT_x
+  * @param  arg: Event argument
+  * @param  pxHigherPriorityTaskWoken: Set if the consumer should run on exit
+  * @retval 1 if posted, 0 if the ring was full (counted in dropped)
+  */
+uint8_t IsrEvent_PostFromISR(IsrEventRing_t *ring, uint16_t code, uint16_t arg,
+                             BaseType_t *pxHigherPriorityTaskWoken)
+{
+    uint32_t ulHead = ring->head;
+    uint32_t ulTail = ring->tail;
+    IsrEvent_t *pxSlot;
+
+    if (ulHead - ulTail > ring->mask) {
+        ring->dropped++;
+        return 0;
+    }
+
+    pxSlot = &ring->events[ulHead & ring->mask];
+    pxSlot->timestamp = DWT->CYCCNT;
+    pxSlot->code = code;
+    pxSlot->arg = arg;
+
+    /* Slot visible before the index that publishes it */
+    __DMB();
+    ring->head = ulHead + 1U;
+
+    /* A non-empty ring means the consumer is awake or already notified */
+    if (ulHead == ulTail && ring->consumer != NULL) {
+        (void)xTaskNotifyFromISR(ring->consumer, ring->notifyBits, eSetBits,
+                                 pxHigherPriorityTaskWoken);
+    }
+
+    return 1;
+}
+
+/**
+  * @brief  Take the oldest event without blocking - consumer task only
+  * @param  ring: Ring
+  * @param  event: Output
+  * @retval 1 if an event was taken, 0 if the ring is empty
+  */
+uint8_t IsrEvent_Get(IsrEventRing_t *ring, IsrEvent_t *event)
+{
+    uint32_t ulTail = ring->tail;
+
+    if (ring->head == ulTail) {
+        return 0;
+    }
+
+    /* Slot read after the head that published it, released after the copy */
+    __DMB();
+    *event = ring->events[ulTail & ring->mask];
+    __DMB();
+    ring->tail = ulTail + 1U;
+    return 1;
+}
+
+/**
+  * @brief  Take the oldest event, blocking on the consumer's notification
+  * @param  ring: Ring
+  * @param  event: Output
+  * @param  xTimeout: Ticks to wait, portMAX_DELAY for ever
+  * @retval 1 if an event was taken, 0 on timeout
+  */
+uint8_t IsrEvent_Wait(IsrEventRing_t *ring, IsrEvent_t *event, TickType_t xTimeout)
+{
+    TickType_t xStart = xTaskGetTickCount();
+    TickType_t xElapsed;
+
+    for (;;) {
+        if (IsrEvent_Get(ring, event)) {
+            return 1;
+        }
+
+        /* A post after the check above leaves the notification pending */
+        if (xTimeout == portMAX_DELAY) {
+            (void)xTaskNotifyWait(0, ring->notifyBits, NULL, portMAX_DELAY);
+            continue;
+        }
+        xElapsed = xTaskGetTickCount() - xStart;
+        if (xElapsed >= xTimeout) {
+            return 0;
+        }
+        (void)xTaskNotifyWait(0, ring->notifyBits, NULL, xTimeout - xElapsed);
+    }
+}
+
+/**
+  * @brief  Posts lost to a full ring since IsrEvent_Init()
+  * @param  ring: Ring
+  * @retval Count
+  */
+uint32_t IsrEvent_GetDropped(const IsrEventRing_t *ring)
+{
+    return ring->dropped;
+}
+
+/**
+  * @brief  Time ISR bursts through xQueueSendFromISR() and through the ring
+  * @note   Command task only; blocks for about bursts ticks per path
+  * @param  bursts: Bursts per path (1-65535)
+  * @param  burstLength: Events per burst (1-ISR_EVENT_BENCH_LENGTH)
+  * @param  result: Output
+  * @retval 1 on success, 0 on bad arguments or no heap for the queue/task
+  */
+uint8_t IsrEvent_Benchmark(uint32_t bursts, uint32_t burstLength, IsrEventBench_t *result)
+{
+    TaskHandle_t xConsumer;
+
+    if (bursts == 0 || bursts > UINT16_MAX || burstLength == 0 ||
+        burstLength > ISR_EVENT_BENCH_LENGTH) {
+        return 0;
+    }
+
+    /* Kept across runs so repeated benchmarks use one queue trace slot */
+    if (xBenchQueue == NULL) {
+        xBenchQueue = xQueueCreate(ISR_EVENT_BENCH_LENGTH, sizeof(IsrEvent_t));
+        if (xBenchQueue == NULL) {
+            return 0;
+        }
+        vQueueAddToRegistry(xBenchQueue, "IsrBenchQ");
+    }
+    (void)xQueueReset(xBenchQueue);
+    (void)IsrEvent_Init(&xBenchRing, xBenchEvents, ISR_EVENT_BENCH_LENGTH);
+
+    memset(result, 0, sizeof(IsrEventBench_t));
+    result->bursts = (uint16_t)bursts;
+    result->burstLength = (uint16_t)burstLength;
+    pxBenchResult = &result->queue;
+    ucBenchPath = BENCH_PATH_QUEUE;
+    ulBenchLength = burstLength;
+    ucBenchStop = 0;
+    ucBenchExited = 0;
+
+    if (xTaskCreate(BenchConsumerTask, "IsrBench", ISR_EVENT_BENCH_STACK, NULL,
+                    ISR_EVENT_BENCH_TASK_PRIO, &xConsumer) != pdPASS) {
+        return 0;
+    }
+    IsrEvent_SetConsumer(&xBenchRing, xConsumer, BENCH_NOTIFY_BIT);
+
+    HAL_NVIC_SetPriority(ISR_EVENT_BENCH_IRQn, ISR_EVENT_BENCH_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(ISR_EVENT_BENCH_IRQn);
+
+    RunBursts(&result->queue, BENCH_PATH_QUEUE, bursts, burstLength);
+    RunBursts(&result->ring, BENCH_PATH_RING, bursts, burstLength);
+
+    HAL_NVIC_DisableIRQ(ISR_EVENT_BENCH_IRQn);
+
+    /* The consumer deletes itself within one wait */
+    ucBenchStop = 1;
+    while (!ucBenchExited) {
+        vTaskDelay(pdMS_TO_TICKS(BENCH_WAIT_MS));
+    }
+
+    return 1;
+}
+
+/**
+  * @brief  Write the "#ib" benchmark lines
+  * @param  result: IsrEvent_Benchmark() output
+  * @retval None
+  */
+void IsrEvent_WriteBenchmark(const IsrEventBench_t *result)
+{
+    static const char header[] = "#ibh path bursts burst_len events lost isr_avg_cyc "
+                                 "isr_max_cyc wake_avg_cyc wake_max_cyc last_avg_cyc\r\n";
+
+    (void)Transport_Write((const uint8_t *)header, sizeof(header) - 1, 1000);
+    WritePath("queue", result, &result->queue);
+    WritePath("ring", result, &result->ring);
+    (void)Transport_Write((const uint8_t *)"#ibd\r\n", 6, 1000);
+}
+
+/**
+  * @brief  Benchmark interrupt: one post per pend, re-pended for the burst
+  * @note   ISR_EVENT_BENCH_IRQn handler
+  * @retval None
+  */
+void IsrEvent_BenchIrq(void)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    IsrEventBenchPath_t *pxPath = pxBenchResult;
+    uint32_t ulStart, ulCycles;
+    uint8_t ucPosted;
+
+    if (ulBenchRemaining == 0 || pxPath == NULL) {
+        return;
+    }
+
+    ulStart = DWT->CYCCNT;
+    if (ucBenchPath == BENCH_PATH_QUEUE) {
+        IsrEvent_t event = { ulStart, ISR_EVENT_BENCH, (uint16_t)ulBenchIndex };
+
+        ucPosted = (xQueueSendFromISR(xBenchQueue, &event, &xHigherPriorityTaskWoken) == pdPASS);
+    } else {
+        ucPosted = IsrEvent_PostFromISR(&xBenchRing, ISR_EVENT_BENCH, (uint16_t)ulBenchIndex,
+                                        &xHigherPriorityTaskWoken);
+    }
+    ulCycles = DWT->CYCCNT - ulStart;
+
+    pxPath->isrCycles += ulCycles;
+    if (ulCycles > pxPath->isrMaxCycles) {
+        pxPath->isrMaxCycles = ulCycles;
+    }
+    if (!ucPosted) {
+        pxPath->lost++;
+    }
+
+    ulBenchIndex++;
+    if (--ulBenchRemaining > 0) {
+        NVIC_SetPendingIRQ(ISR_EVENT_BENCH_IRQn);
+    }
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/**
+  * @brief  Raise the bursts of one path
+  * @param  pxPath: Result for the path
+  * @param  ucPath: BENCH_PATH_x
+  * @param  ulBursts: Bursts
+  * @param  ulLength: Events per burst
+  * @retval None
+  */
+static void RunBursts(IsrEventBenchPath_t *pxPath, uint8_t ucPath, uint32_t ulBursts,
+                      uint32_t ulLength)
+{
+    pxBenchResult = pxPath;
+    ucBenchPath = ucPath;
+
+    /* Let the consumer's wait on the previous path time out */
+    vTaskDelay(pdMS_TO_TICKS(BENCH_SWITCH_MS));
+
+    for (uint32_t i = 0; i < ulBursts; i++) {
+        ulBenchIndex = 0;
+        ulBenchRemaining = ulLength;
+        NVIC_SetPendingIRQ(ISR_EVENT_BENCH_IRQn);
+
+        /* Burst and consumer both finish well inside a tick */
+        vTaskDelay(1);
+    }
+}
+
+/**
+  * @brief  Benchmark consumer: receives on the current path and times each event
+  * @param  pvParameters: Unused
+  * @retval None
+  */
+static void BenchConsumerTask(void *pvParameters)
+{
+    IsrEvent_t event;
+    uint8_t ucReceived;
+
+    (void)pvParameters;
+
+    while (!ucBenchStop) {
+        if (ucBenchPath == BENCH_PATH_QUEUE) {
+            ucReceived = (xQueueReceive(xBenchQueue, &event, pdMS_TO_TICKS(BENCH_WAIT_MS)) == pdTRUE);
+        } else {
+            ucReceived = IsrEvent_Wait(&xBenchRing, &event, pdMS_TO_TICKS(BENCH_WAIT_MS));
+        }
+
+        if (ucReceived) {
+            IsrEventBenchPath_t *pxPath = pxBenchResult;
+            uint32_t ulLatency = DWT->CYCCNT - event.timestamp;
+
+            pxPath->events++;
+            if (event.arg == 0) {
+                pxPath->wakeCycles += ulLatency;
+                pxPath->wakeCount++;
+                if (ulLatency > pxPath->wakeMaxCycles) {
+                    pxPath->wakeMaxCycles = ulLatency;
+                }
+            }
+            if (event.arg == ulBenchLength - 1U) {
+                pxPath->lastCycles += ulLatency;
+                pxPath->lastCount++;
+            }
+        }
+    }
+
+    ucBenchExited = 1;
+    vTaskDelete(NULL);
+}
+
+/**
+  * @brief  Write one "#ib" line
+  * @param  pcName: Path name
+  * @param  result: Benchmark result
+  * @param  pxPath: Path result
+  * @retval None
+  */
+static void WritePath(const char *pcName, const IsrEventBench_t *result,
+                      const IsrEventBenchPath_t *pxPath)
+{
+    char line[BENCH_LINE_SIZE];
+    uint32_t ulPosts = (uint32_t)result->bursts * result->burstLength;
+    int xLen;
+
+    xLen = snprintf(line, sizeof(line), "#ib %s %u %u %lu %lu %lu %lu %lu %lu %lu\r\n",
+                    pcName, result->bursts, result->burstLength,
+                    (unsigned long)pxPath->events, (unsigned long)pxPath->lost,
+                    (unsigned long)MeanCycles(pxPath->isrCycles, ulPosts),
+                    (unsigned long)pxPath->isrMaxCycles,
+                    (unsigned long)MeanCycles(pxPath->wakeCycles, pxPath->wakeCount),
+                    (unsigned long)pxPath->wakeMaxCycles,
+                    (unsigned long)MeanCycles(pxPath->lastCycles, pxPath->lastCount));
+    if (xLen > 0 && xLen < BENCH_LINE_SIZE) {
+        (void)Transport_Write((const uint8_t *)line, (uint16_t)xLen, 1000);
+    }
+}
+
+/**
+  * @brief  Mean of a cycle total
+  * @param  ullTotal: Sum
+  * @param  ulCount: Samples
+  * @retval Mean, 0 without samples
+  */
+static uint32_t MeanCycles(uint64_t ullTotal, uint32_t ulCount)
+{
+    return (ulCount > 0) ? (uint32_t)(ullTotal / ulCount) : 0;
+}
@@ -3,12 +3,201 @@
   * @file    json_formatter.c
   * @brief   JSON Formatter Implementation
   ******************************************************************************
+  * @attention
+  *
+  * The report serializers walk row tables generated from report_schema.h:
+  * one walker per format, no per-field code. Every serializer emits only
+  * the rows flagged in report->fieldMask and report->taskFieldMask, i.e.
+  * what the stream subscribed to and the collector actually gathered.
+  * Rows compiled out of the image have no table entry at all.
+  *
+  ******************************************************************************
   */
 
 #include "json_formatter.h"
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
+/* Bounded text writer for the JSON formats (always NUL terminated) */
+typedef struct {
+    char *ptr;
+    size_t remaining;
+} TextWriter_t;
+
+/* Bounded little-endian writer for the binary format */
+typedef struct {
+    uint8_t *buffer;
+    size_t size;
+    size_t pos;
+    uint8_t overflow;
+} BinaryWriter_t;
+
+/* Row kinds, one per row macro in report_schema.h */
+typedef enum {
+    REPORT_ROW_END = 0,
+    REPORT_ROW_F,
+    REPORT_ROW_A,
+    REPORT_ROW_O,
+    REPORT_ROW_L,
+    REPORT_ROW_M,
+    REPORT_ROW_C
+} ReportRowKind_t;
+
+/* Encodings, see report_schema.h */
+typedef enum {
+    REPORT_ENC_U8 = 0,
+    REPORT_ENC_U16,
+    REPORT_ENC_U32,
+    REPORT_ENC_I32,
+    REPORT_ENC_U64,
+    REPORT_ENC_PCT0,
+    REPORT_ENC_PCT1,
+    REPORT_ENC_PCT2,
+    REPORT_ENC_UA,
+    REPORT_ENC_UAH,
+    REPORT_ENC_TEMP,
+    REPORT_ENC_MHZ,
+    REPORT_ENC_QTYPE,
+    REPORT_ENC_STR,
+    REPORT_ENC_PSTR
+} ReportEncoding_t;
+
+/* One schema row, as the walkers see it */
+typedef struct ReportRow {
+    const char *key[2];                 /* Pretty, compact */
+    const struct ReportRow *items;      /* Record rows (O, L, M, C) */
+    uint32_t bit;                       /* Mask bit, REPORT_ITEM = always */
+    uint16_t offset;                    /* Member offset in the record */
+    uint16_t size;                      /* Member (F), element (A) or record (L, M) bytes */
+    uint16_t aux;                       /* Offset of the counter (L, M) or condition (C) */
+    uint8_t count;                      /* Elements (A), capacity (L, M) */
+    uint8_t kind;                       /* ReportRowKind_t */
+    uint8_t enc;                        /* ReportEncoding_t (F, A) */
+} ReportRow_t;
+
+_Static_assert(sizeof(SystemReport_t) <= 0xFFFF, "SystemReport_t too large for 16-bit row offsets");
+
+/* Row set generating ReportRow_t initialisers; REPORT_BASE is the record type */
+#define REPORT_ROW_SIZE(member)         sizeof(((const REPORT_BASE *)0)->member)
+#define REPORT_ROW_F(bit, enc, member, pretty, compact) \
+    REPORT_IF(bit##_ENABLED, { { pretty, compact }, NULL, bit, offsetof(REPORT_BASE, member), \
+                               REPORT_ROW_SIZE(member), 0, 1, REPORT_ROW_F, REPORT_ENC_##enc },)
+#define REPORT_ROW_A(bit, enc, member, count, pretty, compact) \
+    REPORT_IF(bit##_ENABLED, { { pretty, compact }, NULL, bit, offsetof(REPORT_BASE, member), \
+                               REPORT_ROW_SIZE(member[0]), 0, count, REPORT_ROW_A, REPORT_ENC_##enc },)
+#define REPORT_ROW_O(bit, type, member, table, pretty, compact) \
+    REPORT_IF(bit##_ENABLED, { { pretty, compact }, xReportRows_##table, bit, offsetof(REPORT_BASE, member), \
+                               sizeof(type), 0, 1, REPORT_ROW_O, 0 },)
+#define REPORT_ROW_L(bit, type, member, count, counter, table, pretty, compact) \
+    REPORT_IF(bit##_ENABLED, { { pretty, compact }, xReportRows_##table, bit, offsetof(REPORT_BASE, member), \
+                               sizeof(type), offsetof(REPORT_BASE, counter), count, REPORT_ROW_L, 0 },)
+#define REPORT_ROW_M(bit, type, member, count, counter, table, pretty, compact) \
+    REPORT_IF(bit##_ENABLED, { { pretty, compact }, xReportRows_##table, bit, offsetof(REPORT_BASE, member), \
+                               sizeof(type), offsetof(REPORT_BASE, counter), count, REPORT_ROW_M, 0 },)
+#define REPORT_ROW_C(bit, when, table, pretty, compact) \
+    REPORT_IF(bit##_ENABLED, { { pretty, compact }, xReportRows_##table, bit, 0, \
+                               0, offsetof(REPORT_BASE, when), 1, REPORT_ROW_C, 0 },)
+#define REPORT_ROWS                     REPORT_ROW_F, REPORT_ROW_A, REPORT_ROW_O, \
+                                        REPORT_ROW_L, REPORT_ROW_M, REPORT_ROW_C
+#define REPORT_TABLE(name) \
+    static const ReportRow_t xReportRows_##name[] = { \
+        REPORT_APPLY(REPORT_SCHEMA_##name, REPORT_ROWS) { { NULL, NULL }, NULL, 0, 0, 0, 0, 0, REPORT_ROW_END, 0 } \
+    }
+
+/* Record tables before the tables that reference them; groups built
+ * out of the image have none */
+#define REPORT_BASE TaskStats_t
+REPORT_TABLE(TASK);
+#undef REPORT_BASE
+
+#if REPORT_FIELD_CLOCK_ENABLED
+#define REPORT_BASE ReportClock_t
+REPORT_TABLE(CLOCK);
+#undef REPORT_BASE
+#endif
+
+#if REPORT_FIELD_POWER_ENABLED
+#define REPORT_BASE ReportPower_t
+REPORT_TABLE(POWER);
+#undef REPORT_BASE
+#endif
+
+#if REPORT_FIELD_LINK_ENABLED
+#define REPORT_BASE ReportLink_t
+REPORT_TABLE(LINK);
+#undef REPORT_BASE
+#endif
+
+#if REPORT_FIELD_USER_ENABLED
+#define REPORT_BASE UserSpanStats_t
+REPORT_TABLE(SPAN);
+#undef REPORT_BASE
+#define REPORT_BASE UserCounterStats_t
+REPORT_TABLE(COUNTER);
+#undef REPORT_BASE
+#define REPORT_BASE UserGaugeStats_t
+REPORT_TABLE(GAUGE);
+#undef REPORT_BASE
+#define REPORT_BASE UserMetricsReport_t
+REPORT_TABLE(USER);
+#undef REPORT_BASE
+#endif
+
+#if REPORT_FIELD_QUEUES_ENABLED
+#define REPORT_BASE QueueObjectStats_t
+REPORT_TABLE(QUEUE);
+#undef REPORT_BASE
+#endif
+
+#if REPORT_FIELD_MUTEXES_ENABLED
+#define REPORT_BASE MutexStats_t
+REPORT_TABLE(INVERSION);
+REPORT_TABLE(MUTEX);
+#undef REPORT_BASE
+#endif
+
+#if REPORT_FIELD_SUPPLY_ENABLED
+#define REPORT_BASE ReportSupply_t
+REPORT_TABLE(SUPPLY);
+#undef REPORT_BASE
+#endif
+
+#if REPORT_FIELD_OVERHEAD_ENABLED
+#define REPORT_BASE OverheadStats_t
+REPORT_TABLE(OVERHEAD);
+#undef REPORT_BASE
+#endif
+
+#if REPORT_FIELD_POOLS_ENABLED
+#define REPORT_BASE PoolStats_t
+REPORT_TABLE(POOL);
+#undef REPORT_BASE
+#define REPORT_BASE PoolAllocStats_t
+REPORT_TABLE(POOLS);
+#undef REPORT_BASE
+#endif
+
+#define REPORT_BASE SystemReport_t
+REPORT_TABLE(REPORT);
+#undef REPORT_BASE
+
+static void Append(TextWriter_t *w, const char *fmt, ...);
+static void Separator(TextWriter_t *w, uint8_t *count, const char *sep);
+static void PutU8(BinaryWriter_t *w, uint8_t value);
+static void PutU16(BinaryWriter_t *w, uint16_t value);
+static void PutU32(BinaryWriter_t *w, uint32_t value);
+static void PutString(BinaryWriter_t *w, const char *str, size_t maxLen);
+static uint8_t RowCount(const ReportRow_t *row, const uint8_t *record);
+static void AppendValue(TextWriter_t *w, const ReportRow_t *row, const uint8_t *value);
+static void AppendRows(TextWriter_t *w, const ReportRow_t *rows, const uint8_t *record,
+                       uint32_t mask, uint32_t itemMask, uint8_t compact, uint8_t nested);
+static void PutValue(BinaryWriter_t *w, const ReportRow_t *row, const uint8_t *value);
+static void PutRows(BinaryWriter_t *w, const ReportRow_t *rows, const uint8_t *record,
+                    uint32_t mask, uint32_t itemMask);
+static void AppendTestSeries(TextWriter_t *w, const TestMetricsSeries_t *series, int decimals);
+
 /**
   * @brief  Format system report as JSON string
   * @param  report: Pointer to SystemReport_t structure
@@ -18,98 +207,492 @@
   */
 void FormatSystemReportJSON(const SystemReport_t *report, char *buffer, size_t bufferSize)
 {
-    char *ptr = buffer;
-    size_t remaining = bufferSize;
-    int written;
-    
-    /* Start JSON object */
-    written = snprintf(ptr, remaining, "{\r\n");
-    ptr += written; remaining -= written;
+    TextWriter_t w = { buffer, bufferSize };
     
-    /* Timestamp */
-    written = snprintf(ptr, remaining, "  \"timestamp\": %lu,\r\n", report->timestamp);
-    ptr += written; remaining -= written;
-    
-    /* CPU Load */
-    written = snprintf(ptr, remaining, "  \"cpu_load\": %.1f,\r\n", report->cpuLoad);
-    ptr += written; remaining -= written;
+    Append(&w, "{\r\n");
+    AppendRows(&w, xReportRows_REPORT, (const uint8_t *)report,
+               report->fieldMask, report->taskFieldMask, 0, 0);
+    Append(&w, "\r\n}");
+}
+
+/**
+  * @brief  Format system report as compact JSON (single line)
+  * @param  report: Pointer to SystemReport_t structure
+  * @param  buffer: Output buffer for JSON string
+  * @param  bufferSize: Size of output buffer
+  * @retval None
+  */
+void FormatSystemReportJSONCompact(const SystemReport_t *report, char *buffer, size_t bufferSize)
+{
+    TextWriter_t w = { buffer, bufferSize };
     
-    /* Heap statistics */
-    written = snprintf(ptr, remaining, "  \"heap_free\": %lu,\r\n", report->heapFree);
-    ptr += written; remaining -= written;
+    Append(&w, "{");
+    AppendRows(&w, xReportRows_REPORT, (const uint8_t *)report,
+               report->fieldMask, report->taskFieldMask, 1, 0);
+    Append(&w, "}");
+}
+
+/**
+  * @brief  Format system report as a framed binary record
+  * @note   Payload starts with version, field mask (u32) and task field
+  *         mask (u8); only flagged rows follow, in schema order. Encodings
+  *         are listed in report_schema.h, Tools/report_decode.py reads them
+  * @param  report: Pointer to SystemReport_t structure
+  * @param  buffer: Output buffer
+  * @param  bufferSize: Size of output buffer
+  * @retval Frame length in bytes, 0 if the buffer is too small
+  */
+size_t FormatSystemReportBinary(const SystemReport_t *report, uint8_t *buffer, size_t bufferSize)
+{
+    BinaryWriter_t w = { buffer, bufferSize, 0, 0 };
+    uint16_t sum1 = 0, sum2 = 0;
+    size_t payloadLen;
     
-    written = snprintf(ptr, remaining, "  \"heap_min\": %lu,\r\n", report->heapMin);
-    ptr += written; remaining -= written;
+    /* Header, length patched after the payload is written */
+    PutU8(&w, REPORT_BINARY_SYNC0);
+    PutU8(&w, REPORT_BINARY_SYNC1);
+    PutU16(&w, 0);
     
-    written = snprintf(ptr, remaining, "  \"frag_pct\": %.1f,\r\n", report->fragPercent);
-    ptr += written; remaining -= written;
+    PutU8(&w, REPORT_BINARY_VERSION);
+    PutU32(&w, report->fieldMask);
+    PutU8(&w, report->taskFieldMask);
     
-    /* Tasks array */
-    written = snprintf(ptr, remaining, "  \"tasks\": [\r\n");
-    ptr += written; remaining -= written;
+    PutRows(&w, xReportRows_REPORT, (const uint8_t *)report,
+            report->fieldMask, report->taskFieldMask);
     
-    for (uint8_t i = 0; i < report->taskCount; i++) {
-        written = snprintf(ptr, remaining, "    {\"name\": \"%s\", \"runtime_pct\": %.1f, \"stack_free\": %lu}",
-                          report->tasks[i].taskName,
-                          report->tasks[i].runtimePercent,
-                          report->tasks[i].stackFree);
-        ptr += written; remaining -= written;
-        
-        /* Add comma if not last item */
-        if (i < report->taskCount - 1) {
-            written = snprintf(ptr, remaining, ",\r\n");
-        } else {
-            written = snprintf(ptr, remaining, "\r\n");
-        }
-        ptr += written; remaining -= written;
+    if (w.overflow || w.pos + 2 > bufferSize) {
+        return 0;
     }
     
-    written = snprintf(ptr, remaining, "  ],\r\n");
-    ptr += written; remaining -= written;
+    /* Patch payload length */
+    payloadLen = w.pos - 4;
+    buffer[2] = (uint8_t)(payloadLen & 0xFF);
+    buffer[3] = (uint8_t)(payloadLen >> 8);
     
-    /* Temperature */
-    written = snprintf(ptr, remaining, "  \"temp\": %.1f\r\n", report->temperature);
-    ptr += written; remaining -= written;
+    /* Fletcher-16 over the payload */
+    for (size_t i = 4; i < w.pos; i++) {
+        sum1 = (sum1 + buffer[i]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    PutU8(&w, (uint8_t)sum1);
+    PutU8(&w, (uint8_t)sum2);
     
-    /* End JSON object */
-    written = snprintf(ptr, remaining, "}");
-    ptr += written; remaining -= written;
+    return w.pos;
 }
 
 /**
-  * @brief  Format system report as compact JSON (single line)
-  * @param  report: Pointer to SystemReport_t structure
+  * @brief  Format a test metrics snapshot as one line of JSON
+  * @param  metrics: Snapshot from TestMetrics_GetReport()
   * @param  buffer: Output buffer for JSON string
   * @param  bufferSize: Size of output buffer
   * @retval None
   */
-void FormatSystemReportJSONCompact(const SystemReport_t *report, char *buffer, size_t bufferSize)
+void FormatTestMetricsJSON(const TestMetrics_t *metrics, char *buffer, size_t bufferSize)
 {
-    char *ptr = buffer;
-    size_t remaining = bufferSize;
+    TextWriter_t w = { buffer, bufferSize };
+    uint8_t checks = TestMetrics_EvaluateChecks(metrics);
+    uint8_t passCount = 0;
+    
+    for (uint8_t i = 0; i < TEST_CHECK_COUNT; i++) {
+        passCount += (checks >> i) & 1;
+    }
+    
+    Append(&w, "{\"test_metrics\":{\"uptime_s\":%lu,", metrics->uptimeSeconds);
+    Append(&w, "\"cpu\":");
+    AppendTestSeries(&w, &metrics->cpuLoad, 2);
+    Append(&w, ",\"latency_ms\":");
+    AppendTestSeries(&w, &metrics->latency, 1);
+    Append(&w, ",\"heap_free\":");
+    AppendTestSeries(&w, &metrics->heapFree, 0);
+    Append(&w, ",\"frag_max\":%.1f,", metrics->heapFragmentationMax);
+    Append(&w, "\"watchdog\":{\"feeds\":%lu,\"loop_max_us\":%lu,\"jitter_max_us\":%lu},",
+           metrics->watchdogFeedCount, metrics->watchdogLoopMaxUs, metrics->watchdogJitterMaxUs);
+    Append(&w, "\"stack_overflows\":%lu,\"malloc_failures\":%lu,",
+           metrics->stackOverflowCount, metrics->mallocFailureCount);
+    Append(&w, "\"sleep\":{\"entries\":%lu,\"total_ms\":%lu,\"last_wake_ms\":%lu},",
+           metrics->deepSleepEntryCount, metrics->totalDeepSleepMs, metrics->lastWakeupLatencyMs);
+    Append(&w, "\"checks\":{\"cpu\":%u,\"latency\":%u,\"heap\":%u,\"power\":%u},\"pass\":%u}}",
+           (checks & TEST_CHECK_CPU) ? 1 : 0, (checks & TEST_CHECK_LATENCY) ? 1 : 0,
+           (checks & TEST_CHECK_HEAP) ? 1 : 0, (checks & TEST_CHECK_POWER) ? 1 : 0,
+           passCount);
+}
+
+/**
+  * @brief  Append formatted text, truncating at the end of the buffer
+  * @retval None
+  */
+static void Append(TextWriter_t *w, const char *fmt, ...)
+{
+    va_list args;
     int written;
     
-    /* Start JSON object */
-    written = snprintf(ptr, remaining, "{\"ts\":%lu,\"cpu\":%.1f,\"heap\":%lu,\"min\":%lu,\"frag\":%.1f,\"tasks\":[",
-                      report->timestamp, report->cpuLoad, report->heapFree, 
-                      report->heapMin, report->fragPercent);
-    ptr += written; remaining -= written;
-    
-    /* Tasks array */
-    for (uint8_t i = 0; i < report->taskCount; i++) {
-        written = snprintf(ptr, remaining, "{\"n\":\"%s\",\"r\":%.1f,\"s\":%lu}",
-                          report->tasks[i].taskName,
-                          report->tasks[i].runtimePercent,
-                          report->tasks[i].stackFree);
-        ptr += written; remaining -= written;
+    if (w->remaining <= 1) {
+        return;
+    }
+    
+    va_start(args, fmt);
+    written = vsnprintf(w->ptr, w->remaining, fmt, args);
+    va_end(args);
+    
+    if (written < 0) {
+        return;
+    }
+    
+    if ((size_t)written >= w->remaining) {
+        written = (int)(w->remaining - 1);
+    }
+    w->ptr += written;
+    w->remaining -= written;
+}
+
+/**
+  * @brief  Emit a separator before every field except the first
+  * @retval None
+  */
+static void Separator(TextWriter_t *w, uint8_t *count, const char *sep)
+{
+    if ((*count)++ > 0) {
+        Append(w, "%s", sep);
+    }
+}
+
+/**
+  * @brief  Append one byte to the binary writer
+  * @retval None
+  */
+static void PutU8(BinaryWriter_t *w, uint8_t value)
+{
+    if (w->pos < w->size) {
+        w->buffer[w->pos++] = value;
+    } else {
+        w->overflow = 1;
+    }
+}
+
+/**
+  * @brief  Append a little-endian 16-bit value to the binary writer
+  * @retval None
+  */
+static void PutU16(BinaryWriter_t *w, uint16_t value)
+{
+    PutU8(w, (uint8_t)(value & 0xFF));
+    PutU8(w, (uint8_t)(value >> 8));
+}
+
+/**
+  * @brief  Append a little-endian 32-bit value to the binary writer
+  * @retval None
+  */
+static void PutU32(BinaryWriter_t *w, uint32_t value)
+{
+    PutU16(w, (uint16_t)(value & 0xFFFF));
+    PutU16(w, (uint16_t)(value >> 16));
+}
+
+/**
+  * @brief  Append a length-prefixed string (u8 length, no terminator)
+  * @retval None
+  */
+static void PutString(BinaryWriter_t *w, const char *str, size_t maxLen)
+{
+    uint8_t len = (uint8_t)strnlen(str, maxLen);
+    
+    PutU8(w, len);
+    for (uint8_t c = 0; c < len; c++) {
+        PutU8(w, (uint8_t)str[c]);
+    }
+}
+
+/**
+  * @brief  Records in a list or map row
+  * @param  row: L or M row
+  * @param  record: Record holding the row
+  * @retval Counter value, clamped to the capacity
+  */
+static uint8_t RowCount(const ReportRow_t *row, const uint8_t *record)
+{
+    uint8_t count = record[row->aux];
+    
+    return (count < row->count) ? count : row->count;
+}
+
+/**
+  * @brief  Append one value in its JSON text encoding
+  * @param  w: Writer
+  * @param  row: F or A row
+  * @param  value: The member (or array element)
+  * @retval None
+  */
+static void AppendValue(TextWriter_t *w, const ReportRow_t *row, const uint8_t *value)
+{
+    switch (row->enc) {
+    case REPORT_ENC_U8:
+        Append(w, "%u", *value);
+        break;
+    case REPORT_ENC_U16:
+        Append(w, "%u", *(const uint16_t *)value);
+        break;
+    case REPORT_ENC_U32:
+        Append(w, "%lu", (unsigned long)*(const uint32_t *)value);
+        break;
+    case REPORT_ENC_I32:
+        Append(w, "%ld", (long)*(const int32_t *)value);
+        break;
+    case REPORT_ENC_U64:
+        Append(w, "%llu", (unsigned long long)*(const uint64_t *)value);
+        break;
+    case REPORT_ENC_PCT0:
+    case REPORT_ENC_UA:
+        Append(w, "%.0f", (double)*(const float *)value);
+        break;
+    case REPORT_ENC_PCT1:
+    case REPORT_ENC_TEMP:
+        Append(w, "%.1f", (double)*(const float *)value);
+        break;
+    case REPORT_ENC_PCT2:
+    case REPORT_ENC_UAH:
+        Append(w, "%.2f", (double)*(const float *)value);
+        break;
+    case REPORT_ENC_MHZ:
+        Append(w, "%lu", (unsigned long)(*(const uint32_t *)value / 1000000UL));
+        break;
+    case REPORT_ENC_QTYPE:
+        Append(w, "\"%s\"", QueueTrace_TypeName(*value));
+        break;
+    case REPORT_ENC_STR:
+        Append(w, "\"%.*s\"", (int)strnlen((const char *)value, row->size), (const char *)value);
+        break;
+    case REPORT_ENC_PSTR: {
+        const char *str = *(const char * const *)value;
         
-        if (i < report->taskCount - 1) {
-            written = snprintf(ptr, remaining, ",");
-            ptr += written; remaining -= written;
+        Append(w, "\"%s\"", (str != NULL) ? str : "");
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+  * @brief  Append the members of one record as JSON key/value pairs
+  * @note   Top-level rows (nested = 0) are one per line in the pretty
+  *         format, with one list record per line; nested records are inline
+  * @param  w: Writer
+  * @param  rows: Record table
+  * @param  record: Record
+  * @param  mask: Bits gating these rows
+  * @param  itemMask: Bits gating rows of nested records (task fields)
+  * @param  compact: 1 = short keys, no spaces
+  * @param  nested: 0 for the report itself
+  * @retval None
+  */
+static void AppendRows(TextWriter_t *w, const ReportRow_t *rows, const uint8_t *record,
+                       uint32_t mask, uint32_t itemMask, uint8_t compact, uint8_t nested)
+{
+    const char *sep = compact ? "," : ", ";
+    const char *keyFmt = compact ? "\"%s\":" : (nested ? "\"%s\": " : "  \"%s\": ");
+    uint8_t fields = 0;
+    
+    for (const ReportRow_t *row = rows; row->kind != REPORT_ROW_END; row++) {
+        const uint8_t *member = record + row->offset;
+        
+        if (row->bit != REPORT_ITEM && !(mask & row->bit)) {
+            continue;
+        }
+        if (row->kind == REPORT_ROW_C && *(const uint32_t *)(record + row->aux) == 0) {
+            continue;
+        }
+        
+        Separator(w, &fields, (compact || nested) ? sep : ",\r\n");
+        Append(w, keyFmt, row->key[compact]);
+        
+        switch (row->kind) {
+        case REPORT_ROW_F:
+            AppendValue(w, row, member);
+            break;
+        case REPORT_ROW_A:
+            Append(w, "[");
+            for (uint8_t i = 0; i < row->count; i++) {
+                Append(w, "%s", (i > 0) ? sep : "");
+                AppendValue(w, row, member + (size_t)i * row->size);
+            }
+            Append(w, "]");
+            break;
+        case REPORT_ROW_O:
+        case REPORT_ROW_C:
+            Append(w, "{");
+            AppendRows(w, row->items, member, itemMask, itemMask, compact, 1);
+            Append(w, "}");
+            break;
+        case REPORT_ROW_L: {
+            uint8_t count = RowCount(row, record);
+            uint8_t multiLine = !compact && !nested;
+            
+            Append(w, "[");
+            for (uint8_t i = 0; i < count; i++) {
+                if (multiLine) {
+                    Append(w, (i > 0) ? ",\r\n    {" : "\r\n    {");
+                } else {
+                    Append(w, (i > 0) ? "%s{" : "{", sep);
+                }
+                AppendRows(w, row->items, member + (size_t)i * row->size,
+                           itemMask, itemMask, compact, 1);
+                Append(w, "}");
+            }
+            Append(w, multiLine ? "\r\n  ]" : "]");
+            break;
+        }
+        case REPORT_ROW_M: {
+            uint8_t count = RowCount(row, record);
+            
+            /* Records are a name row and a value row */
+            Append(w, "{");
+            for (uint8_t i = 0; i < count; i++) {
+                const uint8_t *item = member + (size_t)i * row->size;
+                const char *name = *(const char * const *)(item + row->items[0].offset);
+                
+                Append(w, compact ? "%s\"%s\":" : "%s\"%s\": ", (i > 0) ? sep : "",
+                       (name != NULL) ? name : "");
+                AppendValue(w, &row->items[1], item + row->items[1].offset);
+            }
+            Append(w, "}");
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+/**
+  * @brief  Append one value in its binary encoding
+  * @param  w: Writer
+  * @param  row: F or A row
+  * @param  value: The member (or array element)
+  * @retval None
+  */
+static void PutValue(BinaryWriter_t *w, const ReportRow_t *row, const uint8_t *value)
+{
+    switch (row->enc) {
+    case REPORT_ENC_U8:
+    case REPORT_ENC_QTYPE:
+        PutU8(w, *value);
+        break;
+    case REPORT_ENC_U16:
+        PutU16(w, *(const uint16_t *)value);
+        break;
+    case REPORT_ENC_U32:
+    case REPORT_ENC_MHZ:
+        PutU32(w, *(const uint32_t *)value);
+        break;
+    case REPORT_ENC_I32:
+        PutU32(w, (uint32_t)*(const int32_t *)value);
+        break;
+    case REPORT_ENC_U64:
+        PutU32(w, (uint32_t)*(const uint64_t *)value);
+        PutU32(w, (uint32_t)(*(const uint64_t *)value >> 32));
+        break;
+    case REPORT_ENC_PCT0:
+        PutU8(w, (uint8_t)*(const float *)value);
+        break;
+    case REPORT_ENC_PCT1:
+    case REPORT_ENC_PCT2:
+        PutU16(w, (uint16_t)(*(const float *)value * 100.0f));
+        break;
+    case REPORT_ENC_UA:
+        PutU32(w, (uint32_t)*(const float *)value);
+        break;
+    case REPORT_ENC_UAH:
+        PutU32(w, (uint32_t)(*(const float *)value * 100.0f));
+        break;
+    case REPORT_ENC_TEMP:
+        PutU16(w, (uint16_t)(int16_t)(*(const float *)value * 10.0f));
+        break;
+    case REPORT_ENC_STR:
+        PutString(w, (const char *)value, (row->size < REPORT_STRING_MAX) ? row->size : REPORT_STRING_MAX);
+        break;
+    case REPORT_ENC_PSTR: {
+        const char *str = *(const char * const *)value;
+        
+        PutString(w, (str != NULL) ? str : "", REPORT_STRING_MAX);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+  * @brief  Append the members of one record in binary form
+  * @note   Arrays, lists and maps are prefixed with a u8 count; a C row is
+  *         always written
+  * @param  w: Writer
+  * @param  rows: Record table
+  * @param  record: Record
+  * @param  mask: Bits gating these rows
+  * @param  itemMask: Bits gating rows of nested records (task fields)
+  * @retval None
+  */
+static void PutRows(BinaryWriter_t *w, const ReportRow_t *rows, const uint8_t *record,
+                    uint32_t mask, uint32_t itemMask)
+{
+    for (const ReportRow_t *row = rows; row->kind != REPORT_ROW_END; row++) {
+        const uint8_t *member = record + row->offset;
+        
+        if (row->bit != REPORT_ITEM && !(mask & row->bit)) {
+            continue;
+        }
+        
+        switch (row->kind) {
+        case REPORT_ROW_F:
+            PutValue(w, row, member);
+            break;
+        case REPORT_ROW_A:
+            PutU8(w, row->count);
+            for (uint8_t i = 0; i < row->count; i++) {
+                PutValue(w, row, member + (size_t)i * row->size);
+            }
+            break;
+        case REPORT_ROW_O:
+        case REPORT_ROW_C:
+            PutRows(w, row->items, member, itemMask, itemMask);
+            break;
+        case REPORT_ROW_L:
+        case REPORT_ROW_M: {
+            uint8_t count = RowCount(row, record);
+            
+            PutU8(w, count);
+            for (uint8_t i = 0; i < count; i++) {
+                PutRows(w, row->items, member + (size_t)i * row->size, itemMask, itemMask);
+            }
+            break;
+        }
+        default:
+            break;
         }
     }
+}
+
+/**
+  * @brief  Append one test metrics series with its windows
+  * @param  w: Writer
+  * @param  series: Series snapshot
+  * @param  decimals: Digits after the point for the values
+  * @retval None
+  */
+static void AppendTestSeries(TextWriter_t *w, const TestMetricsSeries_t *series, int decimals)
+{
+    static const char * const pcWindowKeys[TEST_WINDOW_COUNT] = { "1s", "1m", "1h" };
     
-    /* Close and add temperature */
-    written = snprintf(ptr, remaining, "],\"temp\":%.1f}", report->temperature);
-    ptr += written; remaining -= written;
+    Append(w, "{\"n\":%lu,\"avg\":%.*f,\"sd\":%.*f,\"min\":%.*f,\"max\":%.*f",
+           series->count, decimals, series->mean, decimals, series->stddev,
+           decimals, series->min, decimals, series->max);
+    for (uint8_t i = 0; i < TEST_WINDOW_COUNT; i++) {
+        const TestMetricsWindow_t *pxWindow = &series->window[i];
+        
+        Append(w, ",\"%s\":{\"n\":%lu,\"avg\":%.*f,\"min\":%.*f,\"max\":%.*f}",
+               pcWindowKeys[i], pxWindow->count, decimals, pxWindow->mean,
+               decimals, pxWindow->min, decimals, pxWindow->max);
+    }
+    Append(w, "}");
 }
@@ -0,0 +1,310 @@
+/**
+  ******************************************************************************
+  * @file    log_channel.c
+  * @brief   Log Channel Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * Multi-producer, single-consumer ring of 32-bit words. A record is
+  *
+  *   [header] [format address] [tick] [payload ...]
+  *
+  * A producer reserves its words by advancing the head with LDREX/STREX,
+  * fills the payload and publishes the header last, after a barrier. The
+  * consumer stops at the first header without LOG_HDR_COMMIT, so a writer
+  * preempted between reserve and publish only delays the records behind it.
+  * The consumer clears every word of a record before releasing it, so a
+  * stale argument can never pass for the committed header of a record
+  * reserved over it; a header that still makes no sense (length outside
+  * the record limits or past the head) drops the ring contents and resyncs.
+  *
+  * The tick is a plain xTaskGetTickCount() load, which on this port
+  * (32-bit TickType_t) needs no critical section and is safe even from
+  * interrupts above configMAX_SYSCALL_INTERRUPT_PRIORITY.
+  *
+  ******************************************************************************
+  */
+
+#include "log_channel.h"
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "uart_transport.h"
+#include <stdio.h>
+#include <string.h>
+
+#define LOG_RING_MASK               (LOG_RING_WORDS - 1U)
+#define LOG_HDR_WORDS               3U
+#define LOG_RECORD_MAX_WORDS        (LOG_HDR_WORDS + LOG_MAX_ARGS)
+
+/* Header word layout */
+#define LOG_HDR_COMMIT              0x80000000UL
+#define LOG_HDR_STRING              0x00010000UL    /* Payload is string bytes */
+#define LOG_HDR_LEN_MASK            0x000000FFUL    /* Record length in words */
+
+#define STREAM_BUFFER_SIZE          256
+
+#if (LOG_RING_WORDS & (LOG_RING_WORDS - 1)) != 0
+#error "LOG_RING_WORDS must be a power of 2"
+#endif
+
+#if ((LOG_STR_MAX + 3) / 4) > LOG_MAX_ARGS
+#error "LOG_STR() records must fit LOG_RECORD_MAX_WORDS"
+#endif
+
+/* Static variables */
+static volatile uint32_t ulRing[LOG_RING_WORDS];
+static volatile uint32_t ulHead = 0;            /* Next word to reserve */
+static volatile uint32_t ulTail = 0;            /* Next word to consume */
+static volatile uint32_t ulDropped = 0;
+static volatile uint32_t ulDraining = 0;        /* Consumer claim */
+static uint32_t ulReportedDropped = 0;
+
+/* Private function prototypes */
+static uint8_t Reserve(uint32_t ulWords, uint32_t *pulStart);
+static void Publish(uint32_t ulStart, uint32_t ulHeader, const char *fmt);
+static uint8_t DrainRecords(void);
+static void Resync(uint32_t ulTailIndex);
+
+/**
+  * @brief  Queue a record with 32-bit arguments (task or ISR)
+  * @param  fmt: Format string (static storage, normally from LOG())
+  * @param  args: Argument words
+  * @param  count: Number of arguments, at most LOG_MAX_ARGS
+  * @retval None
+  */
+void LogChannel_Write(const char *fmt, const uint32_t *args, uint8_t count)
+{
+    uint32_t ulWords;
+    uint32_t ulStart;
+
+    if (count > LOG_MAX_ARGS) {
+        count = LOG_MAX_ARGS;
+    }
+    ulWords = LOG_HDR_WORDS + count;
+
+    if (!Reserve(ulWords, &ulStart)) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        ulRing[(ulStart + LOG_HDR_WORDS + i) & LOG_RING_MASK] = args[i];
+    }
+    Publish(ulStart, ulWords, fmt);
+}
+
+/**
+  * @brief  Queue a record carrying one string argument (task or ISR)
+  * @param  fmt: Format string with a single %s
+  * @param  str: String, truncated to LOG_STR_MAX bytes
+  * @retval None
+  */
+void LogChannel_WriteString(const char *fmt, const char *str)
+{
+    uint32_t ulBytes = 0;
+    uint32_t ulWords;
+    uint32_t ulStart;
+    uint32_t ulWord = 0;
+
+    while ((ulBytes < LOG_STR_MAX) && (str[ulBytes] != '\0')) {
+        ulBytes++;
+    }
+    ulWords = LOG_HDR_WORDS + (ulBytes + 3) / 4;
+
+    if (!Reserve(ulWords, &ulStart)) {
+        return;
+    }
+
+    /* Little-endian packing, zero padded */
+    for (uint32_t i = 0; i < ulBytes; i++) {
+        ulWord |= (uint32_t)(uint8_t)str[i] << (8 * (i & 3));
+        if (((i & 3) == 3) || (i == ulBytes - 1)) {
+            ulRing[(ulStart + LOG_HDR_WORDS + i / 4) & LOG_RING_MASK] = ulWord;
+            ulWord = 0;
+        }
+    }
+    Publish(ulStart, ulWords | LOG_HDR_STRING, fmt);
+}
+
+/**
+  * @brief  Write queued records to the transport (drain task)
+  * @note   Returns immediately if another context is already draining
+  * @retval 1 if anything was written
+  */
+uint8_t LogChannel_Drain(void)
+{
+    uint8_t ucWritten;
+
+    do {
+        if (__LDREXW(&ulDraining) != 0) {
+            __CLREX();
+            return 0;
+        }
+    } while (__STREXW(1, &ulDraining) != 0);
+    __DMB();
+
+    ucWritten = DrainRecords();
+
+    __DMB();
+    ulDraining = 0;
+    return ucWritten;
+}
+
+/**
+  * @brief  Drain regardless of the consumer claim
+  * @note   Only for paths that never hand control back to the scheduler
+  *         (fault hooks); a drain it interrupted may repeat a record
+  * @retval None
+  */
+void LogChannel_Flush(void)
+{
+    (void)DrainRecords();
+}
+
+/**
+  * @brief  Records lost to a full ring since boot
+  * @retval Drop count
+  */
+uint32_t LogChannel_GetDropped(void)
+{
+    return ulDropped;
+}
+
+/**
+  * @brief  Claim ring words for a record
+  * @param  ulWords: Record length including the header
+  * @param  pulStart: Output first word index (free running)
+  * @retval 1 if reserved, 0 if the ring is full (the record is counted as dropped)
+  */
+static uint8_t Reserve(uint32_t ulWords, uint32_t *pulStart)
+{
+    uint32_t ulStart;
+    uint32_t ulOld;
+
+    do {
+        ulStart = __LDREXW(&ulHead);
+        if ((ulStart + ulWords) - ulTail > LOG_RING_WORDS) {
+            __CLREX();
+            do {
+                ulOld = __LDREXW(&ulDropped);
+            } while (__STREXW(ulOld + 1, &ulDropped) != 0);
+            return 0;
+        }
+    } while (__STREXW(ulStart + ulWords, &ulHead) != 0);
+
+    *pulStart = ulStart;
+    return 1;
+}
+
+/**
+  * @brief  Fill the fixed fields and make the record visible to the consumer
+  * @param  ulStart: First word index
+  * @param  ulHeader: Length and flags
+  * @param  fmt: Format string
+  * @retval None
+  */
+static void Publish(uint32_t ulStart, uint32_t ulHeader, const char *fmt)
+{
+    ulRing[(ulStart + 1) & LOG_RING_MASK] = (uint32_t)(uintptr_t)fmt;
+    ulRing[(ulStart + 2) & LOG_RING_MASK] = xTaskGetTickCount();
+    __DMB();
+    ulRing[ulStart & LOG_RING_MASK] = ulHeader | LOG_HDR_COMMIT;
+}
+
+/**
+  * @brief  Format committed records as #lg lines and release their words
+  * @retval 1 if anything was written
+  */
+static uint8_t DrainRecords(void)
+{
+    static char buffer[STREAM_BUFFER_SIZE];
+    size_t xLen = 0;
+    uint8_t ucWritten = 0;
+    uint32_t ulDrops = ulDropped;
+
+    if (ulDrops != ulReportedDropped) {
+        ulReportedDropped = ulDrops;
+        xLen = snprintf(buffer, sizeof(buffer), "#lgd %lu\r\n", ulDrops);
+    }
+
+    while (ulTail != ulHead) {
+        uint32_t ulTailIndex = ulTail;
+        uint32_t ulHeader = ulRing[ulTailIndex & LOG_RING_MASK];
+        uint32_t ulWords = ulHeader & LOG_HDR_LEN_MASK;
+        char line[96];
+        int lineLen;
+
+        if ((ulHeader & LOG_HDR_COMMIT) == 0) {
+            break;
+        }
+        if (ulWords < LOG_HDR_WORDS || ulWords > LOG_RECORD_MAX_WORDS ||
+            ulWords > ulHead - ulTailIndex) {
+            Resync(ulTailIndex);
+            break;
+        }
+        __DMB();
+
+        lineLen = snprintf(line, sizeof(line), "%s %lu %08lx",
+                           (ulHeader & LOG_HDR_STRING) ? "#lgs" : "#lg",
+                           ulRing[(ulTailIndex + 2) & LOG_RING_MASK],
+                           ulRing[(ulTailIndex + 1) & LOG_RING_MASK]);
+        for (uint32_t i = LOG_HDR_WORDS; i < ulWords; i++) {
+            uint32_t ulArg = ulRing[(ulTailIndex + i) & LOG_RING_MASK];
+
+            if (ulHeader & LOG_HDR_STRING) {
+                /* Byte order as stored, so the line is the raw string in hex */
+                lineLen += snprintf(&line[lineLen], sizeof(line) - lineLen, "%s%02lx%02lx%02lx%02lx",
+                                    (i == LOG_HDR_WORDS) ? " " : "",
+                                    ulArg & 0xFF, (ulArg >> 8) & 0xFF,
+                                    (ulArg >> 16) & 0xFF, ulArg >> 24);
+            } else {
+                lineLen += snprintf(&line[lineLen], sizeof(line) - lineLen, " %lx", ulArg);
+            }
+        }
+        lineLen += snprintf(&line[lineLen], sizeof(line) - lineLen, "\r\n");
+
+        for (uint32_t i = 0; i < ulWords; i++) {
+            ulRing[(ulTailIndex + i) & LOG_RING_MASK] = 0;
+        }
+        __DMB();
+        ulTail = ulTailIndex + ulWords;
+
+        if (xLen + lineLen >= sizeof(buffer)) {
+            Transport_Write((const uint8_t*)buffer, xLen, 1000);
+            ucWritten = 1;
+            xLen = 0;
+        }
+        memcpy(&buffer[xLen], line, lineLen);
+        xLen += lineLen;
+    }
+
+    if (xLen > 0) {
+        Transport_Write((const uint8_t*)buffer, xLen, 1000);
+        ucWritten = 1;
+    }
+
+    return ucWritten;
+}
+
+/**
+  * @brief  Drop everything reserved so far after a corrupt header
+  * @note   Records still being written by preempted producers are lost
+  *         with the rest; each dropped word span counts as one drop
+  * @param  ulTailIndex: Tail the corrupt header was read at
+  * @retval None
+  */
+static void Resync(uint32_t ulTailIndex)
+{
+    uint32_t ulHeadIndex = ulHead;
+    uint32_t ulOld;
+
+    for (uint32_t i = ulTailIndex; i != ulHeadIndex; i++) {
+        ulRing[i & LOG_RING_MASK] = 0;
+    }
+    __DMB();
+    ulTail = ulHeadIndex;
+
+    do {
+        ulOld = __LDREXW(&ulDropped);
+    } while (__STREXW(ulOld + 1, &ulDropped) != 0);
+}
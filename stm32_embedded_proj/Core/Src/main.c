@@ -23,22 +23,96 @@
 #include "system_profiler.h"
 #include "json_formatter.h"
 #include "test_metrics.h"
+#include "clock_governor.h"
+#include "power_management.h"
+#include "energy_model.h"
+#include "command_channel.h"
+#include "uart_transport.h"
+#include "pc_sampler.h"
+#include "user_metrics.h"
+#include "burst_capture.h"
+#include "log_channel.h"
+#include "analog_monitor.h"
+#include "workload.h"
+#include "profiler_overhead.h"
+#include "idle_load.h"
+#include "stack_monitor.h"
+#include "sizing_advisor.h"
+#include "pool_alloc.h"
+#include "isr_event.h"
 #include <stdio.h>
 #include <string.h>
 
 /* Private defines -----------------------------------------------------------*/
+/* Stack depths (words) and queue lengths; a header generated by
+ * Tools/sizing_advisor.py overrides them (make SIZING=<header>) */
+#ifndef PROFILER_TASK_STACK_SIZE
 #define PROFILER_TASK_STACK_SIZE    512
+#endif
+#ifndef GPIO_MONITOR_TASK_STACK
 #define GPIO_MONITOR_TASK_STACK     256
+#endif
+#ifndef REPORT_TASK_STACK_SIZE
 #define REPORT_TASK_STACK_SIZE      512
+#endif
+#ifndef IDLE_MONITOR_TASK_STACK
 #define IDLE_MONITOR_TASK_STACK     128
+#endif
+#ifndef WATCHDOG_TASK_STACK_SIZE
 #define WATCHDOG_TASK_STACK_SIZE    256
-
+#endif
+#ifndef COMMAND_TASK_STACK_SIZE
+#define COMMAND_TASK_STACK_SIZE     256
+#endif
+#ifndef LOG_DRAIN_TASK_STACK
+#define LOG_DRAIN_TASK_STACK        256
+#endif
+
+#ifndef PROFILER_QUEUE_LENGTH
 #define PROFILER_QUEUE_LENGTH       10
-#define GPIO_QUEUE_LENGTH           5
+#endif
+#ifndef GPIO_EVENT_RING_LENGTH
+#define GPIO_EVENT_RING_LENGTH      8     // Button EXTI -> GPIO task (power of 2)
+#endif
+
+/* Watchdog task */
+#define WATCHDOG_PERIOD_MS          500
+#define METRICS_REPORT_PERIODS      120   // 120 * 500ms = 60 seconds
+#define LOW_HEAP_WARNING_BYTES      10240
+
+/* Task / queue creation - each expansion owns its stack, TCB and queue
+ * storage in PROFILER_STATIC_ALLOCATION builds. Tasks also tell the sizing
+ * advisor which define sizes their stack. */
+#if PROFILER_STATIC_ALLOCATION
+#define CREATE_TASK(fn, name, stack, prio, handle)                              \
+    do {                                                                        \
+        static StackType_t xStack[stack];                                       \
+        static StaticTask_t xTcb;                                               \
+        SizingAdvisor_Track(SIZING_KIND_STACK, name, #stack, sizeof(StackType_t)); \
+        *(handle) = xTaskCreateStatic(fn, name, stack, NULL, prio, xStack, &xTcb); \
+    } while (0)
+#define CREATE_QUEUE(handle, length, itemSize)                                  \
+    do {                                                                        \
+        static uint8_t ucStorage[(length) * (itemSize)];                        \
+        static StaticQueue_t xQueueBuffer;                                      \
+        *(handle) = xQueueCreateStatic(length, itemSize, ucStorage, &xQueueBuffer); \
+    } while (0)
+#else
+#define CREATE_TASK(fn, name, stack, prio, handle)                              \
+    do {                                                                        \
+        SizingAdvisor_Track(SIZING_KIND_STACK, name, #stack, sizeof(StackType_t)); \
+        if (xTaskCreate(fn, name, stack, NULL, prio, handle) != pdPASS) {       \
+            Error_Handler();                                                    \
+        }                                                                       \
+    } while (0)
+#define CREATE_QUEUE(handle, length, itemSize) \
+    (*(handle) = xQueueCreate(length, itemSize))
+#endif
 
 /* Deep sleep configuration */
 #define BUTTON_LONG_PRESS_TIME_MS   3000  // 3 seconds for deep sleep trigger
 #define BUTTON_DEBOUNCE_MS          50    // 50ms debounce
+#define GPIO_EVENT_NOTIFY_BIT       (1UL << 0)
 
 #define USER_BUTTON_PIN             GPIO_PIN_13  // Blue button on Nucleo
 #define USER_BUTTON_PORT            GPIOC
@@ -56,13 +130,23 @@ TaskHandle_t xGpioMonitorTaskHandle = NULL;
 TaskHandle_t xReportTaskHandle = NULL;
 TaskHandle_t xIdleMonitorTaskHandle = NULL;
 TaskHandle_t xWatchdogTaskHandle = NULL;
+TaskHandle_t xCommandTaskHandle = NULL;
+TaskHandle_t xLogDrainTaskHandle = NULL;
 
 QueueHandle_t xProfilerQueue = NULL;
-QueueHandle_t xGpioQueue = NULL;
+
+/* Button events (EXTI15_10 -> GpioMonitorTask) */
+static IsrEvent_t xGpioEvents[GPIO_EVENT_RING_LENGTH];
+static IsrEventRing_t xGpioRing;
 
 /* Statistics tracking */
-static uint32_t ulIdleCycleCount = 0;
-static volatile uint32_t ulHighFrequencyTimerTicks = 0;
+volatile uint32_t ulHighFrequencyTimerTicks = 0;    /* Run-time stats base (FreeRTOSConfig.h) */
+
+/* Self-instrumentation through the user metrics API */
+static uint8_t ucCollectSpan = USER_METRIC_INVALID;
+static uint8_t ucFormatSpan = USER_METRIC_INVALID;
+static uint8_t ucDroppedCounter = USER_METRIC_INVALID;
+static uint8_t ucQueueGauge = USER_METRIC_INVALID;
 
 /* Button press tracking */
 static volatile uint32_t ulButtonPressStartTime = 0;
@@ -82,6 +166,8 @@ static void GpioMonitorTask(void *pvParameters);
 static void ReportTask(void *pvParameters);
 static void IdleMonitorTask(void *pvParameters);
 static void WatchdogTask(void *pvParameters);
+static void CommandTask(void *pvParameters);
+static void LogDrainTask(void *pvParameters);
 
 /* Interrupt Callbacks */
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
@@ -93,35 +179,85 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
 int main(void)
 {
     /* MCU Configuration--------------------------------------------------------*/
+    uint32_t ulStartupCycles;
+    char startupMsg[64];
+    
     HAL_Init();
     SystemClock_Config();
     
+    /* Time startup on the cycle counter once the final clock is running */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    
+    /* Button events may arrive as soon as EXTI is enabled */
+    if (!IsrEvent_Init(&xGpioRing, xGpioEvents, GPIO_EVENT_RING_LENGTH)) {
+        Error_Handler();
+    }
+    
     /* Initialize all configured peripherals */
     MX_GPIO_Init();
     MX_USART2_UART_Init();
     MX_IWDG_Init();
+    Transport_Init();
+    PcSampler_Init();
+    BurstCapture_Init();
+    AnalogMonitor_Init();
     
     /* Create Queues */
-    xProfilerQueue = xQueueCreate(PROFILER_QUEUE_LENGTH, sizeof(SystemReport_t));
-    xGpioQueue = xQueueCreate(GPIO_QUEUE_LENGTH, sizeof(uint8_t));
+    CREATE_QUEUE(&xProfilerQueue, PROFILER_QUEUE_LENGTH, sizeof(SystemReport_t));
     
-    if (xProfilerQueue == NULL || xGpioQueue == NULL) {
+    if (xProfilerQueue == NULL) {
         Error_Handler();
     }
     
+    /* Name the queues in the trace reports */
+    vQueueAddToRegistry(xProfilerQueue, "ProfilerQ");
+    
+    /* Size defines for the sizing advisor ("sizing" command) */
+    SizingAdvisor_Track(SIZING_KIND_QUEUE, "ProfilerQ", "PROFILER_QUEUE_LENGTH", sizeof(SystemReport_t));
+    SizingAdvisor_Track(SIZING_KIND_STACK, "IDLE", "configMINIMAL_STACK_SIZE", sizeof(StackType_t));
+    SizingAdvisor_Track(SIZING_KIND_STACK, "Tmr Svc", "configTIMER_TASK_STACK_DEPTH", sizeof(StackType_t));
+    
     /* Print startup message */
     char msg[] = "\r\n=== STM32 System Profiler Started ===\r\n";
-    HAL_UART_Transmit(&huart2, (uint8_t*)msg, strlen(msg), HAL_MAX_DELAY);
+    Transport_Write((const uint8_t*)msg, strlen(msg), HAL_MAX_DELAY);
     
     /* Initialize test metrics */
     TestMetrics_Init();
     
+    /* Start frequency scaling governor at the boot operating point */
+    ClockGovernor_Init();
+    
+    /* Initialize power accounting and energy model */
+    PowerManagement_Init();
+    EnergyModel_Init();
+    
+    /* Instrument the profiler's own hot paths */
+    ucCollectSpan = Profiler_SpanRegister("collect");
+    ucFormatSpan = Profiler_SpanRegister("format");
+    ucDroppedCounter = Profiler_CounterRegister("reports_dropped");
+    ucQueueGauge = Profiler_GaugeRegister("report_queue");
+    
     /* Create FreeRTOS Tasks */
-    xTaskCreate(ProfilerTask, "Profiler", PROFILER_TASK_STACK_SIZE, NULL, 3, &xProfilerTaskHandle);
-    xTaskCreate(GpioMonitorTask, "GPIO", GPIO_MONITOR_TASK_STACK, NULL, 2, &xGpioMonitorTaskHandle);
-    xTaskCreate(ReportTask, "Report", REPORT_TASK_STACK_SIZE, NULL, 1, &xReportTaskHandle);
-    xTaskCreate(IdleMonitorTask, "IdleMon", IDLE_MONITOR_TASK_STACK, NULL, 0, &xIdleMonitorTaskHandle);
-    xTaskCreate(WatchdogTask, "Watchdog", WATCHDOG_TASK_STACK_SIZE, NULL, 4, &xWatchdogTaskHandle);
+    CREATE_TASK(ProfilerTask, "Profiler", PROFILER_TASK_STACK_SIZE, 3, &xProfilerTaskHandle);
+    CREATE_TASK(GpioMonitorTask, "GPIO", GPIO_MONITOR_TASK_STACK, 2, &xGpioMonitorTaskHandle);
+    CREATE_TASK(ReportTask, "Report", REPORT_TASK_STACK_SIZE, 1, &xReportTaskHandle);
+    CREATE_TASK(IdleMonitorTask, "IdleMon", IDLE_MONITOR_TASK_STACK, 0, &xIdleMonitorTaskHandle);
+    CREATE_TASK(WatchdogTask, "Watchdog", WATCHDOG_TASK_STACK_SIZE, 4, &xWatchdogTaskHandle);
+    CREATE_TASK(CommandTask, "Command", COMMAND_TASK_STACK_SIZE, 1, &xCommandTaskHandle);
+    CREATE_TASK(LogDrainTask, "LogDrain", LOG_DRAIN_TASK_STACK, 1, &xLogDrainTaskHandle);
+    IsrEvent_SetConsumer(&xGpioRing, xGpioMonitorTaskHandle, GPIO_EVENT_NOTIFY_BIT);
+    
+    /* Allocator pools from what the boot allocations left */
+    PoolAlloc_Init();
+    
+    /* Clock setup to scheduler start, including the boot banner */
+    ulStartupCycles = DWT->CYCCNT;
+    snprintf(startupMsg, sizeof(startupMsg), "Startup: %lu us (%s allocation)\r\n",
+             ulStartupCycles / (SystemCoreClock / 1000000UL),
+             PROFILER_STATIC_ALLOCATION ? "static" : "dynamic");
+    Transport_Write((const uint8_t*)startupMsg, strlen(startupMsg), HAL_MAX_DELAY);
     
     /* Start scheduler */
     vTaskStartScheduler();
@@ -139,30 +275,63 @@ int main(void)
   */
 static void ProfilerTask(void *pvParameters)
 {
-    SystemReport_t report;
+    static SystemReport_t report;   /* Too large for this task's stack */
     TickType_t xLastWakeTime;
-    const TickType_t xFrequency = pdMS_TO_TICKS(100); // 100ms interval
+    ProfilerConfig_t *pxConfig = GetProfilerConfig();
     static uint32_t ulButtonPressTimestamp = 0;
+    static ReportSubscription_t xSampleSubscription;
+    static uint32_t counter = 0;
+    const ReportSubscription_t *pxSubscription;
+    uint32_t ulSpanStart;
     
     xLastWakeTime = xTaskGetTickCount();
     
     for (;;) {
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        /* Sample period is runtime configurable (default 100ms) and
+           stretched by the overhead throttle */
+        vTaskDelayUntil(&xLastWakeTime,
+                        pdMS_TO_TICKS(ProfilerOverhead_SamplePeriodMs(pxConfig->samplePeriodMs)));
+        
+        /* Integrate energy over the last period, before the governor may switch */
+        EnergyModel_Update();
+        
+        /* Over budget: only samples that will be reported walk the task list */
+        pxSubscription = &pxConfig->subscription;
+        if (ProfilerOverhead_GetLevel() >= OVERHEAD_LEVEL_REPORT_TASKS &&
+            counter + 1 < pxConfig->reportEverySamples) {
+            xSampleSubscription = pxConfig->subscription;
+            xSampleSubscription.fieldMask &= ~REPORT_FIELD_TASKS;
+            pxSubscription = &xSampleSubscription;
+        }
+        
+        /* Advance the incremental stack watermark scan */
+        StackMonitor_Scan();
         
         /* Collect system statistics */
-        CollectSystemStats(&report);
+        ulSpanStart = Profiler_SpanBegin(ucCollectSpan);
+        CollectSystemStats(&report, pxSubscription);
+        Profiler_SpanEnd(ucCollectSpan, ulSpanStart);
+        Workload_OnSample(&report);
+        ProfilerOverhead_Update();
         
         /* Record metrics */
         TestMetrics_RecordCpuLoad(report.cpuLoad);
         TestMetrics_RecordHeapStatus(report.heapFree, report.fragPercent);
         
-        /* Send to report queue every 10 samples (1 second) */
-        static uint8_t counter = 0;
-        if (++counter >= 10) {
+        /* Scale core clock to the measured load */
+        ClockGovernor_Update(report.cpuLoad);
+        
+        /* Send to report queue every N samples (default 10 = 1 second);
+           never block here - drop the report if ReportTask is behind */
+        if (++counter >= pxConfig->reportEverySamples) {
             counter = 0;
-            ulButtonPressTimestamp = xTaskGetTickCount();
-            xQueueSend(xProfilerQueue, &report, portMAX_DELAY);
-            TestMetrics_RecordIrqToJsonLatency(0); // Latency recorded in ReportTask
+            if (!pxConfig->paused) {
+                ulButtonPressTimestamp = xTaskGetTickCount();
+                if (xQueueSend(xProfilerQueue, &report, 0) != pdTRUE) {
+                    Profiler_CounterAdd(ucDroppedCounter, 1);
+                }
+                Profiler_GaugeSet(ucQueueGauge, (int32_t)uxQueueMessagesWaiting(xProfilerQueue));
+            }
         }
         
         /* Toggle LED for heartbeat */
@@ -177,19 +346,21 @@ static void ProfilerTask(void *pvParameters)
   */
 static void GpioMonitorTask(void *pvParameters)
 {
-    uint8_t event;
-    SystemReport_t report;
+    IsrEvent_t event;
+    static SystemReport_t report;   /* Too large for this task's stack */
     uint32_t ulButtonHoldTime;
+    ProfilerConfig_t *pxConfig = GetProfilerConfig();
     
     for (;;) {
         /* Check for button press events every 100ms for long press detection */
-        if (xQueueReceive(xGpioQueue, &event, pdMS_TO_TICKS(100)) == pdTRUE) {
+        if (IsrEvent_Wait(&xGpioRing, &event, pdMS_TO_TICKS(100))) {
             /* Button press detected - start tracking time */
             if (ucButtonPressed == 0) {
                 ulButtonPressStartTime = xTaskGetTickCount();
                 ucButtonPressed = 1;
-                char msg[] = "\r\n=== Button Pressed (Hold for deep sleep) ===\r\n";
-                HAL_UART_Transmit(&huart2, (uint8_t*)msg, strlen(msg), 100);
+                if (pxConfig->verbosity > 0) {
+                    LOG("=== Button Pressed (Hold for deep sleep) ===");
+                }
             }
         }
         
@@ -202,15 +373,15 @@ static void GpioMonitorTask(void *pvParameters)
                 /* Button released */
                 if (ulButtonHoldTime >= BUTTON_LONG_PRESS_TIME_MS) {
                     /* Long press detected - enter deep sleep */
-                    char msg[] = "\r\n=== LONG PRESS DETECTED - Entering Deep Sleep ===\r\n";
-                    HAL_UART_Transmit(&huart2, (uint8_t*)msg, strlen(msg), 100);
+                    LOG("=== LONG PRESS DETECTED - Entering Deep Sleep ===");
                     vTaskDelay(pdMS_TO_TICKS(100));
                     EnterDeepSleep();
                 } else {
                     /* Short press - dump system stats */
-                    CollectSystemStats(&report);
-                    char msg[] = "\r\n=== Short Button Press - Full System Dump ===\r\n";
-                    HAL_UART_Transmit(&huart2, (uint8_t*)msg, strlen(msg), 100);
+                    CollectSystemStats(&report, NULL);
+                    if (pxConfig->verbosity > 0) {
+                        LOG("=== Short Button Press - Full System Dump ===");
+                    }
                     xQueueSendToFront(xProfilerQueue, &report, 0);
                 }
                 
@@ -227,27 +398,81 @@ static void GpioMonitorTask(void *pvParameters)
   */
 static void ReportTask(void *pvParameters)
 {
-    SystemReport_t report;
-    char jsonBuffer[1024];
+    static SystemReport_t report;   /* Too large for this task's stack */
+    static char jsonBuffer[4096];
+    static TestMetrics_t xMetricsSnapshot;
     uint32_t ulReportStartTime;
+    uint32_t ulSpanStart;
+    uint32_t ulPhaseStart;
+    ReportFormat_t eFormat;
+    size_t xLength;
+    ProfilerConfig_t *pxConfig = GetProfilerConfig();
     
     for (;;) {
-        /* Wait for profiler data */
-        if (xQueueReceive(xProfilerQueue, &report, portMAX_DELAY) == pdTRUE) {
+        /* Wait for profiler data; wake regularly to stream PC samples */
+        if (xQueueReceive(xProfilerQueue, &report, pdMS_TO_TICKS(PC_SAMPLER_STREAM_MS / 4)) == pdTRUE) {
             /* Record start time for latency measurement */
             ulReportStartTime = xTaskGetTickCount();
+            ulSpanStart = Profiler_SpanBegin(ucFormatSpan);
+            
+            /* Format in the selected output format... */
+            eFormat = pxConfig->format;
+            ulPhaseStart = ProfilerOverhead_Begin();
+            switch (eFormat) {
+            case REPORT_FORMAT_BINARY:
+                xLength = FormatSystemReportBinary(&report, (uint8_t*)jsonBuffer, sizeof(jsonBuffer));
+                break;
+            
+            case REPORT_FORMAT_COMPACT:
+                FormatSystemReportJSONCompact(&report, jsonBuffer, sizeof(jsonBuffer));
+                xLength = strlen(jsonBuffer);
+                break;
+            
+            default:
+                FormatSystemReportJSON(&report, jsonBuffer, sizeof(jsonBuffer));
+                xLength = strlen(jsonBuffer);
+                break;
+            }
+            ProfilerOverhead_End(OVERHEAD_FORMAT, ulPhaseStart);
             
-            /* Format as JSON */
-            FormatSystemReportJSON(&report, jsonBuffer, sizeof(jsonBuffer));
+            /* ...and transmit via UART (polled, so the wire time is CPU time) */
+            ulPhaseStart = ProfilerOverhead_Begin();
+            Transport_Write((const uint8_t*)jsonBuffer, xLength, 1000);
+            if (eFormat != REPORT_FORMAT_BINARY) {
+                Transport_Write((const uint8_t*)"\r\n", 2, 100);
+            }
+            ProfilerOverhead_End(OVERHEAD_TRANSMIT, ulPhaseStart);
             
-            /* Transmit via UART */
-            HAL_UART_Transmit(&huart2, (uint8_t*)jsonBuffer, strlen(jsonBuffer), 1000);
-            HAL_UART_Transmit(&huart2, (uint8_t*)"\r\n", 2, 100);
+            Profiler_SpanEnd(ucFormatSpan, ulSpanStart);
             
             /* Record latency from queue receive to transmission complete */
             uint32_t ulLatency = xTaskGetTickCount() - ulReportStartTime;
             TestMetrics_RecordIrqToJsonLatency(ulLatency);
         }
+        
+        /* Test metrics requested by the watchdog task, snapshot taken here */
+        if (TestMetrics_GetReport(&xMetricsSnapshot)) {
+            FormatTestMetricsJSON(&xMetricsSnapshot, jsonBuffer, sizeof(jsonBuffer));
+            Transport_Write((const uint8_t*)jsonBuffer, strlen(jsonBuffer), 1000);
+            Transport_Write((const uint8_t*)"\r\n", 2, 100);
+        }
+        
+        PcSampler_Stream();
+        BurstCapture_Stream();
+    }
+}
+
+/**
+  * @brief  Log Drain Task - Writes deferred log records to the transport
+  * @param  pvParameters: Task parameters
+  * @retval None
+  */
+static void LogDrainTask(void *pvParameters)
+{
+    for (;;) {
+        /* Polled: producers may be ISRs above the syscall priority */
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_PERIOD_MS));
+        (void)LogChannel_Drain();
     }
 }
 
@@ -271,16 +496,23 @@ static void IdleMonitorTask(void *pvParameters)
   */
 static void WatchdogTask(void *pvParameters)
 {
-    const TickType_t xFrequency = pdMS_TO_TICKS(500);
+    const TickType_t xFrequency = pdMS_TO_TICKS(WATCHDOG_PERIOD_MS);
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+    ProfilerConfig_t *pxConfig = GetProfilerConfig();
+    uint32_t ulLastWakeCycles = DWT->CYCCNT;
+    uint32_t ulLastClock = SystemCoreClock;
+    uint32_t cycleCounter = 0;
     
     for (;;) {
-        vTaskDelay(xFrequency);
+        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        uint32_t ulWakeCycles = DWT->CYCCNT;
         
         /* Check heap status */
         size_t freeHeap = xPortGetFreeHeapSize();
-        if (freeHeap < 10240) { // Less than 10KB free
-            char msg[] = "WARNING: Low heap memory!\r\n";
-            HAL_UART_Transmit(&huart2, (uint8_t*)msg, strlen(msg), 100);
+        if (freeHeap < LOW_HEAP_WARNING_BYTES) {
+            if (pxConfig->verbosity > 0) {
+                LOG("WARNING: Low heap memory! %lu bytes free", (uint32_t)freeHeap);
+            }
             TestMetrics_IncrementMallocFailure();
         }
         
@@ -288,12 +520,47 @@ static void WatchdogTask(void *pvParameters)
         HAL_IWDG_Refresh(&hiwdg);
         TestMetrics_IncrementWatchdogFeed();
         
-        /* Every 60 seconds, print test metrics */
-        static uint32_t cycleCounter = 0;
-        if (++cycleCounter >= 120) { // 120 * 500ms = 60 seconds
+        /* Every 60 seconds, hand a metrics snapshot to the report task */
+        if (++cycleCounter >= METRICS_REPORT_PERIODS) {
             cycleCounter = 0;
-            TestMetrics_PrintReport();
+            if (pxConfig->verbosity > 0) {
+                TestMetrics_RequestReport();
+            }
+        }
+        
+        /* Own timing; an interval spanning a clock change has no common time base */
+        if (SystemCoreClock == ulLastClock) {
+            uint32_t ulCyclesPerUs = SystemCoreClock / 1000000UL;
+            uint32_t ulIntervalUs = (ulWakeCycles - ulLastWakeCycles) / ulCyclesPerUs;
+            uint32_t ulNominalUs = WATCHDOG_PERIOD_MS * 1000UL;
+            
+            TestMetrics_RecordWatchdogTiming(
+                (DWT->CYCCNT - ulWakeCycles) / ulCyclesPerUs,
+                (ulIntervalUs > ulNominalUs) ? ulIntervalUs - ulNominalUs : ulNominalUs - ulIntervalUs);
+        }
+        ulLastWakeCycles = ulWakeCycles;
+        ulLastClock = SystemCoreClock;
+    }
+}
+
+/**
+  * @brief  Command Task - Parses runtime configuration commands from USART2
+  * @param  pvParameters: Task parameters
+  * @retval None
+  */
+static void CommandTask(void *pvParameters)
+{
+    char line[COMMAND_LINE_MAX];
+    
+    CommandChannel_Init(xTaskGetCurrentTaskHandle());
+    
+    for (;;) {
+        /* Periodic timeout lets the channel re-arm RX after errors or deep sleep
+         * and enforces the baud confirmation deadline */
+        if (CommandChannel_ReadLine(line, sizeof(line), pdMS_TO_TICKS(250))) {
+            CommandChannel_Execute(line);
         }
+        Transport_Poll();
     }
 }
 
@@ -307,14 +574,14 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
     static uint32_t ulLastInterruptTime = 0;
     uint32_t ulCurrentTime = xTaskGetTickCountFromISR();
-    uint8_t event = 1;
     
     if (GPIO_Pin == USER_BUTTON_PIN) {
         /* Debounce: ignore interrupts within 50ms */
         if ((ulCurrentTime - ulLastInterruptTime) > BUTTON_DEBOUNCE_MS) {
             ulLastInterruptTime = ulCurrentTime;
-            /* Send event to GPIO monitor task from ISR */
-            xQueueSendFromISR(xGpioQueue, &event, &xHigherPriorityTaskWoken);
+            /* Hand the press to the GPIO monitor task */
+            (void)IsrEvent_PostFromISR(&xGpioRing, ISR_EVENT_BUTTON, GPIO_Pin,
+                                       &xHigherPriorityTaskWoken);
             portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
         }
     }
@@ -326,7 +593,11 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
   */
 void vApplicationIdleHook(void)
 {
-    ulIdleCycleCount++;
+    IdleLoad_Hook();
+    
+#if POWER_IDLE_SLEEP_ENABLED
+    PowerManagement_EnterSleep();
+#endif
 }
 
 /**
@@ -336,6 +607,8 @@ void vApplicationIdleHook(void)
 void vApplicationTickHook(void)
 {
     ulHighFrequencyTimerTicks++;
+    IdleLoad_Tick();
+    BurstCapture_Tick();
 }
 
 /**
@@ -344,9 +617,8 @@ void vApplicationTickHook(void)
   */
 void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName)
 {
-    char msg[64];
-    snprintf(msg, sizeof(msg), "ERROR: Stack overflow in task: %s\r\n", pcTaskName);
-    HAL_UART_Transmit(&huart2, (uint8_t*)msg, strlen(msg), 100);
+    LOG_STR("ERROR: Stack overflow in task: %s", pcTaskName);
+    LogChannel_Flush();
     TestMetrics_IncrementStackOverflow();
     Error_Handler();
 }
@@ -357,25 +629,71 @@ void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName)
   */
 void vApplicationMallocFailedHook(void)
 {
-    char msg[] = "ERROR: Malloc failed!\r\n";
-    HAL_UART_Transmit(&huart2, (uint8_t*)msg, strlen(msg), 100);
+    LOG("ERROR: Malloc failed! %lu bytes free", (uint32_t)xPortGetFreeHeapSize());
+    LogChannel_Flush();
     TestMetrics_IncrementMallocFailure();
     Error_Handler();
 }
 
+#if PROFILER_STATIC_ALLOCATION
+/**
+  * @brief  Provide memory for the idle task (configSUPPORT_STATIC_ALLOCATION)
+  * @param  ppxIdleTaskTCBBuffer: Output TCB
+  * @param  ppxIdleTaskStackBuffer: Output stack
+  * @param  pulIdleTaskStackSize: Output stack size in words
+  * @retval None
+  */
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                   StackType_t **ppxIdleTaskStackBuffer,
+                                   uint32_t *pulIdleTaskStackSize)
+{
+    static StaticTask_t xIdleTaskTCB;
+    static StackType_t xIdleTaskStack[configMINIMAL_STACK_SIZE];
+    
+    *ppxIdleTaskTCBBuffer = &xIdleTaskTCB;
+    *ppxIdleTaskStackBuffer = xIdleTaskStack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+/**
+  * @brief  Provide memory for the timer service task
+  * @param  ppxTimerTaskTCBBuffer: Output TCB
+  * @param  ppxTimerTaskStackBuffer: Output stack
+  * @param  pulTimerTaskStackSize: Output stack size in words
+  * @retval None
+  */
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer,
+                                    StackType_t **ppxTimerTaskStackBuffer,
+                                    uint32_t *pulTimerTaskStackSize)
+{
+    static StaticTask_t xTimerTaskTCB;
+    static StackType_t xTimerTaskStack[configTIMER_TASK_STACK_DEPTH];
+    
+    *ppxTimerTaskTCBBuffer = &xTimerTaskTCB;
+    *ppxTimerTaskStackBuffer = xTimerTaskStack;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+#endif /* PROFILER_STATIC_ALLOCATION */
+
 /**
   * @brief  Enter deep sleep (STM32 STOP mode)
   * @retval None (device wakes via GPIO interrupt)
   */
 static void EnterDeepSleep(void)
 {
+    /* Get pending log records out and stop the UART while interrupts are
+     * still on: a write with them masked cannot wait for the UartTx mutex.
+     * If the drain task was preempted mid-drain its records follow after
+     * wake-up instead */
+    LOG("Entering Stop Mode...");
+    (void)LogChannel_Drain();
+    Transport_Suspend();
+    
     /* Disable all interrupts except EXTI for wake-up */
     __disable_irq();
     
-    /* Transmit message before sleep */
-    char msg[] = "Entering Stop Mode...\r\n";
-    HAL_UART_Transmit(&huart2, (uint8_t*)msg, strlen(msg), 100);
-    HAL_UART_DeInit(&huart2);
+    /* The ADC would keep DMA requests pending and the VBAT bridge loaded */
+    AnalogMonitor_Suspend();
     
     /* Configure GPIO for wake-up */
     ConfigureWakeupPin();
@@ -383,11 +701,8 @@ static void EnterDeepSleep(void)
     /* Enable wake-up pin (GPIO13/PC13) */
     HAL_PWR_EnableWakeUpPin(PWR_WAKEUP_PIN1);
     
-    /* Clear wake-up flag */
-    __HAL_PWR_CLEAR_FLAG(PWR_FLAG_WU);
-    
-    /* Enter STOP mode with low power regulator */
-    HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+    /* Enter STOP mode with low power regulator, timed on the RTC */
+    PowerManagement_EnterDeepSleep();
     
     /* Woke up - Reconfigure system clock */
     SystemClock_Config();
@@ -396,11 +711,21 @@ static void EnterDeepSleep(void)
     MX_USART2_UART_Init();
     MX_GPIO_Init();
     
+    /* Restores the 1 kHz tick and the negotiated baud rate */
+    ClockGovernor_OnClockReset();
+    AnalogMonitor_Resume();
+    
+    /* STOP residency for the energy model (PowerManagement_GetStats()) and
+     * the sleep test metrics */
+    PowerManagement_EndDeepSleep();
+    TestMetrics_RecordDeepSleep(PowerManagement_GetStats()->ulLastDeepSleepMs,
+                                PowerManagement_GetStats()->ulLastWakeupLatencyMs);
+    
     /* Re-enable interrupts */
     __enable_irq();
+    Transport_Resume();
     
-    char wakeMsg[] = "\r\n=== Woken from Deep Sleep ===\r\n";
-    HAL_UART_Transmit(&huart2, (uint8_t*)wakeMsg, strlen(wakeMsg), 100);
+    LOG("=== Woken from Deep Sleep ===");
 }
 
 /**
@@ -427,6 +752,14 @@ void SystemClock_Config(void)
     RCC_OscInitTypeDef RCC_OscInitStruct = {0};
     RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
     
+#if PROFILER_QEMU
+    /* HAL_RCC_OscConfig() would wait forever for ready flags */
+    (void)RCC_OscInitStruct;
+    (void)RCC_ClkInitStruct;
+    SystemCoreClock = PROFILER_QEMU_CPU_HZ;
+    return;
+#endif
+    
     /* Configure the main internal regulator output voltage */
     __HAL_RCC_PWR_CLK_ENABLE();
     __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE2);
@@ -478,6 +811,10 @@ static void MX_USART2_UART_Init(void)
     if (HAL_UART_Init(&huart2) != HAL_OK) {
         Error_Handler();
     }
+    
+    /* USART2 interrupt init (RX command channel) */
+    HAL_NVIC_SetPriority(USART2_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(USART2_IRQn);
 }
 
 /**
@@ -0,0 +1,356 @@
+/**
+  ******************************************************************************
+  * @file    mutex_trace.c
+  * @brief   Mutex Contention and Priority-Inversion Profiler Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * Mutexes are only taken and given from tasks, and every hook below runs
+  * either inside a kernel critical section or with the scheduler suspended,
+  * so no two hooks can interleave and the records need no locking.
+  *
+  * Hold time runs from the outermost take to the matching give (nested
+  * recursive takes never reach the queue hooks). Wait time runs from the
+  * first block to the take or timeout. Both are measured on DWT cycles at
+  * the clock of the moment they end.
+  *
+  * When a task starts waiting, the holder's priority is sampled before
+  * the kernel raises it by inheritance. A wait that ends after
+  * MUTEX_TRACE_INVERSION_US with the waiter above that priority counts as
+  * an inversion and records both task names.
+  *
+  ******************************************************************************
+  */
+
+#include "mutex_trace.h"
+#include "queue_trace.h"
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include <string.h>
+
+/* Live per-mutex record */
+typedef struct {
+    void *handle;
+    TaskHandle_t holder;
+    uint32_t holdStart;
+    MutexStats_t stats;
+} MutexTraceObject_t;
+
+/* Outstanding wait of one task */
+typedef struct {
+    uint8_t mutex;                  /* QUEUE_TRACE_UNTRACKED when not waiting */
+    UBaseType_t waiterPriority;
+    UBaseType_t holderPriority;
+    TaskHandle_t holder;
+    uint32_t start;
+} MutexTraceWait_t;
+
+/* Static variables */
+static MutexTraceObject_t xMutexes[MUTEX_TRACE_MAX_MUTEXES];
+static MutexTraceWait_t xWaits[QUEUE_TRACE_MAX_TASKS];
+static uint8_t ucMutexCount = 0;          /* Records ever used; free ones have no handle */
+
+/* Private function prototypes */
+static MutexTraceWait_t *GetCurrentWait(void);
+static void EndWait(uint8_t ucMutex);
+static uint32_t CyclesToUs(uint32_t ulCycles);
+static void RecordHistogram(uint16_t *pusHist, uint32_t *pulMax, uint32_t ulUs);
+
+/**
+  * @brief  Allocate a record for a new mutex
+  * @param  pvMutex: Mutex handle
+  * @param  ucRecursive: 1 for recursive mutexes
+  * @retval Mutex index, QUEUE_TRACE_UNTRACKED if the table is full
+  */
+uint8_t MutexTrace_Create(void *pvMutex, uint8_t ucRecursive)
+{
+    MutexTraceObject_t *pxMutex;
+    uint8_t ucMutex;
+
+    /* Lowest record released by a delete, else the next unused one */
+    for (ucMutex = 0; ucMutex < ucMutexCount; ucMutex++) {
+        if (xMutexes[ucMutex].handle == NULL) {
+            break;
+        }
+    }
+    if (ucMutex >= MUTEX_TRACE_MAX_MUTEXES) {
+        return QUEUE_TRACE_UNTRACKED;
+    }
+
+    /* Waits are keyed by mutex index, so reset them on first use */
+    if (ucMutexCount == 0) {
+        for (uint8_t i = 0; i < QUEUE_TRACE_MAX_TASKS; i++) {
+            xWaits[i].mutex = QUEUE_TRACE_UNTRACKED;
+        }
+    }
+
+    pxMutex = &xMutexes[ucMutex];
+    memset(pxMutex, 0, sizeof(MutexTraceObject_t));
+    pxMutex->handle = pvMutex;
+    pxMutex->stats.recursive = ucRecursive;
+    if (ucMutex == ucMutexCount) {
+        ucMutexCount++;
+    }
+
+    return ucMutex;
+}
+
+/**
+  * @brief  Release the record of a mutex being deleted
+  * @note   From QueueTrace_Delete(), inside a critical section
+  * @param  ucMutex: Mutex index
+  * @retval None
+  */
+void MutexTrace_Delete(uint8_t ucMutex)
+{
+    if (ucMutex >= ucMutexCount) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < QUEUE_TRACE_MAX_TASKS; i++) {
+        if (xWaits[i].mutex == ucMutex) {
+            xWaits[i].mutex = QUEUE_TRACE_UNTRACKED;
+        }
+    }
+    xMutexes[ucMutex].handle = NULL;
+}
+
+/**
+  * @brief  Drop the wait of a task being deleted
+  * @note   From QueueTrace_TaskDeleted(), before its index is reused
+  * @param  ucTask: Block-timing index of the task
+  * @retval None
+  */
+void MutexTrace_TaskDeleted(uint8_t ucTask)
+{
+    MutexTraceWait_t *pxWait = &xWaits[ucTask];
+
+    if (pxWait->mutex >= ucMutexCount) {
+        return;
+    }
+
+    if (xMutexes[pxWait->mutex].stats.waiters > 0) {
+        xMutexes[pxWait->mutex].stats.waiters--;
+    }
+    pxWait->mutex = QUEUE_TRACE_UNTRACKED;
+}
+
+/**
+  * @brief  Running task obtained the mutex
+  * @param  ucMutex: Mutex index
+  * @retval None
+  */
+void MutexTrace_Taken(uint8_t ucMutex)
+{
+    MutexTraceObject_t *pxMutex;
+
+    if (ucMutex >= ucMutexCount) {
+        return;
+    }
+    pxMutex = &xMutexes[ucMutex];
+
+    EndWait(ucMutex);
+    pxMutex->stats.takes++;
+    pxMutex->holder = xTaskGetCurrentTaskHandle();
+    pxMutex->holdStart = DWT->CYCCNT;
+}
+
+/**
+  * @brief  Running task gave up taking the mutex
+  * @param  ucMutex: Mutex index
+  * @retval None
+  */
+void MutexTrace_TakeFailed(uint8_t ucMutex)
+{
+    if (ucMutex >= ucMutexCount) {
+        return;
+    }
+
+    EndWait(ucMutex);
+    xMutexes[ucMutex].stats.timeouts++;
+}
+
+/**
+  * @brief  Running task released the mutex
+  * @param  ucMutex: Mutex index
+  * @retval None
+  */
+void MutexTrace_Given(uint8_t ucMutex)
+{
+    MutexTraceObject_t *pxMutex;
+
+    if (ucMutex >= ucMutexCount) {
+        return;
+    }
+    pxMutex = &xMutexes[ucMutex];
+
+    /* The kernel's initial give on creation has no holder */
+    if (pxMutex->holder == NULL) {
+        return;
+    }
+
+    RecordHistogram(pxMutex->stats.holdHist, &pxMutex->stats.maxHoldUs,
+                    CyclesToUs(DWT->CYCCNT - pxMutex->holdStart));
+    pxMutex->holder = NULL;
+}
+
+/**
+  * @brief  Running task is about to block on the mutex
+  * @param  ucMutex: Mutex index
+  * @retval None
+  */
+void MutexTrace_Block(uint8_t ucMutex)
+{
+    MutexTraceObject_t *pxMutex;
+    MutexTraceWait_t *pxWait = GetCurrentWait();
+
+    if ((ucMutex >= ucMutexCount) || (pxWait == NULL)) {
+        return;
+    }
+
+    /* Re-blocking after a spurious wake keeps the original start */
+    if (pxWait->mutex == ucMutex) {
+        return;
+    }
+    pxMutex = &xMutexes[ucMutex];
+
+    pxWait->mutex = ucMutex;
+    pxWait->start = DWT->CYCCNT;
+    pxWait->waiterPriority = uxTaskPriorityGet(NULL);
+    pxWait->holder = pxMutex->holder;
+    pxWait->holderPriority = (pxMutex->holder != NULL) ? uxTaskPriorityGet(pxMutex->holder) : 0;
+
+    pxMutex->stats.contended++;
+    pxMutex->stats.waiters++;
+    if (pxMutex->stats.waiters > pxMutex->stats.peakWaiters) {
+        pxMutex->stats.peakWaiters = pxMutex->stats.waiters;
+    }
+}
+
+/**
+  * @brief  Kernel raised the holder's priority for the running task
+  * @note   Called between MutexTrace_Block() and the actual block
+  * @retval None
+  */
+void MutexTrace_PriorityInherit(void)
+{
+    MutexTraceWait_t *pxWait = GetCurrentWait();
+
+    if ((pxWait != NULL) && (pxWait->mutex < ucMutexCount)) {
+        xMutexes[pxWait->mutex].stats.inherits++;
+    }
+}
+
+/**
+  * @brief  Copy statistics of all tracked mutexes
+  * @param  stats: Output array
+  * @param  maxMutexes: Capacity of the output array
+  * @retval Number of mutexes written
+  */
+uint8_t MutexTrace_GetStats(MutexStats_t *stats, uint8_t maxMutexes)
+{
+    uint8_t count = 0;
+
+    vTaskSuspendAll();
+    for (uint8_t i = 0; (i < ucMutexCount) && (count < maxMutexes); i++) {
+        TaskHandle_t xHolder = xMutexes[i].holder;
+
+        /* Released records are skipped, so the output is packed */
+        if (xMutexes[i].handle == NULL) {
+            continue;
+        }
+        stats[count] = xMutexes[i].stats;
+        stats[count].holder = (xHolder != NULL) ? pcTaskGetName(xHolder) : "";
+        stats[count].name = pcQueueGetName((QueueHandle_t)xMutexes[i].handle);
+        if (stats[count].name == NULL) {
+            stats[count].name = "";
+        }
+        count++;
+    }
+    (void)xTaskResumeAll();
+
+    return count;
+}
+
+/**
+  * @brief  Wait record of the running task
+  * @retval Record, NULL for untracked tasks or before the scheduler starts
+  */
+static MutexTraceWait_t *GetCurrentWait(void)
+{
+    uint8_t ucTask = QueueTrace_CurrentTask();
+
+    return (ucTask != QUEUE_TRACE_UNTRACKED) ? &xWaits[ucTask] : NULL;
+}
+
+/**
+  * @brief  Close the running task's wait on a mutex
+  * @param  ucMutex: Mutex the task has just taken or given up on
+  * @retval None
+  */
+static void EndWait(uint8_t ucMutex)
+{
+    MutexTraceWait_t *pxWait = GetCurrentWait();
+    MutexStats_t *pxStats;
+    uint32_t ulWaitUs;
+
+    if ((pxWait == NULL) || (pxWait->mutex != ucMutex)) {
+        return;
+    }
+
+    pxStats = &xMutexes[ucMutex].stats;
+    pxWait->mutex = QUEUE_TRACE_UNTRACKED;
+    ulWaitUs = CyclesToUs(DWT->CYCCNT - pxWait->start);
+
+    if (pxStats->waiters > 0) {
+        pxStats->waiters--;
+    }
+    RecordHistogram(pxStats->waitHist, &pxStats->maxWaitUs, ulWaitUs);
+
+    if ((pxWait->holder != NULL) &&
+        (pxWait->waiterPriority > pxWait->holderPriority) &&
+        (ulWaitUs >= MUTEX_TRACE_INVERSION_US)) {
+        pxStats->inversions++;
+        pxStats->lastInversionUs = ulWaitUs;
+        strncpy(pxStats->lastInversionHolder, pcTaskGetName(pxWait->holder), MUTEX_TRACE_NAME_LEN - 1);
+        strncpy(pxStats->lastInversionWaiter, pcTaskGetName(NULL), MUTEX_TRACE_NAME_LEN - 1);
+    }
+}
+
+/**
+  * @brief  Convert DWT cycles at the current core clock to microseconds
+  * @param  ulCycles: Cycle count
+  * @retval Microseconds
+  */
+static uint32_t CyclesToUs(uint32_t ulCycles)
+{
+    return ulCycles / (SystemCoreClock / 1000000UL);
+}
+
+/**
+  * @brief  Add a duration to a decade histogram and track its maximum
+  * @param  pusHist: MUTEX_TRACE_HIST_BINS saturating bins
+  * @param  pulMax: Maximum so far
+  * @param  ulUs: Duration in microseconds
+  * @retval None
+  */
+static void RecordHistogram(uint16_t *pusHist, uint32_t *pulMax, uint32_t ulUs)
+{
+    uint8_t ucBin = 0;
+    uint32_t ulLimit = 10;
+
+    while ((ucBin < MUTEX_TRACE_HIST_BINS - 1) && (ulUs >= ulLimit)) {
+        ucBin++;
+        ulLimit *= 10;
+    }
+
+    if (pusHist[ucBin] < 0xFFFF) {
+        pusHist[ucBin]++;
+    }
+    if (ulUs > *pulMax) {
+        *pulMax = ulUs;
+    }
+}
@@ -0,0 +1,365 @@
+/**
+  ******************************************************************************
+  * @file    pc_sampler.c
+  * @brief   Sampling PC Profiler Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * TIM3 interrupts at the configured rate. The naked TIM3_IRQHandler shim
+  * (stm32f4xx_it.c) hands the stacked exception frame to PcSampler_Sample(),
+  * which counts the interrupted (PC, LR) pair against the running task in
+  * the active histogram. PcSampler_Stream() swaps histograms and writes the
+  * finished one out; the ISR never waits for the stream.
+  *
+  * LR is the return address only while the interrupted function has not
+  * yet pushed it - treat the caller column as best effort.
+  *
+  ******************************************************************************
+  */
+
+#include "pc_sampler.h"
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "system_profiler.h"
+#include "uart_transport.h"
+#include <stdio.h>
+#include <string.h>
+
+#define STREAM_BUFFER_SIZE    256
+
+/* Histogram entry */
+typedef struct {
+    uint32_t ulPc;
+    uint32_t ulLr;
+    uint16_t usCount;             /* 0 = free slot */
+    uint8_t ucTask;
+} PcSampleEntry_t;
+
+/* Task slot; the name is copied so a window can be streamed after the
+ * task is deleted */
+typedef struct {
+    TaskHandle_t xTask;           /* NULL = deleted */
+    uint32_t ulRetiredWindow;     /* Window active when deleted */
+    char cName[configMAX_TASK_NAME_LEN];
+} PcTaskSlot_t;
+
+typedef struct {
+    PcSampleEntry_t xEntries[PC_SAMPLER_TABLE_SIZE];
+    uint32_t ulSamples;
+    uint32_t ulDropped;
+    uint32_t ulIsrCycles;
+} PcHistogram_t;
+
+/* Static variables */
+static PcHistogram_t xHistograms[2];
+static volatile uint8_t ucActive = 0;
+
+/* Task handle -> slot index (claimed by the ISR, released by
+ * PcSampler_TaskDeleted) */
+static PcTaskSlot_t xTaskSlots[MAX_TASKS];
+static volatile uint8_t ucTaskSlotCount = 0;
+static volatile uint32_t ulWindowCount = 0;   /* Histograms streamed */
+static volatile uint32_t ulWindowSwaps = 0;   /* Histograms swapped out */
+
+static volatile uint32_t ulRateHz = 0;
+static uint32_t ulWindowStartCycles = 0;
+static TickType_t xLastStreamTick = 0;
+static PcSamplerStats_t xLastStats = {0};
+
+/* Private function prototypes */
+static void ProgramTimer(uint32_t rateHz);
+static uint8_t LookupTaskSlot(TaskHandle_t xTask);
+static void StreamHistogram(PcHistogram_t *pxHistogram, uint32_t ulOverheadX100);
+
+/**
+  * @brief  Initialize TIM3 for sampling (stopped until PcSampler_SetRate)
+  * @retval None
+  */
+void PcSampler_Init(void)
+{
+    __HAL_RCC_TIM3_CLK_ENABLE();
+    TIM3->CR1 = 0;
+    TIM3->DIER = 0;
+
+    memset(xHistograms, 0, sizeof(xHistograms));
+    ucActive = 0;
+    ulRateHz = 0;
+
+    HAL_NVIC_SetPriority(TIM3_IRQn, PC_SAMPLER_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(TIM3_IRQn);
+}
+
+/**
+  * @brief  Set the sampling rate
+  * @param  rateHz: PC_SAMPLER_MIN_HZ-PC_SAMPLER_MAX_HZ, or 0 to stop
+  * @retval 1 if applied, 0 if out of range
+  */
+uint8_t PcSampler_SetRate(uint32_t rateHz)
+{
+    if (rateHz != 0 && (rateHz < PC_SAMPLER_MIN_HZ || rateHz > PC_SAMPLER_MAX_HZ)) {
+        return 0;
+    }
+
+    ulRateHz = rateHz;
+    ulWindowStartCycles = DWT->CYCCNT;
+    xLastStreamTick = xTaskGetTickCount();
+    ProgramTimer(rateHz);
+    return 1;
+}
+
+/**
+  * @brief  Re-derive the TIM3 prescaler after a clock tree change
+  * @note   Safe to call with interrupts masked
+  * @retval None
+  */
+void PcSampler_ApplyClock(void)
+{
+    ProgramTimer(ulRateHz);
+}
+
+/**
+  * @brief  Record one sample (TIM3 interrupt, called from the naked shim)
+  * @param  pulFrame: Stacked exception frame of the interrupted context
+  * @param  ulExcReturn: EXC_RETURN value (bit 2 set = thread mode on PSP)
+  * @retval None
+  */
+void PcSampler_Sample(const uint32_t *pulFrame, uint32_t ulExcReturn)
+{
+    uint32_t ulStart = DWT->CYCCNT;
+    PcHistogram_t *pxHistogram = &xHistograms[ucActive];
+    uint32_t ulPc = pulFrame[6];
+    uint32_t ulLr = pulFrame[5];
+    uint8_t ucTask;
+    uint32_t ulIndex;
+
+    TIM3->SR = ~TIM_SR_UIF;
+
+    ucTask = (ulExcReturn & 0x4UL) ? LookupTaskSlot(xTaskGetCurrentTaskHandle())
+                                   : PC_SAMPLER_ISR_SLOT;
+
+    ulIndex = ((ulPc >> 1) ^ (ulLr * 31UL) ^ ucTask) & (PC_SAMPLER_TABLE_SIZE - 1);
+    for (uint8_t i = 0; i < PC_SAMPLER_PROBE_LIMIT; i++) {
+        PcSampleEntry_t *pxEntry = &pxHistogram->xEntries[ulIndex];
+
+        if (pxEntry->usCount == 0) {
+            pxEntry->ulPc = ulPc;
+            pxEntry->ulLr = ulLr;
+            pxEntry->ucTask = ucTask;
+        }
+        if (pxEntry->ulPc == ulPc && pxEntry->ulLr == ulLr && pxEntry->ucTask == ucTask) {
+            if (pxEntry->usCount < 0xFFFF) {
+                pxEntry->usCount++;
+            }
+            pxHistogram->ulSamples++;
+            pxHistogram->ulIsrCycles += DWT->CYCCNT - ulStart;
+            return;
+        }
+        ulIndex = (ulIndex + 1) & (PC_SAMPLER_TABLE_SIZE - 1);
+    }
+
+    pxHistogram->ulDropped++;
+    pxHistogram->ulSamples++;
+    pxHistogram->ulIsrCycles += DWT->CYCCNT - ulStart;
+}
+
+/**
+  * @brief  Stream the finished histogram once per PC_SAMPLER_STREAM_MS
+  * @note   Call periodically from the task that owns report output
+  * @retval None
+  */
+void PcSampler_Stream(void)
+{
+    PcHistogram_t *pxHistogram;
+    uint32_t ulNowCycles, ulElapsedCycles, ulOverheadX100;
+    uint32_t ulRate = ulRateHz;
+
+    if (ulRate == 0 ||
+        (xTaskGetTickCount() - xLastStreamTick) < pdMS_TO_TICKS(PC_SAMPLER_STREAM_MS)) {
+        return;
+    }
+    xLastStreamTick = xTaskGetTickCount();
+
+    /* The ISR preempts this task, so a single store switches it cleanly.
+     * Counting the swap first means a task deleted around it retires
+     * against the window that is active, not the one being streamed */
+    pxHistogram = &xHistograms[ucActive];
+    ulWindowSwaps++;
+    ucActive ^= 1;
+    ulNowCycles = DWT->CYCCNT;
+    ulElapsedCycles = ulNowCycles - ulWindowStartCycles;
+    ulWindowStartCycles = ulNowCycles;
+
+    ulOverheadX100 = 0;
+    if (ulElapsedCycles > 0) {
+        uint64_t ullIsr = (uint64_t)pxHistogram->ulIsrCycles +
+                          (uint64_t)pxHistogram->ulSamples * PC_SAMPLER_ENTRY_CYCLES;
+        ulOverheadX100 = (uint32_t)((ullIsr * 10000ULL) / ulElapsedCycles);
+    }
+
+    xLastStats.ulRateHz = ulRate;
+    xLastStats.ulSamples = pxHistogram->ulSamples;
+    xLastStats.ulDropped = pxHistogram->ulDropped;
+    xLastStats.fOverheadPct = (float)ulOverheadX100 / 100.0f;
+
+    StreamHistogram(pxHistogram, ulOverheadX100);
+    memset(pxHistogram, 0, sizeof(PcHistogram_t));
+    ulWindowCount++;
+
+    /* Cap: halve the rate, stop entirely if even the minimum is too costly */
+    if (xLastStats.fOverheadPct > PC_SAMPLER_MAX_OVERHEAD_PCT) {
+        xLastStats.ulThrottleCount++;
+        PcSampler_SetRate((ulRate / 2 >= PC_SAMPLER_MIN_HZ) ? ulRate / 2 : 0);
+    }
+}
+
+/**
+  * @brief  Release the slot of a deleted task
+  * @note   traceTASK_DELETE, inside the kernel's critical section (the
+  *         sampling interrupt is above it and may still run). The slot
+  *         keeps its name until the active window, the last that can hold
+  *         the task's samples, has been streamed
+  * @param  pvTask: Task handle
+  * @retval None
+  */
+void PcSampler_TaskDeleted(void *pvTask)
+{
+    uint8_t ucCount = ucTaskSlotCount;
+
+    for (uint8_t i = 0; i < ucCount; i++) {
+        if (xTaskSlots[i].xTask == (TaskHandle_t)pvTask) {
+            xTaskSlots[i].ulRetiredWindow = ulWindowSwaps;
+            __DMB();
+            xTaskSlots[i].xTask = NULL;
+            return;
+        }
+    }
+}
+
+/**
+  * @brief  Get sampler statistics for the last window
+  * @param  stats: Pointer to output statistics structure
+  * @retval None
+  */
+void PcSampler_GetStats(PcSamplerStats_t *stats)
+{
+    *stats = xLastStats;
+    stats->ulRateHz = ulRateHz;
+}
+
+/**
+  * @brief  Program TIM3 for a 1 MHz count and the requested update rate
+  * @param  rateHz: Sampling rate, 0 stops the timer
+  * @retval None
+  */
+static void ProgramTimer(uint32_t rateHz)
+{
+    uint32_t ulTimerClock = HAL_RCC_GetPCLK1Freq();
+
+    /* APB1 timers run at 2x PCLK1 whenever the APB1 prescaler is not 1 */
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) {
+        ulTimerClock *= 2;
+    }
+
+    TIM3->CR1 &= ~TIM_CR1_CEN;
+    if (rateHz == 0) {
+        TIM3->DIER &= ~TIM_DIER_UIE;
+        return;
+    }
+
+    TIM3->PSC = (ulTimerClock / 1000000UL) - 1;
+    TIM3->ARR = (1000000UL / rateHz) - 1;
+    TIM3->EGR = TIM_EGR_UG;
+    TIM3->SR = ~TIM_SR_UIF;
+    TIM3->DIER |= TIM_DIER_UIE;
+    TIM3->CR1 |= TIM_CR1_CEN;
+}
+
+/**
+  * @brief  Map a task handle to a small histogram slot (ISR context)
+  * @note   A new task takes a released slot whose samples have already been
+  *         streamed, else appends one
+  * @param  xTask: Running task
+  * @retval Slot index, PC_SAMPLER_ISR_SLOT if the table is full
+  */
+static uint8_t LookupTaskSlot(TaskHandle_t xTask)
+{
+    uint8_t ucCount = ucTaskSlotCount;
+    uint8_t ucSlot = PC_SAMPLER_ISR_SLOT;
+    PcTaskSlot_t *pxSlot;
+
+    for (uint8_t i = 0; i < ucCount; i++) {
+        if (xTaskSlots[i].xTask == xTask) {
+            return i;
+        }
+        if (ucSlot == PC_SAMPLER_ISR_SLOT && xTaskSlots[i].xTask == NULL &&
+            (int32_t)(ulWindowCount - xTaskSlots[i].ulRetiredWindow) > 0) {
+            ucSlot = i;
+        }
+    }
+
+    if (ucSlot == PC_SAMPLER_ISR_SLOT) {
+        if (ucCount >= MAX_TASKS) {
+            return PC_SAMPLER_ISR_SLOT;
+        }
+        ucSlot = ucCount;
+    }
+
+    pxSlot = &xTaskSlots[ucSlot];
+    strncpy(pxSlot->cName, pcTaskGetName(xTask), sizeof(pxSlot->cName) - 1);
+    pxSlot->cName[sizeof(pxSlot->cName) - 1] = '\0';
+    __DMB();
+    pxSlot->xTask = xTask;
+    if (ucSlot == ucCount) {
+        ucTaskSlotCount = ucCount + 1;
+    }
+    return ucSlot;
+}
+
+/**
+  * @brief  Write one histogram in the stream format (see pc_sampler.h)
+  * @param  pxHistogram: Completed histogram
+  * @param  ulOverheadX100: Measured overhead in 0.01 %
+  * @retval None
+  */
+static void StreamHistogram(PcHistogram_t *pxHistogram, uint32_t ulOverheadX100)
+{
+    static char buffer[STREAM_BUFFER_SIZE];
+    size_t xLen;
+
+    xLen = snprintf(buffer, sizeof(buffer), "#pcs %lu %lu %lu %lu %lu.%02lu\r\n",
+                    (unsigned long)xTaskGetTickCount(), (unsigned long)xLastStats.ulRateHz,
+                    pxHistogram->ulSamples, pxHistogram->ulDropped,
+                    ulOverheadX100 / 100, ulOverheadX100 % 100);
+
+    for (uint16_t i = 0; i < PC_SAMPLER_TABLE_SIZE; i++) {
+        PcSampleEntry_t *pxEntry = &pxHistogram->xEntries[i];
+        const char *pcName = "ISR";
+        char line[64];
+        int lineLen;
+
+        if (pxEntry->usCount == 0) {
+            continue;
+        }
+        if (pxEntry->ucTask < ucTaskSlotCount) {
+            pcName = xTaskSlots[pxEntry->ucTask].cName;
+        }
+
+        lineLen = snprintf(line, sizeof(line), "#pc %08lx %08lx %u %s\r\n",
+                           pxEntry->ulPc, pxEntry->ulLr, pxEntry->usCount, pcName);
+        if (xLen + lineLen >= sizeof(buffer)) {
+            Transport_Write((const uint8_t*)buffer, xLen, 1000);
+            xLen = 0;
+        }
+        memcpy(&buffer[xLen], line, lineLen);
+        xLen += lineLen;
+    }
+
+    if (xLen + 6 >= sizeof(buffer)) {
+        Transport_Write((const uint8_t*)buffer, xLen, 1000);
+        xLen = 0;
+    }
+    memcpy(&buffer[xLen], "#pce\r\n", 6);
+    xLen += 6;
+    Transport_Write((const uint8_t*)buffer, xLen, 1000);
+}
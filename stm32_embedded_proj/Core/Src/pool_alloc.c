@@ -0,0 +1,269 @@
+/**
+  ******************************************************************************
+  * @file    pool_alloc.c
+  * @brief   Pool Allocator Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * Linked in with -Wl,--wrap=pvPortMalloc,--wrap=vPortFree: references to
+  * pvPortMalloc()/vPortFree() in every other object resolve to the
+  * __wrap_ functions below, which reach heap_4 as __real_. Like heap_4
+  * they are task-context only. In heap-only builds (POOL_ALLOC_ENABLED 0)
+  * they are a bare __real_ call between two DWT reads, so alloc_cyc and
+  * free_cyc time heap_4 alone. Pool free lists and the counters are
+  * updated in short critical sections; heap fallbacks run outside them,
+  * so heap_4 keeps its own locking and vApplicationMallocFailedHook() is
+  * not called with interrupts masked.
+  *
+  ******************************************************************************
+  */
+
+#include "pool_alloc.h"
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <string.h>
+
+/* Free block, linked through its own first word */
+typedef struct PoolBlock {
+    struct PoolBlock *pxNext;
+} PoolBlock_t;
+
+/* Memory of one size class */
+typedef struct {
+    uint8_t *pucStart;
+    uint8_t *pucEnd;                    /* One past the last block */
+    PoolBlock_t *pxFree;
+} PoolRegion_t;
+
+/* heap_4, reached past the wrap */
+void *__real_pvPortMalloc(size_t xWantedSize);
+void __real_vPortFree(void *pv);
+void *__wrap_pvPortMalloc(size_t xWantedSize);
+void __wrap_vPortFree(void *pv);
+
+/* Static variables */
+static PoolRegion_t xRegions[POOL_ALLOC_CLASS_COUNT];
+static PoolAllocStats_t xStats;
+
+/* Private function prototypes */
+#if POOL_ALLOC_ENABLED
+static PoolBlock_t *TakeBlock(size_t xWantedSize);
+static int32_t FindClass(size_t xWantedSize);
+static int32_t FindOwner(const void *pv);
+#endif
+
+/**
+  * @brief  Carve the size classes from the heap
+  * @note   main(), after its own allocations and before the scheduler starts
+  * @retval None
+  */
+void PoolAlloc_Init(void)
+{
+#if POOL_ALLOC_ENABLED
+    static const uint16_t usSizes[POOL_ALLOC_CLASS_COUNT] = POOL_ALLOC_BLOCK_SIZES;
+    static const uint16_t usCounts[POOL_ALLOC_CLASS_COUNT] = POOL_ALLOC_BLOCK_COUNTS;
+
+    for (uint32_t i = 0; i < POOL_ALLOC_CLASS_COUNT; i++) {
+        PoolStats_t *pxPool = &xStats.pools[i];
+        PoolRegion_t *pxRegion = &xRegions[i];
+        size_t xBlockSize = usSizes[i];
+        size_t xBytes;
+
+        /* Every block aligned like a heap_4 block, and big enough for a link */
+        if (xBlockSize < sizeof(PoolBlock_t)) {
+            xBlockSize = sizeof(PoolBlock_t);
+        }
+        xBlockSize = (xBlockSize + portBYTE_ALIGNMENT_MASK) & ~(size_t)portBYTE_ALIGNMENT_MASK;
+        xBytes = xBlockSize * usCounts[i];
+
+        pxPool->blockSize = (uint16_t)xBlockSize;
+        if (xBytes == 0 || xPortGetFreeHeapSize() < xBytes + POOL_ALLOC_HEAP_RESERVE) {
+            continue;
+        }
+
+        pxRegion->pucStart = __real_pvPortMalloc(xBytes);
+        if (pxRegion->pucStart == NULL) {
+            continue;
+        }
+        pxRegion->pucEnd = pxRegion->pucStart + xBytes;
+
+        /* Free list in address order */
+        for (uint32_t b = usCounts[i]; b > 0; b--) {
+            PoolBlock_t *pxBlock = (PoolBlock_t *)(pxRegion->pucStart + (b - 1U) * xBlockSize);
+
+            pxBlock->pxNext = pxRegion->pxFree;
+            pxRegion->pxFree = pxBlock;
+        }
+        pxPool->blockCount = usCounts[i];
+    }
+
+    xStats.poolCount = POOL_ALLOC_CLASS_COUNT;
+#endif
+}
+
+/**
+  * @brief  Copy the allocator statistics
+  * @param  stats: Output
+  * @retval None
+  */
+void PoolAlloc_GetStats(PoolAllocStats_t *stats)
+{
+    taskENTER_CRITICAL();
+    memcpy(stats, &xStats, sizeof(PoolAllocStats_t));
+    taskEXIT_CRITICAL();
+
+    stats->allocMeanCycles = (stats->allocs > 0) ? (uint32_t)(stats->allocCycles / stats->allocs) : 0;
+    stats->freeMeanCycles = (stats->frees > 0) ? (uint32_t)(stats->freeCycles / stats->frees) : 0;
+}
+
+/**
+  * @brief  pvPortMalloc(): pool block if one fits and is free, else heap_4
+  * @param  xWantedSize: Bytes requested
+  * @retval Memory, NULL if the heap is exhausted
+  */
+void *__wrap_pvPortMalloc(size_t xWantedSize)
+{
+    uint32_t ulStart = DWT->CYCCNT;
+    PoolBlock_t *pxBlock = NULL;
+    void *pvReturn;
+    uint32_t ulCycles;
+
+#if POOL_ALLOC_ENABLED
+    pxBlock = TakeBlock(xWantedSize);
+#endif
+
+    pvReturn = pxBlock;
+    if (pvReturn == NULL) {
+        pvReturn = __real_pvPortMalloc(xWantedSize);
+    }
+    ulCycles = DWT->CYCCNT - ulStart;
+
+    taskENTER_CRITICAL();
+    xStats.allocs++;
+    xStats.allocCycles += ulCycles;
+    if (pxBlock == NULL && pvReturn != NULL) {
+        xStats.heapAllocs++;
+    }
+    taskEXIT_CRITICAL();
+
+    return pvReturn;
+}
+
+/**
+  * @brief  vPortFree(): back to the owning pool, else heap_4
+  * @param  pv: Memory from pvPortMalloc(), or NULL
+  * @retval None
+  */
+void __wrap_vPortFree(void *pv)
+{
+    uint32_t ulStart = DWT->CYCCNT;
+    int32_t lClass;
+    uint32_t ulCycles;
+
+    if (pv == NULL) {
+        return;
+    }
+
+#if POOL_ALLOC_ENABLED
+    lClass = FindOwner(pv);
+#else
+    lClass = -1;
+#endif
+    if (lClass >= 0) {
+        PoolBlock_t *pxBlock = (PoolBlock_t *)pv;
+
+        taskENTER_CRITICAL();
+        pxBlock->pxNext = xRegions[lClass].pxFree;
+        xRegions[lClass].pxFree = pxBlock;
+        xStats.pools[lClass].used--;
+        taskEXIT_CRITICAL();
+    } else {
+        __real_vPortFree(pv);
+    }
+    ulCycles = DWT->CYCCNT - ulStart;
+
+    taskENTER_CRITICAL();
+    xStats.frees++;
+    xStats.freeCycles += ulCycles;
+    taskEXIT_CRITICAL();
+}
+
+#if POOL_ALLOC_ENABLED
+/**
+  * @brief  Pop a block from the smallest class that fits, or the one above it
+  * @note   Only the next class is tried, so small requests cannot drain the
+  *         large classes (the single 512 B block by default)
+  * @param  xWantedSize: Bytes requested
+  * @retval Block, NULL for the heap
+  */
+static PoolBlock_t *TakeBlock(size_t xWantedSize)
+{
+    int32_t lClass = FindClass(xWantedSize);
+    int32_t lLast;
+    PoolBlock_t *pxBlock = NULL;
+
+    if (lClass < 0) {
+        return NULL;
+    }
+    lLast = (lClass + 1 < POOL_ALLOC_CLASS_COUNT) ? lClass + 1 : lClass;
+
+    taskENTER_CRITICAL();
+    for (int32_t i = lClass; i <= lLast && pxBlock == NULL; i++) {
+        PoolStats_t *pxPool = &xStats.pools[i];
+
+        pxBlock = xRegions[i].pxFree;
+        if (pxBlock != NULL) {
+            xRegions[i].pxFree = pxBlock->pxNext;
+            pxPool->hits++;
+            if (++pxPool->used > pxPool->peak) {
+                pxPool->peak = pxPool->used;
+            }
+        }
+    }
+    if (pxBlock == NULL) {
+        xStats.pools[lClass].misses++;
+    }
+    taskEXIT_CRITICAL();
+
+    return pxBlock;
+}
+
+/**
+  * @brief  Smallest carved class a request fits in
+  * @param  xWantedSize: Bytes requested
+  * @retval Class index, -1 for the heap
+  */
+static int32_t FindClass(size_t xWantedSize)
+{
+    if (xWantedSize == 0) {
+        return -1;
+    }
+
+    for (int32_t i = 0; i < POOL_ALLOC_CLASS_COUNT; i++) {
+        if (xStats.pools[i].blockCount > 0 && xWantedSize <= xStats.pools[i].blockSize) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+  * @brief  Class whose region holds a block
+  * @param  pv: Block being freed
+  * @retval Class index, -1 for a heap block
+  */
+static int32_t FindOwner(const void *pv)
+{
+    const uint8_t *pucBlock = (const uint8_t *)pv;
+
+    for (int32_t i = 0; i < POOL_ALLOC_CLASS_COUNT; i++) {
+        if (pucBlock >= xRegions[i].pucStart && pucBlock < xRegions[i].pucEnd) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+#endif
@@ -3,14 +3,32 @@
   * @file    power_management.c
   * @brief   Power Management Implementation
   ******************************************************************************
+  * @attention
+  *
+  * SysTick and the HAL tick stop in STOP mode, so deep sleep is timed with
+  * the RTC, clocked from LSI (already running for the IWDG). The shadow
+  * registers are bypassed: after STOP they would hold the time of entry
+  * until the next synchronisation.
+  *
+  ******************************************************************************
   */
 
 #include "power_management.h"
+#include "main.h"
 #include <string.h>
 
+#define RTC_MS_PER_DAY            86400000UL
+
 /* Static variables */
 static PowerMode_t xCurrentPowerMode = POWER_MODE_RUN;
 static SleepStats_t xSleepStats = {0};
+static uint8_t ucRtcReady = 0;
+static uint32_t ulWakeRtcMs = 0;
+
+/* Private function prototypes */
+static void RtcInit(void);
+static uint32_t RtcReadMs(void);
+static uint32_t RtcElapsedMs(uint32_t ulStartMs);
 
 /**
   * @brief  Initialize power management
@@ -27,15 +45,23 @@ void PowerManagement_Init(void)
     /* Initialize statistics */
     memset(&xSleepStats, 0, sizeof(SleepStats_t));
     xCurrentPowerMode = POWER_MODE_RUN;
+    
+#if !PROFILER_QEMU
+    RtcInit();
+#endif
 }
 
 /**
-  * @brief  Enter deep sleep (STOP) mode
-  * @retval None
+  * @brief  Enter deep sleep (STOP) mode and time it
+  * @note   Interrupts masked and peripherals stopped by the caller, which
+  *         restores the clock tree afterwards and then calls
+  *         PowerManagement_EndDeepSleep()
+  * @retval None (returns on wake-up, running from HSI)
   */
 void PowerManagement_EnterDeepSleep(void)
 {
-    uint32_t ulSleepStartTime = HAL_GetTick();
+    uint32_t ulSleepStartMs = RtcReadMs();
+    uint32_t ulSleepDuration;
     
     xCurrentPowerMode = POWER_MODE_DEEP_SLEEP;
     
@@ -45,23 +71,35 @@ void PowerManagement_EnterDeepSleep(void)
     /* Disable systick interrupt to reduce power consumption */
     SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
     
-    /* Clear all EXTI pending bits */
+    /* Clear all EXTI pending bits and the wake-up flag */
     EXTI->PR = 0xFFFFFFFF;
+    __HAL_PWR_CLEAR_FLAG(PWR_FLAG_WU);
     
     /* Enter STOP mode with low power regulator */
     HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
     
     /* Woke up from STOP mode */
+    ulWakeRtcMs = RtcReadMs();
+    ulSleepDuration = RtcElapsedMs(ulSleepStartMs);
     
     /* Re-enable systick */
     SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
     
     /* Update sleep statistics */
-    uint32_t ulSleepDuration = HAL_GetTick() - ulSleepStartTime;
     xSleepStats.ulDeepSleepCount++;
     xSleepStats.ulTotalSleepTimeMs += ulSleepDuration;
+    xSleepStats.ulLastDeepSleepMs = ulSleepDuration;
     xSleepStats.ulLastWakeupTime = HAL_GetTick();
-    
+}
+
+/**
+  * @brief  Mark the end of the wake-up sequence
+  * @note   After the clock tree and peripherals have been restored
+  * @retval None
+  */
+void PowerManagement_EndDeepSleep(void)
+{
+    xSleepStats.ulLastWakeupLatencyMs = RtcElapsedMs(ulWakeRtcMs);
     xCurrentPowerMode = POWER_MODE_RUN;
 }
 
@@ -71,12 +109,34 @@ void PowerManagement_EnterDeepSleep(void)
   */
 void PowerManagement_EnterSleep(void)
 {
+    uint32_t ulStartVal, ulEndVal, ulCycles;
+    
+    /* Mask interrupts so the wake-up source is serviced only after timing;
+       WFI still wakes on a pending interrupt with PRIMASK set */
+    __disable_irq();
     xCurrentPowerMode = POWER_MODE_SLEEP;
     
+    /* Reading CTRL clears COUNTFLAG */
+    (void)SysTick->CTRL;
+    ulStartVal = SysTick->VAL;
+    
     /* Enter sleep mode - CPU stops but clocks continue */
+    __DSB();
     __WFI();
     
+    /* SysTick fires every tick, so at most one reload happened while asleep */
+    ulEndVal = SysTick->VAL;
+    if (SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk) {
+        ulCycles = ulStartVal + (SysTick->LOAD + 1UL - ulEndVal);
+    } else {
+        ulCycles = ulStartVal - ulEndVal;
+    }
+    
+    xSleepStats.ulSleepCount++;
+    xSleepStats.ullTotalSleepTimeUs += ulCycles / (SystemCoreClock / 1000000UL);
+    
     xCurrentPowerMode = POWER_MODE_RUN;
+    __enable_irq();
 }
 
 /**
@@ -96,3 +156,87 @@ SleepStats_t* PowerManagement_GetStats(void)
 {
     return &xSleepStats;
 }
+
+/**
+  * @brief  Run the RTC from LSI as a free-running time of day
+  * @note   Leaves ucRtcReady at 0 (STOP reads as 0 ms) if LSI or the RTC
+  *         do not come up
+  * @retval None
+  */
+static void RtcInit(void)
+{
+    uint32_t ulLoops = 0;
+    
+    RCC->CSR |= RCC_CSR_LSION;
+    while ((RCC->CSR & RCC_CSR_LSIRDY) == 0) {
+        if (++ulLoops > POWER_RTC_WAIT_LOOPS) {
+            return;
+        }
+    }
+    
+    /* The clock source can only change across a backup domain reset */
+    if ((RCC->BDCR & RCC_BDCR_RTCSEL) != RCC_BDCR_RTCSEL_1) {
+        RCC->BDCR |= RCC_BDCR_BDRST;
+        RCC->BDCR &= ~RCC_BDCR_BDRST;
+        RCC->BDCR |= RCC_BDCR_RTCSEL_1;
+    }
+    RCC->BDCR |= RCC_BDCR_RTCEN;
+    
+    /* Unlock, enter init mode, set the prescalers (sync first) */
+    RTC->WPR = 0xCA;
+    RTC->WPR = 0x53;
+    RTC->ISR |= RTC_ISR_INIT;
+    ulLoops = 0;
+    while ((RTC->ISR & RTC_ISR_INITF) == 0) {
+        if (++ulLoops > POWER_RTC_WAIT_LOOPS) {
+            RTC->WPR = 0xFF;
+            return;
+        }
+    }
+    RTC->PRER = POWER_RTC_PREDIV_SYNC;
+    RTC->PRER |= (uint32_t)POWER_RTC_PREDIV_ASYNC << 16;
+    RTC->CR |= RTC_CR_BYPSHAD;
+    RTC->ISR &= ~RTC_ISR_INIT;
+    RTC->WPR = 0xFF;
+    
+    ucRtcReady = 1;
+}
+
+/**
+  * @brief  Read the RTC time of day
+  * @retval Milliseconds since midnight, 0 if the RTC is not running
+  */
+static uint32_t RtcReadMs(void)
+{
+    uint32_t ulSsr, ulTr;
+    uint32_t ulSeconds;
+    
+    if (!ucRtcReady) {
+        return 0;
+    }
+    
+    /* Registers read directly: repeat until no second boundary fell between */
+    do {
+        ulSsr = RTC->SSR;
+        ulTr = RTC->TR;
+    } while (ulSsr != RTC->SSR || ulTr != RTC->TR);
+    
+    ulSeconds = (((ulTr >> 20) & 0x3) * 10 + ((ulTr >> 16) & 0xF)) * 3600 +
+                (((ulTr >> 12) & 0x7) * 10 + ((ulTr >> 8) & 0xF)) * 60 +
+                (((ulTr >> 4) & 0x7) * 10 + (ulTr & 0xF));
+    
+    return ulSeconds * 1000 +
+           ((POWER_RTC_PREDIV_SYNC - (ulSsr & 0xFFFF)) * 1000) / (POWER_RTC_PREDIV_SYNC + 1);
+}
+
+/**
+  * @brief  RTC time since an earlier reading
+  * @param  ulStartMs: Earlier RtcReadMs() value
+  * @retval Elapsed milliseconds, modulo one day
+  */
+static uint32_t RtcElapsedMs(uint32_t ulStartMs)
+{
+    uint32_t ulNowMs = RtcReadMs();
+    
+    return (ulNowMs + RTC_MS_PER_DAY - ulStartMs) % RTC_MS_PER_DAY;
+}
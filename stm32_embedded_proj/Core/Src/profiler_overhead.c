@@ -0,0 +1,189 @@
+/**
+  ******************************************************************************
+  * @file    profiler_overhead.c
+  * @brief   Profiler Self-Overhead Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * Phase cycles accumulate in free-running words (LDREX/STREX, since the
+  * snapshot phase is also entered from GpioMonitorTask). The window close
+  * in ProfilerTask subtracts the previous totals, so writers never see a
+  * reset and a window can hold up to 2^32 cycles per phase (~51 s at
+  * 84 MHz). Elapsed time is taken from the same counter, which keeps the
+  * ratio valid across clock governor switches.
+  *
+  ******************************************************************************
+  */
+
+#include "profiler_overhead.h"
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "system_profiler.h"
+
+/* Static variables */
+static volatile uint32_t ulPhaseCycles[OVERHEAD_PHASE_COUNT];
+static uint32_t ulPhaseLast[OVERHEAD_PHASE_COUNT];
+static uint32_t ulWindowStartCycles = 0;
+static TickType_t xWindowStartTick = 0;
+static uint8_t ucRelaxWindows = 0;
+
+static volatile uint8_t ucLevel = OVERHEAD_LEVEL_NONE;
+static volatile uint32_t ulBudgetPct = OVERHEAD_DEFAULT_BUDGET_PCT;
+static OverheadStats_t xStats;
+
+/* Private function prototypes */
+static void AtomicAdd(volatile uint32_t *pulValue, uint32_t ulDelta);
+
+/**
+  * @brief  Start stamp for a phase
+  * @retval DWT cycle count
+  */
+uint32_t ProfilerOverhead_Begin(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**
+  * @brief  Charge the cycles since startCycles to a phase
+  * @param  phase: OVERHEAD_x
+  * @param  startCycles: Value from ProfilerOverhead_Begin()
+  * @retval None
+  */
+void ProfilerOverhead_End(OverheadPhase_t phase, uint32_t startCycles)
+{
+    if (phase < OVERHEAD_PHASE_COUNT) {
+        AtomicAdd(&ulPhaseCycles[phase], DWT->CYCCNT - startCycles);
+    }
+}
+
+/**
+  * @brief  Close the window when due and adjust the throttle level
+  * @note   ProfilerTask only, after each sample
+  * @retval None
+  */
+void ProfilerOverhead_Update(void)
+{
+    TickType_t xNow = xTaskGetTickCount();
+    uint32_t ulNowCycles;
+    uint32_t ulElapsed;
+    uint32_t ulDelta[OVERHEAD_PHASE_COUNT];
+    uint32_t ulTotal = 0;
+    float fTotalPct;
+    float fBudget;
+
+    if ((xNow - xWindowStartTick) < pdMS_TO_TICKS(OVERHEAD_WINDOW_MS)) {
+        return;
+    }
+    xWindowStartTick = xNow;
+
+    ulNowCycles = DWT->CYCCNT;
+    ulElapsed = ulNowCycles - ulWindowStartCycles;
+    ulWindowStartCycles = ulNowCycles;
+
+    for (uint8_t i = 0; i < OVERHEAD_PHASE_COUNT; i++) {
+        uint32_t ulCycles = ulPhaseCycles[i];
+
+        ulDelta[i] = ulCycles - ulPhaseLast[i];
+        ulPhaseLast[i] = ulCycles;
+        ulTotal += ulDelta[i];
+    }
+
+    /* No cycle counter (QEMU): nothing to judge the budget by */
+    if (ulElapsed == 0) {
+        return;
+    }
+
+    fTotalPct = 100.0f * (float)ulTotal / (float)ulElapsed;
+    fBudget = (float)ulBudgetPct;
+
+    if (fBudget > 0.0f && fTotalPct > fBudget) {
+        ucRelaxWindows = 0;
+        if (ucLevel < OVERHEAD_LEVEL_MAX) {
+            ucLevel++;
+            xStats.throttleCount++;
+        }
+    } else if (ucLevel > OVERHEAD_LEVEL_NONE &&
+               (fBudget == 0.0f || fTotalPct < fBudget * OVERHEAD_RELAX_PCT / 100.0f)) {
+        if (++ucRelaxWindows >= OVERHEAD_RELAX_WINDOWS) {
+            ucRelaxWindows = 0;
+            ucLevel--;
+        }
+    } else {
+        ucRelaxWindows = 0;
+    }
+
+    taskENTER_CRITICAL();
+    xStats.totalPct = fTotalPct;
+    for (uint8_t i = 0; i < OVERHEAD_PHASE_COUNT; i++) {
+        xStats.phasePct[i] = 100.0f * (float)ulDelta[i] / (float)ulElapsed;
+    }
+    xStats.budgetPct = fBudget;
+    xStats.level = ucLevel;
+    taskEXIT_CRITICAL();
+}
+
+/**
+  * @brief  Set the overhead budget
+  * @param  budgetPct: 1-OVERHEAD_MAX_BUDGET_PCT, or 0 to stop throttling
+  * @retval 1 if applied, 0 if out of range
+  */
+uint8_t ProfilerOverhead_SetBudget(uint32_t budgetPct)
+{
+    if (budgetPct > OVERHEAD_MAX_BUDGET_PCT) {
+        return 0;
+    }
+    ulBudgetPct = budgetPct;
+    return 1;
+}
+
+/**
+  * @brief  Current throttle level
+  * @retval OVERHEAD_LEVEL_x
+  */
+uint8_t ProfilerOverhead_GetLevel(void)
+{
+    return ucLevel;
+}
+
+/**
+  * @brief  Sample period after throttling
+  * @param  configuredMs: Period set by the "rate" command
+  * @retval Period in ms, at most PROFILER_MAX_SAMPLE_MS
+  */
+uint32_t ProfilerOverhead_SamplePeriodMs(uint32_t configuredMs)
+{
+    uint32_t ulPeriod = configuredMs;
+    uint8_t ucShift = (ucLevel >= OVERHEAD_LEVEL_PERIOD_X2) ?
+                      (uint8_t)(ucLevel - OVERHEAD_LEVEL_PERIOD_X2 + 1) : 0;
+
+    ulPeriod <<= ucShift;
+    return (ulPeriod > PROFILER_MAX_SAMPLE_MS) ? PROFILER_MAX_SAMPLE_MS : ulPeriod;
+}
+
+/**
+  * @brief  Copy of the last closed window
+  * @param  stats: Output
+  * @retval None
+  */
+void ProfilerOverhead_GetStats(OverheadStats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = xStats;
+    taskEXIT_CRITICAL();
+}
+
+/**
+  * @brief  Lock-free add
+  * @param  pulValue: Word to update
+  * @param  ulDelta: Amount to add
+  * @retval None
+  */
+static void AtomicAdd(volatile uint32_t *pulValue, uint32_t ulDelta)
+{
+    uint32_t ulOld;
+
+    do {
+        ulOld = __LDREXW(pulValue);
+    } while (__STREXW(ulOld + ulDelta, pulValue) != 0);
+}
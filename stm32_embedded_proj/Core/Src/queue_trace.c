@@ -0,0 +1,422 @@
+/**
+  ******************************************************************************
+  * @file    queue_trace.c
+  * @brief   Queue / Semaphore Instrumentation Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * The send/receive hooks run inside the kernel's own critical sections
+  * (or with the syscall interrupt mask raised in the FROM_ISR variants),
+  * so the per-object counters need no further locking. Only the blocking
+  * hook runs with the scheduler suspended and interrupts enabled.
+  *
+  * Every object gets a table slot in its uxQueueNumber and every task a
+  * 1-based index in its uxTaskNumber when it is created. The delete hooks
+  * release both. A task that blocks on an object records (slot, direction,
+  * tick) against its index; the next send/receive or timeout of that task
+  * closes the interval.
+  *
+  * Mutex operations (task context only) are forwarded to mutex_trace.c.
+  *
+  ******************************************************************************
+  */
+
+#include "queue_trace.h"
+#include "mutex_trace.h"
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include <string.h>
+
+/* Live per-object record */
+typedef struct {
+    void *handle;
+    uint8_t mutex;                  /* mutex_trace index, QUEUE_TRACE_UNTRACKED otherwise */
+    QueueObjectStats_t stats;
+} QueueTraceObject_t;
+
+/* Outstanding block of one task */
+typedef struct {
+    uint8_t used;                   /* Index held by a live task */
+    uint8_t object;                 /* QUEUE_TRACE_UNTRACKED when not blocked */
+    uint8_t receive;
+    TickType_t start;
+} QueueTraceBlock_t;
+
+/* Static variables */
+static QueueTraceObject_t xObjects[QUEUE_TRACE_MAX_OBJECTS];
+static QueueTraceBlock_t xBlocks[QUEUE_TRACE_MAX_TASKS];
+static uint8_t ucObjectCount = 0;         /* Slots ever used; free ones have no handle */
+
+/* Indexed by queueQUEUE_TYPE_x */
+static const char * const pcTypeNames[] = {
+    "queue", "mutex", "csem", "bsem", "rmutex"
+};
+#define QUEUE_TYPE_MUTEX            1
+#define QUEUE_TYPE_RECURSIVE_MUTEX  4
+
+/* Private function prototypes */
+static QueueTraceBlock_t *GetCurrentBlock(void);
+static void EndBlock(uint32_t ulObject);
+static void RecordDepth(QueueObjectStats_t *pxStats, uint32_t ulDepth);
+
+/**
+  * @brief  Allocate a table slot for a new queue, semaphore or mutex
+  * @param  pvQueue: Queue handle
+  * @param  ulLength: Queue length (maximum count for semaphores)
+  * @param  ucType: queueQUEUE_TYPE_x
+  * @retval Slot to store in uxQueueNumber, QUEUE_TRACE_UNTRACKED if full
+  */
+uint32_t QueueTrace_Create(void *pvQueue, uint32_t ulLength, uint8_t ucType)
+{
+    QueueTraceObject_t *pxObject;
+    uint32_t ulSlot;
+
+    /* Lowest slot released by a delete, else the next unused one */
+    taskENTER_CRITICAL();
+    for (ulSlot = 0; ulSlot < ucObjectCount; ulSlot++) {
+        if (xObjects[ulSlot].handle == NULL) {
+            break;
+        }
+    }
+    if (ulSlot >= QUEUE_TRACE_MAX_OBJECTS) {
+        taskEXIT_CRITICAL();
+        return QUEUE_TRACE_UNTRACKED;
+    }
+
+    pxObject = &xObjects[ulSlot];
+    memset(pxObject, 0, sizeof(QueueTraceObject_t));
+    pxObject->handle = pvQueue;
+    pxObject->stats.type = ucType;
+    pxObject->stats.length = (ulLength > 0xFF) ? 0xFF : (uint8_t)ulLength;
+    pxObject->mutex = QUEUE_TRACE_UNTRACKED;
+    if ((ucType == QUEUE_TYPE_MUTEX) || (ucType == QUEUE_TYPE_RECURSIVE_MUTEX)) {
+        pxObject->mutex = MutexTrace_Create(pvQueue, ucType == QUEUE_TYPE_RECURSIVE_MUTEX);
+    }
+    if (ulSlot == ucObjectCount) {
+        ucObjectCount++;
+    }
+    taskEXIT_CRITICAL();
+
+    return ulSlot;
+}
+
+/**
+  * @brief  Release the slot of a queue, semaphore or mutex being deleted
+  * @param  ulObject: Object slot
+  * @retval None
+  */
+void QueueTrace_Delete(uint32_t ulObject)
+{
+    if (ulObject >= ucObjectCount) {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    MutexTrace_Delete(xObjects[ulObject].mutex);
+    for (uint8_t i = 0; i < QUEUE_TRACE_MAX_TASKS; i++) {
+        if (xBlocks[i].object == ulObject) {
+            xBlocks[i].object = QUEUE_TRACE_UNTRACKED;
+        }
+    }
+    xObjects[ulObject].handle = NULL;
+    taskEXIT_CRITICAL();
+}
+
+/**
+  * @brief  Allocate a block-timing index for a new task
+  * @note   Inside the kernel's critical section
+  * @retval 1-based index to store in uxTaskNumber, 0 if untracked
+  */
+uint32_t QueueTrace_TaskCreate(void)
+{
+    for (uint32_t i = 0; i < QUEUE_TRACE_MAX_TASKS; i++) {
+        if (!xBlocks[i].used) {
+            xBlocks[i].used = 1;
+            xBlocks[i].object = QUEUE_TRACE_UNTRACKED;
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+  * @brief  Release the block-timing index of a task being deleted
+  * @note   Inside the kernel's critical section
+  * @param  ulTaskNumber: uxTaskNumber of the task
+  * @retval None
+  */
+void QueueTrace_TaskDeleted(uint32_t ulTaskNumber)
+{
+    if ((ulTaskNumber == 0) || (ulTaskNumber > QUEUE_TRACE_MAX_TASKS)) {
+        return;
+    }
+
+    MutexTrace_TaskDeleted((uint8_t)(ulTaskNumber - 1));
+    xBlocks[ulTaskNumber - 1].object = QUEUE_TRACE_UNTRACKED;
+    xBlocks[ulTaskNumber - 1].used = 0;
+}
+
+/**
+  * @brief  Item written (or semaphore given)
+  * @param  ulObject: Object slot
+  * @param  ulDepth: Items waiting after the write
+  * @param  ucFromIsr: 1 when called from an ISR
+  * @retval None
+  */
+void QueueTrace_Send(uint32_t ulObject, uint32_t ulDepth, uint8_t ucFromIsr)
+{
+    if (ulObject >= ucObjectCount) {
+        return;
+    }
+
+    if (!ucFromIsr) {
+        EndBlock(ulObject);
+        MutexTrace_Given(xObjects[ulObject].mutex);
+    }
+    xObjects[ulObject].stats.sends++;
+    RecordDepth(&xObjects[ulObject].stats, ulDepth);
+}
+
+/**
+  * @brief  Write failed because the object was full
+  * @param  ulObject: Object slot
+  * @param  ucFromIsr: 1 when called from an ISR
+  * @retval None
+  */
+void QueueTrace_SendFailed(uint32_t ulObject, uint8_t ucFromIsr)
+{
+    QueueTraceBlock_t *pxBlock;
+
+    if (ulObject >= ucObjectCount) {
+        return;
+    }
+
+    /* A timed-out block was already counted when it started */
+    pxBlock = ucFromIsr ? NULL : GetCurrentBlock();
+    if ((pxBlock == NULL) || (pxBlock->object != ulObject)) {
+        xObjects[ulObject].stats.sendFull++;
+    }
+    if (!ucFromIsr) {
+        EndBlock(ulObject);
+    }
+}
+
+/**
+  * @brief  Item read (or semaphore taken)
+  * @param  ulObject: Object slot
+  * @param  ulDepth: Items waiting after the read
+  * @param  ucFromIsr: 1 when called from an ISR
+  * @retval None
+  */
+void QueueTrace_Receive(uint32_t ulObject, uint32_t ulDepth, uint8_t ucFromIsr)
+{
+    if (ulObject >= ucObjectCount) {
+        return;
+    }
+
+    if (!ucFromIsr) {
+        EndBlock(ulObject);
+        MutexTrace_Taken(xObjects[ulObject].mutex);
+    }
+    xObjects[ulObject].stats.receives++;
+    RecordDepth(&xObjects[ulObject].stats, ulDepth);
+}
+
+/**
+  * @brief  Read failed because the object was empty
+  * @param  ulObject: Object slot
+  * @param  ucFromIsr: 1 when called from an ISR
+  * @retval None
+  */
+void QueueTrace_ReceiveFailed(uint32_t ulObject, uint8_t ucFromIsr)
+{
+    QueueTraceBlock_t *pxBlock;
+
+    if (ulObject >= ucObjectCount) {
+        return;
+    }
+
+    pxBlock = ucFromIsr ? NULL : GetCurrentBlock();
+    if ((pxBlock == NULL) || (pxBlock->object != ulObject)) {
+        xObjects[ulObject].stats.recvEmpty++;
+    }
+    if (!ucFromIsr) {
+        EndBlock(ulObject);
+        MutexTrace_TakeFailed(xObjects[ulObject].mutex);
+    }
+}
+
+/**
+  * @brief  Calling task is about to block on a full or empty object
+  * @param  ulObject: Object slot
+  * @param  ucReceive: 1 when blocking to receive, 0 to send
+  * @retval None
+  */
+void QueueTrace_Block(uint32_t ulObject, uint8_t ucReceive)
+{
+    QueueTraceBlock_t *pxBlock = GetCurrentBlock();
+    uint32_t ulPrimask;
+
+    if ((ulObject >= ucObjectCount) || (pxBlock == NULL)) {
+        return;
+    }
+
+    if (ucReceive) {
+        MutexTrace_Block(xObjects[ulObject].mutex);
+    }
+
+    /* Re-blocking after a spurious wake keeps the original start */
+    if (pxBlock->object == ulObject) {
+        return;
+    }
+
+    pxBlock->object = (uint8_t)ulObject;
+    pxBlock->receive = ucReceive;
+    pxBlock->start = xTaskGetTickCount();
+
+    /* Interrupts are live here; FROM_ISR failures touch the same counters */
+    ulPrimask = __get_PRIMASK();
+    __disable_irq();
+    if (ucReceive) {
+        xObjects[ulObject].stats.recvEmpty++;
+    } else {
+        xObjects[ulObject].stats.sendFull++;
+    }
+    __set_PRIMASK(ulPrimask);
+}
+
+/**
+  * @brief  Copy statistics of all tracked objects
+  * @param  stats: Output array
+  * @param  maxObjects: Capacity of the output array
+  * @retval Number of objects written
+  */
+uint8_t QueueTrace_GetStats(QueueObjectStats_t *stats, uint8_t maxObjects)
+{
+    void *pvHandles[QUEUE_TRACE_MAX_OBJECTS];
+    uint8_t count = 0;
+
+    if (maxObjects > QUEUE_TRACE_MAX_OBJECTS) {
+        maxObjects = QUEUE_TRACE_MAX_OBJECTS;
+    }
+
+    /* Released slots are skipped, so the output is packed */
+    taskENTER_CRITICAL();
+    for (uint8_t i = 0; (i < ucObjectCount) && (count < maxObjects); i++) {
+        if (xObjects[i].handle != NULL) {
+            stats[count] = xObjects[i].stats;
+            pvHandles[count] = xObjects[i].handle;
+            count++;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    /* Registry lookup is a linear scan, keep it outside the critical section */
+    for (uint8_t i = 0; i < count; i++) {
+        stats[i].name = pcQueueGetName((QueueHandle_t)pvHandles[i]);
+        if (stats[i].name == NULL) {
+            stats[i].name = "";
+        }
+    }
+
+    return count;
+}
+
+/**
+  * @brief  Block-timing index of the running task
+  * @retval 0-based index, QUEUE_TRACE_UNTRACKED for untracked tasks or
+  *         before the scheduler starts
+  */
+uint8_t QueueTrace_CurrentTask(void)
+{
+    UBaseType_t uxIndex;
+
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        return QUEUE_TRACE_UNTRACKED;
+    }
+
+    uxIndex = uxTaskGetTaskNumber(xTaskGetCurrentTaskHandle());
+    if ((uxIndex == 0) || (uxIndex > QUEUE_TRACE_MAX_TASKS)) {
+        return QUEUE_TRACE_UNTRACKED;
+    }
+
+    return (uint8_t)(uxIndex - 1);
+}
+
+/**
+  * @brief  Short name of an object type for reports
+  * @param  type: queueQUEUE_TYPE_x
+  * @retval Type name
+  */
+const char *QueueTrace_TypeName(uint8_t type)
+{
+    if (type < (sizeof(pcTypeNames) / sizeof(pcTypeNames[0]))) {
+        return pcTypeNames[type];
+    }
+    return "?";
+}
+
+/**
+  * @brief  Block record of the running task
+  * @retval Record, NULL for untracked tasks or before the scheduler starts
+  */
+static QueueTraceBlock_t *GetCurrentBlock(void)
+{
+    uint8_t ucTask = QueueTrace_CurrentTask();
+
+    return (ucTask != QUEUE_TRACE_UNTRACKED) ? &xBlocks[ucTask] : NULL;
+}
+
+/**
+  * @brief  Close the running task's block on an object and bin its duration
+  * @param  ulObject: Object slot the task has just operated on
+  * @retval None
+  */
+static void EndBlock(uint32_t ulObject)
+{
+    QueueTraceBlock_t *pxBlock = GetCurrentBlock();
+    QueueObjectStats_t *pxStats;
+    TickType_t xWaited;
+    uint16_t *pusHist;
+    uint8_t ucBin;
+
+    if ((pxBlock == NULL) || (pxBlock->object != ulObject)) {
+        return;
+    }
+
+    pxStats = &xObjects[ulObject].stats;
+    xWaited = xTaskGetTickCount() - pxBlock->start;
+    pxBlock->object = QUEUE_TRACE_UNTRACKED;
+
+    /* Decade bins in ms: 0, 1-9, 10-99, >= 100 */
+    ucBin = (xWaited < pdMS_TO_TICKS(1)) ? 0 :
+            (xWaited < pdMS_TO_TICKS(10)) ? 1 :
+            (xWaited < pdMS_TO_TICKS(100)) ? 2 : 3;
+
+    pusHist = pxBlock->receive ? pxStats->recvBlockHist : pxStats->sendBlockHist;
+    if (pusHist[ucBin] < 0xFFFF) {
+        pusHist[ucBin]++;
+    }
+}
+
+/**
+  * @brief  Update current and peak depth
+  * @param  pxStats: Object statistics
+  * @param  ulDepth: Items waiting
+  * @retval None
+  */
+static void RecordDepth(QueueObjectStats_t *pxStats, uint32_t ulDepth)
+{
+    if (ulDepth > pxStats->length) {
+        ulDepth = pxStats->length;
+    }
+
+    pxStats->depth = (uint8_t)ulDepth;
+    if (pxStats->depth > pxStats->peak) {
+        pxStats->peak = pxStats->depth;
+    }
+}
@@ -0,0 +1,259 @@
+/**
+  ******************************************************************************
+  * @file    sizing_advisor.c
+  * @brief   Sizing Advisor Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * Stack figures come from the stack monitor's registry, one task at a time
+  * with the scheduler suspended, so a task created or deleted while the
+  * report is written may be skipped or listed twice. Lines are written from
+  * the command task after resuming.
+  *
+  ******************************************************************************
+  */
+
+#include "sizing_advisor.h"
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "stack_monitor.h"
+#include "queue_trace.h"
+#include "uart_transport.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SIZING_LINE_SIZE            96
+
+/* One registered size define */
+typedef struct {
+    const char *name;               /* Task or queue registry name */
+    const char *define;
+    uint16_t itemBytes;             /* Bytes per unit of the define */
+    uint8_t kind;                   /* SIZING_KIND_x */
+} SizingTrack_t;
+
+/* Static variables */
+static SizingTrack_t xTracked[SIZING_MAX_TRACKED];
+static uint8_t ucTrackedCount = 0;
+
+/* Private function prototypes */
+static const SizingTrack_t *FindTracked(SizingKind_t kind, const char *pcName);
+static uint32_t RecommendStack(uint32_t ulPeakWords);
+static uint32_t RecommendQueue(uint32_t ulPeakItems);
+static uint32_t RecommendHeap(uint32_t ulPeakBytes);
+static void CopyName(char *pcDest, const char *pcSrc, size_t xSize);
+static void WriteLine(const char *pcLine, int xLen);
+
+/**
+  * @brief  Register the define that sizes a task stack or queue
+  * @note   Before the scheduler starts; pcName and pcDefine must be literals
+  * @param  kind: SIZING_KIND_x
+  * @param  pcName: Task name, or queue registry name
+  * @param  pcDefine: Name of the size define
+  * @param  ulItemBytes: Bytes per stack word or queue item
+  * @retval None
+  */
+void SizingAdvisor_Track(SizingKind_t kind, const char *pcName, const char *pcDefine,
+                         uint32_t ulItemBytes)
+{
+    if (ucTrackedCount >= SIZING_MAX_TRACKED) {
+        return;
+    }
+
+    xTracked[ucTrackedCount].name = pcName;
+    xTracked[ucTrackedCount].define = pcDefine;
+    xTracked[ucTrackedCount].itemBytes = (uint16_t)ulItemBytes;
+    xTracked[ucTrackedCount].kind = (uint8_t)kind;
+    ucTrackedCount++;
+}
+
+/**
+  * @brief  Write the "#sz" sizing report
+  * @note   Command task only
+  * @retval None
+  */
+void SizingAdvisor_Report(void)
+{
+    static QueueObjectStats_t xQueues[QUEUE_TRACE_MAX_OBJECTS];
+    char line[SIZING_LINE_SIZE];
+    char name[configMAX_TASK_NAME_LEN];
+    const SizingTrack_t *pxTrack;
+    int32_t lHeapSaved = 0;         /* Heap bytes freed by the recommended sizes */
+    uint32_t ulDepth, ulFree, ulRec, ulPeakHeap;
+    uint8_t ucQueueCount;
+    int xLen;
+
+    xLen = snprintf(line, sizeof(line), "#szh %s %u %u %u %lu\r\n",
+                    PROFILER_STATIC_ALLOCATION ? "static" : "dynamic",
+                    SIZING_STACK_MARGIN_PCT, SIZING_HEAP_MARGIN_PCT, SIZING_QUEUE_MARGIN_PCT,
+                    (unsigned long)((xTaskGetTickCount() - configINITIAL_TICK_COUNT) /
+                                    configTICK_RATE_HZ));
+    WriteLine(line, xLen);
+
+    /* Task stacks */
+    for (uint32_t i = 0; ; i++) {
+        vTaskSuspendAll();
+        if (i >= StackMonitor_GetTaskCount()) {
+            (void)xTaskResumeAll();
+            break;
+        }
+        ulDepth = StackMonitor_GetSize(i);
+        if (!StackMonitor_GetFree(i, &ulFree)) {
+            ulFree = uxTaskGetStackHighWaterMark((TaskHandle_t)StackMonitor_GetTask(i));
+        }
+        CopyName(name, pcTaskGetName((TaskHandle_t)StackMonitor_GetTask(i)), sizeof(name));
+        (void)xTaskResumeAll();
+
+        pxTrack = FindTracked(SIZING_KIND_STACK, name);
+        ulRec = ulDepth;
+        if (pxTrack != NULL) {
+            ulRec = RecommendStack(ulDepth - ulFree);
+            lHeapSaved += ((int32_t)ulDepth - (int32_t)ulRec) * (int32_t)pxTrack->itemBytes;
+        }
+
+        xLen = snprintf(line, sizeof(line), "#sz stack %s %s %lu %lu %lu\r\n",
+                        name, (pxTrack != NULL) ? pxTrack->define : "-",
+                        (unsigned long)ulDepth, (unsigned long)(ulDepth - ulFree),
+                        (unsigned long)ulRec);
+        WriteLine(line, xLen);
+    }
+
+    /* Queues (semaphores and mutexes have no size to tune) */
+    ucQueueCount = QueueTrace_GetStats(xQueues, QUEUE_TRACE_MAX_OBJECTS);
+    for (uint8_t i = 0; i < ucQueueCount; i++) {
+        const QueueObjectStats_t *pxQueue = &xQueues[i];
+
+        if (pxQueue->type != queueQUEUE_TYPE_BASE) {
+            continue;
+        }
+
+        CopyName(name, (pxQueue->name[0] != '\0') ? pxQueue->name : "?", sizeof(name));
+        pxTrack = FindTracked(SIZING_KIND_QUEUE, pxQueue->name);
+        ulRec = pxQueue->length;
+        if (pxTrack != NULL) {
+            ulRec = RecommendQueue(pxQueue->peak);
+            lHeapSaved += ((int32_t)pxQueue->length - (int32_t)ulRec) * (int32_t)pxTrack->itemBytes;
+        }
+
+        xLen = snprintf(line, sizeof(line), "#sz queue %s %s %u %u %u %lu\r\n",
+                        name, (pxTrack != NULL) ? pxTrack->define : "-",
+                        (pxTrack != NULL) ? pxTrack->itemBytes : 0U,
+                        pxQueue->length, pxQueue->peak, (unsigned long)ulRec);
+        WriteLine(line, xLen);
+    }
+
+    /* Heap: stacks and queue storage are heap blocks in dynamic builds */
+    ulPeakHeap = configTOTAL_HEAP_SIZE - xPortGetMinimumEverFreeHeapSize();
+    ulRec = ulPeakHeap;
+    if (!PROFILER_STATIC_ALLOCATION) {
+        int32_t lPeak = (int32_t)ulPeakHeap - lHeapSaved;
+
+        ulRec = (lPeak > 0) ? (uint32_t)lPeak : 0;
+    }
+    ulRec = RecommendHeap(ulRec);
+
+    xLen = snprintf(line, sizeof(line), "#sz heap configTOTAL_HEAP_SIZE %lu %lu %lu\r\n",
+                    (unsigned long)configTOTAL_HEAP_SIZE, (unsigned long)ulPeakHeap,
+                    (unsigned long)ulRec);
+    WriteLine(line, xLen);
+
+    WriteLine("#szd\r\n", 6);
+}
+
+/**
+  * @brief  Look up a registered define
+  * @param  kind: SIZING_KIND_x
+  * @param  pcName: Name as reported ('_' for spaces)
+  * @retval Entry, NULL if untracked
+  */
+static const SizingTrack_t *FindTracked(SizingKind_t kind, const char *pcName)
+{
+    char name[configMAX_TASK_NAME_LEN];
+
+    for (uint8_t i = 0; i < ucTrackedCount; i++) {
+        if (xTracked[i].kind != (uint8_t)kind) {
+            continue;
+        }
+        CopyName(name, xTracked[i].name, sizeof(name));
+        if (strcmp(name, pcName) == 0) {
+            return &xTracked[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+  * @brief  Stack depth for a peak
+  * @param  ulPeakWords: Deepest use seen
+  * @retval Depth in words
+  */
+static uint32_t RecommendStack(uint32_t ulPeakWords)
+{
+    uint32_t ulHeadroom = (ulPeakWords * SIZING_STACK_MARGIN_PCT + 99U) / 100U;
+
+    if (ulHeadroom < SIZING_STACK_MIN_HEADROOM_WORDS) {
+        ulHeadroom = SIZING_STACK_MIN_HEADROOM_WORDS;
+    }
+
+    return ((ulPeakWords + ulHeadroom + SIZING_STACK_ROUND_WORDS - 1U) /
+            SIZING_STACK_ROUND_WORDS) * SIZING_STACK_ROUND_WORDS;
+}
+
+/**
+  * @brief  Queue length for a peak
+  * @param  ulPeakItems: Most items waiting at once
+  * @retval Length, at least 1
+  */
+static uint32_t RecommendQueue(uint32_t ulPeakItems)
+{
+    uint32_t ulRec = ulPeakItems + (ulPeakItems * SIZING_QUEUE_MARGIN_PCT + 99U) / 100U;
+
+    return (ulRec > 0) ? ulRec : 1U;
+}
+
+/**
+  * @brief  Heap size for a peak
+  * @param  ulPeakBytes: Largest amount allocated at once
+  * @retval Size in bytes, at least SIZING_HEAP_ROUND_BYTES
+  */
+static uint32_t RecommendHeap(uint32_t ulPeakBytes)
+{
+    uint32_t ulRec = ulPeakBytes + (ulPeakBytes * SIZING_HEAP_MARGIN_PCT + 99U) / 100U;
+
+    ulRec = ((ulRec + SIZING_HEAP_ROUND_BYTES - 1U) / SIZING_HEAP_ROUND_BYTES) *
+            SIZING_HEAP_ROUND_BYTES;
+    return (ulRec > 0) ? ulRec : SIZING_HEAP_ROUND_BYTES;
+}
+
+/**
+  * @brief  Copy a name for a space-separated line
+  * @param  pcDest: Output, spaces replaced with '_'
+  * @param  pcSrc: Name
+  * @param  xSize: Size of pcDest
+  * @retval None
+  */
+static void CopyName(char *pcDest, const char *pcSrc, size_t xSize)
+{
+    size_t i;
+
+    for (i = 0; i + 1 < xSize && pcSrc[i] != '\0'; i++) {
+        pcDest[i] = (pcSrc[i] == ' ') ? '_' : pcSrc[i];
+    }
+    pcDest[i] = '\0';
+}
+
+/**
+  * @brief  Write one report line
+  * @param  pcLine: Line including "\r\n"
+  * @param  xLen: snprintf() result
+  * @retval None
+  */
+static void WriteLine(const char *pcLine, int xLen)
+{
+    if (xLen > 0 && xLen < SIZING_LINE_SIZE) {
+        (void)Transport_Write((const uint8_t *)pcLine, (uint16_t)xLen, 1000);
+    }
+}
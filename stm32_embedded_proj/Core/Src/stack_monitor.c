@@ -0,0 +1,249 @@
+/**
+  ******************************************************************************
+  * @file    stack_monitor.c
+  * @brief   Stack Monitor Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * The registry is written by the task create/delete trace hooks, which the
+  * kernel calls inside a critical section, and is read with the scheduler
+  * suspended. A deleted task's stack is freed by the idle task later, after
+  * its entry is already gone, so a scan never reads freed memory.
+  *
+  ******************************************************************************
+  */
+
+#include "stack_monitor.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "log_channel.h"
+#include "profiler_overhead.h"
+
+/* One monitored task */
+typedef struct {
+    void *task;                     /* TaskHandle_t */
+    const uint32_t *base;           /* Lowest stack word (stack grows down) */
+    uint32_t sizeWords;
+    uint32_t freeWords;             /* Cached high water mark */
+    uint32_t cursor;                /* Sweep position, words above base */
+    uint8_t ready;                  /* First sweep completed */
+    uint8_t trendStarted;
+    uint8_t warned;
+    uint32_t trendFreeWords;        /* Mark at the start of the trend window */
+    TickType_t trendTick;
+    float growthBps;                /* Smoothed growth, bytes per second */
+} StackEntry_t;
+
+/* Static variables */
+static StackEntry_t xEntries[STACK_MONITOR_MAX_TASKS];
+static uint32_t ulEntryCount = 0;
+
+/* Private function prototypes */
+static void ScanEntry(StackEntry_t *pxEntry);
+static void UpdateTrend(StackEntry_t *pxEntry, TickType_t xNow);
+
+/**
+  * @brief  Register a new task
+  * @note   traceTASK_CREATE, inside the kernel's critical section
+  * @param  pvTask: Task handle
+  * @param  pvStackBase: Lowest stack address (pxStack)
+  * @param  pvStackEnd: Highest stack word (pxEndOfStack)
+  * @retval None
+  */
+void StackMonitor_TaskCreated(void *pvTask, void *pvStackBase, void *pvStackEnd)
+{
+    StackEntry_t *pxEntry;
+
+    if (ulEntryCount >= STACK_MONITOR_MAX_TASKS) {
+        return;
+    }
+
+    pxEntry = &xEntries[ulEntryCount++];
+    pxEntry->task = pvTask;
+    pxEntry->base = (const uint32_t *)pvStackBase;
+    pxEntry->sizeWords = (uint32_t)((const uint32_t *)pvStackEnd - pxEntry->base) + 1U;
+    pxEntry->freeWords = pxEntry->sizeWords;
+    pxEntry->cursor = 0;
+    pxEntry->ready = 0;
+    pxEntry->trendStarted = 0;
+    pxEntry->warned = 0;
+    pxEntry->growthBps = 0.0f;
+}
+
+/**
+  * @brief  Drop a deleted task
+  * @note   traceTASK_DELETE, inside the kernel's critical section
+  * @param  pvTask: Task handle
+  * @retval None
+  */
+void StackMonitor_TaskDeleted(void *pvTask)
+{
+    for (uint32_t i = 0; i < ulEntryCount; i++) {
+        if (xEntries[i].task == pvTask) {
+            xEntries[i] = xEntries[--ulEntryCount];
+            return;
+        }
+    }
+}
+
+/**
+  * @brief  Advance every task's scan by one budget and update the trends
+  * @note   ProfilerTask, once per sample
+  * @retval None
+  */
+void StackMonitor_Scan(void)
+{
+    uint32_t ulPhaseStart = ProfilerOverhead_Begin();
+    TickType_t xNow = xTaskGetTickCount();
+
+    vTaskSuspendAll();
+    for (uint32_t i = 0; i < ulEntryCount; i++) {
+        ScanEntry(&xEntries[i]);
+        if (xEntries[i].ready) {
+            UpdateTrend(&xEntries[i], xNow);
+        }
+    }
+    (void)xTaskResumeAll();
+
+    ProfilerOverhead_End(OVERHEAD_SNAPSHOT, ulPhaseStart);
+}
+
+/**
+  * @brief  Number of registered tasks
+  * @note   Call with the scheduler suspended, like the getters below
+  * @retval Count
+  */
+uint32_t StackMonitor_GetTaskCount(void)
+{
+    return ulEntryCount;
+}
+
+/**
+  * @brief  Registered task by index
+  * @param  index: 0 to StackMonitor_GetTaskCount() - 1
+  * @retval Task handle, NULL if out of range
+  */
+void *StackMonitor_GetTask(uint32_t index)
+{
+    return (index < ulEntryCount) ? xEntries[index].task : NULL;
+}
+
+/**
+  * @brief  Stack depth of a registered task
+  * @param  index: 0 to StackMonitor_GetTaskCount() - 1
+  * @retval Depth in words, 0 if out of range
+  */
+uint32_t StackMonitor_GetSize(uint32_t index)
+{
+    return (index < ulEntryCount) ? xEntries[index].sizeWords : 0;
+}
+
+/**
+  * @brief  Cached high water mark of a registered task
+  * @param  index: 0 to StackMonitor_GetTaskCount() - 1
+  * @param  pulFreeWords: Output, free stack words never used
+  * @retval 1 if valid, 0 while the first sweep is still running
+  */
+uint8_t StackMonitor_GetFree(uint32_t index, uint32_t *pulFreeWords)
+{
+    if (index >= ulEntryCount || !xEntries[index].ready) {
+        return 0;
+    }
+
+    *pulFreeWords = xEntries[index].freeWords;
+    return 1;
+}
+
+/**
+  * @brief  Smoothed stack growth of a task
+  * @param  pvTask: Task handle
+  * @retval Bytes per hour, 0 if untracked
+  */
+uint32_t StackMonitor_GetGrowth(void *pvTask)
+{
+    for (uint32_t i = 0; i < ulEntryCount; i++) {
+        if (xEntries[i].task == pvTask) {
+            return (uint32_t)(xEntries[i].growthBps * 3600.0f);
+        }
+    }
+
+    return 0;
+}
+
+/**
+  * @brief  Spend one scan budget on a task's stack
+  * @param  pxEntry: Task to scan
+  * @retval None
+  */
+static void ScanEntry(StackEntry_t *pxEntry)
+{
+    const uint32_t *pulBase = pxEntry->base;
+    uint32_t ulBudget = STACK_MONITOR_SCAN_WORDS;
+
+    /* Guard: the stack deepened past the mark */
+    if (pxEntry->ready) {
+        while (ulBudget > 0 && pxEntry->freeWords > 0 &&
+               pulBase[pxEntry->freeWords - 1] != STACK_MONITOR_FILL_WORD) {
+            pxEntry->freeWords--;
+            ulBudget--;
+        }
+    }
+
+    /* Sweep up from the base for the first written word below the mark */
+    while (ulBudget > 0) {
+        if (pxEntry->cursor >= pxEntry->freeWords) {
+            pxEntry->cursor = 0;
+            pxEntry->ready = 1;
+            break;
+        }
+        if (pulBase[pxEntry->cursor] != STACK_MONITOR_FILL_WORD) {
+            pxEntry->freeWords = pxEntry->cursor;
+            pxEntry->cursor = 0;
+            pxEntry->ready = 1;
+            break;
+        }
+        pxEntry->cursor++;
+        ulBudget--;
+    }
+}
+
+/**
+  * @brief  Update the growth trend and warn once when the stack runs short
+  * @param  pxEntry: Task with a valid mark
+  * @param  xNow: Current tick count
+  * @retval None
+  */
+static void UpdateTrend(StackEntry_t *pxEntry, TickType_t xNow)
+{
+    TickType_t xElapsed = xNow - pxEntry->trendTick;
+    uint32_t ulFreeBytes = pxEntry->freeWords * sizeof(uint32_t);
+    float fRate;
+
+    if (!pxEntry->trendStarted) {
+        pxEntry->trendStarted = 1;
+        pxEntry->trendFreeWords = pxEntry->freeWords;
+        pxEntry->trendTick = xNow;
+        return;
+    }
+
+    if (xElapsed >= pdMS_TO_TICKS(STACK_MONITOR_TREND_MS)) {
+        fRate = (float)((pxEntry->trendFreeWords - pxEntry->freeWords) * sizeof(uint32_t)) *
+                (float)configTICK_RATE_HZ / (float)xElapsed;
+        pxEntry->growthBps += STACK_MONITOR_TREND_ALPHA * (fRate - pxEntry->growthBps);
+        pxEntry->trendFreeWords = pxEntry->freeWords;
+        pxEntry->trendTick = xNow;
+    }
+
+    if (pxEntry->warned) {
+        return;
+    }
+
+    if (ulFreeBytes < STACK_MONITOR_WARN_BYTES ||
+        (pxEntry->growthBps > 0.0f &&
+         (float)ulFreeBytes / pxEntry->growthBps < (float)STACK_MONITOR_WARN_HORIZON_S)) {
+        pxEntry->warned = 1;
+        LOG_STR("WARNING: Stack low in task: %s", pcTaskGetName((TaskHandle_t)pxEntry->task));
+        LOG("  %lu bytes free, growing %lu bytes/h", ulFreeBytes,
+            (uint32_t)(pxEntry->growthBps * 3600.0f));
+    }
+}
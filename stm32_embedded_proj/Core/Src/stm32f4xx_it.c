@@ -8,6 +8,9 @@
 #include "stm32f4xx_it.h"
 #include "stm32f4xx_hal.h"
 #include "main.h"
+#include "pc_sampler.h"
+#include "analog_monitor.h"
+#include "isr_event.h"
 
 /* External variables --------------------------------------------------------*/
 extern UART_HandleTypeDef huart2;
@@ -72,6 +75,14 @@ void DebugMon_Handler(void)
 /* STM32F4xx Peripheral Interrupt Handlers                                    */
 /******************************************************************************/
 
+/**
+  * @brief This function handles EXTI line1 interrupt (no pin; "isrbench" bursts).
+  */
+void EXTI1_IRQHandler(void)
+{
+    IsrEvent_BenchIrq();
+}
+
 /**
   * @brief This function handles EXTI line[15:10] interrupts.
   */
@@ -87,3 +98,36 @@ void USART2_IRQHandler(void)
 {
     HAL_UART_IRQHandler(&huart2);
 }
+
+/**
+  * @brief This function handles ADC1 global interrupt (overrun).
+  */
+void ADC_IRQHandler(void)
+{
+    AnalogMonitor_AdcIrq();
+}
+
+/**
+  * @brief This function handles DMA2 Stream0 global interrupt (ADC1 blocks).
+  */
+void DMA2_Stream0_IRQHandler(void)
+{
+    AnalogMonitor_DmaIrq();
+}
+
+/**
+  * @brief This function handles TIM3 global interrupt (PC sampler).
+  * @note  Naked so LR still holds EXC_RETURN; selects the stack the
+  *        interrupted context used and tail-calls PcSampler_Sample().
+  */
+__attribute__((naked)) void TIM3_IRQHandler(void)
+{
+    __asm volatile (
+        "tst   lr, #4              \n"
+        "ite   eq                  \n"
+        "mrseq r0, msp             \n"
+        "mrsne r0, psp             \n"
+        "mov   r1, lr              \n"
+        "b     PcSampler_Sample    \n"
+    );
+}
@@ -6,134 +6,424 @@
   */
 
 #include "system_profiler.h"
+#include "main.h"
 #include "FreeRTOS.h"
 #include "task.h"
+#include "stack_monitor.h"
 #include <string.h>
 #include <stdio.h>
 
 /* External variables */
 extern volatile uint32_t ulHighFrequencyTimerTicks;
 
+/* 64-bit shadow of one task's 32-bit run-time counter. Keyed by task
+ * number, since a new task can reuse a deleted task's handle */
+typedef struct {
+    UBaseType_t uxTaskNumber;           /* 0 = free slot */
+    uint32_t ulLastCounter;
+    uint64_t ullRunTime;
+} RunTimeShadow_t;
+
+/* Run-time accounting, extended on every task snapshot */
+static RunTimeShadow_t xRunTimeShadows[MAX_TASKS];
+static uint32_t ulLastTotalCounter = 0;
+static uint64_t ullTotalRunTime = 0;
+
 /* Static variables for CPU load calculation */
-static uint32_t ulLastTotalRunTime = 0;
-static uint32_t ulLastIdleRunTime = 0;
+static uint64_t ullLastTotalRunTime = 0;
+static uint64_t ullLastIdleRunTime = 0;
+static float fLastRuntimeLoad = 0.0f;
+static uint32_t ulHeldLoadSamples = 0;
+
+/* Sample history for "dump": only the scalar top-level fields (the F rows
+ * of REPORT_SCHEMA_REPORT), ~28 B per sample instead of a whole report */
+#define HISTORY_SKIP(...)
+#define HISTORY_DECLARE         REPORT_DECLARE_F, HISTORY_SKIP, HISTORY_SKIP, \
+                                HISTORY_SKIP, HISTORY_SKIP, HISTORY_SKIP
+#define HISTORY_COPY_F(bit, enc, member, pretty, compact) \
+    REPORT_IF(bit##_ENABLED, pxDst->member = pxSrc->member;)
+#define HISTORY_COPY            HISTORY_COPY_F, HISTORY_SKIP, HISTORY_SKIP, \
+                                HISTORY_SKIP, HISTORY_SKIP, HISTORY_SKIP
+#define HISTORY_MASK            REPORT_BUILT_ROW, HISTORY_SKIP, HISTORY_SKIP, \
+                                HISTORY_SKIP, HISTORY_SKIP, HISTORY_SKIP
+#define HISTORY_FIELDS          (0UL REPORT_APPLY(REPORT_SCHEMA_REPORT, HISTORY_MASK))
 
-/* Circular buffer for statistics */
-#define STATS_BUFFER_SIZE 100
-static SystemReport_t statsBuffer[STATS_BUFFER_SIZE];
+typedef struct {
+    uint32_t fieldMask;
+    REPORT_APPLY(REPORT_SCHEMA_REPORT, HISTORY_DECLARE)
+} HistorySample_t;
+
+#define STATS_BUFFER_SIZE 32
+static HistorySample_t statsBuffer[STATS_BUFFER_SIZE];
 static uint8_t bufferIndex = 0;
+static uint8_t bufferCount = 0;
+
+/* Task status snapshot - static in PROFILER_STATIC_ALLOCATION builds so the
+ * profiler never touches the heap; uxTaskGetSystemState() fails if the
+ * system has more than MAX_TASKS tasks */
+#if PROFILER_STATIC_ALLOCATION
+static TaskStatus_t xTaskStatusArray[MAX_TASKS];
+#endif
+
+/* Runtime configuration */
+static ProfilerConfig_t xProfilerConfig = {
+    .samplePeriodMs = PROFILER_DEFAULT_SAMPLE_MS,
+    .reportEverySamples = PROFILER_DEFAULT_REPORT_EVERY,
+    .format = REPORT_FORMAT_PRETTY,
+    .verbosity = 1,
+    .paused = 0,
+    .loadMode = PROFILER_DEFAULT_CPU_LOAD_MODE,
+    .subscription = {
+        .fieldMask = REPORT_FIELD_ALL,
+        .taskFieldMask = TASK_FIELD_ALL,
+        .taskFilterCount = 0
+    }
+};
+
+/* Full subscription used when the caller passes NULL */
+static const ReportSubscription_t xFullSubscription = {
+    .fieldMask = REPORT_FIELD_ALL,
+    .taskFieldMask = TASK_FIELD_ALL,
+    .taskFilterCount = 0
+};
+
+/* Private function prototypes */
+static uint8_t TaskMatchesFilter(const ReportSubscription_t *subscription, const char *pcTaskName);
+static TaskStatus_t *AcquireTaskStatusArray(UBaseType_t *puxArraySize);
+static void ReleaseTaskStatusArray(TaskStatus_t *pxArray);
+static UBaseType_t GetSystemState(TaskStatus_t *pxArray, UBaseType_t uxArraySize,
+                                  uint32_t *pulTotalRunTime);
+static float CalculateRuntimeLoad(void);
+static void UpdateRunTimeShadows(const TaskStatus_t *pxTasks, UBaseType_t uxCount,
+                                 uint32_t ulTotalCounter);
+static uint64_t GetTaskRunTime(const TaskStatus_t *pxTask);
 
 /**
   * @brief  Collect comprehensive system statistics
+  * @note   CPU load and heap are always sampled (test metrics and the clock
+  *         governor depend on them); everything else only when subscribed.
   * @param  report: Pointer to SystemReport_t structure to fill
+  * @param  subscription: Fields to collect, NULL for everything
   * @retval None
   */
-void CollectSystemStats(SystemReport_t *report)
+void CollectSystemStats(SystemReport_t *report, const ReportSubscription_t *subscription)
 {
     TaskStatus_t *pxTaskStatusArray;
-    volatile UBaseType_t uxArraySize, x;
-    uint32_t ulTotalRunTime, ulStatsAsPercentage;
+    UBaseType_t uxArraySize, x;
+    uint32_t ulTotalRunTime;
+    EnergyStats_t xEnergyStats = {0};
+    uint32_t ulFieldMask;
+    uint8_t ucTaskFieldMask;
+    uint32_t ulPhaseStart = ProfilerOverhead_Begin();
     
+    if (subscription == NULL) {
+        subscription = &xFullSubscription;
+    }
+    
+    /* Fields compiled out of this image are never reported */
+    ulFieldMask = subscription->fieldMask & REPORT_FIELD_ALL;
+    ucTaskFieldMask = (uint8_t)(subscription->taskFieldMask & TASK_FIELD_ALL);
+    if (ucTaskFieldMask == 0) {
+        ulFieldMask &= ~REPORT_FIELD_TASKS;
+    }
+    report->fieldMask = ulFieldMask;
+    report->taskFieldMask = ucTaskFieldMask;
+    report->taskCount = 0;
+    
+#if REPORT_FIELD_TIMESTAMP_ENABLED
     /* Get current timestamp */
     report->timestamp = xTaskGetTickCount();
+#endif
     
     /* Get heap statistics */
     report->heapFree = xPortGetFreeHeapSize();
     report->heapMin = xPortGetMinimumEverFreeHeapSize();
     report->fragPercent = CalculateHeapFragmentation();
     
-    /* Calculate CPU load */
-    report->cpuLoad = CalculateCPULoad();
+    /* Calculate CPU load (a sample with the task list walks anyway) */
+    report->cpuLoad = CalculateCPULoad((ulFieldMask & REPORT_FIELD_TASKS) ? 1 : 0);
     
-    /* Get number of tasks */
-    uxArraySize = uxTaskGetNumberOfTasks();
+    /* Energy estimate (integrated by ProfilerTask) */
+    if ((ulFieldMask & REPORT_FIELD_POWER) ||
+        ((ulFieldMask & REPORT_FIELD_TASKS) && (ucTaskFieldMask & TASK_FIELD_ENERGY))) {
+        EnergyModel_GetStats(&xEnergyStats);
+#if REPORT_FIELD_POWER_ENABLED
+        report->power.avgCurrentUA = xEnergyStats.fAvgCurrentUA;
+        report->power.energyUAh = xEnergyStats.fTotalEnergyUAh;
+        report->power.runTimeMs = xEnergyStats.ulRunTimeMs;
+        report->power.sleepTimeMs = xEnergyStats.ulSleepTimeMs;
+        report->power.stopTimeMs = xEnergyStats.ulStopTimeMs;
+#endif
+    }
     
-    /* Allocate array for task status */
-    pxTaskStatusArray = pvPortMalloc(uxArraySize * sizeof(TaskStatus_t));
+#if REPORT_FIELD_LINK_ENABLED
+    /* UART link counters */
+    if (ulFieldMask & REPORT_FIELD_LINK) {
+        TransportStats_t xLinkStats;
+        
+        Transport_GetStats(&xLinkStats);
+        report->link.baud = xLinkStats.ulBaudRate;
+        report->link.bytesPerSec = xLinkStats.ulBytesPerSec;
+        report->link.utilPct = xLinkStats.fUtilisationPct;
+        report->link.txErrors = xLinkStats.ulTxErrors;
+        report->link.rxErrors = xLinkStats.ulRxErrors;
+        report->link.fallbacks = xLinkStats.ulFallbacks;
+    }
+#endif
     
-    if (pxTaskStatusArray != NULL) {
-        /* Generate raw status information */
-        uxArraySize = uxTaskGetSystemState(pxTaskStatusArray, uxArraySize, &ulTotalRunTime);
+#if REPORT_FIELD_USER_ENABLED
+    /* Application instrumentation */
+    if (ulFieldMask & REPORT_FIELD_USER) {
+        Profiler_GetUserMetrics(&report->user);
+    }
+#endif
+    
+    /* Kernel object instrumentation */
+#if REPORT_FIELD_QUEUES_ENABLED
+    if (ulFieldMask & REPORT_FIELD_QUEUES) {
+        report->queueCount = QueueTrace_GetStats(report->queues, QUEUE_TRACE_MAX_OBJECTS);
+    }
+#endif
+    
+#if REPORT_FIELD_MUTEXES_ENABLED
+    if (ulFieldMask & REPORT_FIELD_MUTEXES) {
+        report->mutexCount = MutexTrace_GetStats(report->mutexes, MUTEX_TRACE_MAX_MUTEXES);
+    }
+#endif
+    
+#if REPORT_FIELD_POOLS_ENABLED
+    if (ulFieldMask & REPORT_FIELD_POOLS) {
+        PoolAlloc_GetStats(&report->pools);
+    }
+#endif
+    
+    ProfilerOverhead_End(OVERHEAD_COMPUTE, ulPhaseStart);
+    
+    /* Per-task statistics - skip the task walk when nobody subscribed */
+    if (ulFieldMask & REPORT_FIELD_TASKS) {
+        ulPhaseStart = ProfilerOverhead_Begin();
         
-        /* Calculate percentage for each task */
-        report->taskCount = (uxArraySize < MAX_TASKS) ? uxArraySize : MAX_TASKS;
+        /* Allocate array for task status */
+        pxTaskStatusArray = AcquireTaskStatusArray(&uxArraySize);
         
-        for (x = 0; x < report->taskCount; x++) {
-            /* Copy task name */
-            strncpy(report->tasks[x].taskName, pxTaskStatusArray[x].pcTaskName, 15);
-            report->tasks[x].taskName[15] = '\0';
-            
-            /* Calculate runtime percentage */
-            ulStatsAsPercentage = pxTaskStatusArray[x].ulRunTimeCounter / (ulTotalRunTime / 100);
+        if (pxTaskStatusArray != NULL) {
+            /* Generate raw status information */
+            uxArraySize = GetSystemState(pxTaskStatusArray, uxArraySize, &ulTotalRunTime);
+            UpdateRunTimeShadows(pxTaskStatusArray, uxArraySize, ulTotalRunTime);
             
-            if (ulStatsAsPercentage > 0UL) {
-                report->tasks[x].runtimePercent = (float)ulStatsAsPercentage;
-            } else {
-                report->tasks[x].runtimePercent = 0.01f;
+            for (x = 0; x < uxArraySize && report->taskCount < MAX_TASKS; x++) {
+                TaskStats_t *pxTask = &report->tasks[report->taskCount];
+                
+                if (!TaskMatchesFilter(subscription, pxTaskStatusArray[x].pcTaskName)) {
+                    continue;
+                }
+                report->taskCount++;
+                
+#if TASK_FIELD_NAME_ENABLED
+                /* Copy task name */
+                if (ucTaskFieldMask & TASK_FIELD_NAME) {
+                    strncpy(pxTask->taskName, pxTaskStatusArray[x].pcTaskName, REPORT_STRING_MAX);
+                    pxTask->taskName[REPORT_STRING_MAX] = '\0';
+                }
+#endif
+                
+#if TASK_FIELD_RUNTIME_ENABLED || TASK_FIELD_ENERGY_ENABLED
+                /* Calculate runtime percentage since boot */
+                if (ucTaskFieldMask & (TASK_FIELD_RUNTIME | TASK_FIELD_ENERGY)) {
+                    float fRuntime = 0.01f;
+                    
+                    if (ullTotalRunTime > 0) {
+                        float fPercent = 100.0f * (float)GetTaskRunTime(&pxTaskStatusArray[x]) /
+                                         (float)ullTotalRunTime;
+                        
+                        if (fPercent > 0.01f) {
+                            fRuntime = fPercent;
+                        }
+                    }
+#if TASK_FIELD_RUNTIME_ENABLED
+                    pxTask->runtimePercent = fRuntime;
+#endif
+#if TASK_FIELD_ENERGY_ENABLED
+                    /* Share of run-mode energy by runtime fraction */
+                    pxTask->energyUAh = xEnergyStats.fRunEnergyUAh * fRuntime / 100.0f;
+#endif
+                }
+#endif
+                
+#if TASK_FIELD_STACK_ENABLED
+                /* Get stack high water mark (free stack space) */
+                if (ucTaskFieldMask & TASK_FIELD_STACK) {
+                    pxTask->stackFree = pxTaskStatusArray[x].usStackHighWaterMark * sizeof(StackType_t);
+                }
+#endif
+                
+#if TASK_FIELD_STACK_GROWTH_ENABLED
+                /* Smoothed high water mark growth */
+                if (ucTaskFieldMask & TASK_FIELD_STACK_GROWTH) {
+#ifdef STACK_MONITOR_HOOKED
+                    pxTask->stackGrowth = StackMonitor_GetGrowth(pxTaskStatusArray[x].xHandle);
+#else
+                    pxTask->stackGrowth = 0;
+#endif
+                }
+#endif
             }
             
-            /* Get stack high water mark (free stack space) */
-            report->tasks[x].stackFree = pxTaskStatusArray[x].usStackHighWaterMark * sizeof(StackType_t);
+            ReleaseTaskStatusArray(pxTaskStatusArray);
         }
         
-        vPortFree(pxTaskStatusArray);
-    } else {
-        report->taskCount = 0;
+        ProfilerOverhead_End(OVERHEAD_SNAPSHOT, ulPhaseStart);
+    }
+    
+    ulPhaseStart = ProfilerOverhead_Begin();
+    
+#if REPORT_FIELD_TEMP_ENABLED || REPORT_FIELD_SUPPLY_ENABLED
+    /* Latest oversampled ADC readings, published by the DMA interrupt */
+    if (ulFieldMask & (REPORT_FIELD_TEMP | REPORT_FIELD_SUPPLY)) {
+        AnalogReadings_t xAnalog;
+        
+        AnalogMonitor_GetReadings(&xAnalog);
+#if REPORT_FIELD_TEMP_ENABLED
+        report->temperature = (float)xAnalog.tempCentiC / 100.0f;
+#endif
+#if REPORT_FIELD_SUPPLY_ENABLED
+        report->supply.vddaMv = (uint16_t)xAnalog.vddaMv;
+        report->supply.vbatMv = (uint16_t)xAnalog.vbatMv;
+#endif
+    }
+#endif
+    
+#if REPORT_FIELD_CLOCK_ENABLED
+    /* Frequency scaling statistics */
+    if (ulFieldMask & REPORT_FIELD_CLOCK) {
+        ClockGovernorStats_t xClockStats;
+        
+        ClockGovernor_GetStats(&xClockStats);
+        report->clock.freqHz = xClockStats.ulFrequencyHz;
+        report->clock.switchCount = xClockStats.ulSwitchCount;
+        memcpy(report->clock.residencyMs, xClockStats.ulResidencyMs, sizeof(report->clock.residencyMs));
+    }
+#endif
+    
+#if REPORT_FIELD_OVERHEAD_ENABLED
+    /* Profiler self-overhead, last closed window */
+    if (ulFieldMask & REPORT_FIELD_OVERHEAD) {
+        ProfilerOverhead_GetStats(&report->overhead);
     }
+#endif
     
-    /* Mock temperature reading (replace with actual sensor if available) */
-    report->temperature = 42.5f;
+    ProfilerOverhead_End(OVERHEAD_COMPUTE, ulPhaseStart);
     
-    /* Store in circular buffer */
-    memcpy(&statsBuffer[bufferIndex], report, sizeof(SystemReport_t));
+    /* Store the scalar fields in the history */
+    ulPhaseStart = ProfilerOverhead_Begin();
+    {
+        HistorySample_t *pxDst = &statsBuffer[bufferIndex];
+        const SystemReport_t *pxSrc = report;
+        
+        pxDst->fieldMask = ulFieldMask & HISTORY_FIELDS;
+        REPORT_APPLY(REPORT_SCHEMA_REPORT, HISTORY_COPY)
+    }
     bufferIndex = (bufferIndex + 1) % STATS_BUFFER_SIZE;
+    if (bufferCount < STATS_BUFFER_SIZE) {
+        bufferCount++;
+    }
+    ProfilerOverhead_End(OVERHEAD_STORE, ulPhaseStart);
 }
 
 /**
-  * @brief  Calculate CPU load percentage
+  * @brief  Calculate CPU load percentage with the configured estimator
+  * @note   The idle-count estimator falls back to runtime stats until its
+  *         boot calibration has completed. From OVERHEAD_LEVEL_REPORT_TASKS
+  *         on, samples without the task list do not walk it for the load
+  *         either: they use the idle count once calibrated, else the last
+  *         runtime-stats load, refreshed every reportEverySamples samples
+  * @param  fullSample: 1 if this sample walks the task list anyway
   * @retval CPU load as float (0.0 - 100.0)
   */
-float CalculateCPULoad(void)
+float CalculateCPULoad(uint8_t fullSample)
+{
+    CpuLoadMode_t eMode = xProfilerConfig.loadMode;
+    uint32_t ulStart, ulRuntimeCycles;
+    float fRuntimeLoad, fIdleLoad;
+    
+    if (eMode == CPU_LOAD_MODE_IDLE && IdleLoad_IsCalibrated()) {
+        return IdleLoad_GetLoad();
+    }
+    
+    if (eMode == CPU_LOAD_MODE_COMPARE && IdleLoad_IsCalibrated()) {
+        ulStart = DWT->CYCCNT;
+        fRuntimeLoad = CalculateRuntimeLoad();
+        ulRuntimeCycles = DWT->CYCCNT - ulStart;
+        
+        ulStart = DWT->CYCCNT;
+        fIdleLoad = IdleLoad_GetLoad();
+        IdleLoad_RecordComparison(fRuntimeLoad, fIdleLoad, ulRuntimeCycles, DWT->CYCCNT - ulStart);
+        return fRuntimeLoad;
+    }
+    
+    if (IdleLoad_IsCalibrated()) {
+        /* Keeps the idle window one sample long for the throttled path */
+        fIdleLoad = IdleLoad_GetLoad();
+        if (!fullSample && ProfilerOverhead_GetLevel() >= OVERHEAD_LEVEL_REPORT_TASKS) {
+            return fIdleLoad;
+        }
+    } else if (!fullSample && ProfilerOverhead_GetLevel() >= OVERHEAD_LEVEL_REPORT_TASKS &&
+               ++ulHeldLoadSamples < xProfilerConfig.reportEverySamples) {
+        return fLastRuntimeLoad;
+    }
+    
+    /* Runtime stats: the delta covers every sample since the last walk */
+    ulHeldLoadSamples = 0;
+    fLastRuntimeLoad = CalculateRuntimeLoad();
+    return fLastRuntimeLoad;
+}
+
+/**
+  * @brief  CPU load from the idle tasks' run-time counters
+  * @retval CPU load as float (0.0 - 100.0)
+  */
+static float CalculateRuntimeLoad(void)
 {
     TaskStatus_t *pxTaskStatusArray;
-    volatile UBaseType_t uxArraySize;
+    UBaseType_t uxArraySize;
     uint32_t ulTotalRunTime = 0;
-    uint32_t ulIdleRunTime = 0;
-    uint32_t ulDeltaTotal, ulDeltaIdle;
+    uint64_t ullIdleRunTime = 0;
+    uint64_t ullDeltaTotal, ullDeltaIdle;
     float cpuLoad = 0.0f;
     
-    /* Get number of tasks */
-    uxArraySize = uxTaskGetNumberOfTasks();
-    
     /* Allocate array */
-    pxTaskStatusArray = pvPortMalloc(uxArraySize * sizeof(TaskStatus_t));
+    pxTaskStatusArray = AcquireTaskStatusArray(&uxArraySize);
     
     if (pxTaskStatusArray != NULL) {
         /* Get system state */
-        uxArraySize = uxTaskGetSystemState(pxTaskStatusArray, uxArraySize, &ulTotalRunTime);
+        uxArraySize = GetSystemState(pxTaskStatusArray, uxArraySize, &ulTotalRunTime);
         
-        /* Find idle task runtime */
-        for (UBaseType_t x = 0; x < uxArraySize; x++) {
-            if (strcmp(pxTaskStatusArray[x].pcTaskName, "IDLE") == 0 ||
-                strcmp(pxTaskStatusArray[x].pcTaskName, "IdleMon") == 0) {
-                ulIdleRunTime += pxTaskStatusArray[x].ulRunTimeCounter;
+        if (uxArraySize > 0) {
+            UpdateRunTimeShadows(pxTaskStatusArray, uxArraySize, ulTotalRunTime);
+            
+            /* Find idle task runtime */
+            for (UBaseType_t x = 0; x < uxArraySize; x++) {
+                if (strcmp(pxTaskStatusArray[x].pcTaskName, "IDLE") == 0 ||
+                    strcmp(pxTaskStatusArray[x].pcTaskName, "IdleMon") == 0) {
+                    ullIdleRunTime += GetTaskRunTime(&pxTaskStatusArray[x]);
+                }
             }
+            
+            /* Calculate deltas */
+            ullDeltaTotal = ullTotalRunTime - ullLastTotalRunTime;
+            ullDeltaIdle = ullIdleRunTime - ullLastIdleRunTime;
+            
+            /* Calculate CPU load */
+            if (ullDeltaTotal > 0 && ullIdleRunTime >= ullLastIdleRunTime) {
+                cpuLoad = 100.0f * (1.0f - ((float)ullDeltaIdle / (float)ullDeltaTotal));
+            }
+            
+            /* Update last values */
+            ullLastTotalRunTime = ullTotalRunTime;
+            ullLastIdleRunTime = ullIdleRunTime;
         }
         
-        /* Calculate deltas */
-        ulDeltaTotal = ulTotalRunTime - ulLastTotalRunTime;
-        ulDeltaIdle = ulIdleRunTime - ulLastIdleRunTime;
-        
-        /* Calculate CPU load */
-        if (ulDeltaTotal > 0) {
-            cpuLoad = 100.0f * (1.0f - ((float)ulDeltaIdle / (float)ulDeltaTotal));
-        }
-        
-        /* Update last values */
-        ulLastTotalRunTime = ulTotalRunTime;
-        ulLastIdleRunTime = ulIdleRunTime;
-        
-        vPortFree(pxTaskStatusArray);
+        ReleaseTaskStatusArray(pxTaskStatusArray);
     }
     
     /* Clamp between 0 and 100 */
@@ -161,19 +451,224 @@ float CalculateHeapFragmentation(void)
 }
 
 /**
-  * @brief  Get statistics from circular buffer
+  * @brief  Get a sample from the history
+  * @note   Only the scalar top-level fields are kept; fieldMask says which
   * @param  index: Index in circular buffer (0 = most recent)
   * @param  report: Pointer to output report
   * @retval 1 if successful, 0 if invalid index
   */
 uint8_t GetBufferedStats(uint8_t index, SystemReport_t *report)
 {
-    if (index >= STATS_BUFFER_SIZE) {
+    if (index >= bufferCount) {
         return 0;
     }
     
     uint8_t actualIndex = (bufferIndex - 1 - index + STATS_BUFFER_SIZE) % STATS_BUFFER_SIZE;
-    memcpy(report, &statsBuffer[actualIndex], sizeof(SystemReport_t));
+    const HistorySample_t *pxSrc = &statsBuffer[actualIndex];
+    SystemReport_t *pxDst = report;
+    
+    memset(report, 0, sizeof(SystemReport_t));
+    report->fieldMask = pxSrc->fieldMask;
+    REPORT_APPLY(REPORT_SCHEMA_REPORT, HISTORY_COPY)
     
     return 1;
 }
+
+/**
+  * @brief  Get number of valid samples in circular buffer
+  * @retval Sample count (0 - STATS_BUFFER_SIZE)
+  */
+uint8_t GetBufferedStatsCount(void)
+{
+    return bufferCount;
+}
+
+/**
+  * @brief  Get runtime profiler configuration
+  * @retval Pointer to configuration structure
+  */
+ProfilerConfig_t* GetProfilerConfig(void)
+{
+    return &xProfilerConfig;
+}
+
+/**
+  * @brief  Check a task name against the subscription's task filter
+  * @param  subscription: Active subscription
+  * @param  pcTaskName: FreeRTOS task name
+  * @retval 1 if the task should be reported, 0 otherwise
+  */
+static uint8_t TaskMatchesFilter(const ReportSubscription_t *subscription, const char *pcTaskName)
+{
+    uint8_t count = subscription->taskFilterCount;
+    
+    if (count == 0) {
+        return 1;
+    }
+    
+    for (uint8_t i = 0; i < count && i < REPORT_TASK_FILTER_MAX; i++) {
+        if (strncmp(subscription->taskFilter[i], pcTaskName, configMAX_TASK_NAME_LEN) == 0) {
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+/**
+  * @brief  Get a TaskStatus_t array sized for every task in the system
+  * @note   The array (static builds) and the run-time shadows are shared by
+  *         ProfilerTask and GpioMonitorTask, so the scheduler stays
+  *         suspended until ReleaseTaskStatusArray()
+  * @param  puxArraySize: Output number of array entries
+  * @retval Array, or NULL if it cannot hold every task
+  */
+static TaskStatus_t *AcquireTaskStatusArray(UBaseType_t *puxArraySize)
+{
+#if PROFILER_STATIC_ALLOCATION
+    vTaskSuspendAll();
+    *puxArraySize = uxTaskGetNumberOfTasks();
+    if (*puxArraySize > MAX_TASKS) {
+        xTaskResumeAll();
+        return NULL;
+    }
+    return xTaskStatusArray;
+#else
+    TaskStatus_t *pxArray;
+    
+    *puxArraySize = uxTaskGetNumberOfTasks();
+    pxArray = pvPortMalloc(*puxArraySize * sizeof(TaskStatus_t));
+    if (pxArray != NULL) {
+        vTaskSuspendAll();
+    }
+    return pxArray;
+#endif
+}
+
+/**
+  * @brief  Release an array obtained from AcquireTaskStatusArray()
+  * @param  pxArray: Array to release
+  * @retval None
+  */
+static void ReleaseTaskStatusArray(TaskStatus_t *pxArray)
+{
+#if PROFILER_STATIC_ALLOCATION
+    (void)pxArray;
+    xTaskResumeAll();
+#else
+    xTaskResumeAll();
+    vPortFree(pxArray);
+#endif
+}
+
+/**
+  * @brief  Task snapshot without the kernel's per-task stack scan
+  * @note   Stack high water marks come from the stack monitor's cache. Falls
+  *         back to uxTaskGetSystemState() when the registry does not cover
+  *         every task (more than STACK_MONITOR_MAX_TASKS, or a deleted task
+  *         awaiting idle-task cleanup); tasks still on their first sweep get
+  *         the kernel's scan. Call with the scheduler suspended.
+  * @param  pxArray: Output array
+  * @param  uxArraySize: Entries in pxArray
+  * @param  pulTotalRunTime: Output total run time
+  * @retval Number of entries filled, 0 if pxArray is too small
+  */
+static UBaseType_t GetSystemState(TaskStatus_t *pxArray, UBaseType_t uxArraySize,
+                                  uint32_t *pulTotalRunTime)
+{
+#ifdef STACK_MONITOR_HOOKED
+    UBaseType_t uxCount = (UBaseType_t)StackMonitor_GetTaskCount();
+    uint32_t ulFreeWords;
+    
+    if (uxCount == uxTaskGetNumberOfTasks() && uxCount <= uxArraySize) {
+        for (UBaseType_t x = 0; x < uxCount; x++) {
+            TaskHandle_t xHandle = (TaskHandle_t)StackMonitor_GetTask(x);
+            
+            vTaskGetInfo(xHandle, &pxArray[x], pdFALSE, eInvalid);
+            if (!StackMonitor_GetFree(x, &ulFreeWords)) {
+                ulFreeWords = uxTaskGetStackHighWaterMark(xHandle);
+            }
+            pxArray[x].usStackHighWaterMark = (uint16_t)ulFreeWords;
+        }
+        *pulTotalRunTime = portGET_RUN_TIME_COUNTER_VALUE();
+        return uxCount;
+    }
+#endif
+    
+    return uxTaskGetSystemState(pxArray, uxArraySize, pulTotalRunTime);
+}
+
+/**
+  * @brief  Extend the 32-bit run-time counters of a task snapshot to 64 bits
+  * @note   Exact as long as some snapshot is taken at least once per counter
+  *         wrap period (49.7 days at the 1 kHz tick). Tasks that are gone
+  *         free their slot; tasks beyond MAX_TASKS keep their 32-bit value.
+  *         Call with the scheduler suspended.
+  * @param  pxTasks: Snapshot from uxTaskGetSystemState()
+  * @param  uxCount: Number of entries in the snapshot
+  * @param  ulTotalCounter: Total run time returned with the snapshot
+  * @retval None
+  */
+static void UpdateRunTimeShadows(const TaskStatus_t *pxTasks, UBaseType_t uxCount,
+                                 uint32_t ulTotalCounter)
+{
+    uint8_t ucSeen[MAX_TASKS] = {0};
+    
+    if (uxCount == 0) {
+        return;
+    }
+    
+    ullTotalRunTime += (uint32_t)(ulTotalCounter - ulLastTotalCounter);
+    ulLastTotalCounter = ulTotalCounter;
+    
+    for (UBaseType_t x = 0; x < uxCount; x++) {
+        int16_t sFree = -1;
+        uint8_t i;
+        
+        for (i = 0; i < MAX_TASKS; i++) {
+            if (xRunTimeShadows[i].uxTaskNumber == pxTasks[x].xTaskNumber) {
+                break;
+            }
+            if (sFree < 0 && xRunTimeShadows[i].uxTaskNumber == 0) {
+                sFree = i;
+            }
+        }
+        
+        if (i < MAX_TASKS) {
+            /* Unsigned difference: correct across one wrap */
+            xRunTimeShadows[i].ullRunTime +=
+                (uint32_t)(pxTasks[x].ulRunTimeCounter - xRunTimeShadows[i].ulLastCounter);
+        } else if (sFree >= 0) {
+            /* Created since the last snapshot: its counter started at 0 */
+            i = (uint8_t)sFree;
+            xRunTimeShadows[i].uxTaskNumber = pxTasks[x].xTaskNumber;
+            xRunTimeShadows[i].ullRunTime = pxTasks[x].ulRunTimeCounter;
+        } else {
+            continue;
+        }
+        xRunTimeShadows[i].ulLastCounter = pxTasks[x].ulRunTimeCounter;
+        ucSeen[i] = 1;
+    }
+    
+    for (uint8_t i = 0; i < MAX_TASKS; i++) {
+        if (!ucSeen[i]) {
+            xRunTimeShadows[i].uxTaskNumber = 0;
+        }
+    }
+}
+
+/**
+  * @brief  64-bit run time of a task from the last UpdateRunTimeShadows()
+  * @param  pxTask: Entry of the snapshot passed to UpdateRunTimeShadows()
+  * @retval Run time in run-time counter units
+  */
+static uint64_t GetTaskRunTime(const TaskStatus_t *pxTask)
+{
+    for (uint8_t i = 0; i < MAX_TASKS; i++) {
+        if (xRunTimeShadows[i].uxTaskNumber == pxTask->xTaskNumber) {
+            return xRunTimeShadows[i].ullRunTime;
+        }
+    }
+    
+    return pxTask->ulRunTimeCounter;
+}
@@ -3,35 +3,143 @@
   * @file    test_metrics.c
   * @brief   Test Metrics Implementation
   ******************************************************************************
+  * @attention
+  *
+  * Counters and maxima are single-word LDREX/STREX updates. Each sampled
+  * series has one writer, which keeps a private working state (64-bit sum,
+  * Welford mean/M2, window buckets) and after every sample publishes a copy
+  * into the inactive one of two banks before bumping the generation. A
+  * reader copies bank[gen & 1] and retries if gen moved, which can only
+  * happen when the writer ran in between and has already finished.
+  *
+  * Windows are built from second buckets: the 1 s window is the last
+  * completed second, the 1 min window merges six 10 s buckets and the 1 h
+  * window twelve 5 min buckets. They advance when the writer records, so a
+  * series that stops being recorded keeps its last windows.
+  *
+  ******************************************************************************
   */
 
 #include "test_metrics.h"
+#include "main.h"
+#include "task.h"
+#include "sizing_advisor.h"
+#include <math.h>
 #include <string.h>
-#include <stdio.h>
 
-/* Test metrics storage */
-static TestMetrics_t xTestMetrics = {0};
-static uint32_t ulStartTime = 0;
+#define TEN_SEC_BUCKETS           6
+#define FIVE_MIN_BUCKETS          12
+#define FIVE_MIN_S                300
+#define HOUR_S                    3600
+
+#define CPU_SCALE                 100     /* Recorded in 0.01% */
+#define FRAG_SCALE                100
+
+/* Integer aggregate of one bucket or window */
+typedef struct {
+    uint64_t sum;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+} Aggregate_t;
+
+/* What readers see of a series */
+typedef struct {
+    Aggregate_t total;
+    double mean;                          /* Welford */
+    double m2;
+    Aggregate_t window[TEST_WINDOW_COUNT];
+} SeriesState_t;
+
+/* Single-writer series */
+typedef struct {
+    SeriesState_t work;                   /* Writer only */
+    SeriesState_t bank[2];                /* bank[gen & 1] is published */
+    volatile uint32_t gen;
+    uint32_t resetGen;                    /* Last ulResetGen applied */
+    uint32_t second;                      /* Second the current bucket covers */
+    Aggregate_t secBucket;
+    Aggregate_t tenSecBucket;
+    Aggregate_t fiveMinBucket;
+    Aggregate_t tenSecRing[TEN_SEC_BUCKETS];
+    Aggregate_t fiveMinRing[FIVE_MIN_BUCKETS];
+    uint8_t tenSecIndex;
+    uint8_t fiveMinIndex;
+    uint32_t scale;                       /* Recorded units per reported unit */
+} Series_t;
+
+/* Sampled series */
+static Series_t xCpuSeries;
+static Series_t xLatencySeries;
+static Series_t xHeapSeries;
 
-/* For calculating running averages */
-static float fCpuLoadSum = 0.0f;
-static uint32_t ulHeapSum = 0;
-static uint32_t ulHeapSampleCount = 0;
+/* Multi-writer counters */
+static volatile uint32_t ulWatchdogFeeds = 0;
+static volatile uint32_t ulStackOverflows = 0;
+static volatile uint32_t ulMallocFailures = 0;
+static volatile uint32_t ulDeepSleepEntries = 0;
+static volatile uint32_t ulDeepSleepMs = 0;
+static volatile uint32_t ulLastWakeupLatencyMs = 0;
+static volatile uint32_t ulFragMax = 0;
+static volatile uint32_t ulWatchdogLoopMaxUs = 0;
+static volatile uint32_t ulWatchdogJitterMaxUs = 0;
+
+static uint64_t ullStartTick = 0;             /* 64-bit: written under a critical section */
+static volatile uint32_t ulResetGen = 0;
+static volatile uint8_t ucReportPending = 0;
+
+/* Private function prototypes */
+static void SeriesInit(Series_t *pxSeries, uint32_t ulScale);
+static void SeriesRecord(Series_t *pxSeries, uint32_t ulValue);
+static void SeriesClear(Series_t *pxSeries);
+static void SeriesRoll(Series_t *pxSeries, uint32_t ulNow);
+static void SeriesRead(const Series_t *pxSeries, TestMetricsSeries_t *pxOut);
+static void AggregateClear(Aggregate_t *pxAgg);
+static void AggregateMerge(Aggregate_t *pxInto, const Aggregate_t *pxFrom);
+static uint32_t CurrentSecond(void);
+static uint64_t TickCount64(void);
+static uint8_t HeapHasHeadroom(const TestMetricsSeries_t *pxHeap);
+static void AtomicAdd(volatile uint32_t *pulValue, uint32_t ulDelta);
+static void AtomicMax(volatile uint32_t *pulValue, uint32_t ulCandidate);
 
 /**
   * @brief  Initialize test metrics tracking
+  * @note   Before the scheduler starts; use TestMetrics_Reset() afterwards
   * @retval None
   */
 void TestMetrics_Init(void)
 {
-    memset(&xTestMetrics, 0, sizeof(TestMetrics_t));
-    ulStartTime = xTaskGetTickCount();
-    fCpuLoadSum = 0.0f;
-    ulHeapSum = 0;
-    ulHeapSampleCount = 0;
-    
-    xTestMetrics.irqToJsonMinLatency = 0xFFFFFFFF;
-    xTestMetrics.minHeapFree = 0xFFFFFFFF;
+    SeriesInit(&xCpuSeries, CPU_SCALE);
+    SeriesInit(&xLatencySeries, 1);
+    SeriesInit(&xHeapSeries, 1);
+    ulResetGen = 0;
+    TestMetrics_Reset();
+}
+
+/**
+  * @brief  Restart all metrics (task context)
+  * @note   Counters restart at once (a plain store also fails any LDREX/STREX
+  *         update it preempted); each series is cleared by its writer on
+  *         its next sample
+  * @retval None
+  */
+void TestMetrics_Reset(void)
+{
+    uint64_t ullNow = TickCount64();
+
+    AtomicAdd(&ulResetGen, 1);
+    taskENTER_CRITICAL();
+    ullStartTick = ullNow;
+    taskEXIT_CRITICAL();
+    ulWatchdogFeeds = 0;
+    ulStackOverflows = 0;
+    ulMallocFailures = 0;
+    ulDeepSleepEntries = 0;
+    ulDeepSleepMs = 0;
+    ulLastWakeupLatencyMs = 0;
+    ulFragMax = 0;
+    ulWatchdogLoopMaxUs = 0;
+    ulWatchdogJitterMaxUs = 0;
 }
 
 /**
@@ -41,17 +149,7 @@ void TestMetrics_Init(void)
   */
 void TestMetrics_RecordCpuLoad(float cpuLoad)
 {
-    xTestMetrics.profileCycleCount++;
-    fCpuLoadSum += cpuLoad;
-    xTestMetrics.avgCpuLoad = fCpuLoadSum / xTestMetrics.profileCycleCount;
-    
-    if (cpuLoad > xTestMetrics.maxCpuLoad) {
-        xTestMetrics.maxCpuLoad = cpuLoad;
-    }
-    
-    if (cpuLoad < xTestMetrics.minCpuLoad || xTestMetrics.minCpuLoad == 0.0f) {
-        xTestMetrics.minCpuLoad = cpuLoad;
-    }
+    SeriesRecord(&xCpuSeries, (cpuLoad > 0.0f) ? (uint32_t)(cpuLoad * CPU_SCALE + 0.5f) : 0);
 }
 
 /**
@@ -61,20 +159,7 @@ void TestMetrics_RecordCpuLoad(float cpuLoad)
   */
 void TestMetrics_RecordIrqToJsonLatency(uint32_t latencyMs)
 {
-    xTestMetrics.jsonTransmitCount++;
-    
-    if (latencyMs < xTestMetrics.irqToJsonMinLatency) {
-        xTestMetrics.irqToJsonMinLatency = latencyMs;
-    }
-    
-    if (latencyMs > xTestMetrics.irqToJsonMaxLatency) {
-        xTestMetrics.irqToJsonMaxLatency = latencyMs;
-    }
-    
-    /* Running average */
-    uint32_t oldAvg = xTestMetrics.irqToJsonAvgLatency;
-    xTestMetrics.irqToJsonAvgLatency = 
-        (oldAvg * (xTestMetrics.jsonTransmitCount - 1) + latencyMs) / xTestMetrics.jsonTransmitCount;
+    SeriesRecord(&xLatencySeries, latencyMs);
 }
 
 /**
@@ -85,17 +170,8 @@ void TestMetrics_RecordIrqToJsonLatency(uint32_t latencyMs)
   */
 void TestMetrics_RecordHeapStatus(uint32_t heapFree, float fragmentation)
 {
-    ulHeapSum += heapFree;
-    ulHeapSampleCount++;
-    xTestMetrics.avgHeapFree = ulHeapSum / ulHeapSampleCount;
-    
-    if (heapFree < xTestMetrics.minHeapFree) {
-        xTestMetrics.minHeapFree = heapFree;
-    }
-    
-    if (fragmentation > xTestMetrics.heapFragmentationMax) {
-        xTestMetrics.heapFragmentationMax = fragmentation;
-    }
+    SeriesRecord(&xHeapSeries, heapFree);
+    AtomicMax(&ulFragMax, (fragmentation > 0.0f) ? (uint32_t)(fragmentation * FRAG_SCALE + 0.5f) : 0);
 }
 
 /**
@@ -104,7 +180,7 @@ void TestMetrics_RecordHeapStatus(uint32_t heapFree, float fragmentation)
   */
 void TestMetrics_IncrementWatchdogFeed(void)
 {
-    xTestMetrics.watchdogFeedCount++;
+    AtomicAdd(&ulWatchdogFeeds, 1);
 }
 
 /**
@@ -113,7 +189,7 @@ void TestMetrics_IncrementWatchdogFeed(void)
   */
 void TestMetrics_IncrementStackOverflow(void)
 {
-    xTestMetrics.stackOverflowCount++;
+    AtomicAdd(&ulStackOverflows, 1);
 }
 
 /**
@@ -122,7 +198,7 @@ void TestMetrics_IncrementStackOverflow(void)
   */
 void TestMetrics_IncrementMallocFailure(void)
 {
-    xTestMetrics.mallocFailureCount++;
+    AtomicAdd(&ulMallocFailures, 1);
 }
 
 /**
@@ -133,22 +209,74 @@ void TestMetrics_IncrementMallocFailure(void)
   */
 void TestMetrics_RecordDeepSleep(uint32_t durationMs, uint32_t wakeupLatencyMs)
 {
-    xTestMetrics.deepSleepEntryCount++;
-    xTestMetrics.totalDeepSleepMs += durationMs;
-    xTestMetrics.lastWakeupLatencyMs = wakeupLatencyMs;
+    AtomicAdd(&ulDeepSleepEntries, 1);
+    AtomicAdd(&ulDeepSleepMs, durationMs);
+    ulLastWakeupLatencyMs = wakeupLatencyMs;
 }
 
 /**
-  * @brief  Get current metrics
-  * @retval Pointer to test metrics structure
+  * @brief  Record the watchdog task's timing for one period
+  * @param  loopUs: Time from wake-up to the end of the loop body
+  * @param  jitterUs: Deviation of the wake-up interval from its nominal period
+  * @retval None
+  */
+void TestMetrics_RecordWatchdogTiming(uint32_t loopUs, uint32_t jitterUs)
+{
+    AtomicMax(&ulWatchdogLoopMaxUs, loopUs);
+    AtomicMax(&ulWatchdogJitterMaxUs, jitterUs);
+}
+
+/**
+  * @brief  Take a consistent copy of every metric (task context)
+  * @note   The uptime read uses a critical section and the kernel's
+  *         overflow count; ISRs call TestMetrics_RequestReport() instead
+  * @param  metrics: Output snapshot
+  * @retval None
+  */
+void TestMetrics_Snapshot(TestMetrics_t *metrics)
+{
+    SeriesRead(&xCpuSeries, &metrics->cpuLoad);
+    SeriesRead(&xLatencySeries, &metrics->latency);
+    SeriesRead(&xHeapSeries, &metrics->heapFree);
+    metrics->heapFragmentationMax = (float)ulFragMax / FRAG_SCALE;
+
+    metrics->uptimeSeconds = TestMetrics_GetUptimeSeconds();
+    metrics->watchdogFeedCount = ulWatchdogFeeds;
+    metrics->stackOverflowCount = ulStackOverflows;
+    metrics->mallocFailureCount = ulMallocFailures;
+    metrics->watchdogLoopMaxUs = ulWatchdogLoopMaxUs;
+    metrics->watchdogJitterMaxUs = ulWatchdogJitterMaxUs;
+
+    metrics->deepSleepEntryCount = ulDeepSleepEntries;
+    metrics->totalDeepSleepMs = ulDeepSleepMs;
+    metrics->lastWakeupLatencyMs = ulLastWakeupLatencyMs;
+}
+
+/**
+  * @brief  Ask the report task to serialize the metrics
+  * @note   Only sets a flag, so callers of any priority (the watchdog
+  *         task) return at once; the snapshot is taken by the serializer
+  * @retval None
   */
-TestMetrics_t* TestMetrics_GetMetrics(void)
+void TestMetrics_RequestReport(void)
 {
-    /* Update uptime */
-    uint32_t ulCurrentTick = xTaskGetTickCount();
-    xTestMetrics.uptimeSeconds = (ulCurrentTick - ulStartTime) / 1000;
-    
-    return &xTestMetrics;
+    ucReportPending = 1;
+}
+
+/**
+  * @brief  Take the requested snapshot, if any (report task)
+  * @param  snapshot: Output copy
+  * @retval 1 if a report was requested
+  */
+uint8_t TestMetrics_GetReport(TestMetrics_t *snapshot)
+{
+    if (!ucReportPending) {
+        return 0;
+    }
+
+    ucReportPending = 0;
+    TestMetrics_Snapshot(snapshot);
+    return 1;
 }
 
 /**
@@ -157,7 +285,10 @@ TestMetrics_t* TestMetrics_GetMetrics(void)
   */
 float TestMetrics_GetAverageCpuLoad(void)
 {
-    return xTestMetrics.avgCpuLoad;
+    TestMetricsSeries_t xCpu;
+
+    SeriesRead(&xCpuSeries, &xCpu);
+    return xCpu.mean;
 }
 
 /**
@@ -166,8 +297,38 @@ float TestMetrics_GetAverageCpuLoad(void)
   */
 uint32_t TestMetrics_GetUptimeSeconds(void)
 {
-    uint32_t ulCurrentTick = xTaskGetTickCount();
-    return (ulCurrentTick - ulStartTime) / 1000;
+    uint64_t ullStart;
+
+    taskENTER_CRITICAL();
+    ullStart = ullStartTick;
+    taskEXIT_CRITICAL();
+
+    return (uint32_t)((TickCount64() - ullStart) / configTICK_RATE_HZ);
+}
+
+/**
+  * @brief  Evaluate the pass/fail checks on a set of metrics
+  * @param  metrics: Snapshot
+  * @retval Bitmask of TEST_CHECK_x that pass
+  */
+uint8_t TestMetrics_EvaluateChecks(const TestMetrics_t *metrics)
+{
+    uint8_t checks = 0;
+
+    if (metrics->cpuLoad.mean < 5.0f) {
+        checks |= TEST_CHECK_CPU;
+    }
+    if (metrics->latency.max < 10.0f) {
+        checks |= TEST_CHECK_LATENCY;
+    }
+    if (HeapHasHeadroom(&metrics->heapFree)) {
+        checks |= TEST_CHECK_HEAP;
+    }
+    if (metrics->deepSleepEntryCount > 0) {
+        checks |= TEST_CHECK_POWER;
+    }
+
+    return checks;
 }
 
 /**
@@ -176,19 +337,19 @@ uint32_t TestMetrics_GetUptimeSeconds(void)
   */
 uint8_t TestMetrics_IsCpuOverheadAcceptable(void)
 {
-    return (xTestMetrics.avgCpuLoad < 5.0f) ? 1 : 0;
+    return (TestMetrics_GetAverageCpuLoad() < 5.0f) ? 1 : 0;
 }
 
 /**
-  * @brief  Check if heap is healthy (>90% free)
+  * @brief  Check if heap is healthy (headroom above the sizing margin)
   * @retval 1 if healthy, 0 if not
   */
 uint8_t TestMetrics_IsHeapHealthy(void)
 {
-    /* Assume total heap is 15KB for STM32 */
-    uint32_t totalHeap = 15360;
-    uint32_t freePercentage = (xTestMetrics.avgHeapFree * 100) / totalHeap;
-    return (freePercentage > 90) ? 1 : 0;
+    TestMetricsSeries_t xHeap;
+
+    SeriesRead(&xHeapSeries, &xHeap);
+    return HeapHasHeadroom(&xHeap);
 }
 
 /**
@@ -197,7 +358,10 @@ uint8_t TestMetrics_IsHeapHealthy(void)
   */
 uint8_t TestMetrics_IsLatencyAcceptable(void)
 {
-    return (xTestMetrics.irqToJsonMaxLatency < 10) ? 1 : 0;
+    TestMetricsSeries_t xLatency;
+
+    SeriesRead(&xLatencySeries, &xLatency);
+    return (xLatency.max < 10.0f) ? 1 : 0;
 }
 
 /**
@@ -206,83 +370,321 @@ uint8_t TestMetrics_IsLatencyAcceptable(void)
   */
 uint8_t TestMetrics_IsPowerConsumptionOk(void)
 {
-    return (xTestMetrics.deepSleepEntryCount > 0) ? 1 : 0;
+    return (ulDeepSleepEntries > 0) ? 1 : 0;
+}
+
+/**
+  * @brief  Set up an empty series
+  * @param  pxSeries: Series
+  * @param  ulScale: Recorded units per reported unit
+  * @retval None
+  */
+static void SeriesInit(Series_t *pxSeries, uint32_t ulScale)
+{
+    memset(pxSeries, 0, sizeof(Series_t));
+    pxSeries->scale = ulScale;
+    SeriesClear(pxSeries);
+    pxSeries->bank[0] = pxSeries->work;
+    pxSeries->bank[1] = pxSeries->work;
+}
+
+/**
+  * @brief  Add a sample and publish the new state (series writer only)
+  * @param  pxSeries: Series
+  * @param  ulValue: Sample in recorded units
+  * @retval None
+  */
+static void SeriesRecord(Series_t *pxSeries, uint32_t ulValue)
+{
+    SeriesState_t *pxWork = &pxSeries->work;
+    uint32_t ulReset = ulResetGen;
+    uint32_t ulNow = CurrentSecond();
+    double dDelta;
+
+    if (pxSeries->resetGen != ulReset) {
+        pxSeries->resetGen = ulReset;
+        SeriesClear(pxSeries);
+    }
+    if (ulNow != pxSeries->second) {
+        SeriesRoll(pxSeries, ulNow);
+    }
+
+    /* Cumulative: exact 64-bit sum, Welford for the variance */
+    pxWork->total.count++;
+    pxWork->total.sum += ulValue;
+    if (ulValue < pxWork->total.min) {
+        pxWork->total.min = ulValue;
+    }
+    if (ulValue > pxWork->total.max) {
+        pxWork->total.max = ulValue;
+    }
+    dDelta = (double)ulValue - pxWork->mean;
+    pxWork->mean += dDelta / pxWork->total.count;
+    pxWork->m2 += dDelta * ((double)ulValue - pxWork->mean);
+
+    pxSeries->secBucket.count++;
+    pxSeries->secBucket.sum += ulValue;
+    if (ulValue < pxSeries->secBucket.min) {
+        pxSeries->secBucket.min = ulValue;
+    }
+    if (ulValue > pxSeries->secBucket.max) {
+        pxSeries->secBucket.max = ulValue;
+    }
+
+    /* Publish into the bank readers are not using */
+    pxSeries->bank[(pxSeries->gen + 1) & 1] = *pxWork;
+    __DMB();
+    pxSeries->gen++;
+}
+
+/**
+  * @brief  Drop all samples and windows (series writer only)
+  * @param  pxSeries: Series
+  * @retval None
+  */
+static void SeriesClear(Series_t *pxSeries)
+{
+    AggregateClear(&pxSeries->work.total);
+    pxSeries->work.mean = 0.0;
+    pxSeries->work.m2 = 0.0;
+    for (uint8_t i = 0; i < TEST_WINDOW_COUNT; i++) {
+        AggregateClear(&pxSeries->work.window[i]);
+    }
+
+    AggregateClear(&pxSeries->secBucket);
+    AggregateClear(&pxSeries->tenSecBucket);
+    AggregateClear(&pxSeries->fiveMinBucket);
+    for (uint8_t i = 0; i < TEN_SEC_BUCKETS; i++) {
+        AggregateClear(&pxSeries->tenSecRing[i]);
+    }
+    for (uint8_t i = 0; i < FIVE_MIN_BUCKETS; i++) {
+        AggregateClear(&pxSeries->fiveMinRing[i]);
+    }
+    pxSeries->tenSecIndex = 0;
+    pxSeries->fiveMinIndex = 0;
+    pxSeries->second = CurrentSecond();
 }
 
 /**
-  * @brief  Print comprehensive test report
+  * @brief  Close every second up to ulNow and cascade into the windows
+  * @note   Only the first second of a gap holds samples, so the rest is
+  *         crossed boundary by boundary: at most TEN_SEC_BUCKETS ten-second
+  *         steps, then five-minute steps, never one per second
+  * @param  pxSeries: Series
+  * @param  ulNow: Current second
   * @retval None
   */
-void TestMetrics_PrintReport(void)
-{
-    char buffer[512];
-    int len;
-    
-    extern UART_HandleTypeDef huart2;
-    
-    len = snprintf(buffer, sizeof(buffer), 
-        "\r\n========== TEST METRICS REPORT ==========\r\n");
-    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, len, 1000);
-    
-    /* CPU Metrics */
-    len = snprintf(buffer, sizeof(buffer),
-        "CPU Load (avg/min/max): %.1f%% / %.1f%% / %.1f%%\r\n"
-        "CPU Overhead Check: %s\r\n",
-        xTestMetrics.avgCpuLoad, xTestMetrics.minCpuLoad, xTestMetrics.maxCpuLoad,
-        TestMetrics_IsCpuOverheadAcceptable() ? "PASS (<5%)" : "FAIL (>5%)");
-    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
-    
-    /* Latency Metrics */
-    len = snprintf(buffer, sizeof(buffer),
-        "IRQ→JSON Latency (min/avg/max): %lu/%lu/%lu ms\r\n"
-        "Latency Check: %s\r\n",
-        xTestMetrics.irqToJsonMinLatency, xTestMetrics.irqToJsonAvgLatency, xTestMetrics.irqToJsonMaxLatency,
-        TestMetrics_IsLatencyAcceptable() ? "PASS (<10ms)" : "FAIL (>10ms)");
-    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
-    
-    /* Heap Metrics */
-    len = snprintf(buffer, sizeof(buffer),
-        "Heap (avg free/min free): %lu / %lu bytes\r\n"
-        "Max Fragmentation: %.1f%%\r\n"
-        "Heap Health Check: %s\r\n",
-        xTestMetrics.avgHeapFree, xTestMetrics.minHeapFree,
-        xTestMetrics.heapFragmentationMax,
-        TestMetrics_IsHeapHealthy() ? "PASS (>90% free)" : "FAIL (<90% free)");
-    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
-    
-    /* Stability Metrics */
-    len = snprintf(buffer, sizeof(buffer),
-        "Uptime: %lu seconds (%lu hours)\r\n"
-        "Watchdog Feeds: %lu\r\n"
-        "Stack Overflows: %lu\r\n"
-        "Malloc Failures: %lu\r\n",
-        xTestMetrics.uptimeSeconds, xTestMetrics.uptimeSeconds / 3600,
-        xTestMetrics.watchdogFeedCount,
-        xTestMetrics.stackOverflowCount,
-        xTestMetrics.mallocFailureCount);
-    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
-    
-    /* Sleep Metrics */
-    len = snprintf(buffer, sizeof(buffer),
-        "Deep Sleep Entries: %lu\r\n"
-        "Total Sleep Time: %lu ms\r\n"
-        "Last Wake Latency: %lu ms\r\n"
-        "Power Check: %s\r\n",
-        xTestMetrics.deepSleepEntryCount,
-        xTestMetrics.totalDeepSleepMs,
-        xTestMetrics.lastWakeupLatencyMs,
-        TestMetrics_IsPowerConsumptionOk() ? "PASS (deep sleep active)" : "NOTE (no deep sleep yet)");
-    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
-    
-    /* Summary */
-    uint8_t passCount = TestMetrics_IsCpuOverheadAcceptable() + 
-                       TestMetrics_IsLatencyAcceptable() + 
-                       TestMetrics_IsHeapHealthy() + 
-                       TestMetrics_IsPowerConsumptionOk();
-    
-    len = snprintf(buffer, sizeof(buffer),
-        "\nTest Results: %d/4 PASS\r\n"
-        "========================================\r\n",
-        passCount);
-    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+static void SeriesRoll(Series_t *pxSeries, uint32_t ulNow)
+{
+    uint32_t ulEmptyTenSec = 0;
+    uint32_t ulStep;
+
+    /* Nothing recorded for an hour (or the tick wrapped): all windows are empty */
+    if (ulNow - pxSeries->second > HOUR_S) {
+        Aggregate_t xTotal = pxSeries->work.total;
+        double dMean = pxSeries->work.mean;
+        double dM2 = pxSeries->work.m2;
+
+        SeriesClear(pxSeries);
+        pxSeries->work.total = xTotal;
+        pxSeries->work.mean = dMean;
+        pxSeries->work.m2 = dM2;
+        pxSeries->second = ulNow;
+        return;
+    }
+
+    while (pxSeries->second != ulNow) {
+        pxSeries->work.window[TEST_WINDOW_1S] = pxSeries->secBucket;
+        AggregateMerge(&pxSeries->tenSecBucket, &pxSeries->secBucket);
+        AggregateClear(&pxSeries->secBucket);
+
+        /* Next boundary that changes a window: ten seconds until the minute
+         * ring holds nothing, then five minutes */
+        if (ulEmptyTenSec < TEN_SEC_BUCKETS) {
+            ulStep = 10 - pxSeries->second % 10;
+        } else {
+            ulStep = FIVE_MIN_S - pxSeries->second % FIVE_MIN_S;
+        }
+        if (ulStep > ulNow - pxSeries->second) {
+            ulStep = ulNow - pxSeries->second;
+        }
+        if (ulStep > 1) {
+            AggregateClear(&pxSeries->work.window[TEST_WINDOW_1S]);
+        }
+        pxSeries->second += ulStep;
+
+        if (pxSeries->second % 10 == 0) {
+            ulEmptyTenSec = (pxSeries->tenSecBucket.count == 0) ? ulEmptyTenSec + 1 : 0;
+            pxSeries->tenSecRing[pxSeries->tenSecIndex] = pxSeries->tenSecBucket;
+            pxSeries->tenSecIndex = (pxSeries->tenSecIndex + 1) % TEN_SEC_BUCKETS;
+            AggregateMerge(&pxSeries->fiveMinBucket, &pxSeries->tenSecBucket);
+            AggregateClear(&pxSeries->tenSecBucket);
+
+            AggregateClear(&pxSeries->work.window[TEST_WINDOW_1MIN]);
+            for (uint8_t i = 0; i < TEN_SEC_BUCKETS; i++) {
+                AggregateMerge(&pxSeries->work.window[TEST_WINDOW_1MIN], &pxSeries->tenSecRing[i]);
+            }
+        }
+
+        if (pxSeries->second % FIVE_MIN_S == 0) {
+            pxSeries->fiveMinRing[pxSeries->fiveMinIndex] = pxSeries->fiveMinBucket;
+            pxSeries->fiveMinIndex = (pxSeries->fiveMinIndex + 1) % FIVE_MIN_BUCKETS;
+            AggregateClear(&pxSeries->fiveMinBucket);
+
+            AggregateClear(&pxSeries->work.window[TEST_WINDOW_1H]);
+            for (uint8_t i = 0; i < FIVE_MIN_BUCKETS; i++) {
+                AggregateMerge(&pxSeries->work.window[TEST_WINDOW_1H], &pxSeries->fiveMinRing[i]);
+            }
+        }
+    }
 }
+
+/**
+  * @brief  Copy a series' published state and convert it to report units
+  * @param  pxSeries: Series
+  * @param  pxOut: Output
+  * @retval None
+  */
+static void SeriesRead(const Series_t *pxSeries, TestMetricsSeries_t *pxOut)
+{
+    SeriesState_t xState;
+    uint32_t ulGen;
+    float fScale = (float)pxSeries->scale;
+
+    do {
+        ulGen = pxSeries->gen;
+        __DMB();
+        xState = pxSeries->bank[ulGen & 1];
+        __DMB();
+    } while (ulGen != pxSeries->gen);
+
+    pxOut->count = xState.total.count;
+    if (xState.total.count > 0) {
+        pxOut->mean = (float)((double)xState.total.sum / xState.total.count) / fScale;
+        pxOut->stddev = sqrtf((float)(xState.m2 / xState.total.count)) / fScale;
+        pxOut->min = xState.total.min / fScale;
+        pxOut->max = xState.total.max / fScale;
+    } else {
+        pxOut->mean = pxOut->stddev = pxOut->min = pxOut->max = 0.0f;
+    }
+
+    for (uint8_t i = 0; i < TEST_WINDOW_COUNT; i++) {
+        const Aggregate_t *pxAgg = &xState.window[i];
+        TestMetricsWindow_t *pxWindow = &pxOut->window[i];
+
+        pxWindow->count = pxAgg->count;
+        if (pxAgg->count > 0) {
+            pxWindow->mean = (float)((double)pxAgg->sum / pxAgg->count) / fScale;
+            pxWindow->min = pxAgg->min / fScale;
+            pxWindow->max = pxAgg->max / fScale;
+        } else {
+            pxWindow->mean = pxWindow->min = pxWindow->max = 0.0f;
+        }
+    }
+}
+
+/**
+  * @brief  Empty an aggregate
+  * @retval None
+  */
+static void AggregateClear(Aggregate_t *pxAgg)
+{
+    pxAgg->sum = 0;
+    pxAgg->count = 0;
+    pxAgg->min = 0xFFFFFFFF;
+    pxAgg->max = 0;
+}
+
+/**
+  * @brief  Fold one aggregate into another
+  * @retval None
+  */
+static void AggregateMerge(Aggregate_t *pxInto, const Aggregate_t *pxFrom)
+{
+    if (pxFrom->count == 0) {
+        return;
+    }
+
+    pxInto->sum += pxFrom->sum;
+    pxInto->count += pxFrom->count;
+    if (pxFrom->min < pxInto->min) {
+        pxInto->min = pxFrom->min;
+    }
+    if (pxFrom->max > pxInto->max) {
+        pxInto->max = pxFrom->max;
+    }
+}
+
+/**
+  * @brief  Seconds since boot
+  * @note   xTaskGetTickCount() is a single load on this port, safe from ISRs
+  * @retval Second index
+  */
+static uint32_t CurrentSecond(void)
+{
+    return xTaskGetTickCount() / configTICK_RATE_HZ;
+}
+
+/**
+  * @brief  Tick count extended with the kernel's own overflow count
+  * @note   Task context (or before the scheduler starts); never wraps
+  * @retval Ticks since the tick counter's start value
+  */
+static uint64_t TickCount64(void)
+{
+    TimeOut_t xNow;
+
+    vTaskSetTimeOutState(&xNow);
+    return ((uint64_t)(uint32_t)xNow.xOverflowCount << 32) | xNow.xTimeOnEntering;
+}
+
+/**
+  * @brief  Heap check shared by the snapshot and the live query
+  * @note   Judged against the peak in use rather than configTOTAL_HEAP_SIZE,
+  *         so a heap sized by the sizing advisor passes
+  * @param  pxHeap: Free heap series
+  * @retval 1 if the lowest free heap is at least SIZING_HEAP_MARGIN_PCT of
+  *         the peak in use
+  */
+static uint8_t HeapHasHeadroom(const TestMetricsSeries_t *pxHeap)
+{
+    float fPeakUsed = (float)configTOTAL_HEAP_SIZE - pxHeap->min;
+
+    return (pxHeap->count > 0 &&
+            pxHeap->min * 100.0f >= fPeakUsed * (float)SIZING_HEAP_MARGIN_PCT) ? 1 : 0;
+}
+
+/**
+  * @brief  Lock-free add
+  * @param  pulValue: Word to update
+  * @param  ulDelta: Amount to add
+  * @retval None
+  */
+static void AtomicAdd(volatile uint32_t *pulValue, uint32_t ulDelta)
+{
+    uint32_t ulOld;
+
+    do {
+        ulOld = __LDREXW(pulValue);
+    } while (__STREXW(ulOld + ulDelta, pulValue) != 0);
+}
+
+/**
+  * @brief  Lock-free maximum
+  * @param  pulValue: Word to update
+  * @param  ulCandidate: New sample
+  * @retval None
+  */
+static void AtomicMax(volatile uint32_t *pulValue, uint32_t ulCandidate)
+{
+    uint32_t ulOld;
+
+    do {
+        ulOld = __LDREXW(pulValue);
+        if (ulCandidate <= ulOld) {
+            __CLREX();
+            return;
+        }
+    } while (__STREXW(ulCandidate, pulValue) != 0);
+}
+
@@ -0,0 +1,404 @@
+/**
+  ******************************************************************************
+  * @file    uart_transport.c
+  * @brief   UART Transport Layer Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * All USART2 output goes through Transport_Write() so the link counters
+  * see every byte. Baud negotiation is host driven over the command channel:
+  *
+  *   host -> "baud 921600"        (at the current rate)
+  *   dev  -> "OK"                 (at the current rate, then switches)
+  *   host -> "ping"               (at the new rate, within
+  *                                 TRANSPORT_CONFIRM_TIMEOUT_MS)
+  *   dev  -> "pong"               (rate confirmed)
+  *
+  * Without a valid command at the new rate the device reverts to the
+  * previous rate. A burst of RX errors at a non-default rate, or a clock
+  * change that makes the rate unachievable, falls back to
+  * TRANSPORT_DEFAULT_BAUD.
+  *
+  * Task-context writes are serialized by the "UartTx" mutex, so a report
+  * frame is never interleaved with a command reply. ISRs, kernel hooks and
+  * code running before the scheduler, with it suspended or with interrupts
+  * masked write unlocked: a mutex wait there could never end.
+  *
+  ******************************************************************************
+  */
+
+#include "uart_transport.h"
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* Upper bound on the TX drain wait before a rate change */
+#define TX_DRAIN_TIMEOUT_LOOPS    100000
+
+/* Rates offered to the host */
+static const uint32_t ulSupportedBauds[] = {
+    115200, 230400, 460800, 921600, 1000000, 2000000
+};
+
+/* External variables */
+extern UART_HandleTypeDef huart2;
+
+/* Static variables */
+static uint32_t ulCurrentBaud = TRANSPORT_DEFAULT_BAUD;
+static uint32_t ulPreviousBaud = TRANSPORT_DEFAULT_BAUD;
+static uint8_t ucConfirmPending = 0;
+static TickType_t xSwitchTick = 0;
+static SemaphoreHandle_t xTxMutex = NULL;
+static uint8_t ucSuspended = 0;
+
+static volatile uint32_t ulBytesSent = 0;
+static volatile uint32_t ulFramesSent = 0;
+static volatile uint32_t ulTxErrors = 0;
+static volatile uint32_t ulRxErrors = 0;
+static uint32_t ulFallbacks = 0;
+
+/* RX error window (Transport_Poll) */
+static TickType_t xErrorWindowStart = 0;
+static uint32_t ulErrorWindowBase = 0;
+
+/* Throughput window (Transport_GetStats) */
+static TickType_t xRateWindowStart = 0;
+static uint32_t ulRateWindowBytes = 0;
+static uint32_t ulBytesPerSec = 0;
+
+/* Private function prototypes */
+static uint8_t ComputeDivider(uint32_t pclkHz, uint32_t baud, uint32_t *brr, uint8_t *over8);
+static void ApplyBaud(uint32_t baud);
+static void WaitTxIdle(void);
+static void Fallback(uint32_t baud);
+
+/**
+  * @brief  Initialize transport at the default rate
+  * @retval None
+  */
+void Transport_Init(void)
+{
+    ulCurrentBaud = TRANSPORT_DEFAULT_BAUD;
+    ulPreviousBaud = TRANSPORT_DEFAULT_BAUD;
+    ucConfirmPending = 0;
+
+    if (xTxMutex == NULL) {
+#if PROFILER_STATIC_ALLOCATION
+        static StaticSemaphore_t xTxMutexBuffer;
+        xTxMutex = xSemaphoreCreateMutexStatic(&xTxMutexBuffer);
+#else
+        xTxMutex = xSemaphoreCreateMutex();
+#endif
+        if (xTxMutex == NULL) {
+            Error_Handler();
+        }
+        vQueueAddToRegistry(xTxMutex, "UartTx");
+    }
+
+    xErrorWindowStart = xTaskGetTickCount();
+    xRateWindowStart = xErrorWindowStart;
+}
+
+/**
+  * @brief  Blocking write to USART2 with link accounting
+  * @param  data: Bytes to send
+  * @param  length: Number of bytes
+  * @param  timeout: Timeout in milliseconds, applied to the mutex wait and
+  *         to the transmission
+  * @retval HAL status, HAL_BUSY if another task kept the link for timeout
+  */
+HAL_StatusTypeDef Transport_Write(const uint8_t *data, uint16_t length, uint32_t timeout)
+{
+    HAL_StatusTypeDef status = HAL_BUSY;
+    uint8_t ucShared = (__get_IPSR() == 0) && (__get_PRIMASK() == 0) && (xTxMutex != NULL) &&
+                       (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING);
+    TickType_t xWait = (timeout == HAL_MAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeout);
+    uint32_t ulPrimask;
+
+    if (!ucShared) {
+        status = HAL_UART_Transmit(&huart2, (uint8_t*)data, length, timeout);
+    } else if (xSemaphoreTake(xTxMutex, xWait) == pdTRUE) {
+        status = HAL_UART_Transmit(&huart2, (uint8_t*)data, length, timeout);
+        xSemaphoreGive(xTxMutex);
+    }
+    ulPrimask = __get_PRIMASK();
+
+    /* Also called from hooks in ISR context - mask briefly instead of locking */
+    __disable_irq();
+    if (status == HAL_OK) {
+        ulBytesSent += length;
+        ulFramesSent++;
+    } else {
+        ulTxErrors++;
+    }
+    __set_PRIMASK(ulPrimask);
+
+    return status;
+}
+
+/**
+  * @brief  Take the link and stop USART2 before a power-down
+  * @note   Task context, interrupts enabled: waits for a write in progress
+  *         to finish. Task writes then wait for Transport_Resume(); writes
+  *         with interrupts masked go out polled and fail on the stopped UART
+  * @retval None
+  */
+void Transport_Suspend(void)
+{
+    if (xTxMutex != NULL && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+        ucSuspended = (xSemaphoreTake(xTxMutex, portMAX_DELAY) == pdTRUE);
+    }
+    HAL_UART_DeInit(&huart2);
+}
+
+/**
+  * @brief  Release the link taken by Transport_Suspend()
+  * @note   Same task, after USART2 has been initialised again
+  * @retval None
+  */
+void Transport_Resume(void)
+{
+    if (ucSuspended) {
+        ucSuspended = 0;
+        xSemaphoreGive(xTxMutex);
+    }
+}
+
+/**
+  * @brief  Check whether a rate is offered and achievable at the current clock
+  * @param  baud: Requested baud rate
+  * @retval 1 if supported, 0 if not
+  */
+uint8_t Transport_IsBaudSupported(uint32_t baud)
+{
+    uint32_t brr;
+    uint8_t over8;
+
+    for (uint8_t i = 0; i < sizeof(ulSupportedBauds) / sizeof(ulSupportedBauds[0]); i++) {
+        if (ulSupportedBauds[i] == baud) {
+            return ComputeDivider(HAL_RCC_GetPCLK1Freq(), baud, &brr, &over8);
+        }
+    }
+
+    return 0;
+}
+
+/**
+  * @brief  Check whether the active rate survives a change of APB1 clock
+  * @param  pclkHz: Prospective PCLK1 frequency
+  * @retval 1 if the active rate stays within tolerance, 0 if not
+  */
+uint8_t Transport_IsClockSupported(uint32_t pclkHz)
+{
+    uint32_t brr;
+    uint8_t over8;
+
+    return ComputeDivider(pclkHz, ulCurrentBaud, &brr, &over8);
+}
+
+/**
+  * @brief  Switch to a new rate and wait for the host to confirm it
+  * @note   Call after the "OK" reply has been queued at the old rate
+  * @param  baud: New baud rate (validated with Transport_IsBaudSupported)
+  * @retval None
+  */
+void Transport_SetBaud(uint32_t baud)
+{
+    vTaskSuspendAll();
+
+    WaitTxIdle();
+    ulPreviousBaud = ulCurrentBaud;
+    ApplyBaud(baud);
+    ucConfirmPending = (ulCurrentBaud != ulPreviousBaud);
+    xSwitchTick = xTaskGetTickCount();
+
+    xTaskResumeAll();
+}
+
+/**
+  * @brief  A valid command arrived - the active rate works in both directions
+  * @retval None
+  */
+void Transport_Confirm(void)
+{
+    ucConfirmPending = 0;
+}
+
+/**
+  * @brief  Enforce the confirmation deadline and the RX error limit
+  * @note   Call periodically from task context
+  * @retval None
+  */
+void Transport_Poll(void)
+{
+    TickType_t xNow = xTaskGetTickCount();
+
+    if (ucConfirmPending && (xNow - xSwitchTick) >= pdMS_TO_TICKS(TRANSPORT_CONFIRM_TIMEOUT_MS)) {
+        Fallback(ulPreviousBaud);
+    }
+
+    if ((xNow - xErrorWindowStart) >= pdMS_TO_TICKS(TRANSPORT_STATS_WINDOW_MS)) {
+        uint32_t ulErrors = ulRxErrors;
+
+        if ((ulErrors - ulErrorWindowBase) >= TRANSPORT_RX_ERROR_LIMIT &&
+            ulCurrentBaud != TRANSPORT_DEFAULT_BAUD) {
+            Fallback(TRANSPORT_DEFAULT_BAUD);
+        }
+
+        ulErrorWindowBase = ulErrors;
+        xErrorWindowStart = xNow;
+    }
+}
+
+/**
+  * @brief  Count a receive error (ISR context)
+  * @retval None
+  */
+void Transport_RecordRxError(void)
+{
+    ulRxErrors++;
+}
+
+/**
+  * @brief  Re-derive the baud divider after a clock tree change
+  * @note   Safe to call with interrupts masked
+  * @retval None
+  */
+void Transport_ApplyClock(void)
+{
+    uint32_t brr;
+    uint8_t over8;
+
+    if (!ComputeDivider(HAL_RCC_GetPCLK1Freq(), ulCurrentBaud, &brr, &over8)) {
+        ulFallbacks++;
+        ucConfirmPending = 0;
+        ulCurrentBaud = TRANSPORT_DEFAULT_BAUD;
+    }
+
+    ApplyBaud(ulCurrentBaud);
+}
+
+/**
+  * @brief  Get link statistics
+  * @param  stats: Pointer to output statistics structure
+  * @retval None
+  */
+void Transport_GetStats(TransportStats_t *stats)
+{
+    TickType_t xNow = xTaskGetTickCount();
+    TickType_t xElapsed = xNow - xRateWindowStart;
+    uint32_t ulBytes = ulBytesSent;
+
+    if (xElapsed >= pdMS_TO_TICKS(TRANSPORT_STATS_WINDOW_MS)) {
+        ulBytesPerSec = (uint32_t)(((uint64_t)(ulBytes - ulRateWindowBytes) * configTICK_RATE_HZ) / xElapsed);
+        ulRateWindowBytes = ulBytes;
+        xRateWindowStart = xNow;
+    }
+
+    stats->ulBaudRate = ulCurrentBaud;
+    stats->ulBytesSent = ulBytes;
+    stats->ulFramesSent = ulFramesSent;
+    stats->ulTxErrors = ulTxErrors;
+    stats->ulRxErrors = ulRxErrors;
+    stats->ulFallbacks = ulFallbacks;
+    stats->ulBytesPerSec = ulBytesPerSec;
+
+    /* 8N1: 10 bit times per byte */
+    stats->fUtilisationPct = 100.0f * (float)(ulBytesPerSec * 10UL) / (float)ulCurrentBaud;
+}
+
+/**
+  * @brief  Compute BRR and oversampling mode for a rate
+  * @note   USARTDIV = PCLK / baud in both modes; OVER16 needs >= 16,
+  *         OVER8 (used only when needed) >= 8
+  * @param  pclkHz: PCLK1 frequency
+  * @param  baud: Requested baud rate
+  * @param  brr: Output BRR register value
+  * @param  over8: Output oversampling flag
+  * @retval 1 if within TRANSPORT_MAX_BAUD_ERROR_PPM, 0 otherwise
+  */
+static uint8_t ComputeDivider(uint32_t pclkHz, uint32_t baud, uint32_t *brr, uint8_t *over8)
+{
+    uint32_t div = (pclkHz + baud / 2) / baud;
+    uint32_t actual, errorPpm;
+
+    if (div < 8) {
+        return 0;
+    }
+
+    actual = pclkHz / div;
+    errorPpm = (uint32_t)(((uint64_t)((actual > baud) ? actual - baud : baud - actual) * 1000000ULL) / baud);
+    if (errorPpm > TRANSPORT_MAX_BAUD_ERROR_PPM) {
+        return 0;
+    }
+
+    if (div >= 16) {
+        *over8 = 0;
+        *brr = div;
+    } else {
+        *over8 = 1;
+        *brr = ((div & ~7UL) << 1) | (div & 7UL);
+    }
+
+    return 1;
+}
+
+/**
+  * @brief  Program USART2 for a rate at the current PCLK1
+  * @param  baud: Baud rate
+  * @retval None
+  */
+static void ApplyBaud(uint32_t baud)
+{
+    uint32_t brr;
+    uint8_t over8;
+
+    if (!ComputeDivider(HAL_RCC_GetPCLK1Freq(), baud, &brr, &over8)) {
+        return;
+    }
+
+    /* OVER8 may only change while the USART is disabled */
+    huart2.Instance->CR1 &= ~USART_CR1_UE;
+    if (over8) {
+        huart2.Instance->CR1 |= USART_CR1_OVER8;
+    } else {
+        huart2.Instance->CR1 &= ~USART_CR1_OVER8;
+    }
+    huart2.Instance->BRR = brr;
+    huart2.Instance->CR1 |= USART_CR1_UE;
+
+    /* Keep the handle in sync so a HAL re-init reproduces the rate */
+    huart2.Init.BaudRate = baud;
+    huart2.Init.OverSampling = over8 ? UART_OVERSAMPLING_8 : UART_OVERSAMPLING_16;
+    ulCurrentBaud = baud;
+}
+
+/**
+  * @brief  Wait until the last byte has left the shift register
+  * @retval None
+  */
+static void WaitTxIdle(void)
+{
+    uint32_t ulTimeout = TX_DRAIN_TIMEOUT_LOOPS;
+
+    while (!__HAL_UART_GET_FLAG(&huart2, UART_FLAG_TC) && --ulTimeout) {
+    }
+}
+
+/**
+  * @brief  Revert to a slower rate
+  * @param  baud: Rate to fall back to
+  * @retval None
+  */
+static void Fallback(uint32_t baud)
+{
+    vTaskSuspendAll();
+
+    WaitTxIdle();
+    ApplyBaud(baud);
+    ucConfirmPending = 0;
+    ulFallbacks++;
+
+    xTaskResumeAll();
+}
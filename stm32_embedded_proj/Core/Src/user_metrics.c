@@ -0,0 +1,253 @@
+/**
+  ******************************************************************************
+  * @file    user_metrics.c
+  * @brief   User Instrumentation API Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * Every update is a LDREX/STREX read-modify-write on a single word, so
+  * tasks and ISRs of any priority may record into the same metric without
+  * a lock. The 64-bit span total is kept as two words; a snapshot taken
+  * while a carry is being propagated can be one low-word wrap behind, which
+  * the next report corrects.
+  *
+  ******************************************************************************
+  */
+
+#include "user_metrics.h"
+#include "main.h"
+
+/* Live span record */
+typedef struct {
+    const char *name;
+    volatile uint32_t count;
+    volatile uint32_t totalLo;
+    volatile uint32_t totalHi;
+    volatile uint32_t max;
+    volatile uint32_t hist[USER_SPAN_HIST_BINS];
+} UserSpan_t;
+
+/* Static variables */
+static UserSpan_t xSpans[USER_MAX_SPANS];
+static const char *pcCounterNames[USER_MAX_COUNTERS];
+static volatile uint32_t ulCounters[USER_MAX_COUNTERS];
+static const char *pcGaugeNames[USER_MAX_GAUGES];
+static volatile int32_t lGauges[USER_MAX_GAUGES];
+
+static volatile uint8_t ucSpanCount = 0;
+static volatile uint8_t ucCounterCount = 0;
+static volatile uint8_t ucGaugeCount = 0;
+
+/* Private function prototypes */
+static uint32_t AtomicAdd(volatile uint32_t *pulValue, uint32_t ulDelta);
+static void AtomicMax(volatile uint32_t *pulValue, uint32_t ulCandidate);
+
+/**
+  * @brief  Register a timed span
+  * @param  name: Span name (static storage)
+  * @retval Span id, USER_METRIC_INVALID if the table is full
+  */
+uint8_t Profiler_SpanRegister(const char *name)
+{
+    uint8_t id;
+    uint32_t ulPrimask = __get_PRIMASK();
+
+    __disable_irq();
+    id = ucSpanCount;
+    if (id < USER_MAX_SPANS) {
+        xSpans[id].name = name;
+        ucSpanCount = id + 1;
+    } else {
+        id = USER_METRIC_INVALID;
+    }
+    __set_PRIMASK(ulPrimask);
+
+    return id;
+}
+
+/**
+  * @brief  Start a span
+  * @param  span: Span id
+  * @retval Start timestamp to pass to Profiler_SpanEnd()
+  */
+uint32_t Profiler_SpanBegin(uint8_t span)
+{
+    (void)span;
+    return DWT->CYCCNT;
+}
+
+/**
+  * @brief  Finish a span and record its duration
+  * @param  span: Span id (USER_METRIC_INVALID is ignored)
+  * @param  startCycles: Value returned by Profiler_SpanBegin()
+  * @retval None
+  */
+void Profiler_SpanEnd(uint8_t span, uint32_t startCycles)
+{
+    uint32_t ulCycles = DWT->CYCCNT - startCycles;
+    UserSpan_t *pxSpan;
+    uint32_t ulBin;
+
+    if (span >= ucSpanCount) {
+        return;
+    }
+    pxSpan = &xSpans[span];
+
+    /* Bin = floor(log4(cycles)) - 2, clamped */
+    ulBin = (31UL - __CLZ(ulCycles | 1UL)) / 2UL;
+    ulBin = (ulBin < 3UL) ? 0UL : ulBin - 2UL;
+    if (ulBin >= USER_SPAN_HIST_BINS) {
+        ulBin = USER_SPAN_HIST_BINS - 1;
+    }
+
+    AtomicAdd(&pxSpan->count, 1);
+    AtomicAdd(&pxSpan->hist[ulBin], 1);
+    if (AtomicAdd(&pxSpan->totalLo, ulCycles) + ulCycles < ulCycles) {
+        AtomicAdd(&pxSpan->totalHi, 1);
+    }
+    AtomicMax(&pxSpan->max, ulCycles);
+}
+
+/**
+  * @brief  Register a monotonic counter
+  * @param  name: Counter name (static storage)
+  * @retval Counter id, USER_METRIC_INVALID if the table is full
+  */
+uint8_t Profiler_CounterRegister(const char *name)
+{
+    uint8_t id;
+    uint32_t ulPrimask = __get_PRIMASK();
+
+    __disable_irq();
+    id = ucCounterCount;
+    if (id < USER_MAX_COUNTERS) {
+        pcCounterNames[id] = name;
+        ucCounterCount = id + 1;
+    } else {
+        id = USER_METRIC_INVALID;
+    }
+    __set_PRIMASK(ulPrimask);
+
+    return id;
+}
+
+/**
+  * @brief  Add to a counter (wraps at 2^32)
+  * @param  counter: Counter id (USER_METRIC_INVALID is ignored)
+  * @param  delta: Amount to add
+  * @retval None
+  */
+void Profiler_CounterAdd(uint8_t counter, uint32_t delta)
+{
+    if (counter < ucCounterCount) {
+        AtomicAdd(&ulCounters[counter], delta);
+    }
+}
+
+/**
+  * @brief  Register a gauge
+  * @param  name: Gauge name (static storage)
+  * @retval Gauge id, USER_METRIC_INVALID if the table is full
+  */
+uint8_t Profiler_GaugeRegister(const char *name)
+{
+    uint8_t id;
+    uint32_t ulPrimask = __get_PRIMASK();
+
+    __disable_irq();
+    id = ucGaugeCount;
+    if (id < USER_MAX_GAUGES) {
+        pcGaugeNames[id] = name;
+        ucGaugeCount = id + 1;
+    } else {
+        id = USER_METRIC_INVALID;
+    }
+    __set_PRIMASK(ulPrimask);
+
+    return id;
+}
+
+/**
+  * @brief  Set a gauge to its latest value
+  * @param  gauge: Gauge id (USER_METRIC_INVALID is ignored)
+  * @param  value: New value
+  * @retval None
+  */
+void Profiler_GaugeSet(uint8_t gauge, int32_t value)
+{
+    if (gauge < ucGaugeCount) {
+        lGauges[gauge] = value;
+    }
+}
+
+/**
+  * @brief  Snapshot all registered metrics
+  * @param  report: Pointer to output snapshot
+  * @retval None
+  */
+void Profiler_GetUserMetrics(UserMetricsReport_t *report)
+{
+    report->spanCount = ucSpanCount;
+    report->counterCount = ucCounterCount;
+    report->gaugeCount = ucGaugeCount;
+
+    for (uint8_t i = 0; i < report->spanCount; i++) {
+        UserSpan_t *pxSpan = &xSpans[i];
+        UserSpanStats_t *pxOut = &report->spans[i];
+
+        pxOut->name = pxSpan->name;
+        pxOut->count = pxSpan->count;
+        pxOut->totalCycles = ((uint64_t)pxSpan->totalHi << 32) | pxSpan->totalLo;
+        pxOut->maxCycles = pxSpan->max;
+        for (uint8_t b = 0; b < USER_SPAN_HIST_BINS; b++) {
+            uint32_t ulBinCount = pxSpan->hist[b];
+            pxOut->hist[b] = (ulBinCount > 0xFFFF) ? 0xFFFF : (uint16_t)ulBinCount;
+        }
+    }
+
+    for (uint8_t i = 0; i < report->counterCount; i++) {
+        report->counters[i].name = pcCounterNames[i];
+        report->counters[i].value = ulCounters[i];
+    }
+
+    for (uint8_t i = 0; i < report->gaugeCount; i++) {
+        report->gauges[i].name = pcGaugeNames[i];
+        report->gauges[i].value = lGauges[i];
+    }
+}
+
+/**
+  * @brief  Lock-free add
+  * @param  pulValue: Word to update
+  * @param  ulDelta: Amount to add
+  * @retval Previous value
+  */
+static uint32_t AtomicAdd(volatile uint32_t *pulValue, uint32_t ulDelta)
+{
+    uint32_t ulOld;
+
+    do {
+        ulOld = __LDREXW(pulValue);
+    } while (__STREXW(ulOld + ulDelta, pulValue) != 0);
+
+    return ulOld;
+}
+
+/**
+  * @brief  Lock-free maximum
+  * @param  pulValue: Word to update
+  * @param  ulCandidate: New sample
+  * @retval None
+  */
+static void AtomicMax(volatile uint32_t *pulValue, uint32_t ulCandidate)
+{
+    uint32_t ulOld;
+
+    do {
+        ulOld = __LDREXW(pulValue);
+        if (ulOld >= ulCandidate) {
+            __CLREX();
+            return;
+        }
+    } while (__STREXW(ulCandidate, pulValue) != 0);
+}
@@ -0,0 +1,644 @@
+/**
+  ******************************************************************************
+  * @file    workload.c
+  * @brief   Synthetic Workload Generator Implementation
+  ******************************************************************************
+  * @attention
+  *
+  * Workers are ordinary heap-allocated tasks so that spawning N of them
+  * costs what N application tasks would: a TCB, a stack and a slot in every
+  * uxTaskGetSystemState() walk. Spawning stops early rather than dipping
+  * into WORKLOAD_HEAP_RESERVE plus the profiler's per-sample TaskStatus_t
+  * array, and allocation churn skips a block instead of failing into
+  * vApplicationMallocFailedHook(), so a run reports "spawned < requested"
+  * or alloc_fail instead of faulting.
+  *
+  * On target the heap caps N at a couple of workers; the host build
+  * (Host/) runs the same module against the FreeRTOS POSIX port for the
+  * 30-60 task end of the curve.
+  *
+  ******************************************************************************
+  */
+
+#include "workload.h"
+#include "main.h"
+#include "task.h"
+#include "queue.h"
+#include "user_metrics.h"
+#include "pool_alloc.h"
+#include "uart_transport.h"
+#include <stdio.h>
+#include <string.h>
+
+#define WORKLOAD_HEAP_RESERVE       1024    /* Never spawn or churn below this */
+#define WORKLOAD_TCB_BYTES          128     /* TCB + heap_4 header, rounded up */
+#define WORKLOAD_STOP_POLL_MS       10
+#define STREAM_BUFFER_SIZE          160
+
+/* One worker slot */
+typedef struct {
+    TaskHandle_t xHandle;
+    QueueHandle_t xQueue;             /* Ping-pong inbox, length 1 */
+    void *pvBlocks[WORKLOAD_MAX_BLOCKS];
+    uint32_t ulRng;
+} Worker_t;
+
+/* Measurement window fed by Workload_OnSample() */
+typedef struct {
+    uint32_t ulSamples;
+    float fLoadSum;
+    uint8_t ucTasksMax;
+    uint32_t ulHeapFreeMin;
+    uint32_t ulHeapMin;
+    float fFragMax;
+} Window_t;
+
+/* Static variables */
+static Worker_t xWorkers[WORKLOAD_MAX_TASKS];
+static WorkloadConfig_t xConfig;
+static uint8_t ucSpawned = 0;
+static volatile uint8_t ucStopping = 0;
+static volatile uint8_t ucRunning = 0;          /* Workers not yet exited */
+static volatile uint32_t ulAllocFailures = 0;
+
+static volatile uint8_t ucMeasuring = 0;
+static Window_t xWindow;
+
+static TaskHandle_t xSweepHandle = NULL;
+static WorkloadConfig_t xSweepConfig;
+static WorkloadSweep_t xSweep;
+
+/* Private function prototypes */
+static void WorkerTask(void *pvParameters);
+static void SweepTask(void *pvParameters);
+static void Spin(uint32_t ulBusyUs);
+static void TouchStack(uint16_t usBytes);
+static void Churn(Worker_t *pxWorker);
+static void FreeBlocks(Worker_t *pxWorker);
+static uint8_t HeapFits(size_t xSize);
+static void MeasureStep(uint8_t ucN, float fBaseline, WorkloadStep_t *pxStep);
+static void GetSpans(uint32_t *pulCounts, uint64_t *pullCycles);
+static void MeasureAllocator(const PoolAllocStats_t *pxStart, const PoolAllocStats_t *pxEnd,
+                             WorkloadStep_t *pxStep);
+static float HeapFragmentation(void);
+static void StreamStep(const WorkloadStep_t *pxStep);
+
+/**
+  * @brief  Fill a configuration with the defaults
+  * @param  config: Output
+  * @retval None
+  */
+void Workload_DefaultConfig(WorkloadConfig_t *config)
+{
+    config->taskCount = 0;
+    config->dutyPct = WORKLOAD_DEFAULT_DUTY_PCT;
+    config->periodMs = WORKLOAD_DEFAULT_PERIOD_MS;
+    config->priorityMin = 1;
+    config->priorityMax = 2;
+    config->pingPong = 1;
+    config->allocsPerPeriod = 1;
+    config->stackTouchBytes = 64;
+    config->allocMinBytes = 16;
+    config->allocMaxBytes = 128;
+}
+
+/**
+  * @brief  Spawn config->taskCount workers (stops any running set first)
+  * @param  config: Worker behaviour
+  * @note   Task context only
+  * @retval Number of workers spawned
+  */
+uint8_t Workload_Start(const WorkloadConfig_t *config)
+{
+    uint32_t ulNeed = WORKLOAD_STACK_WORDS * sizeof(StackType_t) + WORKLOAD_TCB_BYTES;
+    uint8_t ucCount;
+    char name[configMAX_TASK_NAME_LEN];
+
+    Workload_Stop();
+
+    xConfig = *config;
+    if (xConfig.taskCount > WORKLOAD_MAX_TASKS) {
+        xConfig.taskCount = WORKLOAD_MAX_TASKS;
+    }
+    if (xConfig.dutyPct > 100) {
+        xConfig.dutyPct = 100;
+    }
+    if (xConfig.periodMs == 0) {
+        xConfig.periodMs = 1;
+    }
+    if (xConfig.priorityMax >= configMAX_PRIORITIES) {
+        xConfig.priorityMax = configMAX_PRIORITIES - 1;
+    }
+    if (xConfig.priorityMin > xConfig.priorityMax) {
+        xConfig.priorityMin = xConfig.priorityMax;
+    }
+    if (xConfig.stackTouchBytes > WORKLOAD_STACK_TOUCH_MAX) {
+        xConfig.stackTouchBytes = WORKLOAD_STACK_TOUCH_MAX;
+    }
+    if (xConfig.allocMaxBytes < xConfig.allocMinBytes) {
+        xConfig.allocMaxBytes = xConfig.allocMinBytes;
+    }
+    ucCount = xConfig.taskCount;
+
+    memset(xWorkers, 0, sizeof(xWorkers));
+    ulAllocFailures = 0;
+    ucStopping = 0;
+
+    /* Inboxes first, so no worker sends to a partner that has none yet */
+    if (xConfig.pingPong) {
+        for (uint8_t i = 0; i < ucCount; i++) {
+            if (!HeapFits(ulNeed)) {
+                break;
+            }
+            xWorkers[i].xQueue = xQueueCreate(1, sizeof(uint32_t));
+        }
+    }
+
+    for (ucSpawned = 0; ucSpawned < ucCount; ucSpawned++) {
+        uint8_t ucPrio = xConfig.priorityMin +
+                         ucSpawned % (xConfig.priorityMax - xConfig.priorityMin + 1);
+
+        if (!HeapFits(ulNeed)) {
+            break;
+        }
+        xWorkers[ucSpawned].ulRng = (ucSpawned + 1U) * 2654435761UL;
+        snprintf(name, sizeof(name), "wl%02u", (unsigned)ucSpawned);
+
+        taskENTER_CRITICAL();
+        ucRunning++;
+        taskEXIT_CRITICAL();
+        if (xTaskCreate(WorkerTask, name, WORKLOAD_STACK_WORDS, (void *)(uintptr_t)ucSpawned,
+                        ucPrio, &xWorkers[ucSpawned].xHandle) != pdPASS) {
+            taskENTER_CRITICAL();
+            ucRunning--;
+            taskEXIT_CRITICAL();
+            break;
+        }
+    }
+
+    return ucSpawned;
+}
+
+/**
+  * @brief  Stop all workers and release their queues and blocks
+  * @note   Task context only; waits up to two periods for workers to exit
+  * @retval None
+  */
+void Workload_Stop(void)
+{
+    TickType_t xStart = xTaskGetTickCount();
+    TickType_t xLimit = pdMS_TO_TICKS(2U * xConfig.periodMs + 100U);
+
+    ucStopping = 1;
+    while (ucRunning != 0 && (xTaskGetTickCount() - xStart) < xLimit) {
+        vTaskDelay(pdMS_TO_TICKS(WORKLOAD_STOP_POLL_MS));
+    }
+
+    /* Workers that missed the deadline (starved by higher priorities). All
+     * of them go before any queue does, as each sends to its partner's. */
+    for (uint8_t i = 0; i < WORKLOAD_MAX_TASKS; i++) {
+        if (xWorkers[i].xHandle != NULL) {
+            vTaskDelete(xWorkers[i].xHandle);
+            xWorkers[i].xHandle = NULL;
+            FreeBlocks(&xWorkers[i]);
+        }
+    }
+    for (uint8_t i = 0; i < WORKLOAD_MAX_TASKS; i++) {
+        if (xWorkers[i].xQueue != NULL) {
+            vQueueDelete(xWorkers[i].xQueue);
+            xWorkers[i].xQueue = NULL;
+        }
+    }
+
+    ucRunning = 0;
+    ucSpawned = 0;
+}
+
+/**
+  * @brief  Number of workers currently spawned
+  * @retval Count
+  */
+uint8_t Workload_GetActiveCount(void)
+{
+    return ucSpawned;
+}
+
+/**
+  * @brief  Run a sweep over N in the background, one "#wl" line per step
+  * @param  config: Worker behaviour (taskCount is set per step)
+  * @param  sweep: Range and timing
+  * @retval 1 if started, 0 if a sweep is running or it could not start
+  */
+uint8_t Workload_StartSweep(const WorkloadConfig_t *config, const WorkloadSweep_t *sweep)
+{
+    if (xSweepHandle != NULL || sweep->endN < sweep->startN) {
+        return 0;
+    }
+
+    xSweepConfig = *config;
+    xSweep = *sweep;
+    if (xSweep.stepN == 0) {
+        xSweep.stepN = 1;
+    }
+
+    if (xTaskCreate(SweepTask, "WlSweep", WORKLOAD_SWEEP_STACK, NULL,
+                    WORKLOAD_SWEEP_PRIORITY, &xSweepHandle) != pdPASS) {
+        xSweepHandle = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+  * @brief  Whether a sweep is in progress
+  * @retval 1 if running
+  */
+uint8_t Workload_IsSweepRunning(void)
+{
+    return xSweepHandle != NULL;
+}
+
+/**
+  * @brief  Feed one profiler sample into the open measurement window
+  * @param  report: Sample just collected by the profiler task
+  * @retval None
+  */
+void Workload_OnSample(const SystemReport_t *report)
+{
+    float fFrag;
+
+    if (!ucMeasuring) {
+        return;
+    }
+
+    fFrag = HeapFragmentation();
+    taskENTER_CRITICAL();
+    xWindow.ulSamples++;
+    xWindow.fLoadSum += report->cpuLoad;
+    if (report->taskCount > xWindow.ucTasksMax) {
+        xWindow.ucTasksMax = report->taskCount;
+    }
+    if (report->heapFree < xWindow.ulHeapFreeMin) {
+        xWindow.ulHeapFreeMin = report->heapFree;
+    }
+    xWindow.ulHeapMin = report->heapMin;
+    if (fFrag > xWindow.fFragMax) {
+        xWindow.fFragMax = fFrag;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+  * @brief  Worker: spin, dirty the stack, ping-pong and churn every period
+  * @param  pvParameters: Worker index
+  * @retval None
+  */
+static void WorkerTask(void *pvParameters)
+{
+    uint32_t ulIndex = (uint32_t)(uintptr_t)pvParameters;
+    Worker_t *pxSelf = &xWorkers[ulIndex];
+    QueueHandle_t xPartner = NULL;
+    TickType_t xPeriod = pdMS_TO_TICKS(xConfig.periodMs);
+    TickType_t xLastWake = xTaskGetTickCount();
+    uint32_t ulBusyUs = (uint32_t)xConfig.periodMs * 10U * xConfig.dutyPct;
+    uint32_t ulToken;
+
+    /* An unpaired last worker, or a partner that was never spawned, only
+       costs a receive timeout per period */
+    if ((ulIndex ^ 1U) < xConfig.taskCount) {
+        xPartner = xWorkers[ulIndex ^ 1U].xQueue;
+    }
+
+    while (!ucStopping) {
+        if (xPartner != NULL && pxSelf->xQueue != NULL) {
+            if ((ulIndex & 1U) == 0) {
+                ulToken = ulIndex;
+                (void)xQueueSend(xPartner, &ulToken, 0);
+                (void)xQueueReceive(pxSelf->xQueue, &ulToken, xPeriod);
+            } else if (xQueueReceive(pxSelf->xQueue, &ulToken, xPeriod) == pdTRUE) {
+                (void)xQueueSend(xPartner, &ulToken, 0);
+            }
+        }
+
+        Spin(ulBusyUs);
+        TouchStack(xConfig.stackTouchBytes);
+        Churn(pxSelf);
+
+        vTaskDelayUntil(&xLastWake, xPeriod);
+    }
+
+    FreeBlocks(pxSelf);
+    taskENTER_CRITICAL();
+    pxSelf->xHandle = NULL;
+    ucRunning--;
+    taskEXIT_CRITICAL();
+    vTaskDelete(NULL);
+}
+
+/**
+  * @brief  Busy-wait on the cycle counter, bounded by the tick
+  * @param  ulBusyUs: Busy time in microseconds
+  * @retval None
+  */
+static void Spin(uint32_t ulBusyUs)
+{
+    uint32_t ulCycles = ulBusyUs * (SystemCoreClock / 1000000UL);
+    uint32_t ulStart = DWT->CYCCNT;
+    TickType_t xStart = xTaskGetTickCount();
+    TickType_t xLimit = pdMS_TO_TICKS(ulBusyUs / 1000U) + 1;
+
+    while ((DWT->CYCCNT - ulStart) < ulCycles &&
+           (xTaskGetTickCount() - xStart) < xLimit) {
+    }
+}
+
+/**
+  * @brief  Write to part of a stack buffer so the watermark reflects it
+  * @param  usBytes: Bytes to dirty (<= WORKLOAD_STACK_TOUCH_MAX)
+  * @retval None
+  */
+static void TouchStack(uint16_t usBytes)
+{
+    volatile uint8_t ucScratch[WORKLOAD_STACK_TOUCH_MAX];
+
+    for (uint16_t i = 0; i < usBytes; i++) {
+        ucScratch[i] = (uint8_t)i;
+    }
+    (void)ucScratch;
+}
+
+/**
+  * @brief  Replace random blocks with randomly sized new ones
+  * @param  pxWorker: Worker owning the blocks
+  * @retval None
+  */
+static void Churn(Worker_t *pxWorker)
+{
+    uint32_t ulSpan = (uint32_t)xConfig.allocMaxBytes - xConfig.allocMinBytes + 1U;
+
+    for (uint8_t i = 0; i < xConfig.allocsPerPeriod; i++) {
+        uint32_t ulRand;
+        uint32_t ulSlot;
+        size_t xSize;
+
+        pxWorker->ulRng = pxWorker->ulRng * 1664525UL + 1013904223UL;
+        ulRand = pxWorker->ulRng;
+        ulSlot = (ulRand >> 28) % WORKLOAD_MAX_BLOCKS;
+        xSize = xConfig.allocMinBytes + (ulRand >> 8) % ulSpan;
+
+        if (pxWorker->pvBlocks[ulSlot] != NULL) {
+            vPortFree(pxWorker->pvBlocks[ulSlot]);
+            pxWorker->pvBlocks[ulSlot] = NULL;
+        }
+
+        if (HeapFits(xSize)) {
+            pxWorker->pvBlocks[ulSlot] = pvPortMalloc(xSize);
+        }
+        if (pxWorker->pvBlocks[ulSlot] == NULL) {
+            taskENTER_CRITICAL();
+            ulAllocFailures++;
+            taskEXIT_CRITICAL();
+        }
+    }
+}
+
+/**
+  * @brief  Release every block a worker holds
+  * @param  pxWorker: Worker
+  * @retval None
+  */
+static void FreeBlocks(Worker_t *pxWorker)
+{
+    for (uint8_t i = 0; i < WORKLOAD_MAX_BLOCKS; i++) {
+        if (pxWorker->pvBlocks[i] != NULL) {
+            vPortFree(pxWorker->pvBlocks[i]);
+            pxWorker->pvBlocks[i] = NULL;
+        }
+    }
+}
+
+/**
+  * @brief  Whether an allocation leaves the reserve and room for the
+  *         profiler's TaskStatus_t array (one more task than now)
+  * @param  xSize: Bytes to allocate
+  * @retval 1 if it fits
+  */
+static uint8_t HeapFits(size_t xSize)
+{
+    size_t xProfiler = (uxTaskGetNumberOfTasks() + 1U) * sizeof(TaskStatus_t);
+
+    return xPortGetFreeHeapSize() >= xSize + xProfiler + WORKLOAD_HEAP_RESERVE;
+}
+
+/**
+  * @brief  Sweep task: idle baseline, then one measured step per N
+  * @param  pvParameters: Unused
+  * @retval None
+  */
+static void SweepTask(void *pvParameters)
+{
+    static const char header[] = "#wlh n spawned tasks samples expected_pct measured_pct "
+                                 "collect_us format_us heap_free heap_min alloc_fail "
+                                 "alloc_cyc free_cyc pool_hit_pct frag_pct\r\n";
+    WorkloadStep_t step;
+    float fBaseline;
+    uint32_t ulN;
+
+    (void)pvParameters;
+    (void)Transport_Write((const uint8_t *)header, sizeof(header) - 1, 1000);
+
+    /* N = 0 is always measured: it is the reference for expected_pct */
+    MeasureStep(0, 0.0f, &step);
+    fBaseline = step.measuredLoad;
+    StreamStep(&step);
+
+    for (ulN = xSweep.startN; ulN <= xSweep.endN; ulN += xSweep.stepN) {
+        if (ulN == 0) {
+            continue;
+        }
+        MeasureStep((uint8_t)ulN, fBaseline, &step);
+        StreamStep(&step);
+    }
+
+    Workload_Stop();
+    (void)Transport_Write((const uint8_t *)"#wld\r\n", 6, 1000);
+
+    xSweepHandle = NULL;
+    vTaskDelete(NULL);
+}
+
+/**
+  * @brief  Spawn N workers, settle, then measure one window
+  * @param  ucN: Workers requested
+  * @param  fBaseline: Load measured with no workers
+  * @param  pxStep: Output
+  * @retval None
+  */
+static void MeasureStep(uint8_t ucN, float fBaseline, WorkloadStep_t *pxStep)
+{
+    static PoolAllocStats_t xPools, xPoolsEnd;
+    uint32_t ulCounts[2], ulCountsEnd[2];
+    uint64_t ullCycles[2], ullCyclesEnd[2];
+    uint32_t ulCyclesPerUs;
+    float fExpected;
+
+    memset(pxStep, 0, sizeof(WorkloadStep_t));
+    pxStep->requested = ucN;
+
+    xSweepConfig.taskCount = ucN;
+    if (ucN > 0) {
+        pxStep->spawned = Workload_Start(&xSweepConfig);
+    } else {
+        Workload_Stop();
+    }
+    vTaskDelay(pdMS_TO_TICKS(xSweep.settleMs));
+
+    taskENTER_CRITICAL();
+    memset(&xWindow, 0, sizeof(xWindow));
+    xWindow.ulHeapFreeMin = UINT32_MAX;
+    ulAllocFailures = 0;
+    taskEXIT_CRITICAL();
+    GetSpans(ulCounts, ullCycles);
+    PoolAlloc_GetStats(&xPools);
+    ucMeasuring = 1;
+
+    vTaskDelay(pdMS_TO_TICKS(xSweep.measureMs));
+
+    ucMeasuring = 0;
+    GetSpans(ulCountsEnd, ullCyclesEnd);
+    PoolAlloc_GetStats(&xPoolsEnd);
+    MeasureAllocator(&xPools, &xPoolsEnd, pxStep);
+
+    ulCyclesPerUs = SystemCoreClock / 1000000UL;
+    if (ulCyclesPerUs == 0) {
+        ulCyclesPerUs = 1;
+    }
+    for (uint8_t i = 0; i < 2; i++) {
+        uint32_t ulCount = ulCountsEnd[i] - ulCounts[i];
+        uint32_t ulUs = 0;
+
+        if (ulCount > 0) {
+            ulUs = (uint32_t)((ullCyclesEnd[i] - ullCycles[i]) / ulCount / ulCyclesPerUs);
+        }
+        if (i == 0) {
+            pxStep->collectUs = ulUs;
+        } else {
+            pxStep->formatUs = ulUs;
+        }
+    }
+
+    fExpected = fBaseline + (float)pxStep->spawned * xSweepConfig.dutyPct;
+    pxStep->expectedLoad = (fExpected > 100.0f) ? 100.0f : fExpected;
+
+    taskENTER_CRITICAL();
+    pxStep->samples = xWindow.ulSamples;
+    pxStep->tasksReported = xWindow.ucTasksMax;
+    pxStep->heapFree = (xWindow.ulSamples > 0) ? xWindow.ulHeapFreeMin : 0;
+    pxStep->heapMin = xWindow.ulHeapMin;
+    pxStep->allocFailures = ulAllocFailures;
+    pxStep->fragPct = xWindow.fFragMax;
+    if (xWindow.ulSamples > 0) {
+        pxStep->measuredLoad = xWindow.fLoadSum / (float)xWindow.ulSamples;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+  * @brief  Cumulative count and cycles of the "collect" and "format" spans
+  * @param  pulCounts: Output [collect, format]
+  * @param  pullCycles: Output [collect, format]
+  * @retval None
+  */
+static void GetSpans(uint32_t *pulCounts, uint64_t *pullCycles)
+{
+    static UserMetricsReport_t metrics;   /* Too large for this task's stack */
+    static const char *const names[2] = { "collect", "format" };
+
+    Profiler_GetUserMetrics(&metrics);
+    for (uint8_t i = 0; i < 2; i++) {
+        pulCounts[i] = 0;
+        pullCycles[i] = 0;
+        for (uint8_t s = 0; s < metrics.spanCount; s++) {
+            if (strcmp(metrics.spans[s].name, names[i]) == 0) {
+                pulCounts[i] = metrics.spans[s].count;
+                pullCycles[i] = metrics.spans[s].totalCycles;
+            }
+        }
+    }
+}
+
+/**
+  * @brief  Allocator cost and pool share over a window
+  * @param  pxStart: Allocator statistics at the start of the window
+  * @param  pxEnd: Allocator statistics at the end
+  * @param  pxStep: Output
+  * @retval None
+  */
+static void MeasureAllocator(const PoolAllocStats_t *pxStart, const PoolAllocStats_t *pxEnd,
+                             WorkloadStep_t *pxStep)
+{
+    uint32_t ulAllocs = pxEnd->allocs - pxStart->allocs;
+    uint32_t ulFrees = pxEnd->frees - pxStart->frees;
+    uint32_t ulHits = 0;
+
+    for (uint8_t i = 0; i < pxEnd->poolCount; i++) {
+        ulHits += pxEnd->pools[i].hits - pxStart->pools[i].hits;
+    }
+
+    if (ulAllocs > 0) {
+        pxStep->allocCycles = (uint32_t)((pxEnd->allocCycles - pxStart->allocCycles) / ulAllocs);
+        pxStep->poolHitPct = 100.0f * (float)ulHits / (float)ulAllocs;
+    }
+    if (ulFrees > 0) {
+        pxStep->freeCycles = (uint32_t)((pxEnd->freeCycles - pxStart->freeCycles) / ulFrees);
+    }
+}
+
+/**
+  * @brief  Share of the free heap outside its largest block
+  * @note   Walks the heap_4 free list; only sampled while a window is open
+  * @retval Fragmentation in percent
+  */
+static float HeapFragmentation(void)
+{
+    HeapStats_t xHeap;
+
+    vPortGetHeapStats(&xHeap);
+    if (xHeap.xAvailableHeapSpaceInBytes == 0) {
+        return 0.0f;
+    }
+
+    return 100.0f * (1.0f - (float)xHeap.xSizeOfLargestFreeBlockInBytes /
+                            (float)xHeap.xAvailableHeapSpaceInBytes);
+}
+
+/**
+  * @brief  Write one "#wl" line
+  * @param  pxStep: Measured step
+  * @retval None
+  */
+static void StreamStep(const WorkloadStep_t *pxStep)
+{
+    static char buffer[STREAM_BUFFER_SIZE];
+    uint32_t ulExpected = (uint32_t)(pxStep->expectedLoad * 100.0f);
+    uint32_t ulMeasured = (uint32_t)(pxStep->measuredLoad * 100.0f);
+    uint32_t ulHit = (uint32_t)(pxStep->poolHitPct * 100.0f);
+    uint32_t ulFrag = (uint32_t)(pxStep->fragPct * 100.0f);
+    int xLen;
+
+    xLen = snprintf(buffer, sizeof(buffer),
+                    "#wl %u %u %u %lu %lu.%02lu %lu.%02lu %lu %lu %lu %lu %lu %lu %lu %lu.%02lu %lu.%02lu\r\n",
+                    pxStep->requested, pxStep->spawned, pxStep->tasksReported,
+                    (unsigned long)pxStep->samples,
+                    (unsigned long)(ulExpected / 100), (unsigned long)(ulExpected % 100),
+                    (unsigned long)(ulMeasured / 100), (unsigned long)(ulMeasured % 100),
+                    (unsigned long)pxStep->collectUs, (unsigned long)pxStep->formatUs,
+                    (unsigned long)pxStep->heapFree, (unsigned long)pxStep->heapMin,
+                    (unsigned long)pxStep->allocFailures,
+                    (unsigned long)pxStep->allocCycles, (unsigned long)pxStep->freeCycles,
+                    (unsigned long)(ulHit / 100), (unsigned long)(ulHit % 100),
+                    (unsigned long)(ulFrag / 100), (unsigned long)(ulFrag % 100));
+    if (xLen > 0) {
+        (void)Transport_Write((const uint8_t *)buffer, (uint16_t)xLen, 1000);
+    }
+}
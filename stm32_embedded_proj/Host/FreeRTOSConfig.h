@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @file    FreeRTOSConfig.h
+  * @brief   FreeRTOS Configuration for the host (POSIX port) build
+  ******************************************************************************
+  * @attention
+  *
+  * Shadows Core/Inc/FreeRTOSConfig.h for Host/. Same tick, priorities and
+  * run-time stats source as the target; no Cortex-M settings and no
+  * queue/mutex trace hooks. POSIX threads need at least PTHREAD_STACK_MIN
+  * of stack, so every stack depth is in host-sized words.
+  *
+  ******************************************************************************
+  */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <stdint.h>
+#include <limits.h>
+#include <assert.h>
+
+extern uint32_t SystemCoreClock;
+
+#define configUSE_PREEMPTION                     1
+#define configSUPPORT_STATIC_ALLOCATION          0
+#define configSUPPORT_DYNAMIC_ALLOCATION         1
+#define configUSE_IDLE_HOOK                      0
+#define configUSE_TICK_HOOK                      1
+#define configCPU_CLOCK_HZ                       ( SystemCoreClock )
+#define configTICK_RATE_HZ                       ((TickType_t)1000)
+#define configLIBRARY_LOWEST_INTERRUPT_PRIORITY  15      /* SysTick level, clock_switch_test.c */
+#define configMAX_PRIORITIES                     ( 7 )
+#define configMINIMAL_STACK_SIZE                 ((uint16_t)(2 * PTHREAD_STACK_MIN / sizeof(void *)))
+#define configTOTAL_HEAP_SIZE                    ((size_t)(16 * 1024 * 1024))
+#define configMAX_TASK_NAME_LEN                  ( 16 )
+#define configUSE_TRACE_FACILITY                 1
+#define configUSE_16_BIT_TICKS                   0
+#define configUSE_MUTEXES                        1
+#define configQUEUE_REGISTRY_SIZE                0
+#define configUSE_RECURSIVE_MUTEXES              0
+#define configUSE_COUNTING_SEMAPHORES            1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION  0
+#define configUSE_CO_ROUTINES                    0
+#define configUSE_TIMERS                         0
+#define configUSE_MALLOC_FAILED_HOOK             0
+#define configCHECK_FOR_STACK_OVERFLOW           0
+
+/* Run-time stats from the tick hook, as on the target */
+#define configGENERATE_RUN_TIME_STATS            1
+#define configUSE_STATS_FORMATTING_FUNCTIONS     0
+extern volatile uint32_t ulHighFrequencyTimerTicks;
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() (ulHighFrequencyTimerTicks = 0)
+#define portGET_RUN_TIME_COUNTER_VALUE()         (ulHighFrequencyTimerTicks << PROFILER_RUN_TIME_SHIFT)
+
+/* Wrap test build (make WRAP_TEST=1), as on the target */
+#ifndef PROFILER_WRAP_TEST
+#define PROFILER_WRAP_TEST                       0
+#endif
+#if PROFILER_WRAP_TEST
+#define configINITIAL_TICK_COUNT                 ((TickType_t)0xFFFF0000UL)
+#define PROFILER_RUN_TIME_SHIFT                  16
+#else
+#define PROFILER_RUN_TIME_SHIFT                  0
+#endif
+
+#define INCLUDE_vTaskPrioritySet                 1
+#define INCLUDE_uxTaskPriorityGet                1
+#define INCLUDE_vTaskDelete                      1
+#define INCLUDE_vTaskSuspend                     1
+#define INCLUDE_vTaskDelayUntil                  1
+#define INCLUDE_vTaskDelay                       1
+#define INCLUDE_xTaskGetSchedulerState           1
+#define INCLUDE_uxTaskGetStackHighWaterMark      1
+#define INCLUDE_eTaskGetState                    1
+#define INCLUDE_xTaskGetCurrentTaskHandle        1
+
+#define configASSERT( x )                        assert( x )
+
+#endif /* FREERTOS_CONFIG_H */
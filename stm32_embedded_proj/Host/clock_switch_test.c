@@ -0,0 +1,560 @@
+/**
+  ******************************************************************************
+  * @file    clock_switch_test.c
+  * @brief   Host build - clock governor switches against a simulated clock tree
+  ******************************************************************************
+  * @attention
+  *
+  * QEMU has no RCC, so the governor never switches there. This program runs
+  * the target's clock_governor.c against a model of the F401 clock tree:
+  * HAL_RCC_OscConfig/ClockConfig change the simulated SYSCLK and APB1 clock
+  * (and, like the HAL, re-run HAL_InitTick), SysTick counts down at SYSCLK
+  * and every underflow is one kernel tick. A ProfilerTask loop feeds the
+  * governor a load profile that walks HIGH -> MID -> LOW -> HIGH twice and
+  * ends with a STOP wake-up through SystemClock_Config(). It checks:
+  *
+  *   - tick rate: each 1000-tick report period is 1000 ms of simulated time
+  *   - run-time counter: advances by exactly the ticks of each period
+  *   - after every switch: SysTick reload and priority, the APB1 clock the
+  *     UART divider is derived from, and the clock tree limits
+  *   - residency adds up to the elapsed ticks, operating points as expected
+  *
+  *   ./build/clock_switch_test [-v]
+  *
+  * One "#clk" line per report period (-v), "#clkd pass" or "#clkd fail <n>"
+  * at the end; the exit status is the failure count. No kernel sources are
+  * linked: the few kernel calls the governor makes are defined here.
+  *
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "clock_governor.h"
+#include "uart_transport.h"
+#include "pc_sampler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_HSI_HZ                  16000000UL
+#define SIM_SAMPLE_PERIOD_MS        100     /* ProfilerTask default */
+#define SIM_REPORT_EVERY_SAMPLES    10
+#define SIM_STOP_AT_MS              16000
+#define SIM_STOP_MS                 500
+#define SIM_END_MS                  19000
+#define SIM_TICK_INT_PRIORITY       0       /* What HAL_InitTick() leaves behind */
+
+#ifndef configINITIAL_TICK_COUNT
+#define configINITIAL_TICK_COUNT    0
+#endif
+
+/* Simulated clock tree */
+typedef struct {
+    uint8_t ucPllOn;
+    uint32_t ulPllM;
+    uint32_t ulPllN;
+    uint32_t ulPllP;
+    uint8_t ucSysclkPll;
+    uint32_t ulApb1Div;
+    uint32_t ulFlashLatency;
+    uint32_t ulVoltageScale;
+} SimClockTree_t;
+
+/* Load profile: percent from the given time on */
+typedef struct {
+    uint32_t ulFromMs;
+    float fLoad;
+} SimLoadStep_t;
+
+static const SimLoadStep_t xLoadProfile[] = {
+    {     0, 90.0f },     /* Stays at HIGH */
+    {  3000, 10.0f },     /* HIGH -> MID -> LOW, 2 s apart */
+    {  9000, 90.0f },     /* Straight back to HIGH */
+    { 11000, 10.0f },     /* Down to LOW again, then STOP */
+    { 16500, 30.0f },     /* 60% projected onto MID: stays at HIGH */
+};
+
+/* Operating points in the order the profile should visit them */
+static const ClockOpp_t xExpectedOpps[] = {
+    CLOCK_OPP_HIGH, CLOCK_OPP_MID, CLOCK_OPP_LOW, CLOCK_OPP_HIGH,
+    CLOCK_OPP_MID, CLOCK_OPP_LOW, CLOCK_OPP_HIGH
+};
+#define EXPECTED_OPP_COUNT          (sizeof(xExpectedOpps) / sizeof(xExpectedOpps[0]))
+
+uint32_t SystemCoreClock = SIM_HSI_HZ;
+volatile uint32_t ulHighFrequencyTimerTicks = 0;
+SysTick_Type xHostSysTick;
+UART_HandleTypeDef huart2;
+
+static SimClockTree_t xTree = { 0, 16, 0, 2, 0, 1, FLASH_LATENCY_0, PWR_REGULATOR_VOLTAGE_SCALE2 };
+static TickType_t xTickCount = configINITIAL_TICK_COUNT;
+static uint32_t ulSysTickPriority = SIM_TICK_INT_PRIORITY;
+static uint32_t ulUartPclkHz = 0;
+static uint32_t ulSuspendNesting = 0;
+static uint32_t ulCriticalNesting = 0;
+static uint32_t ulWallMs = 0;
+static uint32_t ulFailures = 0;
+static uint8_t ucVerbose = 0;
+
+/* Private function prototypes */
+static uint32_t SimSysclkHz(void);
+static uint32_t SimApb1Hz(void);
+static void SimRun(uint32_t ulMs);
+static void SimEnterStop(uint32_t ulMs);
+static float LoadAt(uint32_t ulMs);
+static uint8_t BaudWithinTolerance(uint32_t ulPclkHz, uint32_t ulBaud);
+static void CheckTimebase(const char *pcWhen);
+static void Check(uint8_t ucOk, const char *pcWhat, uint32_t ulValue);
+void SystemClock_Config(void);
+
+/**
+  * @brief  Host entry point
+  * @param  argc: Argument count
+  * @param  argv: -v prints every report period
+  * @retval Number of failed checks
+  */
+int main(int argc, char **argv)
+{
+    TickType_t xLastWakeTime;
+    TickType_t xReportTick;
+    uint32_t ulReportWallMs, ulReportRunTime;
+    uint32_t ulSwitchesAtReport = 0;
+    uint32_t ulStartTick;
+    uint32_t ulCounter = 0;
+    uint8_t ucStopInPeriod = 0;
+    uint8_t ucStopped = 0;
+    ClockOpp_t xVisited[EXPECTED_OPP_COUNT + 4];
+    uint32_t ulVisitedCount = 0;
+    ClockGovernorStats_t xStats;
+    uint32_t ulResidencySum = 0;
+
+    ucVerbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+
+    /* Boot as main() does: HIGH, then the port takes SysTick over */
+    SystemClock_Config();
+    SysTick->LOAD = (SystemCoreClock / configTICK_RATE_HZ) - 1UL;
+    SysTick->VAL = 0;
+    SysTick->CTRL = SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_TICKINT_Msk;
+    NVIC_SetPriority(SysTick_IRQn, configLIBRARY_LOWEST_INTERRUPT_PRIORITY);
+    ClockGovernor_Init();
+    CheckTimebase("boot");
+
+    ulStartTick = xTickCount;
+    xLastWakeTime = xTickCount;
+    xReportTick = xTickCount;
+    ulReportWallMs = ulWallMs;
+    ulReportRunTime = portGET_RUN_TIME_COUNTER_VALUE();
+    xVisited[ulVisitedCount++] = ClockGovernor_GetCurrentOpp();
+
+    while (ulWallMs < SIM_END_MS) {
+        if (!ucStopped && ulWallMs >= SIM_STOP_AT_MS) {
+            /* EnterDeepSleep(): STOP, wake on HSI, restore HIGH */
+            ucStopped = 1;
+            ucStopInPeriod = 1;
+            SimEnterStop(SIM_STOP_MS);
+            SystemClock_Config();
+            ClockGovernor_OnClockReset();
+            CheckTimebase("STOP wake-up");
+        }
+
+        SimRun(1);
+
+        /* vTaskDelayUntil(&xLastWakeTime, sample period) */
+        while ((TickType_t)(xTickCount - xLastWakeTime) >= pdMS_TO_TICKS(SIM_SAMPLE_PERIOD_MS)) {
+            xLastWakeTime += pdMS_TO_TICKS(SIM_SAMPLE_PERIOD_MS);
+
+            ClockGovernor_Update(LoadAt(ulWallMs));
+            Check(ulSuspendNesting == 0 && ulCriticalNesting == 0,
+                  "scheduler left suspended or critical section open", ulSuspendNesting);
+
+            if (ClockGovernor_GetCurrentOpp() != xVisited[ulVisitedCount - 1]) {
+                if (ulVisitedCount < sizeof(xVisited) / sizeof(xVisited[0])) {
+                    xVisited[ulVisitedCount++] = ClockGovernor_GetCurrentOpp();
+                }
+                CheckTimebase("switch");
+            }
+
+            if (++ulCounter >= SIM_REPORT_EVERY_SAMPLES) {
+                uint32_t ulRunTime = portGET_RUN_TIME_COUNTER_VALUE();
+                uint32_t ulTicks = (uint32_t)(xTickCount - xReportTick);
+                uint32_t ulPeriodMs = ulWallMs - ulReportWallMs;
+                uint32_t ulRunTimeDelta = ulRunTime - ulReportRunTime;
+                uint32_t ulSwitches, ulSlackMs;
+
+                ClockGovernor_GetStats(&xStats);
+                ulSwitches = xStats.ulSwitchCount - ulSwitchesAtReport;
+
+                /* Each switch restarts SysTick, so at most one partial tick
+                   per switch is lost; a STOP period holds no ticks at all */
+                ulSlackMs = 1 + ulSwitches;
+                if (ucStopInPeriod) {
+                    ulPeriodMs -= SIM_STOP_MS;
+                }
+                Check(ulTicks == SIM_REPORT_EVERY_SAMPLES * pdMS_TO_TICKS(SIM_SAMPLE_PERIOD_MS),
+                      "ticks per report period", ulTicks);
+                Check(ulPeriodMs + ulSlackMs >= 1000 && ulPeriodMs <= 1000 + ulSlackMs,
+                      "report period (ms of simulated time)", ulPeriodMs);
+                Check(ulRunTimeDelta == (ulTicks << PROFILER_RUN_TIME_SHIFT),
+                      "run-time counter per report period", ulRunTimeDelta);
+
+                if (ucVerbose) {
+                    printf("#clk %lu %u %lu %lu %lu %lu %lu\n", (unsigned long)ulWallMs,
+                           (unsigned)xStats.currentOpp, (unsigned long)(xStats.ulFrequencyHz / 1000000UL),
+                           (unsigned long)ulPeriodMs, (unsigned long)ulTicks,
+                           (unsigned long)ulRunTimeDelta, (unsigned long)ulSwitches);
+                }
+
+                ulCounter = 0;
+                ucStopInPeriod = 0;
+                ulSwitchesAtReport = xStats.ulSwitchCount;
+                xReportTick = xTickCount;
+                ulReportWallMs = ulWallMs;
+                ulReportRunTime = ulRunTime;
+            }
+        }
+    }
+
+    /* Path through the operating points and what the governor reports */
+    ClockGovernor_GetStats(&xStats);
+    Check(ulVisitedCount == EXPECTED_OPP_COUNT, "operating points visited", ulVisitedCount);
+    for (uint32_t i = 0; i < ulVisitedCount && i < EXPECTED_OPP_COUNT; i++) {
+        Check(xVisited[i] == xExpectedOpps[i], "operating point order", i);
+    }
+    Check(xStats.ulSwitchCount == EXPECTED_OPP_COUNT - 1, "switch count", xStats.ulSwitchCount);
+    for (uint8_t i = 0; i < CLOCK_OPP_COUNT; i++) {
+        ulResidencySum += xStats.ulResidencyMs[i];
+        Check(xStats.ulResidencyMs[i] > 0, "residency in every operating point", i);
+    }
+    Check(ulResidencySum == (uint32_t)(xTickCount - ulStartTick) * portTICK_PERIOD_MS,
+          "residency sum equals elapsed ticks", ulResidencySum);
+
+    if (ulFailures == 0) {
+        printf("#clkd pass\n");
+    } else {
+        printf("#clkd fail %lu\n", (unsigned long)ulFailures);
+    }
+    return (int)ulFailures;
+}
+
+/**
+  * @brief  Host copy of main.c's SystemClock_Config(): 84 MHz from HSI
+  * @retval None
+  */
+void SystemClock_Config(void)
+{
+    RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+    RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+
+    __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE2);
+
+    RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI;
+    RCC_OscInitStruct.HSIState = RCC_HSI_ON;
+    RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+    RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
+    RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSI;
+    RCC_OscInitStruct.PLL.PLLM = 16;
+    RCC_OscInitStruct.PLL.PLLN = 336;
+    RCC_OscInitStruct.PLL.PLLP = RCC_PLLP_DIV4;
+    RCC_OscInitStruct.PLL.PLLQ = 7;
+    if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK) {
+        Error_Handler();
+    }
+
+    RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK
+                                |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
+    RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+    RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
+    RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV2;
+    RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
+    if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_2) != HAL_OK) {
+        Error_Handler();
+    }
+}
+
+/**
+  * @brief  HSI and PLL; the PLL cannot be stopped or retuned while it clocks SYSCLK
+  * @param  RCC_OscInitStruct: Oscillator settings
+  * @retval HAL_ERROR on a request the hardware would refuse
+  */
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct)
+{
+    const RCC_PLLInitTypeDef *pxPll = &RCC_OscInitStruct->PLL;
+
+    if (pxPll->PLLState == RCC_PLL_OFF || pxPll->PLLState == RCC_PLL_ON) {
+        if (xTree.ucSysclkPll) {
+            Check(0, "PLL reconfigured while it clocks SYSCLK", pxPll->PLLState);
+            return HAL_ERROR;
+        }
+        xTree.ucPllOn = (pxPll->PLLState == RCC_PLL_ON);
+    }
+    if (pxPll->PLLState == RCC_PLL_ON) {
+        xTree.ulPllM = pxPll->PLLM;
+        xTree.ulPllN = pxPll->PLLN;
+        xTree.ulPllP = pxPll->PLLP;
+        Check(SIM_HSI_HZ / xTree.ulPllM == 1000000UL, "PLL input (Hz)", SIM_HSI_HZ / xTree.ulPllM);
+    }
+    return HAL_OK;
+}
+
+/**
+  * @brief  SYSCLK source, APB1 divider and flash wait states, then
+  *         HAL_InitTick() as the HAL does
+  * @param  RCC_ClkInitStruct: Bus clock settings
+  * @param  FLatency: Flash wait states
+  * @retval HAL_ERROR on a request the hardware would refuse
+  */
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency)
+{
+    if (RCC_ClkInitStruct->SYSCLKSource == RCC_SYSCLKSOURCE_PLLCLK && !xTree.ucPllOn) {
+        Check(0, "PLL selected while off", 0);
+        return HAL_ERROR;
+    }
+
+    xTree.ucSysclkPll = (RCC_ClkInitStruct->SYSCLKSource == RCC_SYSCLKSOURCE_PLLCLK);
+    xTree.ulApb1Div = (RCC_ClkInitStruct->APB1CLKDivider == RCC_HCLK_DIV2) ? 2 : 1;
+    xTree.ulFlashLatency = FLatency;
+
+    /* F401 at 2.7-3.6 V: one wait state per 30 MHz; scale 3 tops out at 60 MHz */
+    Check(SimSysclkHz() <= (FLatency + 1) * 30000000UL, "flash wait states for SYSCLK", SimSysclkHz());
+    Check(xTree.ulVoltageScale == PWR_REGULATOR_VOLTAGE_SCALE2 || SimSysclkHz() <= 60000000UL,
+          "SYSCLK above the voltage scale 3 limit", SimSysclkHz());
+    Check(SimApb1Hz() <= 42000000UL, "APB1 above 42 MHz", SimApb1Hz());
+
+    SystemCoreClock = SimSysclkHz();
+    SysTick->LOAD = (SystemCoreClock / 1000UL) - 1UL;
+    SysTick->VAL = 0;
+    SysTick->CTRL = SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_TICKINT_Msk;
+    ulSysTickPriority = SIM_TICK_INT_PRIORITY;
+    return HAL_OK;
+}
+
+/**
+  * @brief  PCLK1 as the HAL derives it (from SystemCoreClock)
+  * @retval Hz
+  */
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+    return SystemCoreClock / xTree.ulApb1Div;
+}
+
+/**
+  * @brief  Re-read SystemCoreClock from the clock tree
+  * @retval None
+  */
+void SystemCoreClockUpdate(void)
+{
+    SystemCoreClock = SimSysclkHz();
+}
+
+/**
+  * @brief  VOS: only takes effect while the PLL is off
+  * @param  ulScale: PWR_REGULATOR_VOLTAGE_SCALEx
+  * @retval None
+  */
+void HostPwrVoltageScaling(uint32_t ulScale)
+{
+    Check(!xTree.ucPllOn, "voltage scale changed with the PLL on", ulScale);
+    xTree.ulVoltageScale = ulScale;
+}
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority)
+{
+    if (IRQn == SysTick_IRQn) {
+        ulSysTickPriority = priority;
+    }
+}
+
+/* Transport and sampler: record what the governor hands them */
+uint8_t Transport_IsClockSupported(uint32_t pclkHz)
+{
+    return BaudWithinTolerance(pclkHz, TRANSPORT_DEFAULT_BAUD);
+}
+
+void Transport_ApplyClock(void)
+{
+    ulUartPclkHz = HAL_RCC_GetPCLK1Freq();
+}
+
+void PcSampler_ApplyClock(void)
+{
+}
+
+/* Kernel calls made by the governor */
+TickType_t xTaskGetTickCount(void)
+{
+    return xTickCount;
+}
+
+void vTaskSuspendAll(void)
+{
+    ulSuspendNesting++;
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+    ulSuspendNesting--;
+    return pdFALSE;
+}
+
+void vPortEnterCritical(void)
+{
+    ulCriticalNesting++;
+}
+
+void vPortExitCritical(void)
+{
+    ulCriticalNesting--;
+}
+
+/**
+  * @brief  Fatal error: report and exit
+  * @retval None
+  */
+void Error_Handler(void)
+{
+    fprintf(stderr, "Error_Handler at %lu ms\n", (unsigned long)ulWallMs);
+    exit(1);
+}
+
+/**
+  * @brief  SYSCLK the clock tree currently produces
+  * @retval Hz
+  */
+static uint32_t SimSysclkHz(void)
+{
+    if (xTree.ucSysclkPll) {
+        return (SIM_HSI_HZ / xTree.ulPllM) * xTree.ulPllN / xTree.ulPllP;
+    }
+    return SIM_HSI_HZ;
+}
+
+/**
+  * @brief  APB1 clock the clock tree currently produces
+  * @retval Hz
+  */
+static uint32_t SimApb1Hz(void)
+{
+    return SimSysclkHz() / xTree.ulApb1Div;
+}
+
+/**
+  * @brief  Run the core for some simulated time; SysTick counts SYSCLK cycles
+  * @param  ulMs: Milliseconds
+  * @retval None
+  */
+static void SimRun(uint32_t ulMs)
+{
+    uint64_t ullCycles = (uint64_t)SimSysclkHz() / 1000UL * ulMs;
+
+    ulWallMs += ulMs;
+    if (!(SysTick->CTRL & SysTick_CTRL_ENABLE_Msk)) {
+        return;
+    }
+
+    /* Down counter: a cycle at 0 reloads, reaching 0 raises the tick */
+    while (ullCycles > 0) {
+        uint32_t ulStep;
+
+        if (SysTick->VAL == 0) {
+            SysTick->VAL = SysTick->LOAD;
+            ullCycles--;
+            continue;
+        }
+        ulStep = (ullCycles < SysTick->VAL) ? (uint32_t)ullCycles : SysTick->VAL;
+        SysTick->VAL -= ulStep;
+        ullCycles -= ulStep;
+        if (SysTick->VAL == 0 && (SysTick->CTRL & SysTick_CTRL_TICKINT_Msk)) {
+            xTickCount++;
+            ulHighFrequencyTimerTicks++;
+        }
+    }
+}
+
+/**
+  * @brief  STOP mode: no ticks; wake-up leaves the PLL off and SYSCLK on HSI
+  * @note   SystemCoreClock and SysTick keep their pre-STOP values until the
+  *         wake-up path restores them
+  * @param  ulMs: Milliseconds in STOP
+  * @retval None
+  */
+static void SimEnterStop(uint32_t ulMs)
+{
+    ulWallMs += ulMs;
+    xTree.ucSysclkPll = 0;
+    xTree.ucPllOn = 0;
+}
+
+/**
+  * @brief  CPU load the profile prescribes
+  * @param  ulMs: Simulated time
+  * @retval Percent
+  */
+static float LoadAt(uint32_t ulMs)
+{
+    float fLoad = xLoadProfile[0].fLoad;
+
+    for (uint32_t i = 0; i < sizeof(xLoadProfile) / sizeof(xLoadProfile[0]); i++) {
+        if (ulMs >= xLoadProfile[i].ulFromMs) {
+            fLoad = xLoadProfile[i].fLoad;
+        }
+    }
+    return fLoad;
+}
+
+/**
+  * @brief  USART baud error with 16x oversampling and a rounded divider
+  * @param  ulPclkHz: APB1 clock
+  * @param  ulBaud: Baud rate
+  * @retval 1 if within TRANSPORT_MAX_BAUD_ERROR_PPM
+  */
+static uint8_t BaudWithinTolerance(uint32_t ulPclkHz, uint32_t ulBaud)
+{
+    uint32_t ulBrr = (ulPclkHz + ulBaud / 2) / ulBaud;
+    uint64_t ullActual, ullDiff;
+
+    if (ulBrr < 16) {
+        return 0;
+    }
+    ullActual = ulPclkHz / ulBrr;
+    ullDiff = (ullActual > ulBaud) ? ullActual - ulBaud : ulBaud - ullActual;
+    return (ullDiff * 1000000ULL / ulBaud) <= TRANSPORT_MAX_BAUD_ERROR_PPM;
+}
+
+/**
+  * @brief  Timebase invariants after a clock change
+  * @param  pcWhen: Label for failure messages
+  * @retval None
+  */
+static void CheckTimebase(const char *pcWhen)
+{
+    if (ucVerbose) {
+        printf("#clks %lu %s %lu\n", (unsigned long)ulWallMs, pcWhen,
+               (unsigned long)(SimSysclkHz() / 1000000UL));
+    }
+    Check(SystemCoreClock == SimSysclkHz(), "SystemCoreClock matches SYSCLK", SystemCoreClock);
+    Check(SysTick->LOAD + 1UL == SimSysclkHz() / configTICK_RATE_HZ, "SysTick reload for 1 kHz", SysTick->LOAD);
+    Check((SysTick->CTRL & SysTick_CTRL_ENABLE_Msk) != 0, "SysTick running", SysTick->CTRL);
+    Check(ulSysTickPriority == configLIBRARY_LOWEST_INTERRUPT_PRIORITY, "SysTick at the lowest priority",
+          ulSysTickPriority);
+    Check(ulUartPclkHz == SimApb1Hz() || ulUartPclkHz == 0, "UART divider from the live APB1 clock", ulUartPclkHz);
+    Check(BaudWithinTolerance(SimApb1Hz(), TRANSPORT_DEFAULT_BAUD), "baud rate within tolerance", SimApb1Hz());
+    Check(ClockGovernor_GetFrequencyHz() == SimSysclkHz(), "governor frequency matches SYSCLK",
+          ClockGovernor_GetFrequencyHz());
+}
+
+/**
+  * @brief  Count and report a failed check
+  * @param  ucOk: Check result
+  * @param  pcWhat: Description
+  * @param  ulValue: Offending value
+  * @retval None
+  */
+static void Check(uint8_t ucOk, const char *pcWhat, uint32_t ulValue)
+{
+    if (!ucOk) {
+        ulFailures++;
+        fprintf(stderr, "FAIL at %lu ms: %s (%lu)\n", (unsigned long)ulWallMs, pcWhat, (unsigned long)ulValue);
+    }
+}
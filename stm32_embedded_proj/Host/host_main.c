@@ -0,0 +1,179 @@
+/**
+  ******************************************************************************
+  * @file    host_main.c
+  * @brief   Host build - profiler scaling sweep on the FreeRTOS POSIX port
+  ******************************************************************************
+  * @attention
+  *
+  * Runs the target's report collector, formatters, user metrics and
+  * synthetic workload against the POSIX port, with a profiler task that
+  * samples and formats the way ProfilerTask/ReportTask do on the board.
+  * The host heap is large enough for the 30-60 task end of the sweep the
+  * board cannot reach; the output is the same "#wl" lines.
+  *
+  *   ./build/host_profiler [start end step [duty period settle_ms measure_ms]] [-r]
+  *
+  * -r also prints every formatted report. The program exits after "#wld".
+  *
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "system_profiler.h"
+#include "json_formatter.h"
+#include "test_metrics.h"
+#include "user_metrics.h"
+#include "workload.h"
+#include "pool_alloc.h"
+#include "uart_transport.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HOST_CPU_HZ                 100000000UL     /* Scale of the emulated DWT */
+#define HOST_PROFILER_STACK         (configMINIMAL_STACK_SIZE * 2)
+
+uint32_t SystemCoreClock = HOST_CPU_HZ;
+volatile uint32_t ulHighFrequencyTimerTicks = 0;
+
+static uint8_t ucCollectSpan = USER_METRIC_INVALID;
+static uint8_t ucFormatSpan = USER_METRIC_INVALID;
+static uint8_t ucPrintReports = 0;
+
+static WorkloadConfig_t xConfig;
+static WorkloadSweep_t xSweep;
+
+/* Private function prototypes */
+static void ProfilerTask(void *pvParameters);
+static uint8_t ParseArgs(int argc, char **argv);
+
+/**
+  * @brief  Host entry point
+  * @param  argc: Argument count
+  * @param  argv: Arguments
+  * @retval Exit status
+  */
+int main(int argc, char **argv)
+{
+    if (!ParseArgs(argc, argv)) {
+        fprintf(stderr, "usage: %s [start end step [duty period settle_ms measure_ms]] [-r]\n",
+                argv[0]);
+        return 2;
+    }
+
+    TestMetrics_Init();
+    ucCollectSpan = Profiler_SpanRegister("collect");
+    ucFormatSpan = Profiler_SpanRegister("format");
+
+    xTaskCreate(ProfilerTask, "Profiler", HOST_PROFILER_STACK, NULL, 3, NULL);
+    if (!Workload_StartSweep(&xConfig, &xSweep)) {
+        fprintf(stderr, "sweep did not start\n");
+        return 1;
+    }
+    PoolAlloc_Init();
+
+    vTaskStartScheduler();
+    return 1;
+}
+
+/**
+  * @brief  Run-time stats time base, as on the target
+  * @retval None
+  */
+void vApplicationTickHook(void)
+{
+    ulHighFrequencyTimerTicks++;
+}
+
+/**
+  * @brief  Sample every period, format every reportEverySamples samples
+  * @param  pvParameters: Unused
+  * @retval None
+  */
+static void ProfilerTask(void *pvParameters)
+{
+    static SystemReport_t report;
+    static char buffer[16384];
+    ProfilerConfig_t *pxConfig = GetProfilerConfig();
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+    uint32_t ulCounter = 0;
+    uint32_t ulSpanStart;
+
+    (void)pvParameters;
+
+    for (;;) {
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(pxConfig->samplePeriodMs));
+
+        ulSpanStart = Profiler_SpanBegin(ucCollectSpan);
+        CollectSystemStats(&report, &pxConfig->subscription);
+        Profiler_SpanEnd(ucCollectSpan, ulSpanStart);
+        Workload_OnSample(&report);
+
+        if (++ulCounter >= pxConfig->reportEverySamples) {
+            ulCounter = 0;
+            ulSpanStart = Profiler_SpanBegin(ucFormatSpan);
+            if (pxConfig->format == REPORT_FORMAT_COMPACT) {
+                FormatSystemReportJSONCompact(&report, buffer, sizeof(buffer));
+            } else {
+                FormatSystemReportJSON(&report, buffer, sizeof(buffer));
+            }
+            Profiler_SpanEnd(ucFormatSpan, ulSpanStart);
+
+            if (ucPrintReports) {
+                Transport_Write((const uint8_t *)buffer, strlen(buffer), 1000);
+                Transport_Write((const uint8_t *)"\r\n", 2, 100);
+            }
+        }
+
+        if (!Workload_IsSweepRunning()) {
+            exit(0);
+        }
+    }
+}
+
+/**
+  * @brief  Fill the sweep from the command line
+  * @param  argc: Argument count
+  * @param  argv: Arguments
+  * @retval 1 if valid
+  */
+static uint8_t ParseArgs(int argc, char **argv)
+{
+    unsigned long values[7] = { 0, 60, 10, WORKLOAD_DEFAULT_DUTY_PCT, WORKLOAD_DEFAULT_PERIOD_MS,
+                                WORKLOAD_DEFAULT_SETTLE_MS, WORKLOAD_DEFAULT_MEASURE_MS };
+    uint8_t count = 0;
+    char *end;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0) {
+            ucPrintReports = 1;
+            continue;
+        }
+        if (count >= 7) {
+            return 0;
+        }
+        values[count++] = strtoul(argv[i], &end, 10);
+        if (*end != '\0') {
+            return 0;
+        }
+    }
+
+    if (values[1] > WORKLOAD_MAX_TASKS || values[0] > values[1] || values[2] == 0 ||
+        values[3] < 1 || values[3] > 100 || values[4] < 1 || values[4] > 1000 ||
+        values[5] > 60000 || values[6] == 0 || values[6] > 60000) {
+        return 0;
+    }
+
+    Workload_DefaultConfig(&xConfig);
+    xConfig.dutyPct = (uint8_t)values[3];
+    xConfig.periodMs = (uint16_t)values[4];
+
+    xSweep.startN = (uint8_t)values[0];
+    xSweep.endN = (uint8_t)values[1];
+    xSweep.stepN = (uint8_t)values[2];
+    xSweep.settleMs = (uint16_t)values[5];
+    xSweep.measureMs = (uint16_t)values[6];
+    return 1;
+}
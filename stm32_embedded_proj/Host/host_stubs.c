@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @file    host_stubs.c
+  * @brief   Host build - stand-ins for the target-only modules
+  ******************************************************************************
+  * @attention
+  *
+  * The report collector reads the clock governor, energy model, UART link,
+  * queue/mutex traces and analog monitor. None of them exist on the host,
+  * so their sections report zeros and Transport_Write() goes to stdout.
+  *
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "uart_transport.h"
+#include "clock_governor.h"
+#include "energy_model.h"
+#include "queue_trace.h"
+#include "mutex_trace.h"
+#include "analog_monitor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+  * @brief  Write to stdout
+  * @param  data: Bytes to write
+  * @param  length: Number of bytes
+  * @param  timeout: Unused
+  * @retval HAL_OK, or HAL_ERROR if stdout failed
+  */
+HAL_StatusTypeDef Transport_Write(const uint8_t *data, uint16_t length, uint32_t timeout)
+{
+    (void)timeout;
+
+    if (fwrite(data, 1, length, stdout) != length) {
+        return HAL_ERROR;
+    }
+    fflush(stdout);
+    return HAL_OK;
+}
+
+/* Report sections with nothing to measure on the host */
+void Transport_GetStats(TransportStats_t *stats)
+{
+    memset(stats, 0, sizeof(TransportStats_t));
+}
+
+void ClockGovernor_GetStats(ClockGovernorStats_t *stats)
+{
+    memset(stats, 0, sizeof(ClockGovernorStats_t));
+}
+
+void EnergyModel_GetStats(EnergyStats_t *stats)
+{
+    memset(stats, 0, sizeof(EnergyStats_t));
+}
+
+uint8_t QueueTrace_GetStats(QueueObjectStats_t *stats, uint8_t maxObjects)
+{
+    (void)stats;
+    (void)maxObjects;
+    return 0;
+}
+
+const char *QueueTrace_TypeName(uint8_t type)
+{
+    (void)type;
+    return "queue";
+}
+
+uint8_t MutexTrace_GetStats(MutexStats_t *stats, uint8_t maxMutexes)
+{
+    (void)stats;
+    (void)maxMutexes;
+    return 0;
+}
+
+void AnalogMonitor_GetReadings(AnalogReadings_t *readings)
+{
+    memset(readings, 0, sizeof(AnalogReadings_t));
+}
+
+/**
+  * @brief  Fatal error: report and exit
+  * @retval None
+  */
+void Error_Handler(void)
+{
+    fprintf(stderr, "Error_Handler\n");
+    exit(1);
+}
@@ -0,0 +1,192 @@
+/**
+  ******************************************************************************
+  * @file    stm32f4xx_hal.h
+  * @brief   Host build shim - the few HAL/CMSIS names the profiler core uses
+  ******************************************************************************
+  * @attention
+  *
+  * Only for the POSIX build in Host/. DWT->CYCCNT is derived from
+  * CLOCK_MONOTONIC at SystemCoreClock, "interrupt masking" maps onto the
+  * POSIX port's critical section and the exclusive monitor onto a
+  * compare-and-swap, so user_metrics.c and test_metrics.c compile unchanged.
+  * The clock tree, SysTick and USART2 names below exist only for
+  * clock_governor.c; clock_switch_test.c simulates them.
+  *
+  ******************************************************************************
+  */
+
+#ifndef __STM32F4xx_HAL_H
+#define __STM32F4xx_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <time.h>
+
+typedef enum {
+    HAL_OK       = 0x00U,
+    HAL_ERROR    = 0x01U,
+    HAL_BUSY     = 0x02U,
+    HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY           0xFFFFFFFFU
+
+extern uint32_t SystemCoreClock;
+
+/* Cycle counter */
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} HostDwt_t;
+
+static inline HostDwt_t *HostDwt(void)
+{
+    static HostDwt_t xDwt;
+    struct timespec xNow;
+    uint64_t ullNs;
+
+    clock_gettime(CLOCK_MONOTONIC, &xNow);
+    ullNs = (uint64_t)xNow.tv_sec * 1000000000ULL + (uint64_t)xNow.tv_nsec;
+    xDwt.CYCCNT = (uint32_t)(ullNs * (SystemCoreClock / 1000000UL) / 1000ULL);
+    return &xDwt;
+}
+
+#define DWT                     (HostDwt())
+
+/* PRIMASK: every __disable_irq() in the core is paired with __set_PRIMASK() */
+extern void vPortEnterCritical(void);
+extern void vPortExitCritical(void);
+
+static inline uint32_t __get_PRIMASK(void)
+{
+    return 0;
+}
+
+static inline void __disable_irq(void)
+{
+    vPortEnterCritical();
+}
+
+static inline void __set_PRIMASK(uint32_t ulPrimask)
+{
+    (void)ulPrimask;
+    vPortExitCritical();
+}
+
+/* LDREX/STREX: remember the loaded value, store with compare-and-swap */
+static __thread uint32_t ulHostExclusive;
+
+static inline uint32_t __LDREXW(volatile uint32_t *pulAddr)
+{
+    ulHostExclusive = __atomic_load_n(pulAddr, __ATOMIC_SEQ_CST);
+    return ulHostExclusive;
+}
+
+static inline uint32_t __STREXW(uint32_t ulValue, volatile uint32_t *pulAddr)
+{
+    uint32_t ulExpected = ulHostExclusive;
+
+    return __atomic_compare_exchange_n(pulAddr, &ulExpected, ulValue, 0,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? 0U : 1U;
+}
+
+#define __CLREX()               ((void)0)
+#define __CLZ(x)                ((uint32_t)((x) ? __builtin_clz(x) : 32))
+#define __DMB()                 __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+/* Clock tree (values as in the F4 HAL, PLLP is the divider itself) */
+typedef struct {
+    uint32_t PLLState;
+    uint32_t PLLSource;
+    uint32_t PLLM;
+    uint32_t PLLN;
+    uint32_t PLLP;
+    uint32_t PLLQ;
+} RCC_PLLInitTypeDef;
+
+typedef struct {
+    uint32_t OscillatorType;
+    uint32_t HSEState;
+    uint32_t LSEState;
+    uint32_t HSIState;
+    uint32_t HSICalibrationValue;
+    uint32_t LSIState;
+    RCC_PLLInitTypeDef PLL;
+} RCC_OscInitTypeDef;
+
+typedef struct {
+    uint32_t ClockType;
+    uint32_t SYSCLKSource;
+    uint32_t AHBCLKDivider;
+    uint32_t APB1CLKDivider;
+    uint32_t APB2CLKDivider;
+} RCC_ClkInitTypeDef;
+
+#define RCC_OSCILLATORTYPE_HSI          0x00000002U
+#define RCC_HSI_ON                      0x00000001U
+#define RCC_HSICALIBRATION_DEFAULT      0x10U
+#define RCC_PLL_OFF                     0x00000001U
+#define RCC_PLL_ON                      0x00000002U
+#define RCC_PLLSOURCE_HSI               0x00000000U
+#define RCC_PLLP_DIV2                   0x00000002U
+#define RCC_PLLP_DIV4                   0x00000004U
+#define RCC_PLLP_DIV6                   0x00000006U
+#define RCC_PLLP_DIV8                   0x00000008U
+#define RCC_CLOCKTYPE_SYSCLK            0x00000001U
+#define RCC_CLOCKTYPE_HCLK              0x00000002U
+#define RCC_CLOCKTYPE_PCLK1             0x00000004U
+#define RCC_CLOCKTYPE_PCLK2             0x00000008U
+#define RCC_SYSCLKSOURCE_HSI            0x00000000U
+#define RCC_SYSCLKSOURCE_PLLCLK         0x00000002U
+#define RCC_SYSCLK_DIV1                 0x00000000U
+#define RCC_HCLK_DIV1                   0x00000000U
+#define RCC_HCLK_DIV2                   0x00001000U
+#define FLASH_LATENCY_0                 0U
+#define FLASH_LATENCY_1                 1U
+#define FLASH_LATENCY_2                 2U
+#define PWR_REGULATOR_VOLTAGE_SCALE2    0x00008000U
+#define PWR_REGULATOR_VOLTAGE_SCALE3    0x00004000U
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct);
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+void SystemCoreClockUpdate(void);
+void HostPwrVoltageScaling(uint32_t ulScale);
+
+#define __HAL_PWR_VOLTAGESCALING_CONFIG(scale)  HostPwrVoltageScaling(scale)
+
+/* SysTick and NVIC */
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t LOAD;
+    volatile uint32_t VAL;
+    volatile uint32_t CALIB;
+} SysTick_Type;
+
+typedef int32_t IRQn_Type;
+
+#define SysTick_IRQn                    ((IRQn_Type)-1)
+#define SysTick_CTRL_ENABLE_Msk         (1UL << 0)
+#define SysTick_CTRL_TICKINT_Msk        (1UL << 1)
+
+extern SysTick_Type xHostSysTick;
+#define SysTick                         (&xHostSysTick)
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority);
+
+/* USART2: the transmit-complete poll before a switch always succeeds */
+typedef struct {
+    void *Instance;
+} UART_HandleTypeDef;
+
+#define UART_FLAG_TC                    0x00000040U
+#define __HAL_UART_GET_FLAG(handle, flag)  ((void)(handle), 1)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32F4xx_HAL_H */
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""
+STM32 System Profiler - host link benchmark
+
+Negotiates the highest baud rate the device and adapter sustain, then
+measures sustained reports/s and bytes/s for each report format.
+
+Usage:
+    python3 link_bench.py /dev/ttyACM0 [--rate MS] [--every N] [--seconds S]
+
+Requires pyserial. The port may also be the pty printed by link_replay.py,
+which stands in for a board; pass --no-negotiate when the other end cannot
+change rate.
+"""
+
+import argparse
+import sys
+import time
+
+import serial
+
+DEFAULT_BAUD = 115200
+CANDIDATE_BAUDS = [2000000, 1000000, 921600, 460800, 230400]
+FORMATS = ["pretty", "compact", "binary"]
+
+BINARY_SYNC = b"\xa5\x5a"
+
+
+def command(port, line, expect="OK", timeout=1.0):
+    """Send one command and wait for its reply line."""
+    port.reset_input_buffer()
+    port.write((line + "\n").encode())
+    deadline = time.monotonic() + timeout
+    buffer = b""
+    while time.monotonic() < deadline:
+        buffer += port.read(port.in_waiting or 1)
+        for reply in buffer.split(b"\r\n"):
+            if reply.strip() == expect.encode():
+                return True
+            if reply.startswith(b"ERR"):
+                return False
+    return False
+
+
+def negotiate(port):
+    """Step down through the candidate rates until one is confirmed."""
+    for baud in CANDIDATE_BAUDS:
+        port.baudrate = DEFAULT_BAUD
+        if not command(port, "baud %d" % baud):
+            continue
+
+        port.baudrate = baud
+        time.sleep(0.05)
+        if command(port, "ping", expect="pong"):
+            return baud
+
+        # Device reverts on its own once the confirmation deadline passes
+        time.sleep(2.5)
+
+    port.baudrate = DEFAULT_BAUD
+    return DEFAULT_BAUD
+
+
+def count_text_reports(data, fmt):
+    if fmt == "pretty":
+        return data.count(b"\r\n}")
+    return data.count(b"}\r\n")
+
+
+def count_binary_reports(data):
+    count = 0
+    pos = data.find(BINARY_SYNC)
+    while pos >= 0 and pos + 4 <= len(data):
+        length = data[pos + 2] | (data[pos + 3] << 8)
+        end = pos + 4 + length + 2
+        if end > len(data):
+            break
+        count += 1
+        pos = data.find(BINARY_SYNC, end)
+    return count
+
+
+def measure(port, fmt, seconds):
+    command(port, "format %s" % fmt)
+    port.reset_input_buffer()
+
+    data = b""
+    start = time.monotonic()
+    while time.monotonic() - start < seconds:
+        data += port.read(port.in_waiting or 1)
+    elapsed = time.monotonic() - start
+
+    if fmt == "binary":
+        reports = count_binary_reports(data)
+    else:
+        reports = count_text_reports(data, fmt)
+
+    return reports / elapsed, len(data) / elapsed
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Profiler link benchmark")
+    parser.add_argument("port")
+    parser.add_argument("--rate", type=int, default=10, help="sample period in ms")
+    parser.add_argument("--every", type=int, default=1, help="samples per report")
+    parser.add_argument("--seconds", type=float, default=10.0)
+    parser.add_argument("--no-negotiate", action="store_true")
+    args = parser.parse_args()
+
+    port = serial.Serial(args.port, DEFAULT_BAUD, timeout=0.05)
+
+    baud = DEFAULT_BAUD if args.no_negotiate else negotiate(port)
+    print("link: %d baud" % baud)
+
+    command(port, "verbose 0")
+    command(port, "rate %d" % args.rate)
+    command(port, "every %d" % args.every)
+
+    print("%-8s %10s %10s %8s" % ("format", "reports/s", "bytes/s", "util%"))
+    for fmt in FORMATS:
+        reports_per_sec, bytes_per_sec = measure(port, fmt, args.seconds)
+        print("%-8s %10.1f %10.0f %8.1f" % (fmt, reports_per_sec, bytes_per_sec,
+                                             100.0 * bytes_per_sec * 10 / baud))
+
+    command(port, "format pretty")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,313 @@
+#!/usr/bin/env python3
+"""
+STM32 System Profiler - link stand-in
+
+Plays the board's side of the UART link on a pseudo-terminal, so that
+link_bench.py (or any other host tool) runs without a board. It prints the
+pty path, answers the commands link_bench.py sends (verbose, rate, every,
+format, pause, resume, baud, ping) the way command_channel.c does, and
+streams reports at the configured sample period x every.
+
+Reports are replayed from a capture of real device output (any mix of
+pretty, compact and binary, e.g. from miniterm or qemu_soak.py). A format
+missing from the capture is synthesised from report_schema.h with every
+scalar field at zero. Output is paced to the wire time of the current
+baud rate (10 bits per byte); a report that would queue behind a whole
+unsent report is dropped, as ReportTask drops it when it falls behind.
+
+Usage:
+    python3 link_replay.py capture.log
+    python3 link_bench.py /dev/pts/5 --seconds 5        # path printed above
+
+    python3 link_replay.py --max-baud 460800            # adapter limit
+    python3 link_replay.py capture.log --no-pace        # pty speed only
+
+--max-baud makes faster rates garble the link: the device replies OK, then
+ignores commands until it reverts after the 2 s confirmation timeout, as
+negotiate() in link_bench.py expects. Only the Python standard library is
+needed.
+"""
+
+import argparse
+import json
+import os
+import pty
+import re
+import select
+import struct
+import sys
+import time
+import tty
+
+from report_decode import DEFAULT_SCHEMA, SYNC, HEADER_LEN, Schema, fletcher16
+
+DEFAULT_BAUD = 115200
+SUPPORTED_BAUDS = [115200, 230400, 460800, 921600, 1000000, 2000000]  # uart_transport.c
+CONFIRM_TIMEOUT_S = 2.0                 # TRANSPORT_CONFIRM_TIMEOUT_MS
+MIN_SAMPLE_MS = 10                      # PROFILER_MIN_SAMPLE_MS
+MAX_SAMPLE_MS = 10000                   # PROFILER_MAX_SAMPLE_MS
+FORMATS = ["pretty", "compact", "binary"]
+
+PRETTY = re.compile(rb"\{\r\n.*?\r\n\}", re.S)
+COMPACT = re.compile(rb"^\{[^\r\n]*\}$", re.M)
+
+
+def split_capture(data):
+    """Report records of each format found in a capture."""
+    records = {fmt: [] for fmt in FORMATS}
+
+    records["pretty"] = [match.group(0) for match in PRETTY.finditer(data)]
+    for match in COMPACT.finditer(data.replace(b"\r\n", b"\n")):
+        try:
+            record = json.loads(match.group(0))
+        except ValueError:
+            continue
+        if isinstance(record, dict) and "test_metrics" not in record:
+            records["compact"].append(match.group(0))
+
+    pos = data.find(SYNC)
+    while 0 <= pos and pos + 4 <= len(data):
+        length, = struct.unpack_from("<H", data, pos + 2)
+        end = pos + 4 + length
+        if length >= HEADER_LEN and end + 2 <= len(data) and \
+                fletcher16(data[pos + 4:end]) == (data[end], data[end + 1]):
+            records["binary"].append(data[pos:end + 2])
+            pos = data.find(SYNC, end + 2)
+        else:
+            pos = data.find(SYNC, pos + 1)
+
+    return records
+
+
+ZERO = {"U8": b"\0", "PCT0": b"\0", "QTYPE": b"\0", "STR": b"\0", "PSTR": b"\0",
+        "U16": b"\0" * 2, "PCT1": b"\0" * 2, "PCT2": b"\0" * 2, "TEMP": b"\0" * 2,
+        "U64": b"\0" * 8}
+
+
+def zero_rows(schema, table, keys):
+    """Payload bytes and JSON record of a table with every field at zero."""
+    payload = b""
+    record = {}
+
+    for row in schema.tables[table]:
+        kind = row["kind"]
+        if kind == "F":
+            payload += ZERO.get(row["enc"], b"\0" * 4)
+            value = "" if row["enc"] in ("STR", "PSTR") else 0
+        elif kind in ("O", "C"):
+            nested, value = zero_rows(schema, row["table"], keys)
+            payload += nested
+            if kind == "C":
+                continue            # condition member is zero
+        else:
+            payload += b"\0"       # A, L and M rows: no entries
+            value = {} if kind == "M" else []
+        record[row[keys]] = value
+
+    return payload, record
+
+
+def synthesise(schema, fmt):
+    """One report with every field of report_schema.h present and zero."""
+    if fmt == "binary":
+        body, _ = zero_rows(schema, "REPORT", "pretty")
+        mask = sum(bit for name, bit in schema.bits.items() if name.startswith("REPORT_FIELD_"))
+        item_mask = sum(bit for name, bit in schema.bits.items() if name.startswith("TASK_FIELD_"))
+        payload = struct.pack("<BIB", schema.version or 0, mask, item_mask & 0xFF) + body
+        return SYNC + struct.pack("<H", len(payload)) + payload + bytes(fletcher16(payload))
+
+    _, record = zero_rows(schema, "REPORT", fmt)
+    if fmt == "pretty":
+        return json.dumps(record, indent=2).replace("\n", "\r\n").encode()
+    return json.dumps(record, separators=(",", ":")).encode()
+
+
+class Device:
+    """Command handling and report cadence of the firmware, on one pty."""
+
+    def __init__(self, fd, records, max_baud, pace):
+        self.fd = fd
+        self.records = records
+        self.max_baud = max_baud
+        self.pace = pace
+        self.baud = DEFAULT_BAUD
+        self.garbled_until = 0.0
+        self.previous_baud = DEFAULT_BAUD
+        self.rate_ms = 100
+        self.every = 10
+        self.fmt = "pretty"
+        self.paused = False
+        self.index = {fmt: 0 for fmt in FORMATS}
+        self.line = b""
+        self.out = b""
+        self.wire_free = time.monotonic()
+        self.next_report = time.monotonic()
+        self.sent = self.dropped = 0
+
+    def reply(self, text):
+        self.out += text.encode() + b"\r\n"
+
+    def handle(self, line):
+        words = line.decode("latin-1").split()
+        if not words:
+            return
+        cmd, arg = words[0], (words[1] if len(words) > 1 else None)
+
+        def number(low, high):
+            try:
+                value = int(arg)
+            except (TypeError, ValueError):
+                return None
+            return value if low <= value <= high else None
+
+        if cmd == "ping":
+            self.reply("pong")
+            return
+        if cmd == "rate":
+            value = number(MIN_SAMPLE_MS, MAX_SAMPLE_MS)
+            if value is None:
+                self.reply("ERR range")
+                return
+            self.rate_ms = value
+        elif cmd == "every":
+            value = number(1, 255)
+            if value is None:
+                self.reply("ERR range")
+                return
+            self.every = value
+        elif cmd == "format" and arg is not None:
+            if arg not in FORMATS:
+                self.reply("ERR format")
+                return
+            self.fmt = arg
+        elif cmd == "baud":
+            value = number(0, 1 << 31)
+            if value not in SUPPORTED_BAUDS:
+                self.reply("ERR baud")
+                return
+            self.reply("OK")
+            self.previous_baud, self.baud = self.baud, value
+            if self.max_baud and value > self.max_baud:
+                self.garbled_until = time.monotonic() + CONFIRM_TIMEOUT_S
+            return
+        elif cmd == "pause":
+            self.paused = True
+        elif cmd == "resume":
+            self.paused = False
+        elif cmd == "verbose" and arg is not None:
+            pass
+        else:
+            self.reply("ERR unknown")
+            return
+        self.reply("OK")
+
+    def receive(self, data):
+        now = time.monotonic()
+        if now < self.garbled_until:
+            return
+        self.line += data
+        while True:
+            ends = [pos for pos in (self.line.find(b"\n"), self.line.find(b"\r")) if pos >= 0]
+            if not ends:
+                break
+            end = min(ends)
+            line, self.line = self.line[:end], self.line[end + 1:]
+            self.handle(line)
+
+    def tick(self):
+        now = time.monotonic()
+
+        if self.garbled_until and now >= self.garbled_until:
+            self.garbled_until = 0.0
+            self.baud = self.previous_baud
+
+        period = self.rate_ms * self.every / 1000.0
+        while now >= self.next_report:
+            self.next_report += period
+            if self.paused:
+                continue
+            records = self.records[self.fmt]
+            record = records[self.index[self.fmt] % len(records)]
+            self.index[self.fmt] += 1
+            if self.fmt != "binary":
+                record += b"\r\n"
+            if len(self.out) > len(record):
+                self.dropped += 1
+                continue
+            self.out += record
+            self.sent += 1
+        if self.next_report < now - period:
+            self.next_report = now + period
+
+    def flush(self):
+        """Write what the wire could have carried by now."""
+        now = time.monotonic()
+        if not self.out:
+            self.wire_free = max(self.wire_free, now)
+            return
+        if self.pace:
+            budget = int((now - self.wire_free) * self.baud / 10)
+            if budget <= 0:
+                return
+            chunk = self.out[:budget]
+        else:
+            chunk = self.out
+        try:
+            written = os.write(self.fd, chunk)
+        except BlockingIOError:
+            return
+        self.out = self.out[written:]
+        if self.pace:
+            self.wire_free = max(self.wire_free, now - 0.01) + written * 10.0 / self.baud
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Board stand-in on a pty")
+    parser.add_argument("capture", nargs="?", help="captured device output to replay")
+    parser.add_argument("--max-baud", type=int, default=0,
+                        help="fastest rate the simulated adapter carries (default: all)")
+    parser.add_argument("--no-pace", action="store_true",
+                        help="write as fast as the pty takes it")
+    parser.add_argument("--schema", default=DEFAULT_SCHEMA,
+                        help="report_schema.h for formats missing from the capture")
+    args = parser.parse_args()
+
+    records = {fmt: [] for fmt in FORMATS}
+    if args.capture:
+        with open(args.capture, "rb") as handle:
+            records = split_capture(handle.read())
+
+    schema = None
+    for fmt in FORMATS:
+        note = ""
+        if not records[fmt]:
+            schema = schema or Schema(args.schema)
+            records[fmt] = [synthesise(schema, fmt)]
+            note = " (synthesised)"
+        print("%-8s %d report(s)%s" % (fmt, len(records[fmt]), note))
+
+    master, slave = pty.openpty()
+    tty.setraw(slave)
+    os.set_blocking(master, False)
+    print("link stand-in on %s (Ctrl-C to stop)" % os.ttyname(slave), flush=True)
+
+    device = Device(master, records, args.max_baud, not args.no_pace)
+    try:
+        while True:
+            readable, _, _ = select.select([master], [], [], 0.002)
+            if readable:
+                try:
+                    device.receive(os.read(master, 4096))
+                except OSError:
+                    pass
+            device.tick()
+            device.flush()
+    except KeyboardInterrupt:
+        pass
+
+    print("%d report(s) sent, %d dropped" % (device.sent, device.dropped))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""
+STM32 System Profiler - deferred log decoder
+
+Expands the '#lg/#lgs/#lgd' records written by the firmware log channel
+(a captured log file, or '-' for stdin) back into text. Each record holds
+the flash address of its printf-style format string; the string is read
+from the loadable sections of the ELF the firmware was built from. All
+other lines (JSON reports, other streams) pass through unchanged.
+
+Usage:
+    python3 log_decode.py build/stm32_profiler.elf capture.log
+    python3 -m serial.tools.miniterm /dev/ttyACM0 115200 --raw | \\
+        python3 log_decode.py build/stm32_profiler.elf -
+
+Only the Python standard library is needed.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+SHT_PROGBITS = 1
+SHF_ALLOC = 0x2
+
+CONVERSION = re.compile(
+    r"%([-+ #0]*)(\d+|\*)?(?:\.(\d+|\*))?(hh|h|ll|l|j|z|t|L)?([diouxXeEfFgGcsp%])")
+
+
+class Elf:
+    """Loadable sections of a little-endian ELF32 image."""
+
+    def __init__(self, path):
+        with open(path, "rb") as handle:
+            self.data = handle.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1 or self.data[5] != 1:
+            raise ValueError("%s: not a little-endian ELF32 file" % path)
+
+        shoff, = struct.unpack_from("<I", self.data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2E)
+        self.sections = []
+        for index in range(shnum):
+            (_, sh_type, flags, addr, offset, size) = struct.unpack_from(
+                "<IIIIII", self.data, shoff + index * shentsize)
+            if sh_type == SHT_PROGBITS and flags & SHF_ALLOC and size:
+                self.sections.append((addr, offset, size))
+
+    def string_at(self, address):
+        for addr, offset, size in self.sections:
+            if addr <= address < addr + size:
+                start = offset + address - addr
+                end = self.data.find(b"\0", start, offset + size)
+                if end < 0:
+                    end = offset + size
+                return self.data[start:end].decode("utf-8", errors="replace")
+        return None
+
+
+def signed(word):
+    return word - (1 << 32) if word & 0x80000000 else word
+
+
+def expand(fmt, args, text):
+    """printf() over 32-bit argument words; text is the %s payload, if any."""
+    args = list(args)
+    out = []
+    position = 0
+
+    for match in CONVERSION.finditer(fmt):
+        out.append(fmt[position:match.start()])
+        position = match.end()
+        flags, width, precision, _, conv = match.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        if width == "*":
+            width = str(signed(args.pop(0)) if args else 0)
+        if precision == "*":
+            precision = str(signed(args.pop(0)) if args else 0)
+        spec = "%" + flags + (width or "") + ("." + precision if precision else "")
+
+        if conv == "s":
+            value = text if text is not None else "<?>"
+            out.append((spec + "s") % value)
+            text = None
+            continue
+        if not args:
+            out.append(match.group(0))
+            continue
+        word = args.pop(0)
+        if conv in "di":
+            out.append((spec + "d") % signed(word))
+        elif conv in "ouxX":
+            out.append((spec + conv) % word)
+        elif conv == "c":
+            out.append((spec + "c") % chr(word & 0xFF))
+        elif conv == "p":
+            out.append("0x%08x" % word)
+        else:
+            # Floats travel as IEEE-754 single precision bits (Log_F32)
+            value, = struct.unpack("<f", struct.pack("<I", word))
+            out.append((spec + conv) % value)
+
+    out.append(fmt[position:])
+    return "".join(out)
+
+
+def decode(stream, elf, show_ticks):
+    unknown = 0
+
+    for raw in stream:
+        line = raw.rstrip("\r\n")
+        fields = line.split()
+        if not fields or fields[0] not in ("#lg", "#lgs", "#lgd"):
+            print(line)
+            continue
+
+        if fields[0] == "#lgd":
+            print("[log] %s record(s) dropped so far (ring full)" % fields[1])
+            continue
+
+        try:
+            tick = int(fields[1])
+            fmt = elf.string_at(int(fields[2], 16))
+            if fields[0] == "#lgs":
+                payload = bytes.fromhex("".join(fields[3:]))
+                text = payload.split(b"\0", 1)[0].decode("utf-8", errors="replace")
+                args = []
+            else:
+                text = None
+                args = [int(field, 16) for field in fields[3:]]
+        except (IndexError, ValueError):
+            print(line)
+            continue
+
+        if fmt is None:
+            unknown += 1
+            message = "<unknown format %s> %s" % (fields[2], " ".join(fields[3:]))
+        else:
+            message = expand(fmt, args, text).strip("\r\n")
+
+        if show_ticks:
+            print("[%6d.%03d] %s" % (tick // 1000, tick % 1000, message))
+        else:
+            print(message)
+
+    return unknown
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode deferred log records")
+    parser.add_argument("elf")
+    parser.add_argument("capture", help="captured serial log, '-' for stdin")
+    parser.add_argument("--no-ticks", action="store_true",
+                        help="omit the [seconds.ms] tick prefix")
+    args = parser.parse_args()
+
+    elf = Elf(args.elf)
+
+    if args.capture == "-":
+        unknown = decode(sys.stdin, elf, not args.no_ticks)
+    else:
+        with open(args.capture, errors="replace") as stream:
+            unknown = decode(stream, elf, not args.no_ticks)
+
+    if unknown:
+        print("%d record(s) did not match a string in %s - stale ELF?" % (unknown, args.elf),
+              file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
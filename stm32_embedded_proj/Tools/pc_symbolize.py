@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+STM32 System Profiler - PC sample symbolizer
+
+Reads the '#pcs/#pc/#pce' stream written by the firmware PC sampler (a
+captured log file, or '-' for stdin), resolves addresses against the ELF
+symbol table and prints either a flat profile or folded stacks for
+flamegraph.pl / speedscope.
+
+Usage:
+    python3 pc_symbolize.py build/stm32_profiler.elf capture.log --flat
+    python3 pc_symbolize.py build/stm32_profiler.elf capture.log --folded > out.folded
+    flamegraph.pl out.folded > profile.svg
+
+Symbols are read with arm-none-eabi-nm (override with --nm).
+"""
+
+import argparse
+import bisect
+import collections
+import subprocess
+import sys
+
+
+def load_symbols(elf, nm):
+    """Return sorted (address, name) pairs for text symbols."""
+    output = subprocess.run([nm, "-n", "-C", "--defined-only", elf],
+                            check=True, capture_output=True, text=True).stdout
+    symbols = []
+    for line in output.splitlines():
+        parts = line.split(None, 2)
+        if len(parts) == 3 and parts[1] in "tTwW":
+            # Thumb addresses have bit 0 set in the symbol table only
+            symbols.append((int(parts[0], 16) & ~1, parts[2]))
+    return symbols
+
+
+class Symbolizer:
+    def __init__(self, symbols):
+        self.addresses = [address for address, _ in symbols]
+        self.names = [name for _, name in symbols]
+
+    def __call__(self, address):
+        index = bisect.bisect_right(self.addresses, address & ~1) - 1
+        if index < 0:
+            return "0x%08x" % address
+        return self.names[index]
+
+
+def read_samples(stream):
+    """Accumulate (task, pc, lr) -> count over every window in the capture."""
+    counts = collections.Counter()
+    windows = 0
+    dropped = 0
+    overhead = []
+
+    for raw in stream:
+        line = raw.strip()
+        if line.startswith("#pcs "):
+            fields = line.split()
+            windows += 1
+            dropped += int(fields[4])
+            overhead.append(float(fields[5]))
+        elif line.startswith("#pc "):
+            fields = line.split(None, 4)
+            if len(fields) == 5:
+                counts[(fields[4], int(fields[1], 16), int(fields[2], 16))] += int(fields[3])
+
+    return counts, windows, dropped, overhead
+
+
+def print_flat(counts, symbolize):
+    per_function = collections.Counter()
+    for (task, pc, _), count in counts.items():
+        per_function[(symbolize(pc), task)] += count
+
+    total = sum(per_function.values()) or 1
+    print("%8s %7s  %-16s %s" % ("samples", "pct", "task", "function"))
+    for (function, task), count in per_function.most_common():
+        print("%8d %6.2f%%  %-16s %s" % (count, 100.0 * count / total, task, function))
+
+
+def print_folded(counts, symbolize):
+    stacks = collections.Counter()
+    for (task, pc, lr), count in counts.items():
+        function = symbolize(pc)
+        caller = symbolize(lr)
+        frames = [task.replace(" ", "_")]
+        # LR equal to the sampled function means it was already overwritten
+        if caller != function:
+            frames.append(caller)
+        frames.append(function)
+        stacks[";".join(frames)] += count
+
+    for stack, count in sorted(stacks.items()):
+        print("%s %d" % (stack, count))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Symbolize PC sampler output")
+    parser.add_argument("elf")
+    parser.add_argument("capture", help="captured serial log, '-' for stdin")
+    parser.add_argument("--nm", default="arm-none-eabi-nm")
+    mode = parser.add_mutually_exclusive_group()
+    mode.add_argument("--flat", action="store_true", help="flat profile (default)")
+    mode.add_argument("--folded", action="store_true", help="folded stacks")
+    args = parser.parse_args()
+
+    symbolize = Symbolizer(load_symbols(args.elf, args.nm))
+
+    if args.capture == "-":
+        counts, windows, dropped, overhead = read_samples(sys.stdin)
+    else:
+        with open(args.capture, errors="replace") as stream:
+            counts, windows, dropped, overhead = read_samples(stream)
+
+    if args.folded:
+        print_folded(counts, symbolize)
+    else:
+        print_flat(counts, symbolize)
+        if overhead:
+            print("\n%d windows, %d dropped samples, overhead avg %.2f%% max %.2f%%" %
+                  (windows, dropped, sum(overhead) / len(overhead), max(overhead)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,346 @@
+#!/usr/bin/env python3
+"""
+STM32 System Profiler - simulated soak test
+
+Boots the QEMU image (make QEMU=1) on the netduinoplus2 machine, captures
+the emulated USART2 stream to a file and stops once the firmware's own
+report timestamps reach the requested number of simulated minutes. The
+instruction counter drives virtual time and the idle task sleeps in WFI,
+so QEMU skips idle periods and a simulated day takes far less than a day.
+
+The capture is then checked:
+  json       every report parses; no reboot banner after the first
+  cadence    report timestamps advance by --period-ms (+/- tolerance)
+  overhead   mean runtime share of the profiler's own tasks
+  runtime    per-task runtime shares add up to 100 % in every report
+  heap       least-squares heap_free trend after warm-up, final heap_min
+  metrics    no stack overflows / malloc failures in the test metrics report
+  uptime     test metrics uptime never goes backwards
+
+Usage:
+    python3 qemu_soak.py build/qemu/stm32_profiler.elf --minutes 1440
+    python3 qemu_soak.py --from-capture capture.log      # re-check a capture
+    python3 qemu_soak.py ELF --minutes 60 --summary now.json --baseline prev.json
+    python3 qemu_soak.py build/qemu/wrap/stm32_profiler.elf --tick-start 0xFFFF0000
+
+Report timestamps are 32-bit ticks; they are unwrapped into milliseconds
+since boot, so images built with make WRAP_TEST=1 (tick starting at
+--tick-start, run-time counters wrapping every ~65 s) check the profiler's
+64-bit accounting across many counter wraps.
+
+Either report format (pretty or compact) is accepted, so captures from a
+board (e.g. via miniterm) can be checked with --from-capture as well.
+Only the Python standard library is needed.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import time
+
+BOOT_BANNER = "=== STM32 System Profiler Started ==="
+PROFILER_TASKS = "Profiler,Report,LogDrain"
+
+
+class Capture:
+    """Reassembles JSON objects from the mixed text stream."""
+
+    def __init__(self, tick_start=0):
+        self.tick_start = tick_start
+        self.wraps = 0
+        self.last_raw = None
+        self.reports = []
+        self.metrics = []
+        self.boots = 0
+        self.parse_errors = 0
+        self.pending = []
+        self.depth = 0
+
+    def feed(self, line):
+        text = line.rstrip("\r\n")
+        if BOOT_BANNER in text:
+            self.boots += 1
+
+        if not self.pending:
+            if not text.lstrip().startswith("{"):
+                return
+        self.pending.append(text)
+        self.depth += text.count("{") - text.count("}")
+        if self.depth > 0:
+            return
+
+        blob = "\n".join(self.pending)
+        self.pending = []
+        self.depth = 0
+        try:
+            obj = json.loads(blob)
+        except ValueError:
+            self.parse_errors += 1
+            return
+        self.add(obj)
+
+    def add(self, obj):
+        if "test_metrics" in obj:
+            self.metrics.append(obj["test_metrics"])
+            return
+
+        report = normalize(obj)
+        if report is not None:
+            report["ts"] = self.unwrap(report["ts"])
+            self.reports.append(report)
+
+    def unwrap(self, ts):
+        """32-bit tick timestamp to milliseconds since boot."""
+        if self.last_raw is not None and ts < self.last_raw - 0x80000000:
+            self.wraps += 1
+        self.last_raw = ts
+        return ts + (self.wraps << 32) - self.tick_start
+
+    def last_timestamp(self):
+        return self.reports[-1]["ts"] if self.reports else 0
+
+
+def normalize(obj):
+    """Map pretty or compact report keys onto one shape."""
+    ts = obj.get("timestamp", obj.get("ts"))
+    if ts is None:
+        return None
+
+    tasks = {}
+    for task in obj.get("tasks", []):
+        name = task.get("name", task.get("n"))
+        share = task.get("runtime_pct", task.get("r"))
+        if name is not None and share is not None:
+            tasks[name] = share
+
+    return {
+        "ts": ts,
+        "cpu": obj.get("cpu_load", obj.get("cpu")),
+        "heap": obj.get("heap_free", obj.get("heap")),
+        "heap_min": obj.get("heap_min", obj.get("min")),
+        "tasks": tasks,
+    }
+
+
+def run_qemu(args, capture):
+    cmd = [args.qemu, "-M", args.machine, "-kernel", args.elf,
+           "-display", "none", "-monitor", "none",
+           "-chardev", "stdio,id=usart2,signal=off,logfile=%s" % args.capture,
+           "-serial", "null", "-serial", "chardev:usart2",
+           "-icount", "shift=%d,align=off,sleep=off" % args.icount_shift]
+    target_ms = int(args.minutes * 60000)
+    started = time.monotonic()
+
+    print("qemu: %s" % " ".join(cmd), file=sys.stderr)
+    proc = subprocess.Popen(cmd, stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                            universal_newlines=True, errors="replace")
+    status = "exited"
+    try:
+        for line in proc.stdout:
+            capture.feed(line)
+            if capture.last_timestamp() >= target_ms:
+                status = "done"
+                break
+            if args.timeout and time.monotonic() - started > args.timeout:
+                status = "timeout"
+                break
+    finally:
+        proc.kill()
+        proc.wait()
+
+    elapsed = time.monotonic() - started
+    print("qemu: %s after %.1f s host time, %.1f simulated min" %
+          (status, elapsed, capture.last_timestamp() / 60000.0), file=sys.stderr)
+    return status
+
+
+def slope_per_hour(points):
+    """Least-squares slope of (ms, value) points, in value units per hour."""
+    n = len(points)
+    if n < 2:
+        return 0.0
+    mean_x = sum(x for x, _ in points) / n
+    mean_y = sum(y for _, y in points) / n
+    sxx = sum((x - mean_x) ** 2 for x, _ in points)
+    if sxx == 0:
+        return 0.0
+    sxy = sum((x - mean_x) * (y - mean_y) for x, y in points)
+    return sxy / sxx * 3600000.0
+
+
+def evaluate(capture, args):
+    reports = capture.reports
+    checks = []
+    summary = {"reports": len(reports), "boots": capture.boots,
+               "parse_errors": capture.parse_errors,
+               "simulated_min": round(capture.last_timestamp() / 60000.0, 2)}
+
+    def check(name, passed, detail):
+        checks.append((name, passed, detail))
+
+    check("json", bool(reports) and capture.parse_errors == 0 and capture.boots <= 1,
+          "%d reports, %d unparsable, %d boot(s)" %
+          (len(reports), capture.parse_errors, capture.boots))
+    if not reports:
+        return checks, summary
+
+    # Report cadence
+    deltas = [b["ts"] - a["ts"] for a, b in zip(reports, reports[1:])]
+    tolerance = args.period_ms * args.cadence_tolerance
+    off = [d for d in deltas if abs(d - args.period_ms) > tolerance]
+    summary["period_ms_max"] = max(deltas) if deltas else 0
+    summary["period_ms_min"] = min(deltas) if deltas else 0
+    summary["cadence_misses"] = len(off)
+    check("cadence", not off and all(d > 0 for d in deltas),
+          "%d/%d intervals outside %d +/- %d ms (min %d, max %d)" %
+          (len(off), len(deltas), args.period_ms, tolerance,
+           summary["period_ms_min"], summary["period_ms_max"]))
+
+    # Profiler self-overhead from its own per-task runtime shares
+    names = [n for n in args.overhead_tasks.split(",") if n]
+    shares = [sum(r["tasks"].get(n, 0.0) for n in names) for r in reports if r["tasks"]]
+    loads = [r["cpu"] for r in reports if r["cpu"] is not None]
+    overhead = sum(shares) / len(shares) if shares else None
+    summary["overhead_pct"] = round(overhead, 3) if overhead is not None else None
+    summary["overhead_pct_max"] = round(max(shares), 3) if shares else None
+    summary["cpu_load_pct"] = round(sum(loads) / len(loads), 3) if loads else None
+    if overhead is None:
+        check("overhead", False, "no per-task runtime in the reports")
+    else:
+        check("overhead", overhead <= args.max_overhead,
+              "%.2f%% mean, %.2f%% max (%s), limit %.2f%%" %
+              (overhead, max(shares), "+".join(names), args.max_overhead))
+
+    # Since-boot task shares stay consistent across run-time counter wraps
+    sums = [sum(r["tasks"].values()) for r in reports if r["tasks"]]
+    if sums:
+        bad = [total for total in sums if abs(total - 100.0) > args.runtime_tolerance]
+        summary["runtime_sum_min"] = round(min(sums), 2)
+        summary["runtime_sum_max"] = round(max(sums), 2)
+        check("runtime", not bad,
+              "%d/%d reports with task shares outside 100 +/- %.1f%% (min %.2f, max %.2f)" %
+              (len(bad), len(sums), args.runtime_tolerance, min(sums), max(sums)))
+
+    # Heap trend after warm-up
+    warm = [r for r in reports if r["ts"] >= args.warmup_s * 1000 and r["heap"] is not None]
+    slope = slope_per_hour([(r["ts"], r["heap"]) for r in warm])
+    heap_min = reports[-1]["heap_min"]
+    summary["heap_slope_b_per_h"] = round(slope, 1)
+    summary["heap_min"] = heap_min
+    check("heap", len(warm) >= 2 and slope >= -args.max_heap_leak and (heap_min or 0) > 0,
+          "heap_free trend %+.1f B/h over %d reports (limit -%d B/h), heap_min %s" %
+          (slope, len(warm), args.max_heap_leak, heap_min))
+
+    # Fault counters from the periodic test metrics report
+    if capture.metrics:
+        last = capture.metrics[-1]
+        overflows = last.get("stack_overflows", 0)
+        failures = last.get("malloc_failures", 0)
+        summary["stack_overflows"] = overflows
+        summary["malloc_failures"] = failures
+        check("metrics", overflows == 0 and failures == 0,
+              "%d stack overflow(s), %d malloc failure(s) in %d metrics report(s)" %
+              (overflows, failures, len(capture.metrics)))
+
+        uptimes = [m.get("uptime_s", 0) for m in capture.metrics]
+        back = sum(1 for a, b in zip(uptimes, uptimes[1:]) if b < a)
+        summary["uptime_s"] = uptimes[-1]
+        check("uptime", back == 0,
+              "%d step(s) back in %d metrics report(s), last %d s" %
+              (back, len(uptimes), uptimes[-1]))
+
+    return checks, summary
+
+
+def compare(summary, baseline, args):
+    """Regression checks against a previous --summary file."""
+    checks = []
+    before = baseline.get("overhead_pct")
+    now = summary.get("overhead_pct")
+    if before is not None and now is not None:
+        checks.append(("regress.overhead", now - before <= args.max_regression,
+                       "%.2f%% -> %.2f%% (allowed +%.2f)" % (before, now, args.max_regression)))
+    before = baseline.get("heap_min")
+    now = summary.get("heap_min")
+    if before is not None and now is not None:
+        checks.append(("regress.heap_min", now >= before - args.max_heap_drop,
+                       "%d -> %d B (allowed -%d)" % (before, now, args.max_heap_drop)))
+    return checks
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Simulated soak test on QEMU")
+    parser.add_argument("elf", nargs="?", help="image built with make QEMU=1")
+    parser.add_argument("--minutes", type=float, default=10.0,
+                        help="simulated run time (default 10)")
+    parser.add_argument("--from-capture", metavar="FILE",
+                        help="check an existing capture instead of running QEMU")
+    parser.add_argument("--capture", default="soak_capture.log",
+                        help="file receiving the USART2 stream")
+    parser.add_argument("--qemu", default="qemu-system-arm")
+    parser.add_argument("--machine", default="netduinoplus2")
+    parser.add_argument("--icount-shift", type=int, default=3,
+                        help="virtual ns per instruction = 2^shift (default 3)")
+    parser.add_argument("--tick-start", type=lambda text: int(text, 0), default=0,
+                        help="tick count at boot (0xFFFF0000 for make WRAP_TEST=1)")
+    parser.add_argument("--timeout", type=float, default=0,
+                        help="host seconds before giving up, 0 = none")
+    parser.add_argument("--period-ms", type=int, default=1000,
+                        help="expected report period (default 1000)")
+    parser.add_argument("--cadence-tolerance", type=float, default=0.1,
+                        help="allowed period deviation as a fraction (default 0.1)")
+    parser.add_argument("--overhead-tasks", default=PROFILER_TASKS,
+                        help="tasks counted as profiler overhead (default %s)" % PROFILER_TASKS)
+    parser.add_argument("--max-overhead", type=float, default=5.0,
+                        help="mean profiler overhead limit in percent (default 5)")
+    parser.add_argument("--runtime-tolerance", type=float, default=2.0,
+                        help="allowed deviation of the summed task shares from 100 (default 2)")
+    parser.add_argument("--warmup-s", type=float, default=60.0,
+                        help="reports ignored by the heap trend (default 60 s)")
+    parser.add_argument("--max-heap-leak", type=int, default=64,
+                        help="allowed heap_free decline in bytes/hour (default 64)")
+    parser.add_argument("--summary", metavar="FILE", help="write the results as JSON")
+    parser.add_argument("--baseline", metavar="FILE", help="previous --summary to compare")
+    parser.add_argument("--max-regression", type=float, default=0.5,
+                        help="allowed overhead increase over the baseline, points (default 0.5)")
+    parser.add_argument("--max-heap-drop", type=int, default=256,
+                        help="allowed heap_min decrease over the baseline, bytes (default 256)")
+    args = parser.parse_args()
+
+    capture = Capture(args.tick_start)
+    if args.from_capture:
+        with open(args.from_capture, errors="replace") as stream:
+            for line in stream:
+                capture.feed(line)
+    elif args.elf:
+        if not os.path.exists(args.elf):
+            parser.error("%s not found - build it with 'make QEMU=1'" % args.elf)
+        if run_qemu(args, capture) == "timeout":
+            print("warning: host timeout before %.1f simulated min" % args.minutes,
+                  file=sys.stderr)
+    else:
+        parser.error("an ELF image or --from-capture is required")
+
+    checks, summary = evaluate(capture, args)
+    if args.baseline:
+        with open(args.baseline) as handle:
+            checks += compare(summary, json.load(handle), args)
+
+    for name, passed, detail in checks:
+        print("%-18s %s  %s" % (name, "PASS" if passed else "FAIL", detail))
+    failed = sum(1 for _, passed, _ in checks if not passed)
+    print("%d check(s), %d failed" % (len(checks), failed))
+
+    summary["checks"] = {name: bool(passed) for name, passed, _ in checks}
+    if args.summary:
+        with open(args.summary, "w") as handle:
+            json.dump(summary, handle, indent=2)
+            handle.write("\n")
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,302 @@
+#!/usr/bin/env python3
+"""
+STM32 System Profiler - report decoder
+
+Turns system reports in any of the firmware formats (binary frames from
+"format 2", compact JSON from "format 1", pretty JSON from "format 0") into
+one JSON object per line with one set of keys. A capture may mix formats
+and other streams; anything that is not a report is skipped.
+
+The field list, key names and encodings are read from the same table the
+firmware is built from, Core/Inc/report_schema.h, so a field added there
+is decoded without changes here. Rebuilt firmware with fields compiled out
+(make REPORT_OFF=...) needs no option either: frames carry their masks.
+
+Usage:
+    python3 report_decode.py capture.bin
+    python3 report_decode.py capture.log --keys compact
+    python3 -m serial.tools.miniterm /dev/ttyACM0 115200 --raw | \\
+        python3 report_decode.py -
+
+Only the Python standard library is needed.
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+SYNC = b"\xa5\x5a"
+HEADER_LEN = 6                          # version, u32 field mask, u8 task field mask
+
+# Must match pcTypeNames[] in queue_trace.c
+QUEUE_TYPE_NAMES = ["queue", "mutex", "csem", "bsem", "rmutex"]
+
+DEFAULT_SCHEMA = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                              "..", "Core", "Inc", "report_schema.h")
+
+TABLE = re.compile(r"#define\s+REPORT_SCHEMA_(\w+)\(F, A, O, L, M, C\)")
+ROW = re.compile(r"^\s*([FAOLMC])\((.*)\)\s*\\?\s*$")
+BIT = re.compile(r"#define\s+((?:REPORT|TASK)_FIELD_\w+)\s+\(1UL << (\d+)\)")
+VERSION = re.compile(r"#define\s+REPORT_BINARY_VERSION\s+(\d+)")
+
+# Row columns after the kind letter, see report_schema.h
+COLUMNS = {
+    "F": ("bit", "enc", "member", "pretty", "compact"),
+    "A": ("bit", "enc", "member", "count", "pretty", "compact"),
+    "O": ("bit", "type", "member", "table", "pretty", "compact"),
+    "L": ("bit", "type", "member", "count", "counter", "table", "pretty", "compact"),
+    "M": ("bit", "type", "member", "count", "counter", "table", "pretty", "compact"),
+    "C": ("bit", "when", "table", "pretty", "compact"),
+}
+
+
+class Schema:
+    """Row tables and mask bits of report_schema.h, binary version of json_formatter.h."""
+
+    def __init__(self, path):
+        with open(path) as handle:
+            text = handle.read()
+
+        self.bits = {"REPORT_ITEM": 0}
+        for name, shift in BIT.findall(text):
+            self.bits[name] = 1 << int(shift)
+
+        self.tables = {}
+        current = None
+        for line in text.splitlines():
+            match = TABLE.search(line)
+            if match:
+                current = self.tables.setdefault(match.group(1), [])
+                continue
+            match = ROW.match(line) if current is not None else None
+            if match:
+                current.append(self.parse_row(match.group(1), match.group(2)))
+            elif not line.rstrip().endswith("\\"):
+                current = None
+
+        if "REPORT" not in self.tables:
+            raise ValueError("%s: no REPORT_SCHEMA_REPORT table" % path)
+
+        self.version = None
+        header = os.path.join(os.path.dirname(path), "json_formatter.h")
+        if os.path.exists(header):
+            with open(header) as handle:
+                match = VERSION.search(handle.read())
+            if match:
+                self.version = int(match.group(1))
+
+    def parse_row(self, kind, args):
+        values = [arg.strip() for arg in args.split(",")]
+        if len(values) != len(COLUMNS[kind]):
+            raise ValueError("bad %s row: %s" % (kind, args))
+        row = dict(zip(COLUMNS[kind], values))
+        row["kind"] = kind
+        row["pretty"] = row["pretty"].strip('"')
+        row["compact"] = row["compact"].strip('"')
+        row["bit"] = self.bits.get(row["bit"], 0)
+        return row
+
+
+class Reader:
+    """Little-endian payload cursor."""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, fmt):
+        value, = struct.unpack_from("<" + fmt, self.data, self.pos)
+        self.pos += struct.calcsize(fmt)
+        return value
+
+    def string(self):
+        length = self.take("B")
+        value = self.data[self.pos:self.pos + length].decode("utf-8", errors="replace")
+        self.pos += length
+        return value
+
+
+def read_value(reader, enc):
+    if enc == "U8":
+        return reader.take("B")
+    if enc == "U16":
+        return reader.take("H")
+    if enc == "U32":
+        return reader.take("I")
+    if enc == "I32":
+        return reader.take("i")
+    if enc == "U64":
+        low = reader.take("I")
+        return low | (reader.take("I") << 32)
+    if enc == "PCT0":
+        return reader.take("B")
+    if enc in ("PCT1", "PCT2"):
+        return reader.take("H") / 100.0
+    if enc == "UA":
+        return reader.take("I")
+    if enc == "UAH":
+        return reader.take("I") / 100.0
+    if enc == "TEMP":
+        return reader.take("h") / 10.0
+    if enc == "MHZ":
+        return reader.take("I") // 1000000
+    if enc == "QTYPE":
+        code = reader.take("B")
+        return QUEUE_TYPE_NAMES[code] if code < len(QUEUE_TYPE_NAMES) else "?"
+    if enc in ("STR", "PSTR"):
+        return reader.string()
+    raise ValueError("unknown encoding %s" % enc)
+
+
+def decode_rows(schema, table, reader, mask, item_mask, keys):
+    """One record in table order; C rows are dropped like the JSON formats do."""
+    record = {}
+    members = {}
+
+    for row in schema.tables[table]:
+        if row["bit"] and not mask & row["bit"]:
+            continue
+        kind = row["kind"]
+        if kind == "F":
+            value = read_value(reader, row["enc"])
+            members[row["member"]] = value
+        elif kind == "A":
+            value = [read_value(reader, row["enc"]) for _ in range(reader.take("B"))]
+        elif kind in ("O", "C"):
+            value = decode_rows(schema, row["table"], reader, item_mask, item_mask, keys)
+            if kind == "C" and not members.get(row["when"]):
+                continue
+        elif kind == "L":
+            value = [decode_rows(schema, row["table"], reader, item_mask, item_mask, keys)
+                     for _ in range(reader.take("B"))]
+        else:
+            value = {}
+            name_row, value_row = schema.tables[row["table"]][:2]
+            for _ in range(reader.take("B")):
+                name = read_value(reader, name_row["enc"])
+                value[name] = read_value(reader, value_row["enc"])
+        record[row[keys]] = value
+
+    return record
+
+
+def decode_frame(schema, payload, keys):
+    reader = Reader(payload)
+    version = reader.take("B")
+    if schema.version is not None and version != schema.version:
+        raise ValueError("frame version %d, schema version %d" % (version, schema.version))
+    mask = reader.take("I")
+    item_mask = reader.take("B")
+    report = decode_rows(schema, "REPORT", reader, mask, item_mask, keys)
+    if reader.pos != len(payload):
+        raise ValueError("%d trailing payload bytes" % (len(payload) - reader.pos))
+    return report
+
+
+def fletcher16(data):
+    sum1 = sum2 = 0
+    for byte in data:
+        sum1 = (sum1 + byte) % 255
+        sum2 = (sum2 + sum1) % 255
+    return sum1, sum2
+
+
+def rekey(schema, table, record, keys):
+    """Rename the keys of a JSON record in either style to the chosen style."""
+    rows = {}
+    for row in schema.tables[table]:
+        rows[row["pretty"]] = row
+        rows[row["compact"]] = row
+
+    result = {}
+    for key, value in record.items():
+        row = rows.get(key)
+        if row is None:
+            result[key] = value
+            continue
+        if row["kind"] in ("O", "C") and isinstance(value, dict):
+            value = rekey(schema, row["table"], value, keys)
+        elif row["kind"] == "L" and isinstance(value, list):
+            value = [rekey(schema, row["table"], item, keys) if isinstance(item, dict) else item
+                     for item in value]
+        result[row[keys]] = value
+    return result
+
+
+def is_report(schema, record):
+    known = set()
+    for row in schema.tables["REPORT"]:
+        known.add(row["pretty"])
+        known.add(row["compact"])
+    return isinstance(record, dict) and record and set(record) <= known
+
+
+def decode(data, schema, keys, out):
+    """Scan a capture for binary frames and JSON reports; returns (reports, bad frames)."""
+    text = data.decode("latin-1")
+    decoder = json.JSONDecoder()
+    reports = bad = 0
+    pos = 0
+
+    while pos < len(data):
+        if data.startswith(SYNC, pos) and pos + 4 <= len(data):
+            length, = struct.unpack_from("<H", data, pos + 2)
+            end = pos + 4 + length
+            if length >= HEADER_LEN and end + 2 <= len(data) and \
+                    fletcher16(data[pos + 4:end]) == (data[end], data[end + 1]):
+                try:
+                    record = decode_frame(schema, data[pos + 4:end], keys)
+                except (ValueError, struct.error) as error:
+                    print("frame at offset %d: %s" % (pos, error), file=sys.stderr)
+                    bad += 1
+                else:
+                    out.write(json.dumps(record) + "\n")
+                    reports += 1
+                pos = end + 2
+                continue
+        if data[pos:pos + 1] == b"{":
+            try:
+                record, end = decoder.raw_decode(text, pos)
+            except ValueError:
+                pos += 1
+                continue
+            if is_report(schema, record):
+                out.write(json.dumps(rekey(schema, "REPORT", record, keys)) + "\n")
+                reports += 1
+            pos = end
+            continue
+        pos += 1
+
+    return reports, bad
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode system reports")
+    parser.add_argument("capture", help="captured serial output, '-' for stdin")
+    parser.add_argument("--keys", choices=("pretty", "compact"), default="pretty",
+                        help="key names of the output (default: pretty)")
+    parser.add_argument("--schema", default=DEFAULT_SCHEMA,
+                        help="report_schema.h the firmware was built from")
+    args = parser.parse_args()
+
+    schema = Schema(args.schema)
+
+    if args.capture == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.capture, "rb") as handle:
+            data = handle.read()
+
+    reports, bad = decode(data, schema, args.keys, sys.stdout)
+    if bad:
+        print("%d of %d frame(s) could not be decoded - schema of another build?"
+              % (bad, reports + bad), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
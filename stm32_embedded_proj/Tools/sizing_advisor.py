@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+"""
+STM32 System Profiler - stack/heap/queue sizing header generator
+
+Reads the '#szh/#sz/#szd' reports written by the firmware "sizing" command
+(a captured log file, or '-' for stdin) and writes a header of size defines
+for 'make SIZING=<header>'. A capture may hold several reports, e.g. one per
+test scenario or per board: the largest peak of each define wins.
+
+Usage:
+    python3 sizing_advisor.py capture.log -o Core/Inc/sizing_config.h
+    python3 sizing_advisor.py capture.log --stack-margin 40 --heap-margin 20
+    make SIZING=Core/Inc/sizing_config.h
+
+Margins default to the ones the firmware was built with (first '#szh'
+line). Peaks are only as good as the run: exercise every code path (button
+dump, deep sleep, "load", "sweep", high-rate "dump") before sending "sizing".
+"""
+
+import argparse
+import sys
+
+# Must match sizing_advisor.h
+STACK_MIN_HEADROOM_WORDS = 32
+STACK_ROUND_WORDS = 8
+HEAP_ROUND_BYTES = 64
+STACK_WORD_BYTES = 4
+MIN_UPTIME_S = 60
+
+
+def ceil_div(value, divisor):
+    return -(-value // divisor)
+
+
+def recommend_stack(peak, margin):
+    headroom = max(ceil_div(peak * margin, 100), STACK_MIN_HEADROOM_WORDS)
+    return ceil_div(peak + headroom, STACK_ROUND_WORDS) * STACK_ROUND_WORDS
+
+
+def recommend_queue(peak, margin):
+    return max(peak + ceil_div(peak * margin, 100), 1)
+
+
+def recommend_heap(peak, margin):
+    size = ceil_div(peak + ceil_div(peak * margin, 100), HEAP_ROUND_BYTES) * HEAP_ROUND_BYTES
+    return max(size, HEAP_ROUND_BYTES)
+
+
+def read_reports(stream):
+    """Merge every complete report: largest peak per define, untracked names."""
+    merged = {"mode": None, "margins": None, "uptime": 0, "reports": 0,
+              "stacks": {}, "queues": {}, "heap": None, "untracked": set()}
+    current = None
+
+    for raw in stream:
+        fields = raw.strip().split()
+        if not fields:
+            continue
+        if fields[0] == "#szh" and len(fields) == 6:
+            current = {"mode": fields[1], "margins": tuple(int(f) for f in fields[2:5]),
+                       "uptime": int(fields[5]), "lines": []}
+        elif fields[0] == "#sz" and current is not None:
+            current["lines"].append(fields[1:])
+        elif fields[0] == "#szd" and current is not None:
+            merge(merged, current)
+            current = None
+
+    return merged
+
+
+def merge(merged, report):
+    if merged["mode"] is None:
+        merged["mode"] = report["mode"]
+        merged["margins"] = report["margins"]
+    merged["uptime"] = max(merged["uptime"], report["uptime"])
+    merged["reports"] += 1
+
+    for fields in report["lines"]:
+        kind = fields[0]
+        if kind == "stack" and len(fields) == 6:
+            name, define = fields[1], fields[2]
+            depth, peak = int(fields[3]), int(fields[4])
+            if define == "-":
+                merged["untracked"].add("task " + name)
+                continue
+            entry = merged["stacks"].setdefault(define, {"name": name, "size": depth, "peak": 0})
+            entry["peak"] = max(entry["peak"], peak)
+        elif kind == "queue" and len(fields) == 7:
+            name, define = fields[1], fields[2]
+            item, length, peak = int(fields[3]), int(fields[4]), int(fields[5])
+            if define == "-":
+                merged["untracked"].add("queue " + name)
+                continue
+            entry = merged["queues"].setdefault(define, {"name": name, "item": item,
+                                                         "size": length, "peak": 0})
+            entry["peak"] = max(entry["peak"], peak)
+        elif kind == "heap" and len(fields) == 5:
+            total, peak = int(fields[2]), int(fields[3])
+            if merged["heap"] is None:
+                merged["heap"] = {"define": fields[1], "size": total, "peak": 0}
+            merged["heap"]["peak"] = max(merged["heap"]["peak"], peak)
+
+
+def plan(merged, stack_margin, heap_margin, queue_margin):
+    """Return (define, old, new, comment) rows and the bytes reclaimed."""
+    rows = []
+    stack_saved = 0
+    queue_saved = 0
+
+    for define, entry in merged["stacks"].items():
+        new = recommend_stack(entry["peak"], stack_margin)
+        stack_saved += (entry["size"] - new) * STACK_WORD_BYTES
+        rows.append((define, entry["size"], new, "%s: %d -> %d words, peak %d" %
+                     (entry["name"], entry["size"], new, entry["peak"])))
+
+    for define, entry in merged["queues"].items():
+        new = recommend_queue(entry["peak"], queue_margin)
+        queue_saved += (entry["size"] - new) * entry["item"]
+        rows.append((define, entry["size"], new, "%s: %d -> %d items of %d bytes, peak %d" %
+                     (entry["name"], entry["size"], new, entry["item"], entry["peak"])))
+
+    saved = stack_saved + queue_saved
+    heap = merged["heap"]
+    if heap is not None:
+        # Dynamic builds allocate stacks and queue storage from the heap
+        peak = heap["peak"]
+        if merged["mode"] == "dynamic":
+            peak = max(peak - stack_saved - queue_saved, 0)
+            saved = 0
+        new = recommend_heap(peak, heap_margin)
+        saved += heap["size"] - new
+        rows.append((heap["define"], heap["size"], new, "%d -> %d bytes, peak %d" %
+                     (heap["size"], new, heap["peak"])))
+
+    return rows, saved
+
+
+def write_header(out, rows, merged, margins, source):
+    out.write("/* Generated by Tools/sizing_advisor.py - do not edit\n")
+    out.write(" * Source: %s (%d report%s, longest uptime %d s, %s allocation)\n" %
+              (source, merged["reports"], "" if merged["reports"] == 1 else "s",
+               merged["uptime"], merged["mode"]))
+    out.write(" * Margins: stack %d %%, heap %d %%, queue %d %%\n" % margins)
+    out.write(" */\n\n")
+    out.write("#ifndef __SIZING_CONFIG_H\n#define __SIZING_CONFIG_H\n\n")
+    for define, _, new, comment in rows:
+        out.write("#define %-32s %-6d /* %s */\n" % (define, new, comment))
+    out.write("\n#endif /* __SIZING_CONFIG_H */\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a sizing header from '#sz' reports")
+    parser.add_argument("capture", help="captured serial log, '-' for stdin")
+    parser.add_argument("-o", "--output", help="header to write (default: stdout)")
+    parser.add_argument("--stack-margin", type=int, help="percent over the peak stack use")
+    parser.add_argument("--heap-margin", type=int, help="percent over the peak heap use")
+    parser.add_argument("--queue-margin", type=int, help="percent over the peak queue depth")
+    args = parser.parse_args()
+
+    if args.capture == "-":
+        merged = read_reports(sys.stdin)
+    else:
+        with open(args.capture, errors="replace") as stream:
+            merged = read_reports(stream)
+
+    if merged["reports"] == 0:
+        print("no complete '#szh ... #szd' report in %s" % args.capture, file=sys.stderr)
+        return 1
+
+    margins = (args.stack_margin if args.stack_margin is not None else merged["margins"][0],
+               args.heap_margin if args.heap_margin is not None else merged["margins"][1],
+               args.queue_margin if args.queue_margin is not None else merged["margins"][2])
+    rows, saved = plan(merged, *margins)
+
+    if args.output:
+        with open(args.output, "w") as out:
+            write_header(out, rows, merged, margins, args.capture)
+    else:
+        write_header(sys.stdout, rows, merged, margins, args.capture)
+
+    for define, old, new, _ in rows:
+        if new > old:
+            print("warning: %s grows from %d to %d" % (define, old, new), file=sys.stderr)
+    if merged["uptime"] < MIN_UPTIME_S:
+        print("warning: longest run was %d s; peaks may be incomplete" % merged["uptime"],
+              file=sys.stderr)
+    for name in sorted(merged["untracked"]):
+        print("note: %s has no size define, left as is" % name, file=sys.stderr)
+    print("RAM reclaimed: %d bytes" % saved, file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())